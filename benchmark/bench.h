@@ -0,0 +1,126 @@
+//------------------------------------------------------------------------------
+// Timing of small kernels: each sample calls the kernel often enough to take
+// at least min_time seconds, and the median, minimum and standard deviation of
+// the time per call over the samples are reported.
+//------------------------------------------------------------------------------
+#ifndef __BENCH_H__
+#define __BENCH_H__
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <string>
+#include <vector>
+
+namespace Bench
+{
+   // single: same state in every call, latency of a kernel with hot data
+   // batch : loop over n distinct random states, throughput of a face loop
+   enum class Mode {single, batch};
+
+   struct Options
+   {
+      unsigned int n_states = 4096;
+      unsigned int n_samples = 15;
+      double       min_time = 0.01;
+   };
+
+   struct Stats
+   {
+      double median = 0.0;  // ns per call and state
+      double min = 0.0;
+      double stddev = 0.0;
+      unsigned long calls = 0; // per sample
+   };
+
+   // Prevents the compiler from removing the kernels
+   inline double sink = 0.0;
+
+   //---------------------------------------------------------------------------
+   // kernel(i) processes state i and returns some entry of its result. Batch
+   // kernels of given width process states i,...,i+width-1, or up to the last
+   // state; times are per state.
+   //---------------------------------------------------------------------------
+   template <typename Kernel>
+   Stats
+   measure(Kernel&            kernel,
+           const Mode         mode,
+           const Options&     opt,
+           const unsigned int width = 1)
+   {
+      using clock = std::chrono::steady_clock;
+      const unsigned int n = opt.n_states;
+      double acc = 0.0;
+
+      auto run = [&](const unsigned long n_calls)
+      {
+         const auto t0 = clock::now();
+         if(mode == Mode::single)
+            for(unsigned long k = 0; k < n_calls; k += width)
+               acc += kernel(0);
+         else
+            for(unsigned long k = 0; k < n_calls; k += n)
+               for(unsigned int i = 0; i < n; i += width)
+                  acc += kernel(i);
+         const auto t1 = clock::now();
+         return std::chrono::duration<double>(t1 - t0).count();
+      };
+
+      // Calibrate number of calls per sample, which also warms up
+      unsigned long n_calls = n;
+      double time = run(n_calls);
+      while(time < opt.min_time)
+      {
+         n_calls *= (time > 0.0) ? std::clamp(1.2 * opt.min_time / time, 2.0, 100.0)
+                                 : 100.0;
+         n_calls = ((n_calls + n - 1) / n) * n;
+         time = run(n_calls);
+      }
+
+      std::vector<double> ns(opt.n_samples);
+      for(auto& t : ns)
+         t = run(n_calls) / n_calls * 1.0e9;
+      sink += acc;
+
+      Stats s;
+      s.calls = n_calls;
+      s.min = *std::min_element(ns.begin(), ns.end());
+      double mean = 0.0;
+      for(const auto t : ns) mean += t;
+      mean /= ns.size();
+      for(const auto t : ns) s.stddev += (t - mean) * (t - mean);
+      s.stddev = std::sqrt(s.stddev / std::max<std::size_t>(ns.size() - 1, 1));
+      std::sort(ns.begin(), ns.end());
+      const std::size_t m = ns.size() / 2;
+      s.median = (ns.size() % 2) ? ns[m] : 0.5 * (ns[m - 1] + ns[m]);
+      return s;
+   }
+
+   //---------------------------------------------------------------------------
+   // Kernels are registered by name; they own the data of their n states
+   //---------------------------------------------------------------------------
+   struct Entry
+   {
+      std::string name;
+      std::function<Stats(Mode, const Options&)> run;
+   };
+
+   inline std::vector<Entry>& registry()
+   {
+      static std::vector<Entry> entries;
+      return entries;
+   }
+
+   template <typename Kernel>
+   void add(const std::string& name, Kernel kernel, const unsigned int width = 1)
+   {
+      registry().push_back({name, [kernel, width](const Mode mode,
+                                                  const Options& opt) mutable
+                            {
+                               return measure(kernel, mode, opt, width);
+                            }});
+   }
+}
+
+#endif
@@ -0,0 +1,625 @@
+//------------------------------------------------------------------------------
+// Microbenchmarks of flux functions, characteristic transforms and limiter
+// primitives on random physical states, without running a solver. See
+// README.md for usage.
+//------------------------------------------------------------------------------
+#include <deal.II/base/ndarray.h>
+#include <deal.II/base/point.h>
+#include <deal.II/base/tensor.h>
+#include <deal.II/lac/vector.h>
+#include <deal.II/lac/full_matrix.h>
+#include <deal.II/numerics/data_postprocessor.h>
+
+#include <array>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <string>
+
+#include "bench.h"
+#include "../dg2d/common/limiter.h"
+#include "../dg2d/common/eos.h"
+
+using namespace dealii;
+
+// Each pde.h defines nvar and namespace PDE, so every model gets its own
+// namespace. The model data which problem files normally set is given here.
+// The Euler models share EOS, which is included above.
+namespace Euler2d
+{
+   namespace ProblemData { extern const double gamma = 1.4; }
+#include "../dg2d/models/euler/pde.h"
+}
+
+namespace Euler1d
+{
+   namespace Problem { double gamma = 1.4; }
+#include "../dg1d/system_legendre/euler/pde.h"
+}
+
+namespace Shallow1d
+{
+   namespace Problem { double g = 9.81; }
+#include "../dg1d/system_legendre/shallow/pde.h"
+}
+
+namespace Acoustics1d
+{
+   namespace Problem { double rho = 1.0, bulk = 1.0; }
+#include "../dg1d/system_legendre/acoustics/pde.h"
+}
+
+// Legacy C code in dg1d/c/euler/src, gamma = 1.4
+namespace Legacy
+{
+   extern "C"
+   {
+      extern int NVAR;
+      void   LFFlux(double* Ul, double* Ur, double* flux);
+      void   ECUSPFlux(double* Ul, double* Ur, double* flux);
+      void   HLLCFlux(double* Ul, double* Ur, double* flux);
+      void   AUSMDVFlux(double* Ul, double* Ur, double* flux);
+      void   EigMat(double* U, double R[][3], double Ri[][3]);
+      double minmod(double a, double b, double c);
+   }
+}
+
+const double gamma_gas = 1.4;
+
+//------------------------------------------------------------------------------
+// Random left/right primitive states: density and pressure are log-uniform in
+// [0.1,10], Mach number in [-2,2] so that supersonic states in both directions
+// occur, and the right state differs from the left by a relative jump.
+//------------------------------------------------------------------------------
+struct Primitive
+{
+   double rho, u, v, pre;
+};
+
+std::vector<std::array<Primitive, 2>>
+make_states(const unsigned int n, const double jump, const unsigned int seed)
+{
+   std::mt19937 rng(seed);
+   std::uniform_real_distribution<double> uni(-1.0, 1.0);
+   auto log_uniform = [&]() { return std::pow(10.0, uni(rng)); };
+
+   std::vector<std::array<Primitive, 2>> states(n);
+   for(auto& s : states)
+   {
+      Primitive& l = s[0];
+      l.rho = log_uniform();
+      l.pre = log_uniform();
+      const double c = std::sqrt(gamma_gas * l.pre / l.rho);
+      const double mach = 2.0 * uni(rng);
+      const double theta = M_PI * uni(rng);
+      l.u = mach * c * std::cos(theta);
+      l.v = mach * c * std::sin(theta);
+
+      Primitive& r = s[1];
+      r.rho = l.rho * (1.0 + jump * uni(rng));
+      r.pre = l.pre * (1.0 + jump * uni(rng));
+      r.u = l.u + jump * c * uni(rng);
+      r.v = l.v + jump * c * uni(rng);
+   }
+   return states;
+}
+
+// Conserved variables in 1d (v = 0) and 2d
+void prim2con(const Primitive& q, double* u, const unsigned int dim)
+{
+   u[0] = q.rho;
+   u[1] = q.rho * q.u;
+   if(dim == 2) u[2] = q.rho * q.v;
+   u[dim + 1] = q.pre / (gamma_gas - 1.0) +
+                0.5 * q.rho * (q.u * q.u + (dim == 2 ? q.v * q.v : 0.0));
+}
+
+//------------------------------------------------------------------------------
+// Kernel of euler2d timed with another equation of state than the ideal gas
+//------------------------------------------------------------------------------
+template <typename Kernel>
+void
+add_with_eos(const std::string& name, const EOS::Model& eos, Kernel kernel)
+{
+   Bench::registry().push_back({name, [eos, kernel](const Bench::Mode mode,
+                                                    const Bench::Options& opt)
+                                mutable
+                                {
+                                   const EOS::Model ideal = Euler2d::PDE::eos;
+                                   Euler2d::PDE::eos = eos;
+                                   const auto s = Bench::measure(kernel, mode,
+                                                                 opt);
+                                   Euler2d::PDE::eos = ideal;
+                                   return s;
+                                }});
+}
+
+//------------------------------------------------------------------------------
+// Register all kernels; data is shared by the kernels of one model
+//------------------------------------------------------------------------------
+void
+register_kernels(const std::vector<std::array<Primitive, 2>>& states,
+                 const unsigned int                           table_nodes)
+{
+   const unsigned int n = states.size();
+
+   // Equations of state besides the ideal gas. The table is of the ideal gas,
+   // which it reproduces exactly, on a range which contains all states; the
+   // stiffened gas has a small p_inf so that all states are admissible.
+   EOS::Model stiffened, table;
+   stiffened.set_stiffened(gamma_gas, 0.05);
+   {
+      EOS::Grid grid;
+      grid.n_rho = grid.n_e = table_nodes;
+      grid.rho_min = 0.05;
+      grid.rho_max = 12.0;
+      grid.e_min = 0.01;
+      grid.e_max = 320.0;
+      auto t = std::make_shared<EOS::Table>();
+      t->build(grid, [](const double rho, const double e)
+               { return (gamma_gas - 1.0) * rho * e; }, MPI_COMM_SELF);
+      table.set_table(t);
+   }
+
+   //---------------------------------------------------------------------------
+   // 2d Euler, normal is random
+   //---------------------------------------------------------------------------
+   {
+      using namespace Euler2d;
+      struct Data
+      {
+         std::vector<Vector<double>> ul, ur;
+         std::vector<Tensor<1,2>>    normal;
+         Vector<double>              flux, w1, w2, w3, w4, w5, w6;
+         FullMatrix<double>          Rx, Lx, Ry, Ly;
+         Data()
+            :
+            flux(nvar), w1(nvar), w2(nvar), w3(nvar), w4(nvar), w5(nvar),
+            w6(nvar), Rx(nvar), Lx(nvar), Ry(nvar), Ly(nvar)
+         {}
+      };
+      auto d = std::make_shared<Data>();
+      d->ul.assign(n, Vector<double>(nvar));
+      d->ur.assign(n, Vector<double>(nvar));
+      d->normal.resize(n);
+      std::mt19937 rng(n);
+      std::uniform_real_distribution<double> uni(-M_PI, M_PI);
+      for(unsigned int i = 0; i < n; ++i)
+      {
+         prim2con(states[i][0], d->ul[i].begin(), 2);
+         prim2con(states[i][1], d->ur[i].begin(), 2);
+         const double theta = uni(rng);
+         d->normal[i] = Point<2>(std::cos(theta), std::sin(theta));
+      }
+
+      Bench::add("euler2d/rusanov_flux", [d](const unsigned int i)
+      {
+         const FluxData<2> data{Point<2>(), 0.0, &d->ul[i], &d->ur[i]};
+         PDE::rusanov_flux<2>(d->ul[i], d->ur[i], d->normal[i], data, d->flux);
+         return d->flux[0];
+      });
+      Bench::add("euler2d/steger_warming_flux", [d](const unsigned int i)
+      {
+         PDE::steger_warming_flux<2>(d->ul[i], d->ur[i], d->normal[i], d->flux);
+         return d->flux[0];
+      });
+      Bench::add("euler2d/char_mat", [d](const unsigned int i)
+      {
+         const Point<2> ex(1.0, 0.0), ey(0.0, 1.0);
+         PDE::char_mat(d->ul[i], Point<2>(), ex, ey, d->Rx, d->Lx, d->Ry, d->Ly);
+         return d->Lx(2,0);
+      });
+      // Characteristic limiting of one cell as in system_legendre_mpi, with
+      // average ul, jump du = ur - ul, slope du/10 and differences to the
+      // neighbours -du,du in x (limited) and du,du in y (not limited)
+      Bench::add("euler2d/char_limit", [d](const unsigned int i)
+      {
+         const Point<2> ex(1.0, 0.0), ey(0.0, 1.0);
+         PDE::char_mat(d->ul[i], Point<2>(), ex, ey, d->Rx, d->Lx, d->Ry, d->Ly);
+         for(unsigned int c = 0; c < nvar; ++c)
+            d->flux[c] = d->ur[i][c] - d->ul[i][c];
+         d->Lx.vmult(d->w1, d->flux);
+         d->Ly.vmult(d->w2, d->flux);
+         for(unsigned int c = 0; c < nvar; ++c)
+         {
+            d->w3[c] = minmod(0.1 * d->w1[c], -d->w1[c], d->w1[c]);
+            d->w4[c] = minmod(0.1 * d->w2[c], d->w2[c], d->w2[c]);
+         }
+         d->Rx.vmult(d->w5, d->w3);
+         d->Ry.vmult(d->w6, d->w4);
+         return d->w5[0] + d->w6[0];
+      });
+
+      // Cost of the equation of state, compare with the ideal gas above
+      auto rusanov = [d](const unsigned int i)
+      {
+         const FluxData<2> data{Point<2>(), 0.0, &d->ul[i], &d->ur[i]};
+         PDE::rusanov_flux<2>(d->ul[i], d->ur[i], d->normal[i], data, d->flux);
+         return d->flux[0];
+      };
+      auto char_mat = [d](const unsigned int i)
+      {
+         const Point<2> ex(1.0, 0.0), ey(0.0, 1.0);
+         PDE::char_mat(d->ul[i], Point<2>(), ex, ey, d->Rx, d->Lx, d->Ry, d->Ly);
+         return d->Lx(2,0);
+      };
+      add_with_eos("euler2d/stiffened/rusanov_flux", stiffened, rusanov);
+      add_with_eos("euler2d/table/rusanov_flux", table, rusanov);
+      add_with_eos("euler2d/table/char_mat", table, char_mat);
+   }
+
+   //---------------------------------------------------------------------------
+   // Equation of state alone: sound speed of one state, or of a batch of 64
+   // states with one call, and the inverse e(rho,p) of the table by Newton
+   //---------------------------------------------------------------------------
+   {
+      struct Data
+      {
+         std::vector<double> rho, rho_e, pre, p, c2; // p, c2 = output
+      };
+      auto d = std::make_shared<Data>();
+      for(const auto& s : states)
+      {
+         d->rho.push_back(s[0].rho);
+         d->rho_e.push_back(s[0].pre / (gamma_gas - 1.0));
+         d->pre.push_back(s[0].pre);
+      }
+      d->p.resize(n);
+      d->c2.resize(n);
+
+      const EOS::Model ideal(gamma_gas);
+      const std::vector<std::pair<std::string, EOS::Model>> models
+         {{"ideal", ideal}, {"stiffened", stiffened}, {"table", table}};
+      const unsigned int width = 64;
+      for(const auto& [name, model] : models)
+      {
+         Bench::add("eos/" + name + "/sound_speed",
+                    [d, m = model](const unsigned int i)
+         {
+            const double pre = m.pressure(d->rho[i], d->rho_e[i]);
+            return m.sound_speed2(d->rho[i], d->rho_e[i], pre);
+         });
+         Bench::add("eos/" + name + "/sound_speed_x64",
+                    [d, m = model, n, width](const unsigned int i)
+         {
+            m.sound_speed2(std::min(width, n - i), &d->rho[i], &d->rho_e[i],
+                           &d->p[i], &d->c2[i]);
+            return d->c2[i];
+         }, width);
+      }
+      Bench::add("eos/table/internal_energy", [d, m = table](const unsigned int i)
+      {
+         return m.internal_energy(d->rho[i], d->pre[i]);
+      });
+   }
+
+   //---------------------------------------------------------------------------
+   // 1d Euler
+   //---------------------------------------------------------------------------
+   {
+      using namespace Euler1d;
+      struct Data
+      {
+         std::vector<Vector<double>> ul, ur;
+         Vector<double>              flux, w1, w2;
+         FullMatrix<double>          R, L;
+         Data() : flux(nvar), w1(nvar), w2(nvar), R(nvar), L(nvar) {}
+      };
+      auto d = std::make_shared<Data>();
+      d->ul.assign(n, Vector<double>(nvar));
+      d->ur.assign(n, Vector<double>(nvar));
+      for(unsigned int i = 0; i < n; ++i)
+      {
+         prim2con(states[i][0], d->ul[i].begin(), 1);
+         prim2con(states[i][1], d->ur[i].begin(), 1);
+      }
+
+      Bench::add("euler1d/rusanov_flux", [d](const unsigned int i)
+      {
+         PDE::rusanov_flux(d->ul[i], d->ur[i], Point<1>(), d->flux);
+         return d->flux[0];
+      });
+      Bench::add("euler1d/char_mat", [d](const unsigned int i)
+      {
+         PDE::char_mat(d->ul[i], Point<1>(), d->R, d->L);
+         return d->L(1,0);
+      });
+      // As euler2d/char_limit in x
+      Bench::add("euler1d/char_limit", [d](const unsigned int i)
+      {
+         PDE::char_mat(d->ul[i], Point<1>(), d->R, d->L);
+         for(unsigned int c = 0; c < nvar; ++c)
+            d->flux[c] = d->ur[i][c] - d->ul[i][c];
+         d->L.vmult(d->w1, d->flux);
+         for(unsigned int c = 0; c < nvar; ++c)
+            d->w1[c] = minmod(0.1 * d->w1[c], -d->w1[c], d->w1[c]);
+         d->R.vmult(d->w2, d->w1);
+         return d->w2[0];
+      });
+   }
+
+   //---------------------------------------------------------------------------
+   // 1d shallow water, depth = density
+   //---------------------------------------------------------------------------
+   {
+      using namespace Shallow1d;
+      struct Data
+      {
+         std::vector<Vector<double>> ul, ur;
+         Vector<double>              flux;
+         FullMatrix<double>          R, L;
+         Data() : flux(nvar), R(nvar), L(nvar) {}
+      };
+      auto d = std::make_shared<Data>();
+      d->ul.assign(n, Vector<double>(nvar));
+      d->ur.assign(n, Vector<double>(nvar));
+      for(unsigned int i = 0; i < n; ++i)
+         for(unsigned int s = 0; s < 2; ++s)
+         {
+            auto& u = (s == 0) ? d->ul[i] : d->ur[i];
+            u[0] = states[i][s].rho;
+            u[1] = states[i][s].rho * states[i][s].u;
+         }
+
+      Bench::add("shallow1d/rusanov_flux", [d](const unsigned int i)
+      {
+         PDE::rusanov_flux(d->ul[i], d->ur[i], Point<1>(), d->flux);
+         return d->flux[0];
+      });
+      Bench::add("shallow1d/char_mat", [d](const unsigned int i)
+      {
+         PDE::char_mat(d->ul[i], Point<1>(), d->R, d->L);
+         return d->L(1,0);
+      });
+   }
+
+   //---------------------------------------------------------------------------
+   // 1d linear acoustics, (pressure, velocity)
+   //---------------------------------------------------------------------------
+   {
+      using namespace Acoustics1d;
+      struct Data
+      {
+         std::vector<Vector<double>> ul, ur;
+         Vector<double>              flux;
+         Data() : flux(nvar) {}
+      };
+      auto d = std::make_shared<Data>();
+      d->ul.assign(n, Vector<double>(nvar));
+      d->ur.assign(n, Vector<double>(nvar));
+      for(unsigned int i = 0; i < n; ++i)
+      {
+         d->ul[i][0] = states[i][0].pre; d->ul[i][1] = states[i][0].u;
+         d->ur[i][0] = states[i][1].pre; d->ur[i][1] = states[i][1].u;
+      }
+
+      Bench::add("acoustics1d/rusanov_flux", [d](const unsigned int i)
+      {
+         PDE::rusanov_flux(d->ul[i], d->ur[i], Point<1>(), d->flux);
+         return d->flux[0];
+      });
+   }
+
+   //---------------------------------------------------------------------------
+   // Legacy C code, contiguous arrays
+   //---------------------------------------------------------------------------
+   {
+      struct Data
+      {
+         std::vector<std::array<double,3>> ul, ur;
+         double flux[3], R[3][3], Ri[3][3];
+      };
+      auto d = std::make_shared<Data>();
+      d->ul.resize(n);
+      d->ur.resize(n);
+      for(unsigned int i = 0; i < n; ++i)
+      {
+         prim2con(states[i][0], d->ul[i].data(), 1);
+         prim2con(states[i][1], d->ur[i].data(), 1);
+      }
+      Legacy::NVAR = 3;
+
+      using Flux = void (*)(double*, double*, double*);
+      const std::vector<std::pair<std::string, Flux>> fluxes
+         {{"LFFlux",     Legacy::LFFlux},
+          {"ECUSPFlux",  Legacy::ECUSPFlux},
+          {"HLLCFlux",   Legacy::HLLCFlux},
+          {"AUSMDVFlux", Legacy::AUSMDVFlux}};
+      for(const auto& [name, flux] : fluxes)
+         Bench::add("legacy/" + name, [d, flux = flux](const unsigned int i)
+         {
+            flux(d->ul[i].data(), d->ur[i].data(), d->flux);
+            return d->flux[0];
+         });
+      Bench::add("legacy/EigMat", [d](const unsigned int i)
+      {
+         Legacy::EigMat(d->ul[i].data(), d->R, d->Ri);
+         return d->Ri[1][0];
+      });
+   }
+
+   //---------------------------------------------------------------------------
+   // minmod of random numbers; with tvb, about a third of the calls return
+   // early
+   //---------------------------------------------------------------------------
+   {
+      auto d = std::make_shared<std::vector<std::array<double,3>>>(n);
+      std::mt19937 rng(n + 1);
+      std::normal_distribution<double> normal;
+      for(auto& abc : *d)
+         for(auto& x : abc)
+            x = normal(rng);
+
+      Bench::add("limiter/minmod", [d](const unsigned int i)
+      {
+         const auto& x = (*d)[i];
+         return minmod(x[0], x[1], x[2]);
+      });
+      Bench::add("limiter/minmod_tvb", [d](const unsigned int i)
+      {
+         const auto& x = (*d)[i];
+         return minmod(x[0], x[1], x[2], 0.43);
+      });
+      Bench::add("legacy/minmod", [d](const unsigned int i)
+      {
+         const auto& x = (*d)[i];
+         return Legacy::minmod(x[0], x[1], x[2]);
+      });
+   }
+}
+
+//------------------------------------------------------------------------------
+// Previous results written with -csv, for the speedup column
+//------------------------------------------------------------------------------
+std::map<std::string, double>
+read_baseline(const std::string& filename)
+{
+   std::map<std::string, double> base;
+   std::ifstream f(filename);
+   AssertThrow(f.good(), ExcMessage("Cannot open " + filename));
+   std::string line;
+   while(std::getline(f, line))
+   {
+      if(line.empty() || line[0] == '#') continue;
+      std::stringstream ss(line);
+      std::string name, mode, median;
+      std::getline(ss, name, ',');
+      std::getline(ss, mode, ',');
+      std::getline(ss, median, ',');
+      if(name == "kernel") continue;
+      base[name + "," + mode] = std::stod(median);
+   }
+   return base;
+}
+
+//------------------------------------------------------------------------------
+void usage()
+{
+   std::cout << "Usage: ./bench [options]\n"
+             << "   -filter str   only kernels whose name contains str\n"
+             << "   -mode m       single, batch or both (default)\n"
+             << "   -n n          number of random states (4096)\n"
+             << "   -samples n    number of timed samples (15)\n"
+             << "   -time t       minimum seconds per sample (0.01)\n"
+             << "   -jump r       relative jump between left and right (0.1)\n"
+             << "   -table n      nodes per direction of EOS table (256)\n"
+             << "   -seed s       random seed (1)\n"
+             << "   -csv file     save results\n"
+             << "   -baseline f   csv file of earlier run, prints speedup\n"
+             << "   -list         list kernels\n";
+}
+
+//------------------------------------------------------------------------------
+int
+main(int argc, char** argv)
+{
+   Bench::Options opt;
+   std::string filter, mode_name = "both", csv_file, baseline_file;
+   double jump = 0.1;
+   unsigned int seed = 1, table_nodes = 256;
+   bool list = false;
+
+   for(int i = 1; i < argc; ++i)
+   {
+      const std::string arg = argv[i];
+      auto value = [&]() -> std::string
+      {
+         AssertThrow(i + 1 < argc, ExcMessage("Missing value of " + arg));
+         return argv[++i];
+      };
+      if(arg == "-filter")        filter = value();
+      else if(arg == "-mode")     mode_name = value();
+      else if(arg == "-n")        opt.n_states = std::stoul(value());
+      else if(arg == "-samples")  opt.n_samples = std::stoul(value());
+      else if(arg == "-time")     opt.min_time = std::stod(value());
+      else if(arg == "-jump")     jump = std::stod(value());
+      else if(arg == "-table")    table_nodes = std::stoul(value());
+      else if(arg == "-seed")     seed = std::stoul(value());
+      else if(arg == "-csv")      csv_file = value();
+      else if(arg == "-baseline") baseline_file = value();
+      else if(arg == "-list")     list = true;
+      else
+      {
+         usage();
+         return (arg == "-h" || arg == "-help") ? 0 : 1;
+      }
+   }
+   AssertThrow(opt.n_states > 0 && opt.n_samples > 0,
+               ExcMessage("Need at least one state and one sample"));
+   AssertThrow(jump >= 0.0 && jump < 1.0,
+               ExcMessage("jump must be in [0,1) to keep states admissible"));
+
+   std::vector<Bench::Mode> modes;
+   if(mode_name == "single" || mode_name == "both")
+      modes.push_back(Bench::Mode::single);
+   if(mode_name == "batch" || mode_name == "both")
+      modes.push_back(Bench::Mode::batch);
+   AssertThrow(!modes.empty(), ExcMessage("Unknown mode " + mode_name));
+
+   const auto states = make_states(opt.n_states, jump, seed);
+   register_kernels(states, table_nodes);
+
+   if(list)
+   {
+      for(const auto& e : Bench::registry())
+         std::cout << e.name << "\n";
+      return 0;
+   }
+
+   const auto baseline = baseline_file.empty()
+                         ? std::map<std::string, double>()
+                         : read_baseline(baseline_file);
+
+   std::ofstream csv;
+   if(!csv_file.empty())
+   {
+      csv.open(csv_file);
+      csv << "kernel,mode,median_ns,min_ns,stddev_ns,mstates_per_s\n";
+   }
+
+   std::cout << "States = " << opt.n_states << ", samples = " << opt.n_samples
+             << ", jump = " << jump << ", seed = " << seed << "\n";
+   std::cout << std::left << std::setw(34) << "kernel"
+             << std::setw(8) << "mode" << std::right
+             << std::setw(11) << "ns/call"
+             << std::setw(10) << "min"
+             << std::setw(8) << "+-%"
+             << std::setw(12) << "Mstates/s";
+   if(!baseline.empty()) std::cout << std::setw(10) << "speedup";
+   std::cout << "\n";
+
+   for(const auto& e : Bench::registry())
+   {
+      if(e.name.find(filter) == std::string::npos) continue;
+      for(const auto mode : modes)
+      {
+         const auto s = e.run(mode, opt);
+         const std::string m = (mode == Bench::Mode::single) ? "single"
+                                                             : "batch";
+         const double rate = 1.0e3 / s.median;
+         std::cout << std::left << std::setw(34) << e.name
+                   << std::setw(8) << m << std::right << std::fixed
+                   << std::setprecision(2)
+                   << std::setw(11) << s.median
+                   << std::setw(10) << s.min
+                   << std::setw(8) << std::setprecision(1)
+                   << 100.0 * s.stddev / s.median
+                   << std::setw(12) << std::setprecision(2) << rate;
+         const auto b = baseline.find(e.name + "," + m);
+         if(b != baseline.end())
+            std::cout << std::setw(10) << b->second / s.median;
+         std::cout << std::defaultfloat << "\n";
+         if(csv.is_open())
+            csv << e.name << "," << m << "," << s.median << "," << s.min
+                << "," << s.stddev << "," << rate << "\n";
+      }
+   }
+
+   // Keeps the results of the kernels alive
+   if(Bench::sink == 0.123456789) std::cout << " ";
+   return 0;
+}
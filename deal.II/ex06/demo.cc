@@ -29,6 +29,8 @@
 #include <fstream>
 #include <iostream>
 
+#include "../../dg2d/common/mesh_cache.h"
+
 
 using namespace dealii;
 
@@ -110,12 +112,15 @@ dof_handler (triangulation)
 template <int dim>
 void LaplaceProblem<dim>::make_grid_and_dofs ()
 {
-   GridIn<dim> grid_in;
-   grid_in.attach_triangulation (triangulation);
-   std::ifstream gfile ("Gamma.msh");
-   AssertThrow(gfile.is_open(), ExcMessage("Grid file not found"));
-   grid_in.read_msh(gfile);
-   triangulation.refine_global (nrefine);
+   // The refined grid is cached in Gamma.msh.<hash>.tria
+   const std::string cache_file =
+      MeshCache::refined_file_name("Gamma.msh", dim, nrefine, "ex06");
+   if(!MeshCache::load_refined(cache_file, triangulation))
+   {
+      MeshCache::read_msh("Gamma.msh", triangulation, true);
+      triangulation.refine_global (nrefine);
+      MeshCache::save_refined(cache_file, triangulation);
+   }
    
    std::cout
    << "   Number of active cells: "
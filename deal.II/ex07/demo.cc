@@ -32,6 +32,8 @@
 #include <fstream>
 #include <iostream>
 
+#include "../../dg2d/common/mesh_cache.h"
+
 
 using namespace dealii;
 
@@ -288,11 +290,8 @@ void LaplaceProblem<dim>::run (std::vector<unsigned int> &ncell,
    {
       if(n==0)
       {
-         GridIn<dim> grid_in;
-         grid_in.attach_triangulation (triangulation);
-         std::ifstream gfile ("Gamma.msh");
-         AssertThrow(gfile.is_open(), ExcMessage("Grid file not found"));
-         grid_in.read_msh(gfile);
+         // Refinement is adaptive, so only the coarse grid is cached
+         MeshCache::read_msh("Gamma.msh", triangulation, true);
       }
       else
          refine_grid ();
@@ -46,6 +46,8 @@
 
 #include <fstream>
 
+#include "../../dg2d/common/mesh_cache.h"
+
 // From the following include file we will import the declaration of
 // H1-conforming finite element shape functions. This family of finite
 // elements is called <code>FE_Q</code>, and was used in all examples before
@@ -536,11 +538,8 @@ void Step6<dim>::run()
         {
           //GridGenerator::hyper_ball(triangulation);
           //triangulation.refine_global(1);
-          GridIn<dim> grid_in;
-          grid_in.attach_triangulation (triangulation);
-          std::ifstream gfile ("circ_disc_nice.msh");
-          AssertThrow(gfile.is_open(), ExcMessage("Grid file not found"));
-          grid_in.read_msh(gfile);
+          // Refinement is adaptive, so only the coarse grid is cached
+          MeshCache::read_msh("circ_disc_nice.msh", triangulation, true);
           triangulation.set_all_manifold_ids(0);
           const Point<dim> mesh_center(0.0, 0.0);
           const double inner_radius = 0.25;
@@ -29,6 +29,8 @@
 #include <fstream>
 #include <iostream>
 
+#include "../../dg2d/common/mesh_cache.h"
+
 
 using namespace dealii;
 
@@ -149,18 +151,26 @@ mapping (mapping_degree)
 template <int dim>
 void LaplaceProblem<dim>::make_grid_and_dofs ()
 {
-   GridIn<dim> grid_in;
-   grid_in.attach_triangulation (triangulation);
-   std::ifstream gfile ("annulus.msh");
-   AssertThrow(gfile.is_open(), ExcMessage("Grid file not found"));
-   grid_in.read_msh(gfile);
+   // The refined grid is cached with its manifold ids, but the manifold
+   // object must be attached again after loading
+   const std::string cache_file =
+      MeshCache::refined_file_name("annulus.msh", dim, nrefine, "ex10");
+   const bool cached = MeshCache::load_refined(cache_file, triangulation);
+   if(!cached)
+   {
+      MeshCache::read_msh("annulus.msh", triangulation, true);
+      triangulation.set_all_manifold_ids_on_boundary(0);
+   }
 
    const Point<dim> center(0.0, 0.0);
    const SphericalManifold<dim> manifold(center);
-   triangulation.set_all_manifold_ids_on_boundary(0);
    triangulation.set_manifold(0, manifold);
 
-   triangulation.refine_global(nrefine);
+   if(!cached)
+   {
+      triangulation.refine_global(nrefine);
+      MeshCache::save_refined(cache_file, triangulation);
+   }
    
    std::cout
    << "   Number of active cells: "
@@ -44,6 +44,9 @@
 #include <deal.II/numerics/data_out.h>
 
 #include <fstream>
+#include <iomanip>
+
+#include "../../dg2d/common/mesh_cache.h"
 
 using namespace dealii;
 
@@ -192,6 +195,16 @@ InitialCondition<dim>::vector_value (const Point<dim> &p,
       values(c) = InitialCondition<dim>::value (p, c);
 }
 
+//------------------------------------------------------------------------------------
+// Resident set size of the process in bytes
+//------------------------------------------------------------------------------------
+std::size_t rss_bytes ()
+{
+   Utilities::System::MemoryStats stats;
+   Utilities::System::get_memory_stats (stats);
+   return 1024 * stats.VmRSS;
+}
+
 //------------------------------------------------------------------------------------
 // Main class of the problem
 //------------------------------------------------------------------------------------
@@ -235,7 +248,9 @@ private:
    void assemble_matrix_and_rhs (unsigned int order);
    void solve ();
    void compute_vorticity ();
+   double boundary_flux (const types::boundary_id id) const;
    void output_results() const;
+   void print_memory (const std::string &when) const;
    
    ParameterHandler           *parameters;
    unsigned int               degree;
@@ -258,6 +273,10 @@ private:
    Vector<double>             vorticity;
    SparseDirectUMFPACK        vorticity_solver;
    
+   // Increase of RSS when the UMFPACK factors are computed
+   std::size_t                umfpack_memory, umfpack_memory_vorticity;
+   std::size_t                rss_start;
+   
    // Parameters
    double                     dt, Uref, Lref, Re, viscosity, final_time;
 };
@@ -275,8 +294,11 @@ NS<dim>::NS (ParameterHandler &prm)
    fe_scalar (FE_Q<dim>(QGaussLobatto<1>(degree+2))),
    dof_handler (triangulation),
    dof_handler_scalar (triangulation),
-   mapping (degree+1)
+   mapping (degree+1),
+   umfpack_memory (0),
+   umfpack_memory_vorticity (0)
 {
+   rss_start = rss_bytes ();
    dt = parameters->get_double("time step");
    Re = parameters->get_double("reynolds no");
    Uref = parameters->get_double("reference velocity");
@@ -285,10 +307,7 @@ NS<dim>::NS (ParameterHandler &prm)
    std::string grid_file = parameters->get("mesh file");
    
    std::cout << "Reading grid from " << grid_file << std::endl;
-   GridIn<dim> grid_in;
-   grid_in.attach_triangulation (triangulation);
-   std::ifstream input_file (grid_file.c_str());
-   grid_in.read_msh (input_file);
+   MeshCache::read_msh (grid_file, triangulation, true);
    
    viscosity = Uref*Lref/Re;
 
@@ -698,10 +717,43 @@ template <int dim>
 void NS<dim>::solve()
 {
    SparseDirectUMFPACK  solver;
+   const std::size_t rss0 = rss_bytes ();
    solver.initialize (system_matrix);
+   const std::size_t rss1 = rss_bytes ();
+   umfpack_memory = std::max (umfpack_memory, rss1 - std::min (rss0, rss1));
    solver.vmult (solution2, system_rhs);
 }
 
+//------------------------------------------------------------------------------------
+// Volume flux u.n of the latest velocity through the boundary with given id,
+// with n the outward normal.
+//------------------------------------------------------------------------------------
+template <int dim>
+double NS<dim>::boundary_flux (const types::boundary_id id) const
+{
+   QGauss<dim-1>     quadrature_formula(degree+2);
+   FEFaceValues<dim> fe_face_values (mapping, fe, quadrature_formula,
+                                     update_values         |
+                                     update_normal_vectors |
+                                     update_JxW_values);
+   const unsigned int n_q_points = quadrature_formula.size();
+   const FEValuesExtractors::Vector velocities (0);
+   std::vector<Tensor<1,dim> > velocity (n_q_points);
+   
+   double flux = 0;
+   for (const auto &cell : dof_handler.active_cell_iterators())
+      for (unsigned int f=0; f<GeometryInfo<dim>::faces_per_cell; ++f)
+         if (cell->face(f)->at_boundary() && cell->face(f)->boundary_id() == id)
+         {
+            fe_face_values.reinit (cell, f);
+            fe_face_values[velocities].get_function_values (solution2, velocity);
+            for (unsigned int q=0; q<n_q_points; ++q)
+               flux += velocity[q] * fe_face_values.normal_vector(q)
+                       * fe_face_values.JxW(q);
+         }
+   return flux;
+}
+
 //------------------------------------------------------------------------------------
 // Compute vorticity by doing an L2 projection. Vorticity space has same degree as
 // velocity space.
@@ -714,7 +766,10 @@ void NS<dim>::compute_vorticity ()
    if(status == 0)
    {
       assemble_mass_matrix ();
+      const std::size_t rss0 = rss_bytes ();
       vorticity_solver.initialize (mass_matrix);
+      const std::size_t rss1 = rss_bytes ();
+      umfpack_memory_vorticity = rss1 - std::min (rss0, rss1);
       status = 1;
    }
    
@@ -904,6 +959,65 @@ void NS<dim>::run_unsteady ()
       }
    }
    
+   // Walls and cylinder have zero velocity, so the discrete solution, which is
+   // divergence free against constant pressure, must have outflow = inflow
+   const double inflow = boundary_flux (1);
+   const double outflow = boundary_flux (4);
+   std::cout << "Inflow flux = " << -inflow << std::endl;
+   std::cout << "Outflow flux = " << outflow << std::endl;
+   std::cout << "Flux imbalance = " << (inflow + outflow) / std::fabs(inflow)
+             << std::endl;
+}
+
+//------------------------------------------------------------------------------------
+// Print memory used by matrices, vectors and mesh. UMFPACK does not report the
+// size of its factors, so the increase of RSS during factorization is used; it
+// is zero until the first solve.
+//------------------------------------------------------------------------------------
+template <int dim>
+void NS<dim>::print_memory (const std::string &when) const
+{
+   const std::vector<std::pair<std::string, std::size_t>> items = {
+      {"triangulation", triangulation.memory_consumption()},
+      {"dof handlers", dof_handler.memory_consumption() +
+                       dof_handler_scalar.memory_consumption()},
+      {"sparsity patterns", sparsity_pattern.memory_consumption() +
+                            sparsity_pattern_scalar.memory_consumption()},
+      {"system matrices", system_matrix_constant.memory_consumption() +
+                          system_matrix.memory_consumption()},
+      {"mass matrix", mass_matrix.memory_consumption()},
+      {"solution vectors", solution0.memory_consumption() +
+                           solution1.memory_consumption() +
+                           solution2.memory_consumption() +
+                           system_rhs.memory_consumption()},
+      {"vorticity", vorticity.memory_consumption()},
+      {"UMFPACK factors, system", umfpack_memory},
+      {"UMFPACK factors, vorticity", umfpack_memory_vorticity}};
+
+   Utilities::System::MemoryStats stats;
+   Utilities::System::get_memory_stats (stats);
+   const double MiB = 1024.0 * 1024.0;
+   const double n_dofs = dof_handler.n_dofs() + dof_handler_scalar.n_dofs();
+
+   std::cout << "Memory " << when << ", MiB" << std::endl;
+   std::size_t total = 0;
+   for(const auto &item : items)
+   {
+      std::cout << "   " << std::left << std::setw(30) << item.first
+                << std::right << std::fixed << std::setprecision(2)
+                << item.second / MiB << std::endl;
+      total += item.second;
+   }
+   std::cout << "   " << std::left << std::setw(30) << "Total of items"
+             << std::right << total / MiB << std::endl
+             << "   " << std::left << std::setw(30) << "RSS at start"
+             << std::right << rss_start / MiB << std::endl
+             << "   " << std::left << std::setw(30) << "Peak RSS"
+             << std::right << 1024.0 * stats.VmHWM / MiB << std::endl
+             << std::defaultfloat;
+   std::cout << "   Bytes per dof = " << total / n_dofs << " (items), "
+             << (1024.0 * stats.VmHWM - rss_start) / n_dofs
+             << " (peak RSS above start)" << std::endl;
 }
 
 //------------------------------------------------------------------------------------
@@ -913,6 +1027,7 @@ template <int dim>
 void NS<dim>::run ()
 {
    make_grid_dofs ();
+   print_memory ("after setup");
 
    if(run_mode == steady)
       run_steady ();
@@ -920,6 +1035,8 @@ void NS<dim>::run ()
       run_unsteady ();
    else
       AssertThrow(false, ExcMessage("Unknown run mode"));
+
+   print_memory ("at end");
 }
 
 //------------------------------------------------------------------------------------
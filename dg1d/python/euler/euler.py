@@ -1,3 +1,4 @@
+import os, sys
 import numpy as np
 import matplotlib.pyplot as plt
 import argparse
@@ -24,6 +25,8 @@ parser.add_argument('-ic', choices=('sod','lax'), help='Initial condition',
 parser.add_argument('-char_lim', type=int, help='Characteristic limiter', 
                     default=0)
 parser.add_argument('-tvbM', type=float, help='TVB M parameter', default=0.0)
+parser.add_argument('-kernel', choices=('python','cpp'),
+                    help='Python or compiled kernels', default='python')
 args = parser.parse_args()
 
 # Select initial condition
@@ -146,11 +149,10 @@ def update_plot(fig,ax,lines0,lines1,lines2,t,rho,mom,ene):
 
 # Allocate solution variables
 rho0 = np.zeros((nc,nd)) # solution at n
-rho1 = np.zeros((nc,nd)) # solution at n+1
 mom0 = np.zeros((nc,nd)) # solution at n
-mom1 = np.zeros((nc,nd)) # solution at n+1
 ene0 = np.zeros((nc,nd)) # solution at n
-ene1 = np.zeros((nc,nd)) # solution at n+1
+U1   = np.zeros((3,nc,nd)) # solution at n+1, compiled kernels use this
+rho1, mom1, ene1 = U1[0], U1[1], U1[2] # views into U1
 resr = np.zeros((nc,nd)) # mass residual
 resm = np.zeros((nc,nd)) # momentum residual
 rese = np.zeros((nc,nd)) # energy residual
@@ -174,7 +176,22 @@ wait = input("Press enter to continue ")
 if args.Tf > 0.0:
     Tf  = args.Tf
 
+if args.kernel == 'cpp':
+    sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                                 '..', 'kernels'))
+    from dgkernels import Kernels
+    kernels = Kernels('euler', 'rusanov', k, nc, xmin, xmax)
+
 it, t = 0, 0.0
+while t < Tf and args.kernel == 'cpp':
+    dt  = cfl*dx/kernels.max_speed(U1)
+    if t+dt > Tf:
+        dt = Tf - t
+    kernels.step(dt, U1, k > 0, Mdx2, args.char_lim)
+    t += dt; it += 1
+    if it%args.plot_freq == 0 or np.abs(Tf-t) < 1.0e-13:
+        update_plot(fig,ax,lines0,lines1,lines2,t,rho1,mom1,ene1)
+
 while t < Tf:
     dt  = cfl*dx/max_speed(rho1,mom1,ene1)
     lam = dt/dx
@@ -0,0 +1,475 @@
+//------------------------------------------------------------------------------
+// Compiled kernels of the 1-D DG codes in ../scalar and ../euler
+//
+// Same scheme as the Python codes: Legendre basis sqrt(2n+1) P_n on [-1,+1],
+// (k+1)-point Gauss quadrature, SSPRK3 and TVD/TVB limiter of the slope.
+// Solution of a system with nvar variables on nc cells is stored as a C ordered
+// array u[nvar][nc][nd], nd = k+1, so that the numpy arrays of the Python codes
+// are passed without copy; for scalar PDE, nvar = 1 and u has shape (nc,nd).
+//
+// Build: make, which gives libdgkernels.so used by dgkernels.py
+//------------------------------------------------------------------------------
+#include <algorithm>
+#include <cmath>
+#include <new>
+#include <vector>
+
+namespace
+{
+   enum PDE {linear = 0, burger = 1, euler = 2};
+   enum Flux {central = 0, upwind = 1, godunov = 2, rusanov = 3};
+   enum BC {periodic = 0, neumann = 1};
+
+   const double gamma_gas = 1.4;
+   const double sqrt3 = std::sqrt(3.0);
+
+   //---------------------------------------------------------------------------
+   // Legendre polynomial and its derivative
+   //---------------------------------------------------------------------------
+   void legendre(const int n, const double x, double& p, double& dp)
+   {
+      double p0 = 1.0, p1 = x, d0 = 0.0, d1 = 1.0;
+      if(n == 0)
+      {
+         p = p0, dp = d0;
+         return;
+      }
+      for(int m = 2; m <= n; ++m)
+      {
+         const double p2 = ((2.0 * m - 1.0) * x * p1 - (m - 1.0) * p0) / m;
+         const double d2 = m * p1 + x * d1;
+         p0 = p1, p1 = p2;
+         d0 = d1, d1 = d2;
+      }
+      p = p1, dp = d1;
+   }
+
+   //---------------------------------------------------------------------------
+   // Gauss-Legendre points and weights by Newton iterations
+   //---------------------------------------------------------------------------
+   void gauss(const int n, std::vector<double>& x, std::vector<double>& w)
+   {
+      x.resize(n);
+      w.resize(n);
+      for(int i = 0; i < n; ++i)
+      {
+         double z = -std::cos(M_PI * (i + 0.75) / (n + 0.5));
+         double p, dp;
+         for(int iter = 0; iter < 100; ++iter)
+         {
+            legendre(n, z, p, dp);
+            const double dz = p / dp;
+            z -= dz;
+            if(std::fabs(dz) < 1.0e-15) break;
+         }
+         legendre(n, z, p, dp);
+         x[i] = z;
+         w[i] = 2.0 / ((1.0 - z * z) * dp * dp);
+      }
+   }
+
+   double minmod(const double a, const double b, const double c,
+                 const double Mdx2)
+   {
+      if(std::fabs(a) < Mdx2) return a;
+      if(a > 0.0 && b > 0.0 && c > 0.0)
+         return std::min(a, std::min(b, c));
+      if(a < 0.0 && b < 0.0 && c < 0.0)
+         return std::max(a, std::max(b, c));
+      return 0.0;
+   }
+
+   //---------------------------------------------------------------------------
+   double euler_pressure(const double* u)
+   {
+      return (gamma_gas - 1.0) * (u[2] - 0.5 * u[1] * u[1] / u[0]);
+   }
+
+   void euler_flux(const double* u, double* f)
+   {
+      const double pre = euler_pressure(u);
+      f[0] = u[1];
+      f[1] = pre + u[1] * u[1] / u[0];
+      f[2] = (u[2] + pre) * u[1] / u[0];
+   }
+
+   double euler_max_eig(const double* u)
+   {
+      return std::fabs(u[1] / u[0]) +
+             std::sqrt(gamma_gas * euler_pressure(u) / u[0]);
+   }
+
+   //---------------------------------------------------------------------------
+   // Eigenvector matrices R and L = R^{-1}, same as EigMatrix in gas.py
+   //---------------------------------------------------------------------------
+   void euler_eig_matrix(const double* u, double R[3][3], double L[3][3])
+   {
+      const double g1 = gamma_gas - 1.0;
+      const double g2 = 0.5 * g1;
+      const double d = u[0];
+      const double v = u[1] / d;
+      const double p = euler_pressure(u);
+      const double c = std::sqrt(gamma_gas * p / d);
+      const double h = c * c / g1 + 0.5 * v * v;
+      const double f = 0.5 * d / c;
+
+      L[0][0] = 1.0 - g2 * v * v / (c * c);
+      L[1][0] = (g2 * v * v - v * c) / (d * c);
+      L[2][0] = -(g2 * v * v + v * c) / (d * c);
+      L[0][1] = g1 * v / (c * c);
+      L[1][1] = (c - g1 * v) / (d * c);
+      L[2][1] = (c + g1 * v) / (d * c);
+      L[0][2] = -g1 / (c * c);
+      L[1][2] = g1 / (d * c);
+      L[2][2] = -g1 / (d * c);
+
+      R[0][0] = 1.0;
+      R[1][0] = v;
+      R[2][0] = 0.5 * v * v;
+      R[0][1] = f;
+      R[1][1] = (v + c) * f;
+      R[2][1] = (h + v * c) * f;
+      R[0][2] = -f;
+      R[1][2] = -(v - c) * f;
+      R[2][2] = -(h - v * c) * f;
+   }
+
+   //---------------------------------------------------------------------------
+   struct Solver
+   {
+      int pde, flux, bc;
+      int k, nd, nq, nc, nvar;
+      double xmin, dx;
+      std::vector<double> Vf;     // [q][j] basis at Gauss points
+      std::vector<double> Vg;     // [i][q] gradient times weight
+      std::vector<double> bm, bp; // basis at -1, +1
+      std::vector<double> uq, fq, ul, ur, fl; // work arrays
+      std::vector<double> u0;     // solution at start of time step
+
+      double& at(double* u, const int v, const int i, const int j) const
+      {
+         return u[(v * nc + i) * nd + j];
+      }
+
+      double at(const double* u, const int v, const int i, const int j) const
+      {
+         return u[(v * nc + i) * nd + j];
+      }
+
+      void physical_flux(const double* u, double* f) const
+      {
+         if(pde == linear) f[0] = u[0];
+         else if(pde == burger) f[0] = 0.5 * u[0] * u[0];
+         else euler_flux(u, f);
+      }
+
+      void numerical_flux(const double* l, const double* r, double* f) const
+      {
+         if(pde == euler) // rusanov
+         {
+            double fl3[3], fr3[3];
+            euler_flux(l, fl3);
+            euler_flux(r, fr3);
+            const double lam = std::max(euler_max_eig(l), euler_max_eig(r));
+            for(int v = 0; v < 3; ++v)
+               f[v] = 0.5 * (fl3[v] + fr3[v]) - 0.5 * lam * (r[v] - l[v]);
+            return;
+         }
+
+         double fl1 = 0.0, fr1 = 0.0;
+         if(pde == linear) fl1 = l[0], fr1 = r[0];
+         else fl1 = 0.5 * l[0] * l[0], fr1 = 0.5 * r[0] * r[0];
+         if(flux == central)
+            f[0] = 0.5 * (fl1 + fr1);
+         else if(pde == linear)
+            f[0] = fl1;
+         else if(flux == upwind) // roe
+            f[0] = 0.5 * (fl1 + fr1) - 0.5 * std::fabs(0.5 * (l[0] + r[0])) *
+                                       (r[0] - l[0]);
+         else // godunov
+         {
+            const double u1 = std::max(0.0, l[0]);
+            const double u2 = std::min(0.0, r[0]);
+            f[0] = std::max(0.5 * u1 * u1, 0.5 * u2 * u2);
+         }
+      }
+
+      // Trace of cell i at x = -1 (b = bm) or +1 (b = bp)
+      void trace(const double* u, const int i, const std::vector<double>& b,
+                 double* s) const
+      {
+         for(int v = 0; v < nvar; ++v)
+         {
+            s[v] = 0.0;
+            for(int j = 0; j < nd; ++j)
+               s[v] += at(u, v, i, j) * b[j];
+         }
+      }
+
+      void add_face_flux(const double* u, const int il, const int ir,
+                         double* res)
+      {
+         if(il >= 0) trace(u, il, bp, ul.data());
+         if(ir >= 0) trace(u, ir, bm, ur.data());
+         if(il < 0) ul = ur; // neumann
+         if(ir < 0) ur = ul;
+         numerical_flux(ul.data(), ur.data(), fl.data());
+         for(int v = 0; v < nvar; ++v)
+            for(int j = 0; j < nd; ++j)
+            {
+               if(il >= 0) at(res, v, il, j) += fl[v] * bp[j];
+               if(ir >= 0) at(res, v, ir, j) -= fl[v] * bm[j];
+            }
+      }
+
+      // res = dx * (-du/dt), as compute_residual in dgsolver.py
+      void residual(const double* u, double* res)
+      {
+         for(int i = 0; i < nc; ++i)
+         {
+            for(int q = 0; q < nq; ++q)
+            {
+               double s[3];
+               for(int v = 0; v < nvar; ++v)
+               {
+                  s[v] = 0.0;
+                  for(int j = 0; j < nd; ++j)
+                     s[v] += Vf[q * nd + j] * at(u, v, i, j);
+               }
+               physical_flux(s, &fq[q * nvar]);
+            }
+            for(int v = 0; v < nvar; ++v)
+               for(int j = 0; j < nd; ++j)
+               {
+                  double r = 0.0;
+                  for(int q = 0; q < nq; ++q)
+                     r += Vg[j * nq + q] * fq[q * nvar + v];
+                  at(res, v, i, j) = -r;
+               }
+         }
+
+         if(bc == periodic)
+            add_face_flux(u, nc - 1, 0, res);
+         else
+         {
+            add_face_flux(u, -1, 0, res);
+            add_face_flux(u, nc - 1, -1, res);
+         }
+         for(int i = 1; i < nc; ++i)
+            add_face_flux(u, i - 1, i, res);
+      }
+
+      double max_speed(const double* u) const
+      {
+         double speed = 0.0;
+         for(int i = 0; i < nc; ++i)
+         {
+            if(pde == linear) return 1.0;
+            if(pde == burger)
+               speed = std::max(speed, std::fabs(at(u, 0, i, 0)));
+            else
+            {
+               const double avg[3] = {at(u, 0, i, 0), at(u, 1, i, 0),
+                                      at(u, 2, i, 0)};
+               speed = std::max(speed, euler_max_eig(avg));
+            }
+         }
+         return speed;
+      }
+
+      // Scalar: all cells with periodic neighbours; Euler: interior cells,
+      // optionally in characteristic variables
+      void limit(double* u, const double Mdx2, const int char_lim)
+      {
+         if(k == 0) return;
+         const int i0 = (bc == periodic) ? 0 : 1;
+         const int i1 = (bc == periodic) ? nc : nc - 1;
+         // slopes are limited using old cell averages of neighbours
+         std::vector<double> avg(nvar * nc);
+         for(int v = 0; v < nvar; ++v)
+            for(int i = 0; i < nc; ++i)
+               avg[v * nc + i] = at(u, v, i, 0);
+
+         for(int i = i0; i < i1; ++i)
+         {
+            const int im = (i == 0) ? nc - 1 : i - 1;
+            const int ip = (i == nc - 1) ? 0 : i + 1;
+            double dul[3], dur[3], du[3], uc[3], dun[3];
+            for(int v = 0; v < nvar; ++v)
+            {
+               uc[v] = avg[v * nc + i];
+               dul[v] = uc[v] - avg[v * nc + im];
+               dur[v] = avg[v * nc + ip] - uc[v];
+               du[v] = at(u, v, i, 1);
+            }
+
+            double R[3][3] = {}, L[3][3] = {};
+            if(pde == euler && char_lim)
+            {
+               euler_eig_matrix(uc, R, L);
+               double a[3], b[3], c[3];
+               for(int m = 0; m < 3; ++m)
+               {
+                  a[m] = b[m] = c[m] = 0.0;
+                  for(int v = 0; v < 3; ++v)
+                  {
+                     a[m] += L[m][v] * du[v];
+                     b[m] += L[m][v] * dul[v];
+                     c[m] += L[m][v] * dur[v];
+                  }
+               }
+               std::copy(a, a + 3, du);
+               std::copy(b, b + 3, dul);
+               std::copy(c, c + 3, dur);
+            }
+
+            bool changed = false;
+            for(int v = 0; v < nvar; ++v)
+            {
+               dun[v] = minmod(sqrt3 * du[v], dul[v], dur[v], Mdx2) / sqrt3;
+               if(std::fabs(dun[v] - du[v]) > 1.0e-6) changed = true;
+            }
+            if(!changed) continue;
+
+            if(pde == euler && char_lim)
+            {
+               double a[3] = {0.0, 0.0, 0.0};
+               for(int v = 0; v < 3; ++v)
+                  for(int m = 0; m < 3; ++m)
+                     a[v] += R[v][m] * dun[m];
+               std::copy(a, a + 3, dun);
+            }
+            for(int v = 0; v < nvar; ++v)
+            {
+               at(u, v, i, 1) = dun[v];
+               for(int j = 2; j < nd; ++j)
+                  at(u, v, i, j) = 0.0;
+            }
+         }
+      }
+
+      // One SSPRK3 step of size dt; res is work array of same size as u
+      void step(const double dt, double* u, double* res, const int limiter,
+                const double Mdx2, const int char_lim)
+      {
+         static const double ark[3] = {0.0, 3.0 / 4.0, 1.0 / 3.0};
+         const int n = nvar * nc * nd;
+         const double lam = dt / dx;
+         u0.assign(u, u + n);
+         for(int rk = 0; rk < 3; ++rk)
+         {
+            residual(u, res);
+            const double a = ark[rk], b = 1.0 - ark[rk];
+            for(int m = 0; m < n; ++m)
+               u[m] = a * u0[m] + b * (u[m] - lam * res[m]);
+            if(limiter) limit(u, Mdx2, char_lim);
+         }
+      }
+   };
+}
+
+//------------------------------------------------------------------------------
+// C interface, see dgkernels.py
+//------------------------------------------------------------------------------
+extern "C"
+{
+
+// Returns 0 if the arguments are valid, else the number of the first invalid
+// argument: 1 = pde, 2 = flux, 3 = bc, 4 = degree, 5 = ncell, 6 = xmin, xmax
+int dg1d_check(int pde, int flux, int bc, int degree, int ncell,
+               double xmin, double xmax)
+{
+   if(pde < linear || pde > euler) return 1;
+   if(pde == euler && flux != rusanov) return 2;
+   // for linear advection, roe and godunov fluxes are the upwind flux
+   if(pde != euler && (flux < central || flux > godunov)) return 2;
+   if(bc != periodic && bc != neumann) return 3;
+   if(degree < 0) return 4;
+   if(ncell < 2) return 5;
+   if(!(xmax > xmin)) return 6;
+   return 0;
+}
+
+// Returns nullptr if the arguments are invalid or memory is not available
+void* dg1d_create(int pde, int flux, int bc, int degree, int ncell,
+                  double xmin, double xmax)
+{
+   if(dg1d_check(pde, flux, bc, degree, ncell, xmin, xmax) != 0)
+      return nullptr;
+
+   Solver* s = new(std::nothrow) Solver;
+   if(s == nullptr) return nullptr;
+   s->pde = pde;
+   s->flux = flux;
+   s->bc = bc;
+   s->k = degree;
+   s->nd = degree + 1;
+   s->nq = degree + 1;
+   s->nc = ncell;
+   s->nvar = (pde == euler) ? 3 : 1;
+   s->xmin = xmin;
+   s->dx = (xmax - xmin) / ncell;
+
+   try
+   {
+      std::vector<double> xg, wg;
+      gauss(s->nq, xg, wg);
+      s->Vf.resize(s->nq * s->nd);
+      s->Vg.resize(s->nd * s->nq);
+      s->bm.resize(s->nd);
+      s->bp.resize(s->nd);
+      for(int j = 0; j < s->nd; ++j)
+      {
+         const double scale = std::sqrt(2.0 * j + 1.0);
+         double p, dp;
+         for(int q = 0; q < s->nq; ++q)
+         {
+            legendre(j, xg[q], p, dp);
+            s->Vf[q * s->nd + j] = scale * p;
+            s->Vg[j * s->nq + q] = scale * dp * wg[q];
+         }
+         legendre(j, -1.0, p, dp);
+         s->bm[j] = scale * p;
+         legendre(j, +1.0, p, dp);
+         s->bp[j] = scale * p;
+      }
+      s->fq.resize(s->nq * s->nvar);
+      s->ul.resize(s->nvar);
+      s->ur.resize(s->nvar);
+      s->fl.resize(s->nvar);
+   }
+   catch(const std::bad_alloc&)
+   {
+      delete s;
+      return nullptr;
+   }
+   return s;
+}
+
+void dg1d_destroy(void* solver)
+{
+   delete static_cast<Solver*>(solver);
+}
+
+void dg1d_residual(void* solver, const double* u, double* res)
+{
+   static_cast<Solver*>(solver)->residual(u, res);
+}
+
+double dg1d_max_speed(void* solver, const double* u)
+{
+   return static_cast<Solver*>(solver)->max_speed(u);
+}
+
+void dg1d_limit(void* solver, double* u, double Mdx2, int char_lim)
+{
+   static_cast<Solver*>(solver)->limit(u, Mdx2, char_lim);
+}
+
+void dg1d_step(void* solver, double dt, double* u, double* res, int limiter,
+               double Mdx2, int char_lim)
+{
+   static_cast<Solver*>(solver)->step(dt, u, res, limiter, Mdx2, char_lim);
+}
+
+}
@@ -0,0 +1,118 @@
+"""
+Python interface to the compiled 1-D DG kernels in dgkernels.cc, build with
+    make
+Solution arrays are passed without copy, so they must be C contiguous float64
+arrays of shape (nc,nd) for scalar PDE and (3,nc,nd) for Euler equations.
+The scalar and Euler codes add this directory to their path to use it.
+Errors are raised as exceptions, so that the caller decides what to do.
+
+This is a separate C++ implementation of the scheme of the Python codes, not a
+binding to the deal.II solvers in dg1d; see README.md.
+"""
+import os
+import ctypes
+import numpy as np
+
+_lib = None
+
+def _load():
+    global _lib
+    if _lib is not None:
+        return _lib
+    path = os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                        'libdgkernels.so')
+    if not os.path.exists(path):
+        raise FileNotFoundError('Compiled kernels not found, run make in ' +
+                                os.path.dirname(path))
+    lib = ctypes.CDLL(path)
+    array = np.ctypeslib.ndpointer(dtype=np.float64, flags='C_CONTIGUOUS')
+    lib.dg1d_check.restype = ctypes.c_int
+    lib.dg1d_check.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_int,
+                               ctypes.c_int, ctypes.c_int,
+                               ctypes.c_double, ctypes.c_double]
+    lib.dg1d_create.restype = ctypes.c_void_p
+    lib.dg1d_create.argtypes = [ctypes.c_int, ctypes.c_int, ctypes.c_int,
+                                ctypes.c_int, ctypes.c_int,
+                                ctypes.c_double, ctypes.c_double]
+    lib.dg1d_destroy.restype = None
+    lib.dg1d_destroy.argtypes = [ctypes.c_void_p]
+    lib.dg1d_residual.restype = None
+    lib.dg1d_residual.argtypes = [ctypes.c_void_p, array, array]
+    lib.dg1d_max_speed.restype = ctypes.c_double
+    lib.dg1d_max_speed.argtypes = [ctypes.c_void_p, array]
+    lib.dg1d_limit.restype = None
+    lib.dg1d_limit.argtypes = [ctypes.c_void_p, array, ctypes.c_double,
+                               ctypes.c_int]
+    lib.dg1d_step.restype = None
+    lib.dg1d_step.argtypes = [ctypes.c_void_p, ctypes.c_double, array, array,
+                              ctypes.c_int, ctypes.c_double, ctypes.c_int]
+    _lib = lib
+    return lib
+
+pdes  = {'linear': 0, 'burger': 1, 'euler': 2}
+fluxes = {'central': 0, 'upwind': 1, 'roe': 1, 'godunov': 2, 'rusanov': 3}
+
+# Meaning of the nonzero return values of dg1d_check
+_errors = {1: 'PDE', 2: 'numerical flux for this PDE', 3: 'boundary condition',
+           4: 'degree', 5: 'number of cells (at least 2)',
+           6: 'domain (need xmin < xmax)'}
+
+class Kernels:
+    """
+    pde      = linear, burger, euler
+    num_flux = central, upwind, roe, godunov (scalar); rusanov (euler)
+    Scalar PDE use periodic bc, Euler uses neumann bc at both ends.
+    """
+    def __init__(self, pde, num_flux, degree, ncell, xmin, xmax):
+        self.handle = None
+        if pde not in pdes:
+            raise ValueError('PDE not available in compiled kernels: ' + pde)
+        if num_flux not in fluxes:
+            raise ValueError('Unknown numerical flux: ' + num_flux)
+        self.lib = _load()
+        self.nvar = 3 if pde == 'euler' else 1
+        bc = 1 if pde == 'euler' else 0
+        args = (pdes[pde], fluxes[num_flux], bc, degree, ncell, xmin, xmax)
+        ierr = self.lib.dg1d_check(*args)
+        if ierr != 0:
+            raise ValueError('Invalid ' + _errors[ierr] + ' in ' +
+                             str((pde, num_flux, degree, ncell, xmin, xmax)))
+        self.shape = (ncell, degree+1) if self.nvar == 1 else \
+                     (3, ncell, degree+1)
+        self.res = np.zeros(self.shape)
+        self.handle = self.lib.dg1d_create(*args)
+        if not self.handle:
+            raise MemoryError('Could not create compiled kernels')
+
+    def __del__(self):
+        if getattr(self, 'handle', None):
+            self.lib.dg1d_destroy(self.handle)
+
+    def check(self, u):
+        if (u.dtype != np.float64 or u.shape != self.shape or
+            not u.flags['C_CONTIGUOUS']):
+            raise ValueError('Solution must be C contiguous float64 array '
+                             'of shape ' + str(self.shape))
+
+    # res = dx * (-du/dt), same as compute_residual
+    def residual(self, u, res=None):
+        self.check(u)
+        if res is None:
+            res = self.res
+        self.lib.dg1d_residual(self.handle, u, res)
+        return res
+
+    def max_speed(self, u):
+        self.check(u)
+        return self.lib.dg1d_max_speed(self.handle, u)
+
+    # TVB limiter, in place
+    def limit(self, u, Mdx2, char_lim=0):
+        self.check(u)
+        self.lib.dg1d_limit(self.handle, u, Mdx2, char_lim)
+
+    # One SSPRK3 step, in place
+    def step(self, dt, u, limit=False, Mdx2=0.0, char_lim=0):
+        self.check(u)
+        self.lib.dg1d_step(self.handle, dt, u, self.res, int(limit), Mdx2,
+                           char_lim)
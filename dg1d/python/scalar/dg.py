@@ -26,6 +26,8 @@ parser.add_argument('-compute_error', choices=('no','yes'),
                     help='Compute error norm', default='no')
 parser.add_argument('-num_flux', choices=('central','upwind','roe','godunov'),
                     help='Numerical flux', default='upwind')
+parser.add_argument('-kernel', choices=('python','cpp'),
+                    help='Python or compiled kernels', default='python')
 args = parser.parse_args()
 
 if args.nrefine == 0: # Run on a single grid, plot solution
@@ -1,8 +1,12 @@
+import os, sys
 import numpy as np
 import matplotlib.pyplot as plt
 from basis import *
 from limiter import *
 
+sys.path.append(os.path.join(os.path.dirname(os.path.abspath(__file__)),
+                             '..', 'kernels'))
+
 # SSPRK3 coefficients
 ark = np.array([0.0, 3.0/4.0, 1.0/3.0])
 brk = 1.0 - ark
@@ -16,6 +20,9 @@ class DG:
         self.plot_freq = args.plot_freq
         self.limit = args.limit
         self.compute_error = args.compute_error
+        self.pde = args.pde
+        self.num_flux = args.num_flux
+        self.kernel = args.kernel
 
         self.nd = args.degree + 1
 
@@ -103,6 +110,13 @@ class DG:
         self.u1 = np.zeros((nc,nd)) # solution at n+1
         self.res= np.zeros((nc,nd)) # residual
 
+        # Compiled kernels, varadv is only in python
+        self.kernels = None
+        if self.kernel == 'cpp' and self.pde != 'varadv':
+            from dgkernels import Kernels
+            self.kernels = Kernels(self.pde, self.num_flux, k, nc,
+                                   self.xmin, self.xmax)
+
     # Set initial condition by L2 projection
     def set_ic(self):
         nc = self.nc
@@ -259,6 +273,9 @@ class DG:
         plot_freq = self.plot_freq
         limit = self.limit
 
+        if self.kernels is not None:
+            return self.solve_kernels()
+
         it, t = 0, 0.0
         while t < Tf:
             dt = cfl * dx / max_speed(u1)
@@ -277,6 +294,24 @@ class DG:
                 (it % plot_freq == 0 or np.abs(Tf-t) < 1.0e-13)):
                 self.update_plot(t)
 
+    # Same as solve but each time step is done by compiled kernels
+    def solve_kernels(self):
+        cfl, dx, Tf = self.cfl, self.dx, self.Tf
+        u1, kernels = self.u1, self.kernels
+        plot_freq = self.plot_freq
+        limit = (self.limit == 'yes')
+
+        it, t = 0, 0.0
+        while t < Tf:
+            dt = cfl * dx / kernels.max_speed(u1)
+            if t+dt > Tf:
+                dt = Tf - t
+            kernels.step(dt, u1, limit, self.Mdx2)
+            t += dt; it += 1
+            if (plot_freq > 0 and
+                (it % plot_freq == 0 or np.abs(Tf-t) < 1.0e-13)):
+                self.update_plot(t)
+
     # Driver function
     def run(self):
         self.setup()
@@ -28,6 +28,7 @@
 #include <iostream>
 
 #include "pde.h"
+#include "../../dg2d/common/krylov_exp.h"
 
 #define dsign(a)   (((a) > 0.0) ? 1 : -1)
 
@@ -55,6 +56,10 @@ struct Parameter
    LimiterType  limiter_type;
    double       Mlim;
    FluxType     flux_type;
+   std::string  time_scheme;   // ssprk3 or exp
+   double       exp_step;      // 0 = one step to final time
+   double       krylov_tol;
+   unsigned int krylov_dim;
 };
 
 //------------------------------------------------------------------------------
@@ -108,6 +113,8 @@ private:
    void apply_limiter();
    void apply_TVD_limiter();
    void update(const unsigned int rk_stage);
+   void check_linear();
+   void exp_step();
    void output_results(const double time) const;
    void process_solution(unsigned int step);
 
@@ -115,6 +122,7 @@ private:
    double               time, stage_time, dt;
    double               dx;
    unsigned int         n_rk_stages;
+   unsigned int         n_rhs;
 
    const Quadrature<dim>       cell_quadrature;
    const Function<dim>*        initial_condition;
@@ -129,6 +137,7 @@ private:
    Vector<double>              imm;
    Vector<double>              average;
    ConvergenceTable            convergence_table;
+   Krylov::ExpIntegrator<Vector<double>> exp_integrator;
 };
 
 //------------------------------------------------------------------------------
@@ -150,6 +159,7 @@ DGScalar<dim>::DGScalar(Parameter&           param,
    AssertThrow(dim == 1, ExcIndexRange(dim, 0, 1));
 
    n_rk_stages = 3;
+   exp_integrator.reinit(param.krylov_tol, param.krylov_dim);
 }
 
 //------------------------------------------------------------------------------
@@ -324,6 +334,7 @@ DGScalar<dim>::assemble_rhs()
    std::vector<double> left_state(1), right_state(1);
 
    rhs = 0.0;
+   ++n_rhs;
 
    for(auto & cell : dof_handler.active_cell_iterators())
    {
@@ -475,6 +486,48 @@ DGScalar<dim>::update(const unsigned int rk_stage)
    stage_time = a_rk[rk_stage] * time + b_rk[rk_stage] * (stage_time + dt);
 }
 
+//------------------------------------------------------------------------------
+// Exponential integrator needs rhs(u) = L u with L linear and autonomous,
+// which holds for linear pde with linear flux and no limiter
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGScalar<dim>::check_linear()
+{
+   AssertThrow(param->limiter_type == LimiterType::none,
+               ExcMessage("Exponential integrator needs limiter = none"));
+   const Vector<double> u(solution);
+   assemble_rhs();
+   Vector<double> r1(rhs);
+   solution *= 2.0;
+   assemble_rhs();
+   r1.sadd(-2.0, 1.0, rhs);
+   solution = u;
+   AssertThrow(r1.l2_norm() <= 1.0e-10 * rhs.l2_norm() + 1.0e-14,
+               ExcMessage("Exponential integrator needs a linear rhs"));
+}
+
+//------------------------------------------------------------------------------
+// Advance solution by dt with solution = exp(dt L) solution
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGScalar<dim>::exp_step()
+{
+   auto apply = [&](const Vector<double>& v, Vector<double>& w)
+   {
+      solution = v;
+      assemble_rhs();
+      w = rhs;
+   };
+   solution_old = solution;
+   const auto stats = exp_integrator.advance(apply, dt, solution_old);
+   solution = solution_old;
+   std::cout << "   Krylov: rhs = " << stats.n_matvec
+             << ", substeps = " << stats.n_substeps
+             << ", dimension = " << stats.max_dim << std::endl;
+}
+
 //------------------------------------------------------------------------------
 // Save solution to file
 //------------------------------------------------------------------------------
@@ -531,21 +584,42 @@ DGScalar<dim>::solve()
 
    time = 0.0;
    unsigned int iter = 0;
+   n_rhs = 0;
 
-   while(time < param->final_time)
+   // Steps of SSP-RK3 at the same cfl, for comparison
+   const bool use_exp = (param->time_scheme == "exp");
+   double n_rk_steps = 0.0;
+   if(use_exp)
    {
-      solution_old  = solution;
-      stage_time = time;
-
+      check_linear();
       compute_dt();
-      if(time + dt > param->final_time) dt = param->final_time - time;
+      n_rk_steps = std::ceil(param->final_time / dt);
+   }
 
-      for(unsigned int rk = 0; rk < n_rk_stages; ++rk)
+   while(time < param->final_time)
+   {
+      if(use_exp)
       {
-         assemble_rhs();
-         update(rk);
+         dt = (param->exp_step > 0.0) ? param->exp_step : param->final_time;
+         if(time + dt > param->final_time) dt = param->final_time - time;
+         exp_step();
          compute_averages();
-         apply_limiter();
+      }
+      else
+      {
+         solution_old  = solution;
+         stage_time = time;
+
+         compute_dt();
+         if(time + dt > param->final_time) dt = param->final_time - time;
+
+         for(unsigned int rk = 0; rk < n_rk_stages; ++rk)
+         {
+            assemble_rhs();
+            update(rk);
+            compute_averages();
+            apply_limiter();
+         }
       }
 
       time += dt;
@@ -555,6 +629,11 @@ DGScalar<dim>::solve()
    output_results(time);
    std::cout << "Iter = " << iter << " time = " << time
              << std::endl;
+   std::cout << "Rhs evaluations = " << n_rhs;
+   if(use_exp)
+      std::cout << ", SSP-RK3 at cfl = " << param->cfl << " needs "
+                << n_rk_stages * n_rk_steps;
+   std::cout << std::endl;
 }
 
 //------------------------------------------------------------------------------
@@ -666,6 +745,15 @@ declare_parameters(ParameterHandler& prm)
                      "Numerical flux");
    prm.declare_entry("tvb parameter", "0.0", Patterns::Double(0),
                      "TVB parameter");
+   prm.declare_entry("time scheme", "ssprk3",
+                     Patterns::Selection("ssprk3|exp"),
+                     "Time scheme, exp only for linear pde");
+   prm.declare_entry("exp step", "0.0", Patterns::Double(0),
+                     "Time step of exp scheme, 0 = final time");
+   prm.declare_entry("krylov tolerance", "1.0e-8", Patterns::Double(0),
+                     "Relative error of exp scheme");
+   prm.declare_entry("krylov dimension", "30", Patterns::Integer(1),
+                     "Largest Krylov space of exp scheme");
 }
 
 //------------------------------------------------------------------------------
@@ -682,6 +770,10 @@ parse_parameters(const ParameterHandler& ph, Parameter& param)
 
    param.final_time = ph.get_double("final time");
    param.Mlim = ph.get_double("tvb parameter");
+   param.time_scheme = ph.get("time scheme");
+   param.exp_step = ph.get_double("exp step");
+   param.krylov_tol = ph.get_double("krylov tolerance");
+   param.krylov_dim = ph.get_integer("krylov dimension");
 
    {
       std::string value = ph.get("numflux");
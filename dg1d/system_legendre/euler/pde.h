@@ -2,6 +2,8 @@
 // 1d compressible Euler equations
 //------------------------------------------------------------------------------
 
+#include "../../dg2d/common/eos.h"
+
 using namespace dealii;
 
 // Number of PDE in the system
@@ -24,6 +26,10 @@ namespace PDE
 
    const double gamma = Problem::gamma;
 
+   // Ideal gas unless the problem sets another equation of state, see
+   // dg2d/common/eos.h
+   EOS::Model eos(gamma);
+
    // Numerical flux functions
    enum class FluxType {roe, rusanov};
 
@@ -40,7 +46,7 @@ namespace PDE
    {
       const double rho = u[0];
       const double vel = u[1] / rho;
-      const double pre = (gamma - 1.0) * (u[2] - 0.5 * rho * pow(vel, 2));
+      const double pre = eos.pressure(rho, u[2] - 0.5 * rho * pow(vel, 2));
       flux[0] = rho * vel;
       flux[1] = pre + rho * pow(vel, 2);
       flux[2] = (u[2] + pre) * vel;
@@ -55,13 +61,16 @@ namespace PDE
    {
       const double rho = u[0];
       const double vel = u[1] / rho;
-      const double pre = (gamma - 1.0) * (u[2] - 0.5 * rho * pow(vel, 2));
-      return abs(vel) + sqrt(gamma * pre / rho);
+      double c2;
+      eos.pressure(rho, u[2] - 0.5 * rho * pow(vel, 2), c2);
+      return abs(vel) + sqrt(c2);
    }
 
    //---------------------------------------------------------------------------
    // R = matrix of right eigenvectors, columns are right eigenvectors
    // L = matrix of left eigenvectors = R^(-1), rows are left eigenvectors
+   // With chi = dp/drho, g1 = dp/d(rho e) of the equation of state, which are
+   // 0 and gamma - 1 for the ideal gas
    //---------------------------------------------------------------------------
    void
    char_mat(const Vector<double>& u,
@@ -71,21 +80,25 @@ namespace PDE
    {
       const double rho = u[0];
       const double vel = u[1] / rho;
-      const double pre = (gamma - 1.0) * (u[2] - 0.5 * rho * pow(vel, 2));
+      const double rho_e = u[2] - 0.5 * rho * pow(vel, 2);
+      const double pre = eos.pressure(rho, rho_e);
       const double H = (u[2] + pre) / rho;
-      const double a = sqrt(gamma * pre / rho);
+      double chi, g1;
+      eos.derivatives(rho, rho_e, chi, g1);
+      const double a = sqrt(chi + g1 * (rho_e + pre) / rho);
+      const double Hs = 0.5 * pow(vel, 2) - chi / g1;
 
-      R(0, 0) = 1.0;     R(0, 1) = 1.0;            R(0, 2) = 1.0;
-      R(1, 0) = vel-a;   R(1, 1) = vel;            R(1, 2) = vel+a;
-      R(2, 0) = H-vel*a; R(2, 1) = 0.5*pow(vel,2); R(2, 2) = H+vel*a;
+      R(0, 0) = 1.0;     R(0, 1) = 1.0;   R(0, 2) = 1.0;
+      R(1, 0) = vel-a;   R(1, 1) = vel;   R(1, 2) = vel+a;
+      R(2, 0) = H-vel*a; R(2, 1) = Hs;    R(2, 2) = H+vel*a;
 
       const double M = vel/a;
       const double M2 = pow(M,2);
-      const double g1 = gamma - 1.0;
+      const double X = chi / pow(a,2);
 
-      L(0, 0) = 0.25*g1*M2 + 0.5*M;
-      L(1, 0) = 1.0 - 0.5*g1*M2;
-      L(2, 0) = 0.25*g1*M2 - 0.5*M;
+      L(0, 0) = 0.25*g1*M2 + 0.5*M + 0.5*X;
+      L(1, 0) = 1.0 - 0.5*g1*M2 - X;
+      L(2, 0) = 0.25*g1*M2 - 0.5*M + 0.5*X;
 
       L(0,1) = -0.5*g1*M/a - 0.5/a;
       L(1,1) = g1*M/a;
@@ -0,0 +1,49 @@
+#!/bin/bash
+# Compare cell and dof orderings of the MPI solvers.
+#
+# Run from a problem directory, e.g. models/euler/naca0012
+#
+#    ../../../common/bench_order.sh ../../../system_lagrange_mpi/main 4
+#
+# For each ordering, a parameter file is made which includes input.prm and
+# overrides the ordering. Hardware counters are collected with perf and the
+# time per stage is printed by the solver at the end of the run.
+
+if [ $# -lt 1 ]
+then
+   echo "Usage: $0 /path/to/main [nproc] [input.prm]"
+   exit 1
+fi
+
+MAIN=$1
+NP=${2:-4}
+INPUT=${3:-input.prm}
+EVENTS=cache-references,cache-misses,L1-dcache-load-misses,LLC-load-misses
+
+for ORDER in "natural cell" "hilbert cell" "hilbert cuthill_mckee" "morton cell"
+do
+   set -- $ORDER
+   NAME=order_$1_$2
+   echo "INCLUDE $INPUT"      >  $NAME.prm
+   echo "set cell order = $1" >> $NAME.prm
+   echo "set dof order  = $2" >> $NAME.prm
+   echo "Running $NAME"
+   # one perf output file per rank (OpenMPI or MPICH rank variable)
+   mpirun -np $NP bash -c "perf stat -e $EVENTS \
+      -o $NAME.perf.\${OMPI_COMM_WORLD_RANK:-\$PMI_RANK} \
+      $MAIN $NAME.prm" > $NAME.log 2>&1
+done
+
+# Summary: ghost cells, stage times and cache misses summed over ranks
+for f in order_*.log
+do
+   NAME=${f%.log}
+   echo "-------------------- $NAME --------------------"
+   grep "Number of ghost cells" $f
+   grep -E "^\| (Assemble|Update|Ghost|Compute|Limiter|Output)" $f
+   for e in ${EVENTS//,/ }
+   do
+      awk -v e=$e '$2==e {gsub(",","",$1); s+=$1} END {printf "%-24s %15d\n", e, s}' \
+         $NAME.perf.*
+   done
+done
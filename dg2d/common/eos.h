@@ -0,0 +1,674 @@
+//------------------------------------------------------------------------------
+// Equation of state of a compressible fluid for the Euler models. Pressure is
+// given in terms of density rho and internal energy per volume rho*e, which
+// the conserved variables give without any division:
+//
+//    ideal    : p = (gamma - 1) rho e
+//    stiffened: p = (gamma - 1) rho e - gamma p_inf
+//    table    : bicubic interpolation of p(rho, e) on a uniform grid
+//
+// The eigenvectors of the flux need the derivatives
+//
+//    kappa = dp/d(rho e) at fixed rho,   chi = dp/drho at fixed rho e
+//
+// in terms of which c^2 = chi + kappa (e + p/rho); kappa = gamma - 1 and
+// chi = 0 for the ideal and stiffened gas.
+//
+// The scalar functions of a Model test its type in every call, ideal gas
+// first, so the ideal gas costs one well predicted branch more than the
+// closed forms. The batch functions test the type once and then loop over
+// arrays without branches, which the compiler can vectorize.
+//------------------------------------------------------------------------------
+#ifndef __EOS_H__
+#define __EOS_H__
+
+#include <deal.II/base/config.h>
+#include <deal.II/base/exceptions.h>
+#include <deal.II/base/mpi.h>
+
+#include <algorithm>
+#include <cmath>
+#include <fstream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace EOS
+{
+   using namespace dealii;
+
+   enum class Type {ideal, stiffened, table};
+
+   //---------------------------------------------------------------------------
+   // Uniform grid of n_rho x n_e nodes on [rho_min,rho_max] x [e_min,e_max],
+   // e = specific internal energy
+   //---------------------------------------------------------------------------
+   struct Grid
+   {
+      unsigned int n_rho = 0, n_e = 0;
+      double       rho_min = 0.0, rho_max = 0.0;
+      double       e_min = 0.0, e_max = 0.0;
+   };
+
+   //---------------------------------------------------------------------------
+   // p(rho, e) is bicubic in each cell of the grid. It interpolates the nodal
+   // values of p and of p_rho, p_e, p_rho_e, which are approximated by second
+   // order differences of the nodal values, so that p, its first derivatives
+   // and the sound speed are continuous, and a function which is quadratic in
+   // rho and in e, like the ideal and stiffened gas, is reproduced exactly.
+   // The 16 coefficients of each cell are computed once: a lookup is an index
+   // computation, two cache lines and 15 multiply-adds. States outside of the
+   // grid use the polynomial of the nearest cell.
+   //
+   // The coefficients are not changed after setup, so any number of threads
+   // can use a table. With MPI, one copy per node is kept in a shared memory
+   // window, written by the first rank of the node and read by the others.
+   //---------------------------------------------------------------------------
+   class Table
+   {
+   public:
+      Table() = default;
+      Table(const Table&) = delete;
+      Table& operator=(const Table&) = delete;
+      ~Table()
+      {
+         free();
+      }
+
+      //------------------------------------------------------------------------
+      // Tabulate pre(rho, e) on grid; collective on comm, only rank 0 calls pre
+      //------------------------------------------------------------------------
+      template <typename Function>
+      void build(const Grid& g, const Function& pre, const MPI_Comm comm)
+      {
+         std::vector<double> values;
+         if(rank(comm) == 0)
+         {
+            values.resize(g.n_rho * g.n_e);
+            const double drho = (g.rho_max - g.rho_min) / (g.n_rho - 1);
+            const double de = (g.e_max - g.e_min) / (g.n_e - 1);
+            for(unsigned int i = 0; i < g.n_rho; ++i)
+               for(unsigned int j = 0; j < g.n_e; ++j)
+                  values[i * g.n_e + j] = pre(g.rho_min + i * drho,
+                                              g.e_min + j * de);
+         }
+         setup(g, values, comm);
+      }
+
+      //------------------------------------------------------------------------
+      // Text file with lines starting with # as comments, then
+      //
+      //    n_rho n_e
+      //    rho_min rho_max
+      //    e_min e_max
+      //
+      // and the n_rho * n_e pressure values, e varying fastest. Collective on
+      // comm, only rank 0 reads the file.
+      //------------------------------------------------------------------------
+      void read(const std::string& filename, const MPI_Comm comm)
+      {
+         Grid g;
+         std::vector<double> values;
+         if(rank(comm) == 0)
+         {
+            std::ifstream f(filename);
+            AssertThrow(f.good(), ExcMessage("Cannot open " + filename));
+            std::stringstream data;
+            std::string line;
+            while(std::getline(f, line))
+               if(!line.empty() && line[0] != '#')
+                  data << line << "\n";
+            data >> g.n_rho >> g.n_e >> g.rho_min >> g.rho_max
+                 >> g.e_min >> g.e_max;
+            AssertThrow(!data.fail(), ExcMessage("Bad header in " + filename));
+            values.resize(g.n_rho * g.n_e);
+            for(auto& v : values)
+               data >> v;
+            AssertThrow(!data.fail(),
+                        ExcMessage("Too few pressure values in " + filename));
+         }
+         setup(g, values, comm);
+      }
+
+      //------------------------------------------------------------------------
+      // p(rho, e)
+      //------------------------------------------------------------------------
+      DEAL_II_ALWAYS_INLINE double
+      pressure(const double rho, const double e) const
+      {
+         double s, t;
+         const int k = cell(rho, e, s, t);
+         const double b0 = cubic(k, t), b1 = cubic(k + 4, t);
+         const double b2 = cubic(k + 8, t), b3 = cubic(k + 12, t);
+         return ((b3 * s + b2) * s + b1) * s + b0;
+      }
+
+      //------------------------------------------------------------------------
+      // p(rho, e) and its derivatives p_rho at fixed e and p_e at fixed rho
+      //------------------------------------------------------------------------
+      DEAL_II_ALWAYS_INLINE double
+      pressure(const double rho,
+               const double e,
+               double&      p_rho,
+               double&      p_e) const
+      {
+         double s, t;
+         const int k = cell(rho, e, s, t);
+         const double b0 = cubic(k, t), b1 = cubic(k + 4, t);
+         const double b2 = cubic(k + 8, t), b3 = cubic(k + 12, t);
+         const double d0 = dcubic(k, t), d1 = dcubic(k + 4, t);
+         const double d2 = dcubic(k + 8, t), d3 = dcubic(k + 12, t);
+         p_rho = ((3.0 * b3 * s + 2.0 * b2) * s + b1) * inv_drho;
+         p_e = (((d3 * s + d2) * s + d1) * s + d0) * inv_de;
+         return ((b3 * s + b2) * s + b1) * s + b0;
+      }
+
+      //------------------------------------------------------------------------
+      // e with p(rho, e) = pre by Newton iterations, which start from the
+      // middle of the grid; p is close to linear in e for most fluids.
+      //------------------------------------------------------------------------
+      double energy(const double rho, const double pre) const
+      {
+         double e = 0.5 * (grid.e_min + grid.e_max);
+         for(unsigned int k = 0; k < 50; ++k)
+         {
+            double p_rho, p_e;
+            const double de = (pressure(rho, e, p_rho, p_e) - pre) / p_e;
+            e -= de;
+            if(std::fabs(de) <= 1.0e-13 * std::fabs(e))
+               return e;
+         }
+         AssertThrow(false, ExcMessage("EOS table: no convergence of e(rho,p)"
+                                       " at rho = " + std::to_string(rho) +
+                                       ", p = " + std::to_string(pre)));
+         return e;
+      }
+
+      //------------------------------------------------------------------------
+      // pre[i] = p(rho[i], rho_e[i]/rho[i]) for i < n
+      //------------------------------------------------------------------------
+      void pressure(const unsigned int n,
+                    const double*      rho,
+                    const double*      rho_e,
+                    double*            pre) const
+      {
+         DEAL_II_OPENMP_SIMD_PRAGMA
+         for(unsigned int i = 0; i < n; ++i)
+            pre[i] = pressure(rho[i], rho_e[i] / rho[i]);
+      }
+
+      //------------------------------------------------------------------------
+      // c2[i] = sound speed^2 for i < n, pre[i] = pressure
+      //------------------------------------------------------------------------
+      void sound_speed2(const unsigned int n,
+                        const double*      rho,
+                        const double*      rho_e,
+                        double*            pre,
+                        double*            c2) const
+      {
+         DEAL_II_OPENMP_SIMD_PRAGMA
+         for(unsigned int i = 0; i < n; ++i)
+         {
+            double p_rho, p_e;
+            pre[i] = pressure(rho[i], rho_e[i] / rho[i], p_rho, p_e);
+            c2[i] = p_rho + pre[i] * p_e / (rho[i] * rho[i]);
+         }
+      }
+
+      const Grid& get_grid() const
+      {
+         return grid;
+      }
+
+      // Bytes of coefficients, which are held once per node
+      std::size_t memory_consumption() const
+      {
+         return 16 * sizeof(double) * (grid.n_rho - 1) * (grid.n_e - 1);
+      }
+
+   private:
+      static unsigned int rank(const MPI_Comm comm)
+      {
+         return Utilities::MPI::job_supports_mpi()
+                ? Utilities::MPI::this_mpi_process(comm) : 0;
+      }
+
+      // Cubic in t with coefficients coef[k,...,k+3] and its derivative.
+      // Offsets instead of pointers let the compiler vectorize loops over
+      // states with gather loads.
+      DEAL_II_ALWAYS_INLINE double
+      cubic(const int k, const double t) const
+      {
+         return ((coef[k + 3] * t + coef[k + 2]) * t + coef[k + 1]) * t
+                + coef[k];
+      }
+
+      DEAL_II_ALWAYS_INLINE double
+      dcubic(const int k, const double t) const
+      {
+         return (3.0 * coef[k + 3] * t + 2.0 * coef[k + 2]) * t + coef[k + 1];
+      }
+
+      //------------------------------------------------------------------------
+      // Offset of the coefficients of the cell containing (rho, e), or of the
+      // nearest cell, and local coordinates s, t, which are in [0,1] inside
+      // the cell
+      //------------------------------------------------------------------------
+      DEAL_II_ALWAYS_INLINE int
+      cell(const double rho,
+           const double e,
+           double&      s,
+           double&      t) const
+      {
+         const double x = (rho - grid.rho_min) * inv_drho;
+         const double y = (e - grid.e_min) * inv_de;
+         const int i = std::min(std::max(x, 0.0), x_last);
+         const int j = std::min(std::max(y, 0.0), y_last);
+         s = x - i;
+         t = y - j;
+         return 16 * (i * stride + j);
+      }
+
+      void setup(const Grid& g, std::vector<double>& values, const MPI_Comm comm);
+      void compute_coefficients(const std::vector<double>& values,
+                                double*                    a) const;
+      void free();
+
+      Grid                grid;
+      double              inv_drho = 0.0, inv_de = 0.0;
+      double              x_last = 0.0, y_last = 0.0; // index of last cell
+      int                 stride = 0;                 // cells per density
+      const double*       coef = nullptr;
+      std::vector<double> local;   // coefficients if not shared
+      MPI_Win             window = MPI_WIN_NULL;
+      MPI_Comm            node_comm = MPI_COMM_NULL;
+   };
+
+   //---------------------------------------------------------------------------
+   // Grid is given on rank 0 of comm, values on rank 0 only
+   //---------------------------------------------------------------------------
+   inline void
+   Table::setup(const Grid& g, std::vector<double>& values, const MPI_Comm comm)
+   {
+      free();
+      grid = g;
+      const bool parallel = Utilities::MPI::job_supports_mpi();
+      if(parallel)
+      {
+         double header[6] = {double(g.n_rho), double(g.n_e), g.rho_min,
+                             g.rho_max, g.e_min, g.e_max};
+         MPI_Bcast(header, 6, MPI_DOUBLE, 0, comm);
+         grid.n_rho = header[0];
+         grid.n_e = header[1];
+         grid.rho_min = header[2];
+         grid.rho_max = header[3];
+         grid.e_min = header[4];
+         grid.e_max = header[5];
+      }
+      AssertThrow(grid.n_rho >= 3 && grid.n_e >= 3,
+                  ExcMessage("EOS table needs at least 3 x 3 nodes"));
+      AssertThrow(grid.rho_max > grid.rho_min && grid.e_max > grid.e_min,
+                  ExcMessage("EOS table has an empty range"));
+      inv_drho = (grid.n_rho - 1) / (grid.rho_max - grid.rho_min);
+      inv_de = (grid.n_e - 1) / (grid.e_max - grid.e_min);
+      x_last = grid.n_rho - 2;
+      y_last = grid.n_e - 2;
+      stride = grid.n_e - 1;
+
+      // Errors in the values are found on rank 0, but all ranks must throw
+      int valid = 1;
+      if(rank(comm) == 0)
+         for(unsigned int i = 0; i < grid.n_rho; ++i)
+            for(unsigned int j = 0; j < grid.n_e; ++j)
+            {
+               const double p = values[i * grid.n_e + j];
+               if(!std::isfinite(p) ||
+                  (j > 0 && p <= values[i * grid.n_e + j - 1]))
+                  valid = 0;
+            }
+      if(parallel)
+         valid = Utilities::MPI::min(valid, comm);
+      AssertThrow(valid, ExcMessage("EOS table: pressure must be finite and "
+                                    "increase with e"));
+
+      const std::size_t n_coef = memory_consumption() / sizeof(double);
+      if(!parallel)
+      {
+         local.resize(n_coef);
+         compute_coefficients(values, local.data());
+         coef = local.data();
+         return;
+      }
+
+      // First rank of each node gets the values and writes the coefficients
+      MPI_Comm_split_type(comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL,
+                          &node_comm);
+      const bool writer = (Utilities::MPI::this_mpi_process(node_comm) == 0);
+      MPI_Comm writers;
+      MPI_Comm_split(comm, writer ? 0 : MPI_UNDEFINED, 0, &writers);
+      if(writer)
+      {
+         values.resize(grid.n_rho * grid.n_e);
+         MPI_Bcast(values.data(), values.size(), MPI_DOUBLE, 0, writers);
+         MPI_Comm_free(&writers);
+      }
+
+      double* base = nullptr;
+      MPI_Win_allocate_shared(writer ? n_coef * sizeof(double) : 0,
+                              sizeof(double), MPI_INFO_NULL, node_comm, &base,
+                              &window);
+      MPI_Aint size;
+      int disp_unit;
+      MPI_Win_shared_query(window, 0, &size, &disp_unit, &base);
+      if(writer)
+         compute_coefficients(values, base);
+      MPI_Win_fence(0, window);
+      coef = base;
+   }
+
+   //---------------------------------------------------------------------------
+   // a = M F M^T with F = [f, f_t; f_s, f_st] at the corners of a cell in
+   // local coordinates (s,t), p(s,t) = sum_kl a[4k+l] s^k t^l
+   //---------------------------------------------------------------------------
+   inline void
+   Table::compute_coefficients(const std::vector<double>& values,
+                               double*                    a) const
+   {
+      const unsigned int nr = grid.n_rho, ne = grid.n_e;
+      auto f = [&](const unsigned int i, const unsigned int j)
+      {
+         return values[i * ne + j];
+      };
+      // Second order differences per grid step, one-sided at the ends
+      auto diff = [](const unsigned int i, const unsigned int n, auto&& g)
+      {
+         if(i == 0)     return 0.5 * (-3.0 * g(0) + 4.0 * g(1) - g(2));
+         if(i == n - 1) return 0.5 * (3.0 * g(n - 1) - 4.0 * g(n - 2) + g(n - 3));
+         return 0.5 * (g(i + 1) - g(i - 1));
+      };
+      std::vector<double> fs(nr * ne), ft(nr * ne), fst(nr * ne);
+      for(unsigned int i = 0; i < nr; ++i)
+         for(unsigned int j = 0; j < ne; ++j)
+         {
+            fs[i * ne + j] = diff(i, nr, [&](unsigned int k) { return f(k, j); });
+            ft[i * ne + j] = diff(j, ne, [&](unsigned int k) { return f(i, k); });
+         }
+      for(unsigned int i = 0; i < nr; ++i)
+         for(unsigned int j = 0; j < ne; ++j)
+            fst[i * ne + j] = diff(i, nr, [&](unsigned int k)
+                                   { return ft[k * ne + j]; });
+
+      const double M[4][4] = {{ 1.0,  0.0,  0.0,  0.0},
+                              { 0.0,  0.0,  1.0,  0.0},
+                              {-3.0,  3.0, -2.0, -1.0},
+                              { 2.0, -2.0,  1.0,  1.0}};
+      for(unsigned int i = 0; i + 1 < nr; ++i)
+         for(unsigned int j = 0; j + 1 < ne; ++j)
+         {
+            const unsigned int n00 = i * ne + j, n01 = n00 + 1;
+            const unsigned int n10 = n00 + ne, n11 = n10 + 1;
+            const double F[4][4] =
+               {{values[n00], values[n01], ft[n00],  ft[n01]},
+                {values[n10], values[n11], ft[n10],  ft[n11]},
+                {fs[n00],     fs[n01],     fst[n00], fst[n01]},
+                {fs[n10],     fs[n11],     fst[n10], fst[n11]}};
+            double MF[4][4];
+            for(unsigned int k = 0; k < 4; ++k)
+               for(unsigned int l = 0; l < 4; ++l)
+               {
+                  MF[k][l] = 0.0;
+                  for(unsigned int m = 0; m < 4; ++m)
+                     MF[k][l] += M[k][m] * F[m][l];
+               }
+            double* ac = a + 16 * (i * (ne - 1) + j);
+            for(unsigned int k = 0; k < 4; ++k)
+               for(unsigned int l = 0; l < 4; ++l)
+               {
+                  ac[4 * k + l] = 0.0;
+                  for(unsigned int m = 0; m < 4; ++m)
+                     ac[4 * k + l] += MF[k][m] * M[l][m];
+               }
+         }
+   }
+
+   //---------------------------------------------------------------------------
+   // The window may outlive MPI if the table is held by a global object
+   //---------------------------------------------------------------------------
+   inline void
+   Table::free()
+   {
+      int finalized = 1;
+      if(window != MPI_WIN_NULL)
+         MPI_Finalized(&finalized);
+      if(!finalized)
+      {
+         MPI_Win_free(&window);
+         MPI_Comm_free(&node_comm);
+      }
+      window = MPI_WIN_NULL;
+      node_comm = MPI_COMM_NULL;
+      local.clear();
+      coef = nullptr;
+   }
+
+   //---------------------------------------------------------------------------
+   // Equation of state used by the pde; copies share the table
+   //---------------------------------------------------------------------------
+   class Model
+   {
+   public:
+      explicit Model(const double gamma = 1.4)
+      {
+         set_ideal(gamma);
+      }
+
+      void set_ideal(const double gamma)
+      {
+         set_stiffened(gamma, 0.0);
+         type = Type::ideal;
+      }
+
+      void set_stiffened(const double gamma, const double p_inf)
+      {
+         AssertThrow(gamma > 1.0, ExcMessage("EOS needs gamma > 1"));
+         type = Type::stiffened;
+         this->gamma = gamma;
+         this->p_inf = p_inf;
+         g1 = gamma - 1.0;
+         table.reset();
+      }
+
+      void set_table(const std::shared_ptr<const Table>& table)
+      {
+         AssertThrow(table, ExcMessage("EOS table is empty"));
+         type = Type::table;
+         this->table = table;
+      }
+
+      Type get_type() const
+      {
+         return type;
+      }
+
+      double get_gamma() const
+      {
+         return gamma;
+      }
+
+      std::string description() const
+      {
+         std::stringstream s;
+         if(type == Type::ideal)
+            s << "ideal gas, gamma = " << gamma;
+         else if(type == Type::stiffened)
+            s << "stiffened gas, gamma = " << gamma << ", p_inf = " << p_inf;
+         else
+         {
+            const Grid& g = table->get_grid();
+            s << "table of " << g.n_rho << " x " << g.n_e << " nodes, rho in ["
+              << g.rho_min << "," << g.rho_max << "], e in [" << g.e_min << ","
+              << g.e_max << "], " << table->memory_consumption() / 1048576.0
+              << " MiB per node";
+         }
+         return s.str();
+      }
+
+      //------------------------------------------------------------------------
+      // Pressure from density and internal energy per volume
+      //------------------------------------------------------------------------
+      template <typename Number>
+      Number pressure(const Number rho, const Number rho_e) const
+      {
+         if(type == Type::ideal)
+            return g1 * rho_e;
+         if(type == Type::stiffened)
+            return g1 * rho_e - gamma * p_inf;
+         return table->pressure(rho, rho_e / rho);
+      }
+
+      //------------------------------------------------------------------------
+      // Internal energy per volume from density and pressure
+      //------------------------------------------------------------------------
+      template <typename Number>
+      Number internal_energy(const Number rho, const Number pre) const
+      {
+         if(type == Type::ideal)
+            return pre / g1;
+         if(type == Type::stiffened)
+            return (pre + gamma * p_inf) / g1;
+         return rho * table->energy(rho, pre);
+      }
+
+      //------------------------------------------------------------------------
+      // Square of sound speed, pre = pressure(rho, rho_e)
+      //------------------------------------------------------------------------
+      template <typename Number>
+      Number sound_speed2(const Number rho,
+                          const Number rho_e,
+                          const Number pre) const
+      {
+         if(type == Type::ideal)
+            return gamma * pre / rho;
+         if(type == Type::stiffened)
+            return gamma * (pre + p_inf) / rho;
+         double p_rho, p_e;
+         table->pressure(rho, rho_e / rho, p_rho, p_e);
+         return p_rho + pre * p_e / (rho * rho);
+      }
+
+      //------------------------------------------------------------------------
+      // Pressure and square of sound speed c2, with one lookup for tables
+      //------------------------------------------------------------------------
+      template <typename Number>
+      Number pressure(const Number rho, const Number rho_e, Number& c2) const
+      {
+         if(type != Type::table)
+         {
+            const Number pre = pressure(rho, rho_e);
+            c2 = sound_speed2(rho, rho_e, pre);
+            return pre;
+         }
+         double p_rho, p_e;
+         const double pre = table->pressure(rho, rho_e / rho, p_rho, p_e);
+         c2 = p_rho + pre * p_e / (rho * rho);
+         return pre;
+      }
+
+      //------------------------------------------------------------------------
+      // chi = dp/drho at fixed rho e, kappa = dp/d(rho e) at fixed rho
+      //------------------------------------------------------------------------
+      template <typename Number>
+      void derivatives(const Number rho,
+                       const Number rho_e,
+                       Number&      chi,
+                       Number&      kappa) const
+      {
+         if(type != Type::table)
+         {
+            chi = 0.0;
+            kappa = g1;
+            return;
+         }
+         double p_rho, p_e;
+         const double e = rho_e / rho;
+         table->pressure(rho, e, p_rho, p_e);
+         kappa = p_e / rho;
+         chi = p_rho - p_e * e / rho;
+      }
+
+      //------------------------------------------------------------------------
+      // State with rho > 0 is admissible if the sound speed is real; for the
+      // ideal gas this is p > 0 and for tables we also require p > 0.
+      //------------------------------------------------------------------------
+      template <typename Number>
+      bool is_admissible(const Number rho,
+                         const Number rho_e,
+                         const Number pre) const
+      {
+         if(type == Type::ideal)
+            return pre > 0.0;
+         if(type == Type::stiffened)
+            return pre + p_inf > 0.0;
+         return pre > 0.0 && sound_speed2(rho, rho_e, pre) > 0.0;
+      }
+
+      //------------------------------------------------------------------------
+      // Mathematical entropy -rho s/(gamma-1), s = log((p + p_inf)/rho^gamma);
+      // zero for tables, which have no entropy.
+      //------------------------------------------------------------------------
+      template <typename Number>
+      Number entropy(const Number rho, const Number pre) const
+      {
+         if(type == Type::table)
+            return 0.0;
+         return -rho * (std::log(pre + p_inf) - gamma * std::log(rho)) / g1;
+      }
+
+      //------------------------------------------------------------------------
+      // Batch versions for arrays of n states
+      //------------------------------------------------------------------------
+      void pressure(const unsigned int n,
+                    const double*      rho,
+                    const double*      rho_e,
+                    double*            pre) const
+      {
+         if(type == Type::table)
+         {
+            table->pressure(n, rho, rho_e, pre);
+            return;
+         }
+         const double shift = gamma * p_inf;
+         DEAL_II_OPENMP_SIMD_PRAGMA
+         for(unsigned int i = 0; i < n; ++i)
+            pre[i] = g1 * rho_e[i] - shift;
+      }
+
+      void sound_speed2(const unsigned int n,
+                        const double*      rho,
+                        const double*      rho_e,
+                        double*            pre,
+                        double*            c2) const
+      {
+         if(type == Type::table)
+         {
+            table->sound_speed2(n, rho, rho_e, pre, c2);
+            return;
+         }
+         const double shift = gamma * p_inf;
+         DEAL_II_OPENMP_SIMD_PRAGMA
+         for(unsigned int i = 0; i < n; ++i)
+         {
+            pre[i] = g1 * rho_e[i] - shift;
+            c2[i] = gamma * (pre[i] + p_inf) / rho[i];
+         }
+      }
+
+   private:
+      Type                         type = Type::ideal;
+      double                       gamma = 1.4, g1 = 0.4, p_inf = 0.0;
+      std::shared_ptr<const Table> table;
+   };
+}
+
+#endif
@@ -0,0 +1,219 @@
+//------------------------------------------------------------------------------
+// Timeline of the phases of a solver on every rank and thread, saved in the
+// Chrome trace event format; open it in https://ui.perfetto.dev or in
+// chrome://tracing to see load imbalance and waiting between ranks.
+//
+// Each thread writes begin/end time stamps into its own ring buffer, which is
+// allocated when the thread records its first event, so recording costs a
+// read of the time stamp counter and a store. When a buffer is full, the
+// oldest events are overwritten. Event names must be string literals, since
+// only the pointer is stored. Time starts at a barrier in reinit, so the
+// ranks are aligned to within the latency of the barrier.
+//------------------------------------------------------------------------------
+#ifndef __EVENT_TRACE_H__
+#define __EVENT_TRACE_H__
+
+#include <deal.II/base/mpi.h>
+#include <deal.II/base/utilities.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace EventTrace
+{
+   using namespace dealii;
+
+   // Ticks of the time stamp counter, or ns where there is none
+   inline uint64_t
+   now()
+   {
+#if defined(__x86_64__) || defined(__i386__)
+      return __rdtsc();
+#else
+      return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+   }
+
+   inline double
+   wall_ns()
+   {
+      return std::chrono::duration<double, std::nano>(
+                std::chrono::steady_clock::now().time_since_epoch()).count();
+   }
+
+   struct Event
+   {
+      const char* name;
+      uint64_t    begin, end;
+   };
+
+   // Ring buffer of one thread; capacity is a power of two
+   struct Buffer
+   {
+      std::vector<Event> events;
+      uint64_t           n = 0;   // events recorded, including overwritten
+      unsigned int       thread;
+   };
+
+   //---------------------------------------------------------------------------
+   class Tracer
+   {
+   public:
+      // capacity = events per thread, rounded up to a power of two
+      void reinit(const bool enable, const unsigned int capacity,
+                  const MPI_Comm comm)
+      {
+         enabled = enable;
+         mpi_comm = comm;
+         {
+            std::lock_guard<std::mutex> lock(mutex);
+            buffers.clear();
+            ++generation;
+         }
+         if(!enabled) return;
+
+         mask = 1;
+         while(mask < capacity) mask <<= 1;
+         --mask;
+         buffer(); // the calling thread is thread 0
+         MPI_Barrier(mpi_comm);
+         tick0 = now();
+         wall0 = wall_ns();
+      }
+
+      bool is_enabled() const
+      {
+         return enabled;
+      }
+
+      void record(const char* name, const uint64_t begin, const uint64_t end)
+      {
+         Buffer& b = buffer();
+         b.events[b.n++ & mask] = {name, begin, end};
+      }
+
+      class Scope
+      {
+      public:
+         Scope(Tracer& tracer, const char* name, const bool active = true)
+            :
+            tracer(tracer.enabled && active ? &tracer : nullptr),
+            name(name),
+            begin(this->tracer ? now() : 0)
+         {}
+
+         ~Scope()
+         {
+            if(tracer) tracer->record(name, begin, now());
+         }
+
+      private:
+         Tracer* const    tracer;
+         const char* const name;
+         const uint64_t   begin;
+      };
+
+      //------------------------------------------------------------------------
+      // Gathers the events of all ranks on rank 0 which saves them; must be
+      // called on all ranks when no thread is recording. Returns the number of
+      // events saved and overwritten, summed over ranks.
+      //------------------------------------------------------------------------
+      std::pair<uint64_t,uint64_t> write(const std::string& filename) const
+      {
+         if(!enabled) return {0, 0};
+         const unsigned int rank = Utilities::MPI::this_mpi_process(mpi_comm);
+         const double ns_per_tick = (wall_ns() - wall0) /
+                                    std::max<double>(now() - tick0, 1.0);
+         auto us = [&](const uint64_t t)
+         {
+            return 1.0e-3 * ns_per_tick * (double(t) - double(tick0));
+         };
+
+         std::ostringstream ss;
+         ss.precision(3);
+         ss << std::fixed;
+         uint64_t n_saved = 0, n_lost = 0;
+         ss << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":" << rank
+            << ",\"args\":{\"name\":\"rank " << rank << "\"}},\n"
+            << "{\"name\":\"process_sort_index\",\"ph\":\"M\",\"pid\":" << rank
+            << ",\"args\":{\"sort_index\":" << rank << "}}";
+         for(const auto& b : buffers)
+         {
+            ss << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":" << rank
+               << ",\"tid\":" << b->thread << ",\"args\":{\"name\":\"thread "
+               << b->thread << "\"}}";
+            const uint64_t size = mask + 1;
+            const uint64_t first = (b->n > size) ? b->n - size : 0;
+            for(uint64_t i = first; i < b->n; ++i)
+            {
+               const Event& e = b->events[i & mask];
+               ss << ",\n{\"name\":\"" << e.name << "\",\"ph\":\"X\",\"pid\":"
+                  << rank << ",\"tid\":" << b->thread << ",\"ts\":"
+                  << us(e.begin) << ",\"dur\":" << us(e.end) - us(e.begin)
+                  << "}";
+            }
+            n_saved += b->n - first;
+            n_lost += first;
+         }
+
+         const auto all = Utilities::MPI::gather(mpi_comm, ss.str(), 0);
+         if(rank == 0)
+         {
+            std::ofstream f(filename);
+            f << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+            for(unsigned int r = 0; r < all.size(); ++r)
+               f << (r > 0 ? ",\n" : "") << all[r];
+            f << "\n]}\n";
+         }
+         return {Utilities::MPI::sum(n_saved, mpi_comm),
+                 Utilities::MPI::sum(n_lost, mpi_comm)};
+      }
+
+   private:
+      // Buffer of the calling thread, found by a thread local pointer after
+      // the first call
+      Buffer& buffer()
+      {
+         struct Cache
+         {
+            const Tracer* owner = nullptr;
+            uint64_t      generation = 0;
+            Buffer*       buffer = nullptr;
+         };
+         thread_local Cache cache;
+         if(cache.owner != this || cache.generation != generation)
+         {
+            std::lock_guard<std::mutex> lock(mutex);
+            auto b = std::make_unique<Buffer>();
+            b->events.resize(mask + 1);
+            b->thread = buffers.size();
+            cache = {this, generation, b.get()};
+            buffers.push_back(std::move(b));
+         }
+         return *cache.buffer;
+      }
+
+      bool                                 enabled = false;
+      MPI_Comm                             mpi_comm = MPI_COMM_WORLD;
+      uint64_t                             mask = 0;
+      uint64_t                             generation = 0;
+      uint64_t                             tick0 = 0;
+      double                               wall0 = 0.0;
+      std::mutex                           mutex;
+      std::deque<std::unique_ptr<Buffer>>  buffers;
+   };
+}
+
+#endif
@@ -0,0 +1,204 @@
+//------------------------------------------------------------------------------
+// Exponential integrator for linear autonomous systems du/dt = A u, where A
+// is only available as a matrix-vector product, e.g., the DG rhs of a linear
+// PDE. The solution u(t) = exp(t A) u(0) is approximated in the Krylov space
+//
+//    K_m = span{u, A u, ..., A^{m-1} u}
+//
+// built by Arnoldi, u(t) = beta V_m exp(t H_m) e_1, beta = |u|. The dimension
+// m is increased until the a posteriori error estimate of Saad
+//
+//    err = beta h_{m+1,m} t |e_m^T phi_1(t H_m) e_1|,  phi_1(z) = (e^z - 1)/z
+//
+// is below the tolerance; if the largest dimension is reached first, t is
+// split into substeps. Both exp(t H_m) e_1 and phi_1(t H_m) e_1 are obtained
+// from the exponential of H_m augmented by one column, as in Expokit. Arnoldi
+// is used instead of Lanczos since upwind DG operators are not normal.
+//------------------------------------------------------------------------------
+#ifndef __KRYLOV_EXP_H__
+#define __KRYLOV_EXP_H__
+
+#include <deal.II/base/exceptions.h>
+#include <deal.II/lac/full_matrix.h>
+#include <deal.II/lac/identity_matrix.h>
+
+#include <algorithm>
+#include <cmath>
+#include <vector>
+
+namespace Krylov
+{
+   using namespace dealii;
+
+   //---------------------------------------------------------------------------
+   // E = exp(A) of a small dense matrix by scaling and squaring with the
+   // (6,6) Pade approximant
+   //---------------------------------------------------------------------------
+   inline void
+   expm(const FullMatrix<double>& A, FullMatrix<double>& E)
+   {
+      const unsigned int n = A.m();
+      const unsigned int p = 6;
+
+      // Scale so that |A / 2^s| <= 1/2
+      const double norm = A.linfty_norm();
+      const int s = (norm > 0.5) ? int(std::ceil(std::log2(norm))) + 1 : 0;
+      FullMatrix<double> X(A);
+      X *= std::pow(2.0, -s);
+
+      // N = sum_k c_k X^k, D = sum_k (-1)^k c_k X^k
+      const IdentityMatrix I(n);
+      FullMatrix<double> N(I), D(I), Xk(I), tmp(n, n);
+      double c = 1.0;
+      for(unsigned int k = 1; k <= p; ++k)
+      {
+         c *= double(p - k + 1) / double((2 * p - k + 1) * k);
+         X.mmult(tmp, Xk);
+         Xk = tmp;
+         N.add(c, Xk);
+         D.add((k % 2 == 0) ? c : -c, Xk);
+      }
+      D.gauss_jordan();
+      E.reinit(n, n);
+      D.mmult(E, N);
+
+      for(int i = 0; i < s; ++i)
+      {
+         E.mmult(tmp, E);
+         E = tmp;
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   // VectorType needs l2_norm, dot product by operator*, add, equ and
+   // reinit(v, omit_zeroing); with distributed vectors, norms and dot
+   // products are summed over ranks and all ranks take the same substeps.
+   //---------------------------------------------------------------------------
+   template <typename VectorType>
+   class ExpIntegrator
+   {
+   public:
+      struct Stats
+      {
+         unsigned int n_matvec = 0;
+         unsigned int n_substeps = 0;
+         unsigned int max_dim = 0;   // largest Krylov dimension used
+      };
+
+      // Error of u(t) relative to |u| is about tol, summed over substeps
+      void reinit(const double tol, const unsigned int max_dim)
+      {
+         AssertThrow(max_dim > 0, ExcMessage("Krylov dimension must be > 0"));
+         this->tol = tol;
+         m_max = max_dim;
+         V.clear();
+      }
+
+      //------------------------------------------------------------------------
+      // u = exp(t A) u, where apply(v, w) computes w = A v
+      //------------------------------------------------------------------------
+      template <typename Operator>
+      Stats advance(const Operator& apply, const double t, VectorType& u)
+      {
+         Stats stats;
+         if(t <= 0.0 || u.l2_norm() == 0.0) return stats;
+
+         if(V.size() != m_max + 1)
+            V.resize(m_max + 1);
+         for(auto& v : V)
+            if(v.size() != u.size())
+               v.reinit(u, true);
+
+         FullMatrix<double> H(m_max + 1, m_max);
+         FullMatrix<double> E;
+         double t_done = 0.0;
+         double tau_next = t;
+         while(t - t_done > 1.0e-12 * t)
+         {
+            const double beta = u.l2_norm();
+            V[0].equ(1.0 / beta, u);
+            H = 0.0;
+            double tau = std::min(tau_next, t - t_done);
+
+            // Arnoldi with modified Gram-Schmidt, until the error estimate
+            // is small enough or the largest dimension is reached
+            unsigned int m = 0;
+            double err = 0.0;
+            bool happy = false;
+            for(unsigned int j = 0; j < m_max; ++j)
+            {
+               apply(V[j], V[j + 1]);
+               ++stats.n_matvec;
+               for(unsigned int i = 0; i <= j; ++i)
+               {
+                  H(i, j) = V[j + 1] * V[i];
+                  V[j + 1].add(-H(i, j), V[i]);
+               }
+               const double h = V[j + 1].l2_norm();
+               m = j + 1;
+               // Krylov space is invariant and the solution is exact
+               if(h <= 1.0e-12 * H.frobenius_norm())
+               {
+                  happy = true;
+                  tau = t - t_done;
+                  break;
+               }
+               H(j + 1, j) = h;
+               V[j + 1] /= h;
+               err = estimate(H, m, tau, beta, E);
+               if(err <= tol * beta * tau / t) break;
+            }
+
+            // Reduce the substep; the Krylov space does not change
+            bool reduced = false;
+            for(unsigned int k = 0; !happy && err > tol * beta * tau / t; ++k)
+            {
+               AssertThrow(k < 50, ExcMessage("Krylov substep did not converge"));
+               const double ratio = tol * beta * tau / (t * err);
+               tau *= std::clamp(0.9 * std::pow(ratio, 1.0 / m), 0.1, 0.9);
+               err = estimate(H, m, tau, beta, E);
+               reduced = true;
+            }
+            if(happy)
+               estimate(H, m, tau, beta, E);
+
+            // u = beta V_m exp(tau H_m) e_1
+            u = 0.0;
+            for(unsigned int i = 0; i < m; ++i)
+               u.add(beta * E(i, 0), V[i]);
+
+            t_done += tau;
+            tau_next = reduced ? tau : t - t_done;
+            ++stats.n_substeps;
+            stats.max_dim = std::max(stats.max_dim, m);
+         }
+         return stats;
+      }
+
+   private:
+      //------------------------------------------------------------------------
+      // E = exp of [tau H_m, e_1; 0, 0], whose first column has exp(tau H_m) e_1
+      // and whose last column has phi_1(tau H_m) e_1; returns the error estimate
+      //------------------------------------------------------------------------
+      static double estimate(const FullMatrix<double>& H,
+                             const unsigned int        m,
+                             const double              tau,
+                             const double              beta,
+                             FullMatrix<double>&       E)
+      {
+         FullMatrix<double> Ha(m + 1, m + 1);
+         for(unsigned int i = 0; i < m; ++i)
+            for(unsigned int j = 0; j < m; ++j)
+               Ha(i, j) = tau * H(i, j);
+         Ha(0, m) = 1.0;
+         expm(Ha, E);
+         return beta * H(m, m - 1) * tau * std::fabs(E(m - 1, m));
+      }
+
+      double                  tol = 1.0e-8;
+      unsigned int            m_max = 30;
+      std::vector<VectorType> V;
+   };
+}
+
+#endif
@@ -0,0 +1,37 @@
+//------------------------------------------------------------------------------
+// Limiter primitives shared by the 2d system solvers and the benchmarks
+//------------------------------------------------------------------------------
+#ifndef __LIMITER_H__
+#define __LIMITER_H__
+
+#include <algorithm>
+#include <cmath>
+
+//------------------------------------------------------------------------------
+// minmod of three numbers; a is returned unchanged if |a| < Mh2 (TVB)
+//------------------------------------------------------------------------------
+inline double
+minmod(const double a, const double b, const double c, const double Mh2 = 0.0)
+{
+   double aa = std::fabs(a);
+   if(aa < Mh2) return a;
+
+   int sa = (a > 0.0) ? 1 : -1;
+   int sb = (b > 0.0) ? 1 : -1;
+   int sc = (c > 0.0) ? 1 : -1;
+
+   double result;
+
+   if(sa != sb || sb != sc)
+   {
+      result = 0.0;
+   }
+   else
+   {
+      result  = sa * std::min(aa, std::min(std::fabs(b), std::fabs(c)));
+   }
+
+   return result;
+}
+
+#endif
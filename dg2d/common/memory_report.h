@@ -0,0 +1,177 @@
+//------------------------------------------------------------------------------
+// Memory used by the data structures of a solver, and resident set size of
+// the process, summed over ranks, with an estimate of the largest number of
+// dofs which fit on one node.
+//
+// Items are given in bytes from memory_consumption() of deal.II objects. RSS
+// also contains libraries, MPI buffers and freed memory not returned to the
+// system, so it is larger than the sum of the items. The bytes per dof are
+// taken from the increase of the peak RSS above the RSS at reinit, which
+// should be called before the grid is made.
+//------------------------------------------------------------------------------
+#ifndef __MEMORY_REPORT_H__
+#define __MEMORY_REPORT_H__
+
+#include <deal.II/base/conditional_ostream.h>
+#include <deal.II/base/memory_consumption.h>
+#include <deal.II/base/mpi.h>
+#include <deal.II/base/multithread_info.h>
+#include <deal.II/base/quadrature.h>
+#include <deal.II/base/utilities.h>
+#include <deal.II/fe/fe_values.h>
+
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace MemoryReport
+{
+   using namespace dealii;
+
+   // Current and peak resident set size in bytes
+   inline std::pair<double,double>
+   rss()
+   {
+      Utilities::System::MemoryStats stats;
+      Utilities::System::get_memory_stats(stats);
+      return {1024.0 * stats.VmRSS, 1024.0 * stats.VmHWM};
+   }
+
+   // Physical memory of the node in bytes, 0 if not known
+   inline double
+   node_memory()
+   {
+      std::ifstream f("/proc/meminfo");
+      std::string name;
+      double kb;
+      while(f >> name >> kb)
+      {
+         if(name == "MemTotal:") return 1024.0 * kb;
+         f.ignore(256, '\n');
+      }
+      return 0.0;
+   }
+
+   //---------------------------------------------------------------------------
+   // Scratch data of mesh_loop, which keeps one copy per thread besides the
+   // sample one. FEInterfaceValues holds face and subface values of both
+   // cells, so it is counted as four FEFaceValues. work_bytes are the work
+   // arrays of one scratch object.
+   //---------------------------------------------------------------------------
+   template <int dim>
+   inline std::size_t
+   scratch_memory(const FEValues<dim>&     fe_values,
+                  const Quadrature<dim-1>& face_quadrature,
+                  const std::size_t        work_bytes)
+   {
+      const FEFaceValues<dim> fe_face_values(fe_values.get_mapping(),
+                                             fe_values.get_fe(),
+                                             face_quadrature,
+                                             update_values |
+                                             update_quadrature_points |
+                                             update_JxW_values |
+                                             update_normal_vectors);
+      const std::size_t bytes = fe_values.memory_consumption() +
+                                4 * fe_face_values.memory_consumption() +
+                                work_bytes;
+      return (MultithreadInfo::n_threads() + 1) * bytes;
+   }
+
+   //---------------------------------------------------------------------------
+   class Report
+   {
+   public:
+      // Call on all ranks before making the grid
+      void reinit(const MPI_Comm comm)
+      {
+         mpi_comm = comm;
+         rss0 = rss().first;
+         items.clear();
+      }
+
+      void clear()
+      {
+         items.clear();
+      }
+
+      void add(const std::string& name, const std::size_t bytes)
+      {
+         items.emplace_back(name, bytes);
+      }
+
+      //------------------------------------------------------------------------
+      // Must be called on all ranks with the same items
+      //------------------------------------------------------------------------
+      void print(ConditionalOStream&           pcout,
+                 const std::string&            title,
+                 const types::global_dof_index n_dofs) const
+      {
+         const double MiB = 1024.0 * 1024.0;
+         const unsigned int n_ranks = Utilities::MPI::n_mpi_processes(mpi_comm);
+
+         pcout << "\nMemory " << title << ", MiB per rank and sum over "
+               << n_ranks << " ranks\n";
+         pcout << std::left << std::setw(30) << "   item" << std::right
+               << std::setw(12) << "min" << std::setw(12) << "max"
+               << std::setw(12) << "sum" << "\n";
+         auto line = [&](const std::string& name, const double bytes)
+         {
+            const auto s = Utilities::MPI::min_max_avg(bytes, mpi_comm);
+            pcout << std::left << std::setw(30) << "   " + name << std::right
+                  << std::fixed << std::setprecision(2)
+                  << std::setw(12) << s.min / MiB
+                  << std::setw(12) << s.max / MiB
+                  << std::setw(12) << s.sum / MiB << std::defaultfloat << "\n";
+            return s.sum;
+         };
+
+         double total = 0.0;
+         for(const auto& [name, bytes] : items)
+         {
+            line(name, bytes);
+            total += bytes;
+         }
+         const double total_sum = line("Total of items", total);
+         const auto [now, peak] = rss();
+         line("RSS at start", rss0);
+         line("RSS", now);
+         const double peak_sum = line("Peak RSS", peak);
+         const double rss0_sum = Utilities::MPI::sum(rss0, mpi_comm);
+
+         const double items_per_dof = total_sum / n_dofs;
+         const double rss_per_dof = std::max(peak_sum - rss0_sum, 0.0) / n_dofs;
+         pcout << "   Bytes per dof = " << items_per_dof << " (items), "
+               << rss_per_dof << " (peak RSS above start), dofs = " << n_dofs
+               << "\n";
+
+         // Ranks sharing a node, and the fixed memory per rank
+         MPI_Comm node_comm;
+         MPI_Comm_split_type(mpi_comm, MPI_COMM_TYPE_SHARED, 0, MPI_INFO_NULL,
+                             &node_comm);
+         const unsigned int ranks_per_node =
+            Utilities::MPI::max(Utilities::MPI::n_mpi_processes(node_comm),
+                                mpi_comm);
+         MPI_Comm_free(&node_comm);
+         const double node_bytes = Utilities::MPI::min(node_memory(), mpi_comm);
+         const double rss0_max = Utilities::MPI::max(rss0, mpi_comm);
+         if(node_bytes > 0.0 && rss_per_dof > 0.0)
+         {
+            const double free = node_bytes - ranks_per_node * rss0_max;
+            pcout << "   Node memory = " << node_bytes / (1024.0 * MiB)
+                  << " GiB; with " << ranks_per_node << " ranks per node, "
+                  << "about " << std::max(free, 0.0) / rss_per_dof
+                  << " dofs fit on one node\n";
+         }
+      }
+
+   private:
+      MPI_Comm                                         mpi_comm = MPI_COMM_WORLD;
+      double                                           rss0 = 0.0;
+      std::vector<std::pair<std::string,std::size_t>>  items;
+   };
+}
+
+#endif
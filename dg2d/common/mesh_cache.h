@@ -0,0 +1,200 @@
+//------------------------------------------------------------------------------
+// Binary cache of grids read from gmsh files
+// Parsing a large ascii msh file can take much longer than the rest of the
+// setup. The coarse triangulation read from foo.msh is saved with boost
+// serialization in foo.msh.<hash>.tria, where the hash is of the file contents
+// and of the deal.II version, and is loaded on later runs. The archive keeps
+// boundary and manifold ids, but manifold objects, periodicity and grid
+// transformation are not stored and are applied by the solver after reading.
+//
+// The refined grid is cached too, in foo.msh.<hash>.tria with the number of
+// refinements and a key of the caller in the hash; the key must contain
+// everything else which changes the grid, e.g., the problem name. A serial
+// triangulation is saved with all its levels after transformation and
+// refinement; manifold objects and periodicity must be set again after
+// loading. A distributed triangulation is saved with p4est after the solver
+// has set up the coarse grid with periodicity, manifolds and transformation,
+// and loading it replaces refine_global; it can be loaded on any number of
+// ranks.
+//------------------------------------------------------------------------------
+#ifndef __MESH_CACHE_H__
+#define __MESH_CACHE_H__
+
+#include <deal.II/base/mpi.h>
+#include <deal.II/distributed/tria.h>
+#include <deal.II/grid/tria.h>
+#include <deal.II/grid/grid_in.h>
+
+#include <boost/archive/binary_iarchive.hpp>
+#include <boost/archive/binary_oarchive.hpp>
+
+#include <cstdio>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+
+namespace MeshCache
+{
+   using namespace dealii;
+
+   //---------------------------------------------------------------------------
+   // Reading the file as bytes is cheap compared to parsing it
+   //---------------------------------------------------------------------------
+   inline std::string
+   file_name(const std::string& grid_file,
+             const int          dim,
+             const std::string& key = "")
+   {
+      std::ifstream in(grid_file, std::ios::binary);
+      AssertThrow(in.is_open(), ExcMessage("Grid file not found"));
+      std::ostringstream contents;
+      contents << in.rdbuf() << "|" << dim << "|" << DEAL_II_PACKAGE_VERSION
+               << key;
+      const std::size_t hash = std::hash<std::string>()(contents.str());
+      std::ostringstream name;
+      name << grid_file << "." << std::hex << hash << ".tria";
+      return name.str();
+   }
+
+   //---------------------------------------------------------------------------
+   // Returns false if there is no cache or it cannot be read
+   //---------------------------------------------------------------------------
+   template <int dim>
+   inline bool
+   load(const std::string& cache_file, Triangulation<dim>& triangulation)
+   {
+      std::ifstream in(cache_file, std::ios::binary);
+      if(!in.is_open()) return false;
+      try
+      {
+         boost::archive::binary_iarchive archive(in);
+         triangulation.load(archive, 0);
+      }
+      catch(...)
+      {
+         triangulation.clear();
+         return false;
+      }
+      return true;
+   }
+
+   //---------------------------------------------------------------------------
+   // Write to a temporary file and rename it, so that other processes never
+   // read a partial file
+   //---------------------------------------------------------------------------
+   template <int dim>
+   inline void
+   save(const std::string& cache_file, const Triangulation<dim>& triangulation)
+   {
+      const std::string tmp_file = cache_file + ".tmp";
+      {
+         std::ofstream out(tmp_file, std::ios::binary);
+         if(!out.is_open()) return; // e.g., read-only directory
+         boost::archive::binary_oarchive archive(out);
+         triangulation.save(archive, 0);
+      }
+      std::rename(tmp_file.c_str(), cache_file.c_str());
+   }
+
+   //---------------------------------------------------------------------------
+   // Read gmsh file into a serial triangulation, from the cache if possible.
+   // If the cache is used but does not exist, it is written by rank 0 of
+   // mpi_comm. Returns true if the grid was loaded from the cache.
+   //---------------------------------------------------------------------------
+   template <int dim>
+   inline bool
+   read_msh(const std::string&  grid_file,
+            Triangulation<dim>& triangulation,
+            const bool          use_cache,
+            const MPI_Comm      mpi_comm = MPI_COMM_SELF)
+   {
+      const std::string cache_file = use_cache ? file_name(grid_file, dim) : "";
+      if(use_cache && load(cache_file, triangulation)) return true;
+
+      GridIn<dim> grid_in;
+      grid_in.attach_triangulation(triangulation);
+      std::ifstream gfile(grid_file);
+      AssertThrow(gfile.is_open(), ExcMessage("Grid file not found"));
+      grid_in.read_msh(gfile);
+
+      if(use_cache && Utilities::MPI::this_mpi_process(mpi_comm) == 0)
+         save(cache_file, triangulation);
+      return false;
+   }
+
+   //---------------------------------------------------------------------------
+   // Name of cache of grid_file refined n_refine times
+   //---------------------------------------------------------------------------
+   inline std::string
+   refined_file_name(const std::string& grid_file,
+                     const int          dim,
+                     const unsigned int n_refine,
+                     const std::string& key)
+   {
+      return file_name(grid_file, dim,
+                       "|refine=" + std::to_string(n_refine) + "|" + key);
+   }
+
+   //---------------------------------------------------------------------------
+   // Serial triangulation with all levels; returns true if loaded
+   //---------------------------------------------------------------------------
+   template <int dim>
+   inline bool
+   load_refined(const std::string&  cache_file,
+                Triangulation<dim>& triangulation)
+   {
+      return load(cache_file, triangulation);
+   }
+
+   template <int dim>
+   inline void
+   save_refined(const std::string&        cache_file,
+                const Triangulation<dim>& triangulation)
+   {
+      save(cache_file, triangulation);
+   }
+
+   //---------------------------------------------------------------------------
+   // Distributed triangulation, which must have the coarse grid of the saved
+   // one. Rank 0 checks that the files exist, so that all ranks load or none.
+   //---------------------------------------------------------------------------
+   template <int dim>
+   inline bool
+   load_refined(const std::string&                         cache_file,
+                parallel::distributed::Triangulation<dim>& triangulation)
+   {
+      const MPI_Comm mpi_comm = triangulation.get_communicator();
+      int found = 0;
+      if(Utilities::MPI::this_mpi_process(mpi_comm) == 0)
+         found = std::ifstream(cache_file).good() &&
+                 std::ifstream(cache_file + ".info").good();
+      found = Utilities::MPI::broadcast(mpi_comm, found, 0);
+      if(!found) return false;
+      triangulation.load(cache_file);
+      return true;
+   }
+
+   //---------------------------------------------------------------------------
+   // Collective. The files are written under a temporary name and renamed by
+   // rank 0, so that other runs never read a partial cache.
+   //---------------------------------------------------------------------------
+   template <int dim>
+   inline void
+   save_refined(const std::string&                               cache_file,
+                const parallel::distributed::Triangulation<dim>& triangulation)
+   {
+      const MPI_Comm mpi_comm = triangulation.get_communicator();
+      const std::string tmp_file = cache_file + ".tmp";
+      triangulation.save(tmp_file);
+      Utilities::MPI::sum(0, mpi_comm); // all ranks have written their part
+      if(Utilities::MPI::this_mpi_process(mpi_comm) == 0)
+         for(const std::string suffix : {"", "_fixed.data", "_variable.data",
+                                         ".info"})
+            if(std::ifstream(tmp_file + suffix).good())
+               std::rename((tmp_file + suffix).c_str(),
+                           (cache_file + suffix).c_str());
+   }
+}
+
+#endif
@@ -0,0 +1,339 @@
+//------------------------------------------------------------------------------
+// Hardware counters of phases of a solver, read with Linux perf_event_open
+//
+// Each phase accumulates time, cycles, instructions, last level cache misses
+// and floating point operations of the calling thread in user mode. Memory
+// traffic is estimated as 64 bytes per cache miss, which ignores prefetching
+// and write backs, so GB/s is a lower bound. The FP events are model specific
+// raw events given as config:flops_per_event; the default is for Intel cores
+// since Skylake (FP_ARITH_INST_RETIRED scalar, 128, 256, 512 bit double).
+// FMA instructions are counted as two flops by these events.
+//
+// The report compares the phases with a STREAM triad and an FMA loop run at
+// startup, which give the bandwidth and flop rate achievable by this code on
+// each rank. If counters cannot be opened (not Linux, perf_event_paranoid,
+// containers), only times are reported.
+//------------------------------------------------------------------------------
+#ifndef __PERF_COUNTERS_H__
+#define __PERF_COUNTERS_H__
+
+#include <deal.II/base/conditional_ostream.h>
+#include <deal.II/base/mpi.h>
+#include <deal.II/base/timer.h>
+#include <deal.II/base/utilities.h>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+#include <algorithm>
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <map>
+#include <string>
+#include <vector>
+
+namespace PerfCounters
+{
+   using namespace dealii;
+
+   // Order of counts in a phase
+   enum {cycles, instructions, cache_misses, flops, n_counts};
+
+   //---------------------------------------------------------------------------
+   // One perf event group; read gives counts scaled for multiplexing
+   //---------------------------------------------------------------------------
+   class Group
+   {
+   public:
+      Group() = default;
+      Group(const Group&) = delete;
+      ~Group()
+      {
+#ifdef __linux__
+         for(const auto fd : fds) close(fd);
+#endif
+      }
+
+      // Returns false if the event is not available
+      bool add(const uint32_t type, const uint64_t config)
+      {
+#ifdef __linux__
+         perf_event_attr attr{};
+         attr.size = sizeof(attr);
+         attr.type = type;
+         attr.config = config;
+         attr.disabled = fds.empty() ? 1 : 0;
+         attr.exclude_kernel = 1;
+         attr.exclude_hv = 1;
+         attr.read_format = PERF_FORMAT_GROUP |
+                            PERF_FORMAT_TOTAL_TIME_ENABLED |
+                            PERF_FORMAT_TOTAL_TIME_RUNNING;
+         const int leader = fds.empty() ? -1 : fds[0];
+         const int fd = syscall(__NR_perf_event_open, &attr, 0, -1, leader, 0);
+         if(fd < 0) return false;
+         fds.push_back(fd);
+         return true;
+#else
+         (void) type;
+         (void) config;
+         return false;
+#endif
+      }
+
+      unsigned int size() const
+      {
+         return fds.size();
+      }
+
+      void start()
+      {
+#ifdef __linux__
+         if(!fds.empty())
+            ioctl(fds[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+#endif
+      }
+
+      std::vector<double> read() const
+      {
+         std::vector<double> counts(fds.size(), 0.0);
+#ifdef __linux__
+         if(fds.empty()) return counts;
+         std::vector<uint64_t> buffer(3 + fds.size());
+         if(::read(fds[0], buffer.data(), buffer.size() * sizeof(uint64_t)) <= 0)
+            return counts;
+         const double scale = (buffer[2] > 0) ? double(buffer[1]) / buffer[2]
+                                              : 0.0;
+         for(unsigned int i = 0; i < fds.size(); ++i)
+            counts[i] = scale * buffer[3 + i];
+#endif
+         return counts;
+      }
+
+   private:
+      std::vector<int> fds;
+   };
+
+   //---------------------------------------------------------------------------
+   // STREAM triad a = b + s c on arrays much larger than caches, best of
+   // n_trials; returns GB/s counting 24 bytes per entry as STREAM does
+   //---------------------------------------------------------------------------
+   inline double
+   stream_triad(const unsigned int n = 1u << 23, const unsigned int n_trials = 5)
+   {
+      std::vector<double> a(n, 0.0), b(n, 1.0), c(n, 2.0);
+      const double s = 3.0;
+      double best = 1.0e20;
+      for(unsigned int t = 0; t < n_trials; ++t)
+      {
+         const auto t0 = std::chrono::steady_clock::now();
+         for(unsigned int i = 0; i < n; ++i)
+            a[i] = b[i] + s * c[i];
+         const auto t1 = std::chrono::steady_clock::now();
+         best = std::min(best, std::chrono::duration<double>(t1 - t0).count());
+         std::swap(a, b);
+      }
+      volatile double sink = a[n / 2];
+      (void) sink;
+      return 24.0 * n / best * 1.0e-9;
+   }
+
+   //---------------------------------------------------------------------------
+   // Independent multiply-add chains which the compiler can vectorize; returns
+   // GFLOP/s of one core as compiled, not the theoretical peak
+   //---------------------------------------------------------------------------
+   inline double
+   fma_peak(const unsigned int n_iter = 1u << 22)
+   {
+      constexpr unsigned int n_chains = 32;
+      alignas(64) double x[n_chains];
+      for(unsigned int j = 0; j < n_chains; ++j)
+         x[j] = 1.0 + 1.0e-3 * j;
+      const double a = 0.999999, b = 1.0e-7;
+      const auto t0 = std::chrono::steady_clock::now();
+      for(unsigned int i = 0; i < n_iter; ++i)
+         for(unsigned int j = 0; j < n_chains; ++j)
+            x[j] = x[j] * a + b;
+      const auto t1 = std::chrono::steady_clock::now();
+      double sum = 0.0;
+      for(unsigned int j = 0; j < n_chains; ++j)
+         sum += x[j];
+      volatile double sink = sum;
+      (void) sink;
+      const double time = std::chrono::duration<double>(t1 - t0).count();
+      return 2.0 * n_chains * n_iter / time * 1.0e-9;
+   }
+
+   //---------------------------------------------------------------------------
+   // Phases are identified by name; use Scope around the code of a phase.
+   // Phases must not be nested.
+   //---------------------------------------------------------------------------
+   class Monitor
+   {
+   public:
+      // fp_events: comma separated list of config:flops, config in hex
+      void reinit(const bool enable, const std::string& fp_events,
+                  const MPI_Comm comm)
+      {
+         enabled = enable;
+         mpi_comm = comm;
+         phases.clear();
+         if(!enabled) return;
+
+         fp_weights.clear();
+#ifdef __linux__
+         have_counters =
+            basic.add(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES) &&
+            basic.add(PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS) &&
+            basic.add(PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES);
+         for(const auto& entry : Utilities::split_string_list(fp_events))
+         {
+            const auto cw = Utilities::split_string_list(entry, ':');
+            AssertThrow(cw.size() == 2,
+                        ExcMessage("Give perf fp events as: config:flops,..."));
+            if(have_counters &&
+               fp.add(PERF_TYPE_RAW, std::stoull(cw[0], nullptr, 16)))
+               fp_weights.push_back(Utilities::string_to_double(cw[1]));
+         }
+#else
+         (void) fp_events;
+#endif
+         have_counters = Utilities::MPI::min(have_counters ? 1 : 0, mpi_comm);
+         have_flops = Utilities::MPI::min(fp_weights.empty() ? 0 : 1, mpi_comm);
+         basic.start();
+         fp.start();
+
+         // Probes run on all ranks at the same time, as the solver does
+         MPI_Barrier(mpi_comm);
+         stream_bw = stream_triad();
+         peak_flops = fma_peak();
+      }
+
+      bool is_enabled() const
+      {
+         return enabled;
+      }
+
+      class Scope
+      {
+      public:
+         Scope(Monitor& monitor, const std::string& name)
+            :
+            monitor(monitor),
+            name(name)
+         {
+            if(monitor.enabled) monitor.read(start);
+         }
+
+         ~Scope()
+         {
+            if(!monitor.enabled) return;
+            std::array<double, n_counts + 1> end;
+            monitor.read(end);
+            auto& phase = monitor.phases[name];
+            for(unsigned int i = 0; i <= n_counts; ++i)
+               phase[i] += end[i] - start[i];
+         }
+
+      private:
+         Monitor&                         monitor;
+         const std::string                name;
+         std::array<double, n_counts + 1> start;
+      };
+
+      // Sums over ranks; must be called on all ranks
+      void print(ConditionalOStream& pcout) const
+      {
+         if(!enabled) return;
+         const unsigned int n_ranks = Utilities::MPI::n_mpi_processes(mpi_comm);
+         const double total_bw = Utilities::MPI::sum(stream_bw, mpi_comm);
+         const double total_peak = Utilities::MPI::sum(peak_flops, mpi_comm);
+
+         pcout << "\nHardware counters, sum over " << n_ranks << " ranks\n";
+         pcout << "   STREAM triad = " << total_bw << " GB/s, FMA loop = "
+               << total_peak << " GFLOP/s\n";
+         if(!have_counters)
+            pcout << "   Counters not available, see /proc/sys/kernel/perf_event_paranoid\n";
+         else if(!have_flops)
+            pcout << "   FP events not available, set perf fp events for this cpu\n";
+
+         pcout << std::left << std::setw(18) << "   phase"
+               << std::right << std::setw(10) << "time(s)"
+               << std::setw(8) << "IPC"
+               << std::setw(10) << "GFLOP/s"
+               << std::setw(8) << "%peak"
+               << std::setw(10) << "GB/s"
+               << std::setw(8) << "%bw"
+               << std::setw(10) << "flop/B" << "\n";
+         for(const auto& [name, local] : phases)
+         {
+            std::vector<double> c(local.begin(), local.end());
+            const double time = Utilities::MPI::max(c[n_counts], mpi_comm);
+            c = Utilities::MPI::sum(c, mpi_comm);
+            const double bytes = 64.0 * c[cache_misses];
+            pcout << std::left << std::setw(18) << "   " + name << std::right
+                  << std::fixed << std::setprecision(3)
+                  << std::setw(10) << time;
+            if(have_counters && time > 0.0)
+            {
+               const double gflops = c[flops] / time * 1.0e-9;
+               const double gbs = bytes / time * 1.0e-9;
+               pcout << std::setw(8) << std::setprecision(2)
+                     << c[instructions] / std::max(c[cycles], 1.0);
+               if(have_flops)
+                  pcout << std::setw(10) << gflops
+                        << std::setw(8) << std::setprecision(1)
+                        << 100.0 * gflops / total_peak;
+               else
+                  pcout << std::setw(10) << "-" << std::setw(8) << "-";
+               pcout << std::setw(10) << std::setprecision(2) << gbs
+                     << std::setw(8) << std::setprecision(1)
+                     << 100.0 * gbs / total_bw;
+               if(have_flops && bytes > 0.0)
+                  pcout << std::setw(10) << std::setprecision(2)
+                        << c[flops] / bytes;
+               else
+                  pcout << std::setw(10) << "-";
+            }
+            pcout << std::defaultfloat << "\n";
+         }
+         if(have_flops)
+            pcout << "   Machine balance = " << total_peak / total_bw
+                  << " flop/B; phases below it are bandwidth bound\n";
+      }
+
+   private:
+      // counts and time in seconds in the last entry
+      void read(std::array<double, n_counts + 1>& c) const
+      {
+         c.fill(0.0);
+         if(have_counters)
+         {
+            const auto b = basic.read();
+            for(unsigned int i = 0; i < b.size(); ++i)
+               c[i] = b[i];
+            const auto f = fp.read();
+            for(unsigned int i = 0; i < f.size(); ++i)
+               c[flops] += fp_weights[i] * f[i];
+         }
+         c[n_counts] = timer.wall_time();
+      }
+
+      bool                 enabled = false;
+      bool                 have_counters = false;
+      bool                 have_flops = false;
+      MPI_Comm             mpi_comm = MPI_COMM_WORLD;
+      Group                basic, fp;
+      std::vector<double>  fp_weights;
+      double               stream_bw = 0.0, peak_flops = 0.0;
+      Timer                timer;
+      std::map<std::string, std::array<double, n_counts + 1>> phases;
+   };
+}
+
+#endif
@@ -0,0 +1,224 @@
+//------------------------------------------------------------------------------
+// Orderings of cells and dofs which improve memory locality of the cell and
+// face loops. Cells are sorted along a space filling curve (Morton or Hilbert)
+// through their centers; dofs are numbered cell by cell along this curve or
+// by a breadth first search over face neighbours (Cuthill-McKee on cells).
+//------------------------------------------------------------------------------
+#ifndef __RENUMBER_H__
+#define __RENUMBER_H__
+
+#include <deal.II/grid/tria.h>
+#include <deal.II/grid/grid_tools.h>
+#include <deal.II/dofs/dof_handler.h>
+#include <deal.II/dofs/dof_renumbering.h>
+
+#include <algorithm>
+#include <cstdint>
+#include <numeric>
+#include <queue>
+
+namespace Renumber
+{
+   using namespace dealii;
+
+   // Points are mapped to a 2^16 x 2^16 integer grid before computing keys
+   const std::uint32_t n_bits = 16;
+
+   //---------------------------------------------------------------------------
+   // Interleave the bits of x and y
+   //---------------------------------------------------------------------------
+   inline std::uint64_t
+   morton_key(const std::uint32_t x, const std::uint32_t y)
+   {
+      auto spread = [](std::uint64_t v)
+      {
+         v = (v | (v << 16)) & 0x0000FFFF0000FFFFull;
+         v = (v | (v << 8))  & 0x00FF00FF00FF00FFull;
+         v = (v | (v << 4))  & 0x0F0F0F0F0F0F0F0Full;
+         v = (v | (v << 2))  & 0x3333333333333333ull;
+         v = (v | (v << 1))  & 0x5555555555555555ull;
+         return v;
+      };
+      return spread(x) | (spread(y) << 1);
+   }
+
+   //---------------------------------------------------------------------------
+   // Distance of (x,y) along the Hilbert curve filling a n x n grid, where n is
+   // a power of 2.
+   //---------------------------------------------------------------------------
+   inline std::uint64_t
+   hilbert_key(const std::uint32_t n, std::uint32_t x, std::uint32_t y)
+   {
+      std::uint64_t d = 0;
+      for(std::uint32_t s = n / 2; s > 0; s /= 2)
+      {
+         const std::uint32_t rx = (x & s) > 0;
+         const std::uint32_t ry = (y & s) > 0;
+         d += std::uint64_t(s) * s * ((3 * rx) ^ ry);
+         // rotate quadrant
+         if(ry == 0)
+         {
+            if(rx == 1)
+            {
+               x = n - 1 - x;
+               y = n - 1 - y;
+            }
+            std::swap(x, y);
+         }
+      }
+      return d;
+   }
+
+   //---------------------------------------------------------------------------
+   // Permutation which sorts the points along the given curve:
+   // points[order[0]], points[order[1]], ... are in curve order.
+   //---------------------------------------------------------------------------
+   template <int dim>
+   std::vector<unsigned int>
+   curve_order(const std::vector<Point<dim>>& points, const std::string& curve)
+   {
+      AssertThrow(dim == 2, ExcNotImplemented());
+      AssertThrow(curve == "morton" || curve == "hilbert",
+                  ExcMessage("Unknown space filling curve " + curve));
+
+      Point<dim> pmin = points[0], pmax = points[0];
+      for(const auto& p : points)
+         for(unsigned int d = 0; d < dim; ++d)
+         {
+            pmin[d] = std::min(pmin[d], p[d]);
+            pmax[d] = std::max(pmax[d], p[d]);
+         }
+
+      const std::uint32_t n = 1u << n_bits;
+      std::vector<std::uint64_t> key(points.size());
+      for(unsigned int i = 0; i < points.size(); ++i)
+      {
+         std::uint32_t ix[dim];
+         for(unsigned int d = 0; d < dim; ++d)
+         {
+            const double len = std::max(pmax[d] - pmin[d], 1.0e-300);
+            const double s = (points[i][d] - pmin[d]) / len;
+            ix[d] = std::min<std::uint32_t>(s * n, n - 1);
+         }
+         key[i] = (curve == "morton") ? morton_key(ix[0], ix[1])
+                                      : hilbert_key(n, ix[0], ix[1]);
+      }
+
+      std::vector<unsigned int> order(points.size());
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(),
+                       [&](const unsigned int a, const unsigned int b)
+                       { return key[a] < key[b]; });
+      return order;
+   }
+
+   //---------------------------------------------------------------------------
+   // Create triangulation "out" from the coarse cells of "in" sorted along
+   // a space filling curve. Boundary and manifold ids are preserved. Since a
+   // distributed triangulation partitions the coarse cells in the order in
+   // which they are given, this also gives compact partitions.
+   //---------------------------------------------------------------------------
+   template <int dim>
+   void
+   reorder_coarse_cells(const Triangulation<dim>& in,
+                        Triangulation<dim>&       out,
+                        const std::string&        curve)
+   {
+      auto [vertices, cells, subcelldata]
+         = GridTools::get_coarse_mesh_description(in);
+
+      std::vector<Point<dim>> centers(cells.size());
+      for(unsigned int c = 0; c < cells.size(); ++c)
+      {
+         for(const auto v : cells[c].vertices)
+            centers[c] += vertices[v];
+         centers[c] /= cells[c].vertices.size();
+      }
+
+      const auto order = curve_order(centers, curve);
+      std::vector<CellData<dim>> sorted_cells(cells.size());
+      for(unsigned int c = 0; c < cells.size(); ++c)
+         sorted_cells[c] = cells[order[c]];
+
+      out.create_triangulation(vertices, sorted_cells, subcelldata);
+   }
+
+   //---------------------------------------------------------------------------
+   // Locally owned cells in breadth first order over face neighbours, starting
+   // from the first cell in iteration order. Periodic neighbours are followed.
+   //---------------------------------------------------------------------------
+   template <int dim>
+   std::vector<typename DoFHandler<dim>::active_cell_iterator>
+   cuthill_mckee_cells(const DoFHandler<dim>& dof_handler)
+   {
+      using Iterator = typename DoFHandler<dim>::active_cell_iterator;
+      const auto& tria = dof_handler.get_triangulation();
+      std::vector<bool> visited(tria.n_active_cells(), false);
+      std::vector<Iterator> order;
+      std::queue<Iterator> queue;
+
+      for(const auto& seed : dof_handler.active_cell_iterators())
+      if(seed->is_locally_owned() && !visited[seed->active_cell_index()])
+      {
+         visited[seed->active_cell_index()] = true;
+         queue.push(seed);
+         while(!queue.empty())
+         {
+            const auto cell = queue.front();
+            queue.pop();
+            order.push_back(cell);
+            for(const unsigned int f : cell->face_indices())
+            {
+               if(cell->at_boundary(f) && !cell->has_periodic_neighbor(f))
+                  continue;
+               const auto ncell = cell->neighbor_or_periodic_neighbor(f);
+               if(ncell->is_active() && ncell->is_locally_owned() &&
+                  !visited[ncell->active_cell_index()])
+               {
+                  visited[ncell->active_cell_index()] = true;
+                  queue.push(ncell);
+               }
+            }
+         }
+      }
+
+      return order;
+   }
+
+   //---------------------------------------------------------------------------
+   // Locally owned cells in iteration order, which follows the order of the
+   // coarse cells and the z-order of their children.
+   //---------------------------------------------------------------------------
+   template <int dim>
+   std::vector<typename DoFHandler<dim>::active_cell_iterator>
+   natural_cells(const DoFHandler<dim>& dof_handler)
+   {
+      std::vector<typename DoFHandler<dim>::active_cell_iterator> order;
+      for(const auto& cell : dof_handler.active_cell_iterators())
+         if(cell->is_locally_owned())
+            order.push_back(cell);
+      return order;
+   }
+
+   //---------------------------------------------------------------------------
+   // Set cell user index: owned cells in the given order followed by ghost
+   // cells, so that cell data like averages is stored in the same order as
+   // the dofs. Returns number of cells which got an index.
+   //---------------------------------------------------------------------------
+   template <int dim>
+   unsigned int
+   set_user_indices(
+      const DoFHandler<dim>&                                             dof_handler,
+      const std::vector<typename DoFHandler<dim>::active_cell_iterator>& owned_cells)
+   {
+      unsigned int counter = 0;
+      for(const auto& cell : owned_cells)
+         cell->set_user_index(counter++);
+      for(const auto& cell : dof_handler.active_cell_iterators())
+         if(cell->is_ghost())
+            cell->set_user_index(counter++);
+      return counter;
+   }
+
+}
+#endif
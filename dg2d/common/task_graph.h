@@ -0,0 +1,125 @@
+//------------------------------------------------------------------------------
+// Directed acyclic graph of tasks, each of which runs when all the tasks it
+// depends on have finished. There is no barrier between the tasks: a task is
+// started as soon as its last dependency finishes, on the thread which
+// finished it, so that data written by a task is read while it is in cache.
+//
+// With TBB, tasks are run by its work stealing scheduler; otherwise they run
+// one after another in an order which respects the dependencies.
+//------------------------------------------------------------------------------
+#ifndef __TASK_GRAPH_H__
+#define __TASK_GRAPH_H__
+
+#include <deal.II/base/config.h>
+#include <deal.II/base/exceptions.h>
+
+#ifdef DEAL_II_WITH_TBB
+#include <tbb/task_group.h>
+#endif
+
+#include <atomic>
+#include <deque>
+#include <functional>
+#include <vector>
+
+namespace TaskGraph
+{
+   using namespace dealii;
+
+   class Graph
+   {
+   public:
+      void clear()
+      {
+         tasks.clear();
+      }
+
+      // Returns the index of the new task
+      unsigned int add(std::function<void()> work)
+      {
+         tasks.push_back({std::move(work), {}, 0});
+         return tasks.size() - 1;
+      }
+
+      // Task runs after task before; repeated edges are ignored
+      void depends(const unsigned int task, const unsigned int before)
+      {
+         AssertIndexRange(task, tasks.size());
+         AssertIndexRange(before, task); // tasks are added in a valid order
+         auto& next = tasks[before].next;
+         for(const auto t : next)
+            if(t == task) return;
+         next.push_back(task);
+         ++tasks[task].n_before;
+      }
+
+      unsigned int size() const
+      {
+         return tasks.size();
+      }
+
+      //------------------------------------------------------------------------
+      // Run all tasks and return when they have finished. Exceptions thrown
+      // by a task are passed on to the caller.
+      //------------------------------------------------------------------------
+      void run()
+      {
+         const unsigned int n = tasks.size();
+         std::vector<std::atomic<unsigned int>> remaining(n);
+         for(unsigned int i = 0; i < n; ++i)
+            remaining[i] = tasks[i].n_before;
+
+#ifdef DEAL_II_WITH_TBB
+         tbb::task_group group;
+         std::function<void(unsigned int)> execute = [&](unsigned int i)
+         {
+            while(true)
+            {
+               tasks[i].work();
+               // Spawn all ready successors but one, which this thread runs
+               unsigned int ready = n;
+               for(const auto t : tasks[i].next)
+                  if(--remaining[t] == 0)
+                  {
+                     if(ready < n)
+                        group.run([&execute, ready]() { execute(ready); });
+                     ready = t;
+                  }
+               if(ready == n) return;
+               i = ready;
+            }
+         };
+         for(unsigned int i = 0; i < n; ++i)
+            if(tasks[i].n_before == 0)
+               group.run([&execute, i]() { execute(i); });
+         group.wait();
+#else
+         std::deque<unsigned int> ready;
+         for(unsigned int i = 0; i < n; ++i)
+            if(tasks[i].n_before == 0)
+               ready.push_back(i);
+         while(!ready.empty())
+         {
+            const unsigned int i = ready.front();
+            ready.pop_front();
+            tasks[i].work();
+            for(const auto t : tasks[i].next)
+               if(--remaining[t] == 0)
+                  ready.push_back(t);
+         }
+#endif
+      }
+
+   private:
+      struct Task
+      {
+         std::function<void()>     work;
+         std::vector<unsigned int> next;     // tasks which depend on this one
+         unsigned int              n_before; // tasks this one depends on
+      };
+
+      std::vector<Task> tasks;
+   };
+}
+
+#endif
@@ -0,0 +1,209 @@
+//------------------------------------------------------------------------------
+// Sum factorization for the tensor product Legendre basis FE_DGQLegendre in 2d.
+// The shape function with index i + n*j, n = degree+1, is L_i(x) L_j(y), see
+// deal.II/misc/tensor_product_order. Quadrature points are the tensor product
+// of 1d Gauss points with the x index running fastest, like QGauss<2>.
+//
+// Each function works on one component: c has n*n coefficients, u has values
+// at n_q*n_q points (cell) or n_q points (face). Faces 0,1 are x = 0,1 and
+// faces 2,3 are y = 0,1 in reference coordinates, and face points are ordered
+// along the tangential coordinate.
+//------------------------------------------------------------------------------
+#ifndef __TENSOR_PRODUCT_H__
+#define __TENSOR_PRODUCT_H__
+
+#include <deal.II/base/quadrature_lib.h>
+#include <deal.II/base/table.h>
+#include <deal.II/fe/fe_dgq.h>
+
+#include <vector>
+
+namespace TensorProduct
+{
+   using namespace dealii;
+
+   //---------------------------------------------------------------------------
+   // 1d basis values at Gauss points and at end points of [0,1]
+   //---------------------------------------------------------------------------
+   struct Basis1D
+   {
+      void reinit(const unsigned int degree, const unsigned int n_q_points)
+      {
+         n = degree + 1;
+         n_q = n_q_points;
+         const QGauss<1> quadrature(n_q);
+         const FE_DGQLegendre<1> fe(degree);
+         points.resize(n_q);
+         weights.resize(n_q);
+         value.reinit(n_q, n);
+         grad.reinit(n_q, n);
+         face_value.reinit(2, n);
+         for(unsigned int q = 0; q < n_q; ++q)
+         {
+            points[q] = quadrature.point(q)[0];
+            weights[q] = quadrature.weight(q);
+            for(unsigned int i = 0; i < n; ++i)
+            {
+               value(q, i) = fe.shape_value(i, quadrature.point(q));
+               grad(q, i) = fe.shape_grad(i, quadrature.point(q))[0];
+            }
+         }
+         for(unsigned int i = 0; i < n; ++i)
+         {
+            face_value(0, i) = fe.shape_value(i, Point<1>(0.0));
+            face_value(1, i) = fe.shape_value(i, Point<1>(1.0));
+         }
+      }
+
+      unsigned int        n, n_q;
+      std::vector<double> points, weights;
+      Table<2,double>     value, grad; // [q][i]
+      Table<2,double>     face_value;  // [side][i]
+   };
+
+   //---------------------------------------------------------------------------
+   // Work array for the intermediate sums
+   //---------------------------------------------------------------------------
+   template <typename Number>
+   inline Number*
+   work_array(std::vector<Number>& tmp, const unsigned int size)
+   {
+      if(tmp.size() < size) tmp.resize(size);
+      return tmp.data();
+   }
+
+   //---------------------------------------------------------------------------
+   // u(qx,qy) = sum_i L_i(x_qx) sum_j L_j(y_qy) c(i,j)
+   //---------------------------------------------------------------------------
+   template <typename Number>
+   inline void
+   evaluate_cell(const Basis1D&       b,
+                 const Number*        c,
+                 Number*              u,
+                 std::vector<Number>& tmp)
+   {
+      const unsigned int n = b.n, n_q = b.n_q;
+      Number* t = work_array(tmp, n * n_q); // t(i,qy)
+      for(unsigned int qy = 0; qy < n_q; ++qy)
+         for(unsigned int i = 0; i < n; ++i)
+         {
+            Number s = 0;
+            for(unsigned int j = 0; j < n; ++j)
+               s += b.value(qy, j) * c[i + n * j];
+            t[i + n * qy] = s;
+         }
+      for(unsigned int qy = 0; qy < n_q; ++qy)
+         for(unsigned int qx = 0; qx < n_q; ++qx)
+         {
+            Number s = 0;
+            for(unsigned int i = 0; i < n; ++i)
+               s += b.value(qx, i) * t[i + n * qy];
+            u[qx + n_q * qy] = s;
+         }
+   }
+
+   //---------------------------------------------------------------------------
+   // r(i,j) += integral of (fx d/dx + fy d/dy)(L_i(x) L_j(y)) over the cell
+   // of size hx * hy
+   //---------------------------------------------------------------------------
+   template <typename Number>
+   inline void
+   integrate_cell(const Basis1D&       b,
+                  const Number*        fx,
+                  const Number*        fy,
+                  const double         hx,
+                  const double         hy,
+                  Number*              r,
+                  std::vector<Number>& tmp)
+   {
+      const unsigned int n = b.n, n_q = b.n_q;
+      Number* ta = work_array(tmp, 2 * n * n_q); // ta(i,qy), tb(i,qy)
+      Number* tb = ta + n * n_q;
+      for(unsigned int qy = 0; qy < n_q; ++qy)
+         for(unsigned int i = 0; i < n; ++i)
+         {
+            Number sa = 0, sb = 0;
+            for(unsigned int qx = 0; qx < n_q; ++qx)
+            {
+               const unsigned int q = qx + n_q * qy;
+               sa += b.weights[qx] * b.grad(qx, i) * fx[q];
+               sb += b.weights[qx] * b.value(qx, i) * fy[q];
+            }
+            ta[i + n * qy] = hy * b.weights[qy] * sa;
+            tb[i + n * qy] = hx * b.weights[qy] * sb;
+         }
+      for(unsigned int j = 0; j < n; ++j)
+         for(unsigned int i = 0; i < n; ++i)
+         {
+            Number s = 0;
+            for(unsigned int qy = 0; qy < n_q; ++qy)
+               s += b.value(qy, j) * ta[i + n * qy] +
+                    b.grad(qy, j) * tb[i + n * qy];
+            r[i + n * j] += s;
+         }
+   }
+
+   //---------------------------------------------------------------------------
+   // Trace on face f at the face quadrature points
+   //---------------------------------------------------------------------------
+   template <typename Number>
+   inline void
+   evaluate_face(const Basis1D&       b,
+                 const unsigned int   f,
+                 const Number*        c,
+                 Number*              u,
+                 std::vector<Number>& tmp)
+   {
+      const unsigned int n = b.n, n_q = b.n_q;
+      const unsigned int side = f % 2;
+      Number* t = work_array(tmp, n); // coefficients of trace
+      for(unsigned int k = 0; k < n; ++k)
+      {
+         Number s = 0;
+         for(unsigned int l = 0; l < n; ++l)
+            s += b.face_value(side, l) * ((f < 2) ? c[l + n * k] : c[k + n * l]);
+         t[k] = s;
+      }
+      for(unsigned int q = 0; q < n_q; ++q)
+      {
+         Number s = 0;
+         for(unsigned int k = 0; k < n; ++k)
+            s += b.value(q, k) * t[k];
+         u[q] = s;
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   // r(i,j) += sum_q w_q g_q (L_i L_j)(face point q); g must include the face
+   // length
+   //---------------------------------------------------------------------------
+   template <typename Number>
+   inline void
+   integrate_face(const Basis1D&       b,
+                  const unsigned int   f,
+                  const Number*        g,
+                  Number*              r,
+                  std::vector<Number>& tmp)
+   {
+      const unsigned int n = b.n, n_q = b.n_q;
+      const unsigned int side = f % 2;
+      Number* t = work_array(tmp, n);
+      for(unsigned int k = 0; k < n; ++k)
+      {
+         Number s = 0;
+         for(unsigned int q = 0; q < n_q; ++q)
+            s += b.weights[q] * b.value(q, k) * g[q];
+         t[k] = s;
+      }
+      for(unsigned int k = 0; k < n; ++k)
+         for(unsigned int l = 0; l < n; ++l)
+         {
+            if(f < 2)
+               r[l + n * k] += b.face_value(side, l) * t[k];
+            else
+               r[k + n * l] += b.face_value(side, l) * t[k];
+         }
+   }
+}
+
+#endif
@@ -27,6 +27,25 @@ struct Problem : ProblemBase<dim>
    const double pre_inf = 1.0/(gasGam * mach_inf * mach_inf);
    const double pre_out = pre_inf;
 
+   // Stagnation state of freestream for characteristic inflow
+   const double rho0 = rho_inf * pow(1.0 + 0.5 * (gasGam - 1.0) * mach_inf * mach_inf,
+                                     1.0 / (gasGam - 1.0));
+   const double pre0 = pre_inf * pow(1.0 + 0.5 * (gasGam - 1.0) * mach_inf * mach_inf,
+                                     gasGam / (gasGam - 1.0));
+
+   // Use characteristic inflow/outflow if set to 1 by set_parameter, else
+   // fix full inflow state and outflow energy as before
+   bool characteristic = false;
+
+   //---------------------------------------------------------------------------
+   void set_parameter(const std::string& name, const double value) override
+   {
+      if(name == "characteristic")
+         characteristic = (value != 0.0);
+      else
+         ProblemBase<dim>::set_parameter(name, value);
+   }
+
    //---------------------------------------------------------------------------
    void initial_value(const Point<dim>& /*p*/,
                       Vector<double>&   u) const override
@@ -65,6 +84,11 @@ struct Problem : ProblemBase<dim>
 
          case 2: // outflow
          {
+            if(characteristic)
+            {
+               PDE::subsonic_outflow_state(Uint, pre_out, normal, Uout);
+               break;
+            }
             Uout = Uint;
             const double Eout = pre_out / (gasGam - 1.0) + 0.5 * rho * vint.norm_square();
             Uout[3] = Eout;
@@ -73,6 +97,14 @@ struct Problem : ProblemBase<dim>
 
          case 4: // inflow
          {
+            if(characteristic)
+            {
+               Tensor<1,dim> direction;
+               direction[0] = 1.0;
+               PDE::subsonic_inflow_state(Uint, rho0, pre0, direction, normal,
+                                          Uout);
+               break;
+            }
             Uout[0] = rho_inf;
             Uout[1] = rho_inf * vel_inf;
             Uout[2] = 0.0;
@@ -21,14 +21,32 @@ struct Problem : ProblemBase<dim>
 {
    const double gamma = ProblemData::gamma;
 
-   const double mach_inf = 0.5;
+   double mach_inf = 0.5;
    const double theta = 45.0 * (M_PI / 180.0);
-   const double u0 = mach_inf * cos(theta);
-   const double v0 = mach_inf * sin(theta);
-   const double beta = 5.0;
+   double u0 = mach_inf * cos(theta);
+   double v0 = mach_inf * sin(theta);
+   double beta = 5.0;
    const double x0 = 0.0, y0 = 0.0;
-   const double a1 = 0.5 * beta / M_PI;
-   const double a2 = 0.5 * (gamma - 1.0) * pow(a1, 2) / gamma;
+   double a1 = 0.5 * beta / M_PI;
+   double a2 = 0.5 * (gamma - 1.0) * pow(a1, 2) / gamma;
+
+   //---------------------------------------------------------------------------
+   // beta is the vortex strength
+   //---------------------------------------------------------------------------
+   void set_parameter(const std::string& name, const double value) override
+   {
+      if(name == "mach")
+         mach_inf = value;
+      else if(name == "beta")
+         beta = value;
+      else
+         ProblemBase<dim>::set_parameter(name, value);
+
+      u0 = mach_inf * cos(theta);
+      v0 = mach_inf * sin(theta);
+      a1 = 0.5 * beta / M_PI;
+      a2 = 0.5 * (gamma - 1.0) * pow(a1, 2) / gamma;
+   }
 
    //---------------------------------------------------------------------------
    void initial_value(const Point<dim>& p,
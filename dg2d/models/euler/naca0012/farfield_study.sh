@@ -0,0 +1,59 @@
+#!/bin/bash
+# Effect of far field boundary condition and domain radius on lift and drag.
+#
+# Run from this directory
+#
+#    ./farfield_study.sh ../../../system_lagrange_mpi/main 4 "50 20 10 5"
+#
+# For each radius R of the outer boundary, a grid is made with gmsh and three
+# ensemble members are run on it: freestream state, characteristic condition
+# and characteristic condition with point vortex correction. The lift
+# coefficient for the vortex is taken from the characteristic run on the
+# largest domain.
+
+if [ $# -lt 1 ]
+then
+   echo "Usage: $0 /path/to/main [nproc] [radii] [input.prm]"
+   exit 1
+fi
+
+MAIN=$1
+NP=${2:-4}
+RADII=${3:-"50 20 10 5"}
+INPUT=${4:-input.prm}
+
+# Lift coefficient from largest domain
+R0=${RADII%% *}
+gmsh -2 -setnumber R $R0 naca.geo -o naca_R$R0.msh > /dev/null
+NAME=farfield_R${R0}_ref
+echo "INCLUDE $INPUT"                        >  $NAME.prm
+echo "set grid = naca_R$R0.msh"              >> $NAME.prm
+echo "set force boundary ids = 0"            >> $NAME.prm
+echo "set ensemble size = 1"                 >> $NAME.prm
+echo "set ensemble parameters = characteristic = 1" >> $NAME.prm
+echo "Running $NAME"
+mpirun -np $NP $MAIN $NAME.prm > $NAME.log 2>&1
+CL=$(grep "Force coefficients" $NAME.log | tail -1 | \
+     awk '{for(i = 1; i < NF; ++i) if($i == "cl") print $(i+2)}')
+echo "Lift coefficient for vortex correction = $CL"
+
+for R in $RADII
+do
+   [ -f naca_R$R.msh ] || gmsh -2 -setnumber R $R naca.geo -o naca_R$R.msh > /dev/null
+   NAME=farfield_R$R
+   echo "INCLUDE $INPUT"                     >  $NAME.prm
+   echo "set grid = naca_R$R.msh"            >> $NAME.prm
+   echo "set force boundary ids = 0"         >> $NAME.prm
+   echo "set ensemble size = 3"              >> $NAME.prm
+   echo "set ensemble parameters = characteristic = 0,1,1; cl = 0,0,$CL" >> $NAME.prm
+   echo "Running $NAME"
+   mpirun -np $NP $MAIN $NAME.prm > $NAME.log 2>&1
+done
+
+# Summary: members are freestream, characteristic, vortex
+for R in $RADII
+do
+   echo "-------------------- R = $R --------------------"
+   grep "Number of active cells" farfield_R$R.log
+   grep "Force coefficients" farfield_R$R.log
+done
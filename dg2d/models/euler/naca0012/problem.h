@@ -18,11 +18,64 @@ template <int dim>
 struct Problem : ProblemBase<dim>
 {
    const double gamma = ProblemData::gamma;
-   const double alpha = 2.0 * (M_PI / 180.0);
-   const double mach = 0.63;
+   double alpha = 2.0 * (M_PI / 180.0);
+   double mach = 0.63;
    const double rho_inf = 1.0;
    const double vel_inf = 1.0;
-   const double pre_inf = 1.0/(gamma * mach * mach);
+   double pre_inf = 1.0/(gamma * mach * mach);
+
+   // Far field condition: freestream state (default), or characteristic
+   // condition which lets outgoing waves leave. If cl is not zero, the
+   // exterior state includes a point vortex at the quarter chord with
+   // circulation for lift coefficient cl, which allows a smaller domain.
+   bool characteristic = false;
+   double cl = 0.0;
+   const double chord = 1.0;
+   const Point<dim> x_vortex = Point<dim>(0.25, 0.0);
+
+   //---------------------------------------------------------------------------
+   // alpha is given in degrees
+   //---------------------------------------------------------------------------
+   void set_parameter(const std::string& name, const double value) override
+   {
+      if(name == "mach")
+      {
+         mach = value;
+         pre_inf = 1.0/(gamma * mach * mach);
+      }
+      else if(name == "alpha")
+      {
+         alpha = value * (M_PI / 180.0);
+      }
+      else if(name == "cl")
+      {
+         cl = value;
+      }
+      else if(name == "characteristic")
+      {
+         characteristic = (value != 0.0);
+      }
+      else
+      {
+         ProblemBase<dim>::set_parameter(name, value);
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   // Moment about quarter chord
+   //---------------------------------------------------------------------------
+   typename ProblemBase<dim>::ForceReference
+   get_force_reference() const override
+   {
+      typename ProblemBase<dim>::ForceReference ref;
+      ref.rho = rho_inf;
+      ref.vel = vel_inf;
+      ref.pre = pre_inf;
+      ref.alpha = alpha;
+      ref.length = chord;
+      ref.center = x_vortex;
+      return ref;
+   }
 
    //---------------------------------------------------------------------------
    void initial_value(const Point<dim>& /*p*/,
@@ -37,6 +90,41 @@ struct Problem : ProblemBase<dim>
       PDE::prim2con(rho, vel, pre, u);
    }
 
+   //---------------------------------------------------------------------------
+   // Freestream corrected by compressible point vortex, see
+   //   Thomas & Salas, AIAA J., 1986
+   // Total enthalpy and entropy are same as in freestream.
+   //---------------------------------------------------------------------------
+   void farfield_value(const Point<dim>& p,
+                       Vector<double>&   u) const
+   {
+      if(cl == 0.0)
+      {
+         initial_value(p, u);
+         return;
+      }
+
+      const Tensor<1,dim> dr = p - x_vortex;
+      const double r = dr.norm();
+      const double theta = atan2(dr[1], dr[0]);
+      const double circulation = 0.5 * vel_inf * chord * cl;
+      const double beta = sqrt(1.0 - mach * mach);
+      const double factor = circulation * beta
+                            / (2.0 * M_PI * r
+                               * (1.0 - pow(mach * sin(theta - alpha), 2)));
+
+      Tensor<1,dim> vel;
+      vel[0] = vel_inf * cos(alpha) + factor * sin(theta);
+      vel[1] = vel_inf * sin(alpha) - factor * cos(theta);
+
+      const double c2_inf = gamma * pre_inf / rho_inf;
+      const double c2 = c2_inf
+                        + 0.5 * (gamma - 1.0) * (pow(vel_inf, 2) - vel.norm_square());
+      const double rho = rho_inf * pow(c2 / c2_inf, 1.0 / (gamma - 1.0));
+      const double pre = pre_inf * pow(c2 / c2_inf, gamma / (gamma - 1.0));
+      PDE::prim2con(rho, vel, pre, u);
+   }
+
    //---------------------------------------------------------------------------
    void boundary_value(const int             boundary_id,
                        const Point<dim>&     p,
@@ -64,7 +152,16 @@ struct Problem : ProblemBase<dim>
 
          case 1: // farfield
          {
-            initial_value(p, Uout);
+            if(characteristic)
+            {
+               Vector<double> Uinf(nvar);
+               farfield_value(p, Uinf);
+               PDE::farfield_state(Uint, Uinf, normal, Uout);
+            }
+            else
+            {
+               farfield_value(p, Uout);
+            }
             break;
          }
 
@@ -6,6 +6,8 @@
 
 #include <deal.II/numerics/data_postprocessor.h>
 
+#include "../common/eos.h"
+
 using namespace dealii;
 
 constexpr unsigned int nvar = 4;
@@ -19,13 +21,13 @@ FluxTypeList{{"rusanov",        FluxType::rusanov},
              {"none",           FluxType::none}};
 
 //------------------------------------------------------------------------------
-template <int dim>
+template <int dim, typename Number = double>
 struct FluxData
 {
    Point<dim> p;       // coordinates
    double t;           // time
-   Vector<double>* ul; // left  cell average
-   Vector<double>* ur; // right cell average
+   Vector<Number>* ul; // left  cell average
+   Vector<Number>* ur; // right cell average
 };
 
 //------------------------------------------------------------------------------
@@ -49,39 +51,88 @@ namespace PDE
 {
 
    const std::string name = "2D Euler equations";
+
+   // Conserved variables whose drift is checked by the diagnostics: mass and
+   // energy; momentum changes with the boundary forces
+   const std::vector<unsigned int> conserved_vars = {0, nvar - 1};
    const double gamma = ProblemData::gamma;
 
+   // Ideal gas unless the problem sets another equation of state in its
+   // constructor, e.g., PDE::eos.set_stiffened(gamma, p_inf)
+   EOS::Model eos(gamma);
+
    //---------------------------------------------------------------------------
-   template <int dim>
+   // Replace eos by the table in file; collective on comm. The table is read
+   // once and shared by all solvers which use the same file.
+   //---------------------------------------------------------------------------
+   inline void
+   use_eos_table(const std::string& file, const MPI_Comm comm)
+   {
+      static std::string                 current;
+      static std::shared_ptr<EOS::Table> table;
+      if(file != current)
+      {
+         table = std::make_shared<EOS::Table>();
+         table->read(file, comm);
+         current = file;
+      }
+      eos.set_table(table);
+   }
+
+   //---------------------------------------------------------------------------
+   // Internal energy per volume rho*e of conserved state
+   //---------------------------------------------------------------------------
+   template <int dim, typename Number>
+   inline Number
+   internal_energy(const Vector<Number>& u)
+   {
+      Number m2 = 0.0;
+      for(unsigned int d = 0; d < dim; ++d)
+         m2 += pow(u[d + 1], 2);
+      return u[dim + 1] - 0.5 * m2 / u[0];
+   }
+
+   //---------------------------------------------------------------------------
+   // Pressure, also used for forces on walls
+   //---------------------------------------------------------------------------
+   template <int dim, typename Number>
+   inline Number
+   pressure(const Vector<Number>& u)
+   {
+      return eos.pressure(u[0], internal_energy<dim>(u));
+   }
+
+   //---------------------------------------------------------------------------
+   template <int dim, typename Number>
    inline void
-   con2prim(const Vector<double>& u,
-            double&               rho,
-            Tensor<1,dim>&        vel,
-            double&               pre)
+   con2prim(const Vector<Number>&   u,
+            Number&                 rho,
+            Tensor<1,dim,Number>&   vel,
+            Number&                 pre)
    {
       rho = u[0];
 
-      double v2 = 0.0;
+      Number v2 = 0.0;
       for(unsigned int d = 0; d < dim; ++d)
       {
          vel[d] = u[d + 1] / rho;
          v2 += pow(vel[d], 2);
       }
 
-      const double E = u[dim + 1];
-      pre = (gamma - 1.0) * (E - 0.5 * rho * v2);
+      const Number E = u[dim + 1];
+      pre = eos.pressure<Number>(rho, E - 0.5 * rho * v2);
    }
 
    //---------------------------------------------------------------------------
-   template <int dim>
+   template <int dim, typename Number>
    inline void
-   prim2con(const double          rho,
-            const Tensor<1, dim>& vel,
-            const double          pre,
-            Vector<double>&       u)
+   prim2con(const Number                rho,
+            const Tensor<1, dim, Number>& vel,
+            const Number                pre,
+            Vector<Number>&             u)
    {
       u[0] = rho;
-      u[dim+1] = pre/(gamma - 1.0) + 0.5 * rho * vel.norm_square();
+      u[dim+1] = eos.internal_energy(rho, pre) + 0.5 * rho * vel.norm_square();
 
       for (unsigned int d = 0; d < dim; ++d)
       {
@@ -91,15 +142,15 @@ namespace PDE
    }
 
    //---------------------------------------------------------------------------
-   template <int dim>
+   template <int dim, typename Number>
    inline void
-   con2prim(const Vector<double>& u, Vector<double>& q)
+   con2prim(const Vector<Number>& u, Vector<Number>& q)
    {
       // density
       q[0] = u[0];
 
       // velocity
-      double v2 = 0.0;
+      Number v2 = 0.0;
       for(unsigned int d = 1; d <= dim; ++d)
       {
          q[d] = u[d] / u[0];
@@ -107,18 +158,18 @@ namespace PDE
       }
 
       // pressure
-      q[dim+1] = (gamma - 1.0) * (u[dim+1] - 0.5 * u[0] * v2);
+      q[dim+1] = eos.pressure<Number>(u[0], u[dim+1] - 0.5 * u[0] * v2);
    }
 
    //---------------------------------------------------------------------------
    // q = primitive
    //---------------------------------------------------------------------------
-   template <int dim>
+   template <int dim, typename Number>
    inline void
-   prim2prim(const Vector<double>& q,
-             double&               rho,
-             Tensor<1,dim>&        vel,
-             double&               pre)
+   prim2prim(const Vector<Number>&  q,
+             Number&                rho,
+             Tensor<1,dim,Number>&  vel,
+             Number&                pre)
    {
       rho = q[0];
       pre = q[dim+1];
@@ -128,73 +179,69 @@ namespace PDE
    }
 
    //---------------------------------------------------------------------------
-   // q = primitive
+   // u = conserved, pre = pressure
    //---------------------------------------------------------------------------
-   template <int dim>
+   template <int dim, typename Number>
    void
-   physical_flux(const Vector<double>& q,
+   physical_flux(const Vector<Number>& u,
+                 const Number          pre,
                  const Tensor<1, dim>& normal,
-                 Vector<double>&       flux)
+                 Vector<Number>&       flux)
    {
-      double vn = 0.0, v2 = 0.0;
+      Number mn = 0.0;
       for(unsigned int d = 0; d < dim; ++d)
-      {
-         vn += q[d+1] * normal[d];
-         v2 += pow(q[d+1], 2);
-      }
+         mn += u[d+1] * normal[d];
+      const Number vn = mn / u[0];
 
-      flux[0] = q[0] * vn;
+      flux[0] = mn;
       for(unsigned int d = 0; d < dim; ++d)
-         flux[d+1] = q[dim+1] * normal[d] + q[0] * q[d+1] * vn;
-
-      const double E = q[dim+1] / (gamma - 1.0) + 0.5 * q[0] * v2;
-      flux[dim + 1] = (E + q[dim+1]) * vn;
+         flux[d+1] = pre * normal[d] + u[d+1] * vn;
+      flux[dim + 1] = (u[dim+1] + pre) * vn;
    }
 
    //---------------------------------------------------------------------------
-   // q = primitive
+   // u = conserved
    //---------------------------------------------------------------------------
-   template <int dim>
-   inline double
-   max_speed(const Vector<double>&  q,
+   template <int dim, typename Number>
+   inline Number
+   max_speed(const Vector<Number>&  u,
              const Tensor<1, dim>&  normal)
    {
-      double vn = 0.0;
+      Number vn = 0.0;
       for(unsigned int d = 0; d < dim; ++d)
-         vn += q[d + 1] * normal[d];
+         vn += u[d + 1] * normal[d];
+      vn /= u[0];
 
-      if(q[0] <= 0.0 || q[dim+1] <= 0.0)
+      Number c2;
+      const Number pre = eos.pressure(u[0], internal_energy<dim>(u), c2);
+      if(u[0] <= 0.0 || c2 <= 0.0)
       {
-         std::cout << "Non-physical trace: rho, pre = " << q[0] << " " 
-                   << q[dim+1] << std::endl;
+         std::cout << "Non-physical trace: rho, pre = " << u[0] << " " 
+                   << pre << std::endl;
       }
-      return abs(vn) + sqrt(gamma * q[dim + 1] / q[0]);
+      return abs(vn) + sqrt(c2);
    }
 
    //---------------------------------------------------------------------------
-   template <int dim>
+   template <int dim, typename Number>
    void
-   rusanov_flux(const Vector<double>&  ul,
-                const Vector<double>&  ur,
-                const Tensor<1, dim>&  normal,
-                const FluxData<dim>&   data,
-                Vector<double>&        flux)
+   rusanov_flux(const Vector<Number>&       ul,
+                const Vector<Number>&       ur,
+                const Tensor<1, dim>&       normal,
+                const FluxData<dim,Number>& data,
+                Vector<Number>&             flux)
    {
-      Vector<double> ql(nvar), qr(nvar);
-      con2prim<dim>(ul, ql);
-      con2prim<dim>(ur, qr);
+      const Number pre_l = pressure<dim>(ul);
+      const Number pre_r = pressure<dim>(ur);
 
-      Vector<double> fl(nvar), fr(nvar);
-      physical_flux(ql, normal, fl);
-      physical_flux(qr, normal, fr);
+      Vector<Number> fl(nvar), fr(nvar);
+      physical_flux(ul, pre_l, normal, fl);
+      physical_flux(ur, pre_r, normal, fr);
 
       // Speed based on cell average
-      Vector<double> qal(nvar), qar(nvar);
-      con2prim<dim>(*data.ul, qal);
-      con2prim<dim>(*data.ur, qar);
-      const double al = max_speed(qal, normal);
-      const double ar = max_speed(qar, normal);
-      const double lam = std::max(al, ar);
+      const Number al = max_speed(*data.ul, normal);
+      const Number ar = max_speed(*data.ur, normal);
+      const Number lam = std::max(al, ar);
 
       for(unsigned int i = 0; i < nvar; ++i)
          flux[i] = 0.5 * (fl[i] + fr[i] - lam * (ur[i] - ul[i]));
@@ -206,32 +253,36 @@ namespace PDE
    // See 
    //   Toro, Section 8.4.2
    //   Steger & Warming, JCP, 1981, Eq. (B9)
+   // The splitting uses f(u) = A(u) u, which holds only for the ideal gas.
    //---------------------------------------------------------------------------
-   template <int dim>
+   template <int dim, typename Number>
    void
-   steger_warming_flux(const Vector<double>& ul,
-                       const Vector<double>& ur,
+   steger_warming_flux(const Vector<Number>& ul,
+                       const Vector<Number>& ur,
                        const Tensor<1, dim>& normal,
-                       Vector<double>&       flux)
+                       Vector<Number>&       flux)
    {
-      double rho_l, rho_r, pre_l, pre_r;
-      Tensor<1,dim> vel_l, vel_r;
+      AssertThrow(eos.get_type() == EOS::Type::ideal,
+                  ExcMessage("Steger-Warming flux needs an ideal gas"));
+      const Number zero = 0.0;
+      Number rho_l, rho_r, pre_l, pre_r;
+      Tensor<1,dim,Number> vel_l, vel_r;
       con2prim<dim>(ul, rho_l, vel_l, pre_l);
       con2prim<dim>(ur, rho_r, vel_r, pre_r);
 
-      const double c_l = sqrt(gamma * pre_l / rho_l);
-      const double c_r = sqrt(gamma * pre_r / rho_r);
-      const double vn_l = vel_l * normal;
-      const double vn_r = vel_r * normal;
+      const Number c_l = sqrt(gamma * pre_l / rho_l);
+      const Number c_r = sqrt(gamma * pre_r / rho_r);
+      const Number vn_l = vel_l * normal;
+      const Number vn_r = vel_r * normal;
 
       // positive flux
-      const double l1p = std::max(vn_l,       0.0);
-      const double l2p = std::max(vn_l + c_l, 0.0);
-      const double l3p = std::max(vn_l - c_l, 0.0);
-      const double ap  = 2.0 * (gamma - 1.0) * l1p + l2p + l3p;
-      const double fp  = 0.5 * rho_l / gamma;
+      const Number l1p = std::max(vn_l,       zero);
+      const Number l2p = std::max(vn_l + c_l, zero);
+      const Number l3p = std::max(vn_l - c_l, zero);
+      const Number ap  = 2.0 * (gamma - 1.0) * l1p + l2p + l3p;
+      const Number fp  = 0.5 * rho_l / gamma;
 
-      Vector<double> pflux(nvar);
+      Vector<Number> pflux(nvar);
       pflux[0] = ap;
       for(unsigned int d=0; d<dim; ++d)
          pflux[d+1] = ap * vel_l[d] + c_l * (l2p - l3p) * normal[d];
@@ -240,13 +291,13 @@ namespace PDE
                      c_l * c_l * (l2p + l3p) / (gamma - 1.0);
 
       // negative flux
-      const double l1m = std::min(vn_r,       0.0);
-      const double l2m = std::min(vn_r + c_r, 0.0);
-      const double l3m = std::min(vn_r - c_r, 0.0);
-      const double am  = 2.0 * (gamma - 1.0) * l1m + l2m + l3m;
-      const double fm  = 0.5 * rho_r / gamma;
+      const Number l1m = std::min(vn_r,       zero);
+      const Number l2m = std::min(vn_r + c_r, zero);
+      const Number l3m = std::min(vn_r - c_r, zero);
+      const Number am  = 2.0 * (gamma - 1.0) * l1m + l2m + l3m;
+      const Number fm  = 0.5 * rho_r / gamma;
 
-      Vector<double> mflux(nvar);
+      Vector<Number> mflux(nvar);
       mflux[0] = am;
       for(unsigned int d=0; d<dim; ++d)
          mflux[d+1] = am * vel_r[d] + c_r * (l2m - l3m) * normal[d];
@@ -262,42 +313,64 @@ namespace PDE
    //---------------------------------------------------------------------------
    // Following functions are directly called from DG solver
    //---------------------------------------------------------------------------
-   template <int dim>
+   template <int dim, typename Number>
    void
-   max_speed(const Vector<double>& u,
+   max_speed(const Vector<Number>& u,
              const Point<dim>&     /*p*/,
              Tensor<1, dim>&       speed)
    {
-      double rho, pre;
-      Tensor<1,dim> vel;
-      con2prim<dim>(u, rho, vel, pre);
-
-      if(rho <= 0.0 || pre <= 0.0)
+      const Number rho = u[0];
+      Number c2;
+      const Number pre = eos.pressure(rho, internal_energy<dim>(u), c2);
+      if(rho <= 0.0 || c2 <= 0.0)
       {
          std::cout << "Non-physical avg: rho, pre = " << rho << " " 
                    << pre << std::endl;
       }
 
-      const double c = sqrt(gamma * pre / rho);
+      const Number c = sqrt(c2);
 
       for(unsigned int d = 0; d < dim; ++d)
-         speed[d] = abs(vel[d]) + c;
+         speed[d] = abs(u[d + 1] / rho) + c;
+   }
+
+   //---------------------------------------------------------------------------
+   // Positive density and real sound speed; positive pressure for ideal gas
+   //---------------------------------------------------------------------------
+   template <int dim, typename Number>
+   inline bool
+   is_admissible(const Vector<Number>& u)
+   {
+      if(u[0] <= 0.0) return false;
+      const Number rho_e = internal_energy<dim>(u);
+      return eos.is_admissible(u[0], rho_e, eos.pressure(u[0], rho_e));
+   }
+
+   //---------------------------------------------------------------------------
+   // Mathematical entropy -rho s/(gamma-1) with s = log(pre/rho^gamma), see
+   // EOS::Model::entropy for other equations of state
+   //---------------------------------------------------------------------------
+   template <int dim, typename Number>
+   inline Number
+   entropy(const Vector<Number>& u)
+   {
+      return eos.entropy(u[0], pressure<dim>(u));
    }
 
    //---------------------------------------------------------------------------
    // Flux of the PDE model: f(u,x)
    //---------------------------------------------------------------------------
-   template <int dim>
+   template <int dim, typename Number>
    void
-   physical_flux(const Vector<double>&       u,
-                 const FluxData<dim>&        /*data*/,
-                 ndarray<double, nvar, dim>& flux)
+   physical_flux(const Vector<Number>&       u,
+                 const FluxData<dim,Number>& /*data*/,
+                 ndarray<Number, nvar, dim>& flux)
    {
-      double rho, pre;
-      Tensor<1,dim> vel;
+      Number rho, pre;
+      Tensor<1,dim,Number> vel;
       con2prim<dim>(u, rho, vel, pre);
 
-      const double E = u[dim + 1];
+      const Number E = u[dim + 1];
 
       for(unsigned int d = 0; d < dim; ++d)
       {
@@ -316,24 +389,228 @@ namespace PDE
 
    //---------------------------------------------------------------------------
    // Compute flux across cell faces
+   //---------------------------------------------------------------------------
+   template <int dim, typename Number>
+   void
+   numerical_flux(const FluxType              flux_type,
+                  const Vector<Number>&       ul,
+                  const Vector<Number>&       ur,
+                  const Tensor<1, dim>&       normal,
+                  const FluxData<dim,Number>& data,
+                  Vector<Number>&             flux)
+   {
+      switch(flux_type)
+      {
+         case FluxType::rusanov:
+            rusanov_flux(ul, ur, normal, data, flux);
+            break;
+
+         case FluxType::steger_warming:
+            steger_warming_flux(ul, ur, normal, flux);
+            break;
+
+         default:
+            AssertThrow(false, ExcMessage("Unknown numerical flux"));
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   // Steger-Warming for the ideal gas, else Rusanov
+   //---------------------------------------------------------------------------
+   template <int dim, typename Number>
+   void
+   boundary_flux(const Vector<Number>&       ul,
+                 const Vector<Number>&       ur,
+                 const Tensor<1, dim>&       normal,
+                 const FluxData<dim,Number>& data,
+                 Vector<Number>&             flux)
+   {
+      if(eos.get_type() == EOS::Type::ideal)
+         steger_warming_flux(ul, ur, normal, flux);
+      else
+         rusanov_flux(ul, ur, normal, data, flux);
+   }
+
+   //---------------------------------------------------------------------------
+   // Batch versions for n ensemble members, used by system_lagrange_mpi. States
+   // are stored with the member index innermost, u[c * n + m], and the flux as
+   // flux[(c * dim + d) * n + m] or flux[c * n + m] across a face; al, ar are
+   // the cell averages next to the face. Like the scalar fluxes, they do not
+   // depend on time, which may differ among members. The loops over members
+   // have no branches, so that the compiler can vectorize them, and the eos is
+   // called once for all members. work needs batch_work * n values.
+   //---------------------------------------------------------------------------
+   constexpr unsigned int batch_work = 6;
+
+   template <int dim>
+   inline void
+   internal_energy(const unsigned int n, const double* u, double* rho_e)
+   {
+      DEAL_II_OPENMP_SIMD_PRAGMA
+      for(unsigned int m = 0; m < n; ++m)
+      {
+         double m2 = 0.0;
+         for(unsigned int d = 0; d < dim; ++d)
+            m2 += u[(d + 1) * n + m] * u[(d + 1) * n + m];
+         rho_e[m] = u[(dim + 1) * n + m] - 0.5 * m2 / u[m];
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   template <int dim>
+   void
+   physical_flux(const unsigned int n,
+                 const double*      u,
+                 const Point<dim>&  /*p*/,
+                 double*            flux,
+                 double*            work)
+   {
+      double* rho_e = work;
+      double* pre = work + n;
+      internal_energy<dim>(n, u, rho_e);
+      eos.pressure(n, u, rho_e, pre);
+
+      for(unsigned int d = 0; d < dim; ++d)
+      {
+         const double* md = u + (d + 1) * n;
+         DEAL_II_OPENMP_SIMD_PRAGMA
+         for(unsigned int m = 0; m < n; ++m)
+         {
+            const double vel = md[m] / u[m];
+            flux[d * n + m] = md[m];
+            for(unsigned int e = 1; e <= dim; ++e)
+               flux[(e * dim + d) * n + m] = u[e * n + m] * vel;
+            flux[((d + 1) * dim + d) * n + m] += pre[m];
+            flux[((dim + 1) * dim + d) * n + m] =
+               (u[(dim + 1) * n + m] + pre[m]) * vel;
+         }
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   // lam[m] = largest of the wave speeds |vn| + c of the averages al and ar
+   //---------------------------------------------------------------------------
+   template <int dim>
+   void
+   max_speed(const unsigned int    n,
+             const double*         al,
+             const double*         ar,
+             const Tensor<1, dim>& normal,
+             double*               lam,
+             double*               work)
+   {
+      double* rho_e = work;
+      double* pre = work + n;
+      double* c2 = work + 2 * n;
+      std::fill(lam, lam + n, 0.0);
+      for(const double* a : {al, ar})
+      {
+         internal_energy<dim>(n, a, rho_e);
+         eos.sound_speed2(n, a, rho_e, pre, c2);
+         DEAL_II_OPENMP_SIMD_PRAGMA
+         for(unsigned int m = 0; m < n; ++m)
+         {
+            double vn = 0.0;
+            for(unsigned int d = 0; d < dim; ++d)
+               vn += a[(d + 1) * n + m] * normal[d];
+            lam[m] = std::max(lam[m], std::fabs(vn / a[m]) + std::sqrt(c2[m]));
+         }
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   template <int dim>
+   void
+   rusanov_flux(const unsigned int    n,
+                const double*         ul,
+                const double*         ur,
+                const double*         al,
+                const double*         ar,
+                const Tensor<1, dim>& normal,
+                double*               flux,
+                double*               work)
+   {
+      double* pre_l = work;
+      double* pre_r = work + n;
+      double* lam = work + 2 * n;
+      max_speed<dim>(n, al, ar, normal, lam, work + 3 * n);
+      internal_energy<dim>(n, ul, work + 3 * n);
+      eos.pressure(n, ul, work + 3 * n, pre_l);
+      internal_energy<dim>(n, ur, work + 3 * n);
+      eos.pressure(n, ur, work + 3 * n, pre_r);
+
+      DEAL_II_OPENMP_SIMD_PRAGMA
+      for(unsigned int m = 0; m < n; ++m)
+      {
+         double mn_l = 0.0, mn_r = 0.0;
+         for(unsigned int d = 0; d < dim; ++d)
+         {
+            mn_l += ul[(d + 1) * n + m] * normal[d];
+            mn_r += ur[(d + 1) * n + m] * normal[d];
+         }
+         const double vn_l = mn_l / ul[m], vn_r = mn_r / ur[m];
+
+         flux[m] = 0.5 * (mn_l + mn_r - lam[m] * (ur[m] - ul[m]));
+         for(unsigned int d = 0; d < dim; ++d)
+         {
+            const unsigned int k = (d + 1) * n + m;
+            flux[k] = 0.5 * ((pre_l[m] + pre_r[m]) * normal[d] +
+                             ul[k] * vn_l + ur[k] * vn_r -
+                             lam[m] * (ur[k] - ul[k]));
+         }
+         const unsigned int k = (dim + 1) * n + m;
+         flux[k] = 0.5 * ((ul[k] + pre_l[m]) * vn_l + (ur[k] + pre_r[m]) * vn_r -
+                          lam[m] * (ur[k] - ul[k]));
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   // Member by member, with the scalar function
+   //---------------------------------------------------------------------------
+   template <int dim>
+   void
+   steger_warming_flux(const unsigned int    n,
+                       const double*         ul,
+                       const double*         ur,
+                       const Tensor<1, dim>& normal,
+                       double*               flux)
+   {
+      Vector<double> ul_m(nvar), ur_m(nvar), flux_m(nvar);
+      for(unsigned int m = 0; m < n; ++m)
+      {
+         for(unsigned int c = 0; c < nvar; ++c)
+         {
+            ul_m[c] = ul[c * n + m];
+            ur_m[c] = ur[c * n + m];
+         }
+         steger_warming_flux(ul_m, ur_m, normal, flux_m);
+         for(unsigned int c = 0; c < nvar; ++c)
+            flux[c * n + m] = flux_m[c];
+      }
+   }
+
    //---------------------------------------------------------------------------
    template <int dim>
    void
    numerical_flux(const FluxType        flux_type,
-                  const Vector<double>& ul,
-                  const Vector<double>& ur,
+                  const unsigned int    n,
+                  const double*         ul,
+                  const double*         ur,
+                  const double*         al,
+                  const double*         ar,
                   const Tensor<1, dim>& normal,
-                  const FluxData<dim>&  data,
-                  Vector<double>&       flux)
+                  const Point<dim>&     /*p*/,
+                  double*               flux,
+                  double*               work)
    {
       switch(flux_type)
       {
          case FluxType::rusanov:
-            rusanov_flux(ul, ur, normal, data, flux);
+            rusanov_flux(n, ul, ur, al, ar, normal, flux, work);
             break;
 
          case FluxType::steger_warming:
-            steger_warming_flux(ul, ur, normal, flux);
+            steger_warming_flux(n, ul, ur, normal, flux);
             break;
 
          default:
@@ -344,48 +621,197 @@ namespace PDE
    //---------------------------------------------------------------------------
    template <int dim>
    void
-   boundary_flux(const Vector<double>& ul,
-                 const Vector<double>& ur,
+   boundary_flux(const unsigned int    n,
+                 const double*         ul,
+                 const double*         ur,
+                 const double*         al,
+                 const double*         ar,
                  const Tensor<1, dim>& normal,
-                 const FluxData<dim>&  /*data*/,
-                 Vector<double>&       flux)
+                 const Point<dim>&     /*p*/,
+                 double*               flux,
+                 double*               work)
+   {
+      if(eos.get_type() == EOS::Type::ideal)
+         steger_warming_flux(n, ul, ur, normal, flux);
+      else
+         rusanov_flux(n, ul, ur, al, ar, normal, flux, work);
+   }
+
+   //---------------------------------------------------------------------------
+   // Boundary states based on characteristics, to be used in boundary_value of
+   // problem.h. States are conserved variables and normal points out of the
+   // domain. Outgoing waves are taken from the interior state Uint so that
+   // they leave the domain with little reflection. They need an ideal gas.
+   //---------------------------------------------------------------------------
+
+   //---------------------------------------------------------------------------
+   // Far field: Riemann invariants vn + 2c/(gamma-1) from Uint and
+   // vn - 2c/(gamma-1) from exterior state Uinf; entropy and tangential
+   // velocity are upwinded.
+   //---------------------------------------------------------------------------
+   template <int dim>
+   void
+   farfield_state(const Vector<double>& Uint,
+                  const Vector<double>& Uinf,
+                  const Tensor<1,dim>&  normal,
+                  Vector<double>&       Uout)
    {
-      steger_warming_flux(ul, ur, normal, flux);
+      AssertThrow(eos.get_type() == EOS::Type::ideal,
+                  ExcMessage("farfield_state needs an ideal gas"));
+      double rho_i, pre_i, rho_e, pre_e;
+      Tensor<1,dim> vel_i, vel_e;
+      con2prim<dim>(Uint, rho_i, vel_i, pre_i);
+      con2prim<dim>(Uinf, rho_e, vel_e, pre_e);
+      const double c_i = sqrt(gamma * pre_i / rho_i);
+      const double c_e = sqrt(gamma * pre_e / rho_e);
+      const double vn_i = vel_i * normal;
+      const double vn_e = vel_e * normal;
+
+      // Supersonic inflow and outflow
+      if(vn_e <= -c_e)
+      {
+         Uout = Uinf;
+         return;
+      }
+      if(vn_i >= c_i)
+      {
+         Uout = Uint;
+         return;
+      }
+
+      const double Rp = vn_i + 2.0 * c_i / (gamma - 1.0);
+      const double Rm = vn_e - 2.0 * c_e / (gamma - 1.0);
+      const double vn = 0.5 * (Rp + Rm);
+      const double c = 0.25 * (gamma - 1.0) * (Rp - Rm);
+
+      double s;
+      Tensor<1,dim> vel;
+      if(vn < 0.0) // inflow
+      {
+         s = pre_e / pow(rho_e, gamma);
+         vel = vel_e + (vn - vn_e) * normal;
+      }
+      else
+      {
+         s = pre_i / pow(rho_i, gamma);
+         vel = vel_i + (vn - vn_i) * normal;
+      }
+      const double rho = pow(c * c / (gamma * s), 1.0 / (gamma - 1.0));
+      const double pre = rho * c * c / gamma;
+      prim2con(rho, vel, pre, Uout);
+   }
+
+   //---------------------------------------------------------------------------
+   // Subsonic inflow with given stagnation density rho0, stagnation pressure
+   // pre0 and flow direction (unit vector). Riemann invariant vn + 2c/(gamma-1)
+   // is taken from Uint and speed follows from constant total enthalpy.
+   //---------------------------------------------------------------------------
+   template <int dim>
+   void
+   subsonic_inflow_state(const Vector<double>& Uint,
+                         const double          rho0,
+                         const double          pre0,
+                         const Tensor<1,dim>&  direction,
+                         const Tensor<1,dim>&  normal,
+                         Vector<double>&       Uout)
+   {
+      AssertThrow(eos.get_type() == EOS::Type::ideal,
+                  ExcMessage("subsonic_inflow_state needs an ideal gas"));
+      double rho_i, pre_i;
+      Tensor<1,dim> vel_i;
+      con2prim<dim>(Uint, rho_i, vel_i, pre_i);
+      const double c_i = sqrt(gamma * pre_i / rho_i);
+      const double Rp = vel_i * normal + 2.0 * c_i / (gamma - 1.0);
+
+      // c = (gamma-1)/2 * (Rp - v dn) and H0 = c^2/(gamma-1) + v^2/2 give a
+      // quadratic for the speed v
+      const double c02 = gamma * pre0 / rho0;
+      const double H0 = c02 / (gamma - 1.0);
+      const double dn = direction * normal;
+      const double a = 0.25 * (gamma - 1.0) * dn * dn + 0.5;
+      const double b = -0.5 * (gamma - 1.0) * Rp * dn;
+      const double cc = 0.25 * (gamma - 1.0) * Rp * Rp - H0;
+      const double disc = std::max(b * b - 4.0 * a * cc, 0.0);
+      const double v = std::max((-b + sqrt(disc)) / (2.0 * a), 0.0);
+      const double c2 = std::min(c02 - 0.5 * (gamma - 1.0) * v * v, c02);
+
+      // Isentropic relations from stagnation state
+      const double rho = rho0 * pow(c2 / c02, 1.0 / (gamma - 1.0));
+      const double pre = pre0 * pow(c2 / c02, gamma / (gamma - 1.0));
+      const Tensor<1,dim> vel = v * direction;
+      prim2con(rho, vel, pre, Uout);
+   }
+
+   //---------------------------------------------------------------------------
+   // Subsonic outflow with given static pressure pre_out. Entropy, tangential
+   // velocity and Riemann invariant vn + 2c/(gamma-1) come from Uint.
+   // Supersonic outflow takes the interior state.
+   //---------------------------------------------------------------------------
+   template <int dim>
+   void
+   subsonic_outflow_state(const Vector<double>& Uint,
+                          const double          pre_out,
+                          const Tensor<1,dim>&  normal,
+                          Vector<double>&       Uout)
+   {
+      AssertThrow(eos.get_type() == EOS::Type::ideal,
+                  ExcMessage("subsonic_outflow_state needs an ideal gas"));
+      double rho_i, pre_i;
+      Tensor<1,dim> vel_i;
+      con2prim<dim>(Uint, rho_i, vel_i, pre_i);
+      const double c_i = sqrt(gamma * pre_i / rho_i);
+      const double vn_i = vel_i * normal;
+      if(vn_i >= c_i)
+      {
+         Uout = Uint;
+         return;
+      }
+
+      const double rho = rho_i * pow(pre_out / pre_i, 1.0 / gamma);
+      const double c = sqrt(gamma * pre_out / rho);
+      const double vn = vn_i + 2.0 * (c_i - c) / (gamma - 1.0);
+      const Tensor<1,dim> vel = vel_i + (vn - vn_i) * normal;
+      prim2con(rho, vel, pre_out, Uout);
    }
 
    //---------------------------------------------------------------------------
-   // Right and left eigenvector matrix in 2d
+   // Right and left eigenvector matrix in 2d. For a general equation of state
+   // dp = phi2 drho - kappa (u dm_x + v dm_y - dE), phi2 = chi + kappa q^2/2,
+   // and kappa = g1 = gamma - 1, chi = 0 for the ideal gas.
    //---------------------------------------------------------------------------
+   template <typename Number>
    void
-   char_mat(const Vector<double>& sol,
+   char_mat(const Vector<Number>& sol,
             const Point<2>&       /*p*/,
             const Tensor<1, 2>&   ex,
             const Tensor<1, 2>&   ey,
-            FullMatrix<double>&   Rx,
-            FullMatrix<double>&   Lx,
-            FullMatrix<double>&   Ry,
-            FullMatrix<double>&   Ly)
+            FullMatrix<Number>&   Rx,
+            FullMatrix<Number>&   Lx,
+            FullMatrix<Number>&   Ry,
+            FullMatrix<Number>&   Ly)
    {
-      double rho, pre;
-      Tensor<1,2> vel;
+      Number rho, pre;
+      Tensor<1,2,Number> vel;
       con2prim(sol, rho, vel, pre);
 
-      const double u = vel * ex;
-      const double v = vel * ey;
+      const Number u = vel * ex;
+      const Number v = vel * ey;
 
-      const double g1 = gamma - 1.0;
-      const double q2 = u * u + v * v;
-      const double c2 = gamma * pre / rho;
-      const double c = std::sqrt(c2);
-      const double beta = 0.5 / c2;
-      const double phi2 = 0.5 * g1 * q2;
-      const double h = c2 / g1 + 0.5 * q2;
+      Number chi, g1;
+      const Number rho_e = internal_energy<2>(sol);
+      eos.derivatives(rho, rho_e, chi, g1);
+      const Number q2 = u * u + v * v;
+      const Number c2 = chi + g1 * (rho_e + pre) / rho;
+      const Number c = std::sqrt(c2);
+      const Number beta = 0.5 / c2;
+      const Number phi2 = chi + 0.5 * g1 * q2;
+      const Number h = (sol[3] + pre) / rho;
 
       // x direction
       Rx(0,0) = 1;
       Rx(1,0) = u;
       Rx(2,0) = v;
-      Rx(3,0) = 0.5 * q2;
+      Rx(3,0) = 0.5 * q2 - chi / g1;
 
       Rx(0,1) = 0;
       Rx(1,1) = 0;
@@ -406,7 +832,7 @@ namespace PDE
       Ry(0,0) = 1;
       Ry(1,0) = u;
       Ry(2,0) = v;
-      Ry(3,0) = 0.5 * q2;
+      Ry(3,0) = 0.5 * q2 - chi / g1;
 
       Ry(0,1) = 0;
       Ry(1,1) = 1;
@@ -469,7 +895,7 @@ namespace PDE
    //---------------------------------------------------------------------------
    void print_info()
    {
-      std::cout << "Ratio of specific heats, gamma = " << gamma << std::endl;
+      std::cout << "Equation of state: " << eos.description() << std::endl;
    }
 
    //---------------------------------------------------------------------------
@@ -0,0 +1,30 @@
+"""
+Write the stiffened gas of problem.h as a table p(rho,e) for EOS::Table::read
+    python3 make_table.py [-output water_table.dat]
+The bicubic interpolation of the table is exact for this p(rho,e), so that a
+run with "set eos table = water_table.dat" must give the same solution.
+"""
+import argparse
+
+gamma = 4.4
+p_inf = 6.0e8
+
+# Covers the states of the shock tube, 909 < rho < 1134, with some margin
+n_rho, rho_min, rho_max = 51, 800.0, 1300.0
+n_e, e_min, e_max = 101, 5.0e5, 1.5e6
+
+parser = argparse.ArgumentParser()
+parser.add_argument('-output', default='water_table.dat', help='Table file')
+args = parser.parse_args()
+
+with open(args.output, 'w') as f:
+    f.write('# Stiffened gas, gamma = %g, p_inf = %g\n' % (gamma, p_inf))
+    f.write('%d %d\n' % (n_rho, n_e))
+    f.write('%.17g %.17g\n' % (rho_min, rho_max))
+    f.write('%.17g %.17g\n' % (e_min, e_max))
+    for i in range(n_rho):
+        rho = rho_min + i * (rho_max - rho_min) / (n_rho - 1)
+        for j in range(n_e):
+            e = e_min + j * (e_max - e_min) / (n_e - 1)
+            f.write('%.17g\n' % ((gamma - 1.0) * rho * e - gamma * p_inf))
+print('Wrote', args.output)
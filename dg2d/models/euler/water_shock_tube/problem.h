@@ -0,0 +1,73 @@
+//------------------------------------------------------------------------------
+// Water shock tube with the stiffened gas equation of state
+//    p = (gamma - 1) rho e - gamma p_inf,  gamma = 4.4, p_inf = 6e8 Pa
+// See
+//    Saurel & Abgrall, JCP, 1999, Section 6.1
+//------------------------------------------------------------------------------
+namespace ProblemData
+{
+   const std::string name = "WATER SHOCK TUBE";
+   const double xmin = 0.0;
+   const double xmax = 1.0;
+   const double ymin = 0.0;
+   const double ymax = 0.02;
+   const double final_time = 2.4e-4;
+   const bool periodic_x = false;
+   const bool periodic_y = true;
+
+   const double gamma = 4.4;
+}
+
+//------------------------------------------------------------------------------
+template <int dim>
+struct Problem : ProblemBase<dim>
+{
+   const double p_inf = 6.0e8;
+
+   const double rho_l = 1000.0;
+   const double p_l   = 1.0e9;
+   const double rho_r = 1000.0;
+   const double p_r   = 1.0e5;
+
+   // Location of jump
+   const double xdia  = 0.7;
+
+   Problem()
+   {
+      PDE::eos.set_stiffened(ProblemData::gamma, p_inf);
+   }
+
+   //---------------------------------------------------------------------------
+   void initial_value(const Point<dim>& p,
+                      Vector<double>&   u) const override
+   {
+      Tensor<1,dim> vel;
+      if(p[0] < xdia)
+         PDE::prim2con(rho_l, vel, p_l, u);
+      else
+         PDE::prim2con(rho_r, vel, p_r, u);
+   }
+
+   //---------------------------------------------------------------------------
+   void boundary_value(const int             boundary_id,
+                       const Point<dim>&     /*p*/,
+                       const double          /*t*/,
+                       const Tensor<1,dim>&  /*normal*/,
+                       const Vector<double>& Uint,
+                       Vector<double>&       Uout) const override
+   {
+      switch(boundary_id)
+      {
+         case 0: // left
+         case 1: // right
+         {
+            Uout = Uint;
+            break;
+         }
+
+         default:
+            DEAL_II_NOT_IMPLEMENTED();
+      }
+   }
+
+};
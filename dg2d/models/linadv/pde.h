@@ -17,13 +17,13 @@ std::map<std::string, FluxType> FluxTypeList{{"upwind", FluxType::upwind},
                                              {"none",   FluxType::none}};
 
 //------------------------------------------------------------------------------
-template <int dim>
+template <int dim, typename Number = double>
 struct FluxData
 {
    Point<dim> p;       // coordinates
    double t;           // time
-   Vector<double>* ul; // left  cell average
-   Vector<double>* ur; // right cell average
+   Vector<Number>* ul; // left  cell average
+   Vector<Number>* ur; // right cell average
 };
 
 //------------------------------------------------------------------------------
@@ -40,16 +40,19 @@ namespace PDE
 {
 
    const std::string name = "2D linear advection equation";
+
+   // Conserved variables whose drift is checked by the diagnostics
+   const std::vector<unsigned int> conserved_vars = {0};
    using ProblemData::velocity;
 
    //---------------------------------------------------------------------------
-   template <int dim>
+   template <int dim, typename Number>
    void
-   upwind_flux(const Vector<double>&  ul,
-               const Vector<double>&  ur,
-               const Tensor<1, dim>&  normal,
-               const FluxData<dim>&   data,
-               Vector<double>&        flux)
+   upwind_flux(const Vector<Number>&       ul,
+               const Vector<Number>&       ur,
+               const Tensor<1, dim>&       normal,
+               const FluxData<dim,Number>& data,
+               Vector<Number>&             flux)
    {
       Tensor<1,dim> vel;
       velocity(data.p, vel);
@@ -60,9 +63,9 @@ namespace PDE
    //---------------------------------------------------------------------------
    // Following functions are directly called from DG solver
    //---------------------------------------------------------------------------
-   template <int dim>
+   template <int dim, typename Number>
    void
-   max_speed(const Vector<double>& /*u*/,
+   max_speed(const Vector<Number>& /*u*/,
              const Point<dim>&     p,
              Tensor<1, dim>&       speed)
    {
@@ -72,11 +75,11 @@ namespace PDE
    //---------------------------------------------------------------------------
    // Flux of the PDE model: f(u,x)
    //---------------------------------------------------------------------------
-   template <int dim>
+   template <int dim, typename Number>
    void
-   physical_flux(const Vector<double>&       u,
-                 const FluxData<dim>&        data,
-                 ndarray<double, nvar, dim>& flux)
+   physical_flux(const Vector<Number>&       u,
+                 const FluxData<dim,Number>& data,
+                 ndarray<Number, nvar, dim>& flux)
    {
       Tensor<1,dim> vel;
       velocity(data.p, vel);
@@ -87,14 +90,14 @@ namespace PDE
    //---------------------------------------------------------------------------
    // Compute flux across cell faces
    //---------------------------------------------------------------------------
-   template <int dim>
+   template <int dim, typename Number>
    void
-   numerical_flux(const FluxType        flux_type,
-                  const Vector<double>& ul,
-                  const Vector<double>& ur,
-                  const Tensor<1, dim>& normal,
-                  const FluxData<dim>&  data,
-                  Vector<double>&       flux)
+   numerical_flux(const FluxType              flux_type,
+                  const Vector<Number>&       ul,
+                  const Vector<Number>&       ur,
+                  const Tensor<1, dim>&       normal,
+                  const FluxData<dim,Number>& data,
+                  Vector<Number>&             flux)
    {
       switch(flux_type)
       {
@@ -107,28 +110,131 @@ namespace PDE
       }
    }
 
+   //---------------------------------------------------------------------------
+   template <int dim, typename Number>
+   void
+   boundary_flux(const Vector<Number>&       ul,
+                 const Vector<Number>&       ur,
+                 const Tensor<1, dim>&       normal,
+                 const FluxData<dim,Number>& data,
+                 Vector<Number>&             flux)
+   {
+      upwind_flux(ul, ur, normal, data, flux);
+   }
+
+   //---------------------------------------------------------------------------
+   // Batch versions for n ensemble members, used by system_lagrange_mpi; see
+   // euler/pde.h for the layout. The velocity is the same for all members.
+   //---------------------------------------------------------------------------
+   constexpr unsigned int batch_work = 0;
+
+   template <int dim>
+   void
+   physical_flux(const unsigned int n,
+                 const double*      u,
+                 const Point<dim>&  p,
+                 double*            flux,
+                 double*            /*work*/)
+   {
+      Tensor<1,dim> vel;
+      velocity(p, vel);
+      for(unsigned int d = 0; d < dim; ++d)
+         for(unsigned int m = 0; m < n; ++m)
+            flux[d * n + m] = vel[d] * u[m];
+   }
+
+   //---------------------------------------------------------------------------
+   template <int dim>
+   void
+   numerical_flux(const FluxType        flux_type,
+                  const unsigned int    n,
+                  const double*         ul,
+                  const double*         ur,
+                  const double*         /*al*/,
+                  const double*         /*ar*/,
+                  const Tensor<1, dim>& normal,
+                  const Point<dim>&     p,
+                  double*               flux,
+                  double*               /*work*/)
+   {
+      AssertThrow(flux_type == FluxType::upwind,
+                  ExcMessage("Unknown numerical flux"));
+      Tensor<1,dim> vel;
+      velocity(p, vel);
+      const double vn = vel * normal;
+      const double* u = (vn > 0.0) ? ul : ur;
+      for(unsigned int m = 0; m < n; ++m)
+         flux[m] = vn * u[m];
+   }
+
    //---------------------------------------------------------------------------
    template <int dim>
    void
-   boundary_flux(const Vector<double>& ul,
-                 const Vector<double>& ur,
+   boundary_flux(const unsigned int    n,
+                 const double*         ul,
+                 const double*         ur,
+                 const double*         al,
+                 const double*         ar,
                  const Tensor<1, dim>& normal,
-                 const FluxData<dim>&  data,
-                 Vector<double>&       flux)
+                 const Point<dim>&     p,
+                 double*               flux,
+                 double*               work)
    {
-      upwind_flux(ul, ur, normal, data, flux);
+      numerical_flux(FluxType::upwind, n, ul, ur, al, ar, normal, p, flux,
+                     work);
+   }
+
+   //---------------------------------------------------------------------------
+   // Every state is admissible
+   //---------------------------------------------------------------------------
+   template <int dim, typename Number>
+   inline bool
+   is_admissible(const Vector<Number>& /*u*/)
+   {
+      return true;
+   }
+
+   //---------------------------------------------------------------------------
+   // Solution is also the primitive variable
+   //---------------------------------------------------------------------------
+   template <int dim, typename Number>
+   inline void
+   con2prim(const Vector<Number>& u, Vector<Number>& q)
+   {
+      q = u;
    }
 
    //---------------------------------------------------------------------------
+   // No pressure, so forces on boundaries are zero
+   //---------------------------------------------------------------------------
+   template <int dim, typename Number>
+   inline Number
+   pressure(const Vector<Number>& /*u*/)
+   {
+      return 0.0;
+   }
+
+   //---------------------------------------------------------------------------
+   // Quadratic entropy
+   //---------------------------------------------------------------------------
+   template <int dim, typename Number>
+   inline Number
+   entropy(const Vector<Number>& u)
+   {
+      return 0.5 * u[0] * u[0];
+   }
+
+   //---------------------------------------------------------------------------
+   template <typename Number>
    void
-   char_mat(const Vector<double>& /*sol*/,
+   char_mat(const Vector<Number>& /*sol*/,
             const Point<2>&       /*p*/,
             const Tensor<1, 2>&   /*ex*/,
             const Tensor<1, 2>&   /*ey*/,
-            FullMatrix<double>&   Rx,
-            FullMatrix<double>&   Lx,
-            FullMatrix<double>&   Ry,
-            FullMatrix<double>&   Ly)
+            FullMatrix<Number>&   Rx,
+            FullMatrix<Number>&   Lx,
+            FullMatrix<Number>&   Ry,
+            FullMatrix<Number>&   Ly)
    {
       Rx[0][0] = 1.0;
       Ry[0][0] = 1.0;
@@ -136,6 +242,13 @@ namespace PDE
       Ly[0][0] = 1.0;
    }
 
+   //---------------------------------------------------------------------------
+   inline void
+   use_eos_table(const std::string& /*file*/, const MPI_Comm /*comm*/)
+   {
+      AssertThrow(false, ExcMessage("Linear advection has no equation of state"));
+   }
+
    //---------------------------------------------------------------------------
    void print_info()
    {
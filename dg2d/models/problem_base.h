@@ -51,6 +51,30 @@ struct ProblemBase
       DEAL_II_NOT_IMPLEMENTED();
    }
 
+   // Set a problem parameter by name, e.g., to make ensemble members differ.
+   // Problems which support this must override it.
+   virtual void set_parameter(const std::string& name, const double /*value*/)
+   {
+      AssertThrow(false, ExcMessage("Problem has no parameter " + name));
+   }
+
+   // Freestream state, angle of attack (radians), reference length and
+   // moment center used for force and pressure coefficients
+   struct ForceReference
+   {
+      double     rho = 1.0;
+      double     vel = 1.0;
+      double     pre = 0.0;
+      double     alpha = 0.0;
+      double     length = 1.0;
+      Point<dim> center;
+   };
+
+   virtual ForceReference get_force_reference() const
+   {
+      return ForceReference();
+   }
+
    virtual std::string get_name()
    {
       return ProblemData::name;
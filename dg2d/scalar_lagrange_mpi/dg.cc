@@ -39,6 +39,8 @@
 #include <fstream>
 #include <cmath>
 
+#include "../common/mesh_cache.h"
+
 // #define FORCE_USE_OF_TRILINOS
 
 // Use petsc by default, to use trilinos uncomment above line
@@ -787,11 +789,11 @@ Step12<dim>::run()
    }
    else if(grid == 2)
    {
-      GridIn<dim> grid_in;
-      grid_in.attach_triangulation(triangulation);
-      std::ifstream gfile("annulus.msh");
-      AssertThrow(gfile.is_open(), ExcMessage("Grid file not found"));
-      grid_in.read_msh(gfile);
+      Triangulation<dim> serial_triangulation;
+      if(MeshCache::read_msh("annulus.msh", serial_triangulation, true,
+                             mpi_communicator))
+         pcout << "Loaded grid from cache\n";
+      triangulation.copy_triangulation(serial_triangulation);
 
       const Point<dim> center(0.0, 0.0);
       const SphericalManifold<dim> manifold(center);
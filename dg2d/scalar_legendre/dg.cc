@@ -835,6 +835,28 @@ DGScalar<dim>::process_solution()
              << n_dofs << " "
              << L2_error << " "
              << H1_error << std::endl;
+
+   // Mass and center of mass, which are known for test_rotate.h even when
+   // the exact solution is not, e.g., with inflow boundaries
+   QGauss<dim> quadrature(fe.degree + 1);
+   FEValues<dim> fe_values(mapping, fe, quadrature,
+                           update_values | update_quadrature_points |
+                           update_JxW_values);
+   std::vector<double> values(quadrature.size());
+   double mass = 0.0;
+   Point<dim> moment;
+   for(auto & cell : dof_handler.active_cell_iterators())
+   {
+      fe_values.reinit(cell);
+      fe_values.get_function_values(solution, values);
+      for(unsigned int q = 0; q < quadrature.size(); ++q)
+      {
+         mass += values[q] * fe_values.JxW(q);
+         moment += values[q] * fe_values.JxW(q) * fe_values.quadrature_point(q);
+      }
+   }
+   std::cout << "Mass = " << mass << std::endl;
+   std::cout << "Center of mass = " << moment / mass << std::endl;
 }
 
 //------------------------------------------------------------------------------
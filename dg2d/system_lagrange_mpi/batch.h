@@ -0,0 +1,240 @@
+//------------------------------------------------------------------------------
+// Batch driver: run many cases which differ only in scheme parameters (cfl,
+// numflux, limiter, tvb parameter, final time, ...) or problem parameters on
+// one grid. Cases are given as parameter files, each read after the main input
+// file, and/or as a sweep over all combinations of values:
+//
+//    set batch cases = rusanov.prm, steger.prm
+//    set batch sweep = cfl = 0.2,0.3; mach = 0.5,0.6
+//
+// A sweep name which is not an input parameter is passed to set_parameter of
+// the problem. Grid, dofs and mass matrix are made once. With batch groups > 1,
+// the ranks are split into groups which make their own grid and run every
+// n-th case concurrently.
+//------------------------------------------------------------------------------
+#ifndef __BATCH_H__
+#define __BATCH_H__
+
+#include <boost/serialization/map.hpp>
+#include <boost/serialization/string.hpp>
+#include <boost/serialization/utility.hpp>
+#include <boost/serialization/vector.hpp>
+
+#include <iomanip>
+
+template <int dim>
+class Batch
+{
+public:
+   Batch(const ParameterHandler& ph,
+         const std::string&      input_file,
+         Quadrature<1>&          quadrature_1d);
+   void run();
+
+private:
+   struct Case
+   {
+      std::string                                      name;
+      std::string                                      file; // may be empty
+      std::vector<std::pair<std::string, std::string>> values;
+   };
+
+   void make_cases(const ParameterHandler& ph);
+   void make_case_parameters(const Case& c, Parameter& param,
+                             Problem<dim>& problem) const;
+   void write_summary(const std::vector<std::map<std::string, double>>&
+                      results) const;
+
+   const MPI_Comm           world_comm;
+   const std::string        input_file;
+   Quadrature<1>            quadrature_1d;
+   unsigned int             n_groups;
+   std::vector<Case>        cases;
+   std::vector<Parameter>   params;
+   std::vector<Problem<dim>> problems;
+};
+
+//------------------------------------------------------------------------------
+template <int dim>
+Batch<dim>::Batch(const ParameterHandler& ph,
+                  const std::string&      input_file,
+                  Quadrature<1>&          quadrature_1d)
+   :
+   world_comm(MPI_COMM_WORLD),
+   input_file(input_file),
+   quadrature_1d(quadrature_1d),
+   n_groups(ph.get_integer("batch groups"))
+{
+   make_cases(ph);
+   params.resize(cases.size());
+   problems.resize(cases.size());
+   for(unsigned int i = 0; i < cases.size(); ++i)
+      make_case_parameters(cases[i], params[i], problems[i]);
+}
+
+//------------------------------------------------------------------------------
+// Every file case is combined with every combination of sweep values
+//------------------------------------------------------------------------------
+template <int dim>
+void
+Batch<dim>::make_cases(const ParameterHandler& ph)
+{
+   std::vector<std::string> files = Utilities::split_string_list(ph.get("batch cases"));
+   if(files.empty()) files.push_back("");
+
+   std::vector<Case> sweep(1);
+   for(const auto& entry : Utilities::split_string_list(ph.get("batch sweep"), ';'))
+   {
+      auto name_values = Utilities::split_string_list(entry, '=');
+      AssertThrow(name_values.size() == 2,
+                  ExcMessage("Give batch sweep as: name = v1,v2,..."));
+      std::vector<Case> new_sweep;
+      for(const auto& c : sweep)
+         for(const auto& value : Utilities::split_string_list(name_values[1], ','))
+         {
+            new_sweep.push_back(c);
+            new_sweep.back().values.emplace_back(name_values[0], value);
+         }
+      sweep = new_sweep;
+   }
+
+   for(const auto& file : files)
+      for(const auto& c : sweep)
+      {
+         Case new_case = c;
+         new_case.file = file;
+         std::string stem = file.substr(0, file.rfind(".prm"));
+         new_case.name = "case" + Utilities::int_to_string(cases.size(), 3);
+         if(!stem.empty()) new_case.name += "-" + stem;
+         cases.push_back(new_case);
+      }
+}
+
+//------------------------------------------------------------------------------
+template <int dim>
+void
+Batch<dim>::make_case_parameters(const Case&   c,
+                                 Parameter&    param,
+                                 Problem<dim>& problem) const
+{
+   ParameterHandler ph;
+   declare_parameters(ph);
+   ph.parse_input(input_file);
+   if(!c.file.empty()) ph.parse_input(c.file);
+
+   std::vector<std::pair<std::string, double>> problem_values;
+   for(const auto& [name, value] : c.values)
+   {
+      try
+      {
+         ph.set(name, value);
+      }
+      catch(const ExceptionBase&)
+      {
+         problem_values.emplace_back(name, Utilities::string_to_double(value));
+      }
+   }
+
+   param.final_time = problem.get_final_time(); // override in input file
+   parse_parameters(ph, param);
+   AssertThrow(param.ensemble_size == 1,
+               ExcMessage("Batch cases need ensemble size = 1"));
+   for(const auto& [name, values] : param.ensemble_parameters)
+      problem.set_parameter(name, values[0]);
+   for(const auto& [name, value] : problem_values)
+      problem.set_parameter(name, value);
+}
+
+//------------------------------------------------------------------------------
+template <int dim>
+void
+Batch<dim>::run()
+{
+   const unsigned int n_ranks = Utilities::MPI::n_mpi_processes(world_comm);
+   const unsigned int rank = Utilities::MPI::this_mpi_process(world_comm);
+   AssertThrow(n_ranks % n_groups == 0,
+               ExcMessage("Number of ranks must be multiple of batch groups"));
+   n_groups = std::min(n_groups, static_cast<unsigned int>(cases.size()));
+   while(n_ranks % n_groups != 0) --n_groups;
+   const unsigned int group = rank / (n_ranks / n_groups);
+
+   MPI_Comm group_comm;
+   const int ierr = MPI_Comm_split(world_comm, group, rank, &group_comm);
+   AssertThrowMPI(ierr);
+
+   if(rank == 0)
+      std::cout << "Running " << cases.size() << " batch cases in "
+                << n_groups << " groups\n";
+
+   // Results of own cases on rank 0 of each group, [case][quantity]
+   std::vector<std::pair<unsigned int, std::map<std::string, double>>> results;
+   {
+      DGSystem<dim> solver(params[group], problems[group], quadrature_1d,
+                           group_comm);
+      solver.set_verbose(group == 0 && rank == 0);
+      solver.setup();
+      for(unsigned int i = group; i < cases.size(); i += n_groups)
+      {
+         auto result = solver.run_case(params[i], problems[i], cases[i].name);
+         if(Utilities::MPI::this_mpi_process(group_comm) == 0)
+            results.emplace_back(i, result);
+      }
+   }
+   MPI_Comm_free(&group_comm);
+
+   const auto all_results = Utilities::MPI::gather(world_comm, results, 0);
+   if(rank != 0) return;
+
+   std::vector<std::map<std::string, double>> case_results(cases.size());
+   for(const auto& group_results : all_results)
+      for(const auto& [i, result] : group_results)
+         case_results[i] = result;
+   write_summary(case_results);
+}
+
+//------------------------------------------------------------------------------
+// One row per case with its file, sweep values and results, written to screen
+// and batch_summary.txt
+//------------------------------------------------------------------------------
+template <int dim>
+void
+Batch<dim>::write_summary(const std::vector<std::map<std::string, double>>&
+                          results) const
+{
+   std::vector<std::string> keys;
+   for(const auto& result : results)
+      for(const auto& key_value : result)
+         if(std::find(keys.begin(), keys.end(), key_value.first) == keys.end())
+            keys.push_back(key_value.first);
+
+   std::ostringstream table;
+   table << std::left << std::setw(24) << "# case";
+   if(!cases.empty())
+      for(const auto& value : cases[0].values)
+         table << std::setw(16) << value.first;
+   for(const auto& key : keys)
+      table << std::setw(16) << key;
+   table << "\n";
+
+   for(unsigned int i = 0; i < cases.size(); ++i)
+   {
+      table << std::setw(24) << cases[i].name;
+      for(const auto& value : cases[i].values)
+         table << std::setw(16) << value.second;
+      for(const auto& key : keys)
+      {
+         const auto it = results[i].find(key);
+         if(it != results[i].end())
+            table << std::setw(16) << std::setprecision(8) << it->second;
+         else
+            table << std::setw(16) << "-";
+      }
+      table << "\n";
+   }
+
+   std::cout << "\nBatch summary\n" << table.str();
+   std::ofstream file("batch_summary.txt");
+   file << table.str();
+}
+
+#endif
@@ -23,6 +23,7 @@
 #include <deal.II/base/function.h>
 #include <deal.II/base/parameter_handler.h>
 #include <deal.II/base/conditional_ostream.h>
+#include <deal.II/base/timer.h>
 
 #include <deal.II/numerics/vector_tools.h>
 #include <deal.II/numerics/data_out.h>
@@ -36,13 +37,25 @@
 #include <deal.II/distributed/tria.h>
 
 
+#include <algorithm>
+#include <array>
+#include <deque>
+#include <set>
 #include <fstream>
+#include <memory>
+#include <numeric>
 #include <iostream>
+#include <limits>
+#include <map>
 
 #include "pde.h"
 #include "../models/problem_base.h"
-
-#define sign(a)   (((a) > 0.0) ? 1 : -1)
+#include "../common/renumber.h"
+#include "../common/mesh_cache.h"
+#include "../common/perf_counters.h"
+#include "../common/limiter.h"
+#include "../common/memory_report.h"
+#include "probes.h"
 
 using namespace dealii;
 
@@ -68,41 +81,50 @@ struct Parameter
    std::string  grid;
    unsigned int n_cells_x, n_cells_y;
    unsigned int n_refine;
+   bool         mesh_cache;
    unsigned int output_step;
    unsigned int output_number;
    double       output_interval;
    LimiterType  limiter_type;
    double       Mlim;
    FluxType     flux_type;
+   std::string  eos_table;          // file, empty = eos of problem
+   std::string  cell_order;
+   std::string  dof_order;
+   unsigned int ensemble_size;
+   std::string  ensemble_dt;
+   // name and values of problem parameters which differ among members
+   std::vector<std::pair<std::string,std::vector<double>>> ensemble_parameters;
+   unsigned int n_time_slices;      // > 1 to use parareal
+   unsigned int coarse_degree;
+   double       coarse_cfl;        // 0 = 0.95/(2*coarse_degree+1)
+   double       parareal_tol;
+   unsigned int parareal_max_iter;
+   bool         parareal_reference;
+   std::vector<unsigned int> force_boundary_ids;
+   double       force_tol;          // > 0 to stop when forces settle
+   unsigned int force_window;
+   bool         diagnostics;
+   double       drift_tol;          // > 0 to stop when conserved vars drift
+   std::vector<Point<2>> probe_points; // includes points on probe lines
+   unsigned int probe_step;
+   bool         probe_binary;
+   bool         perf_counters;
+   std::string  perf_fp_events;
+   std::string  pmg_cycle;          // none, v or w; see pmg.h
+   unsigned int pmg_coarse_degree;
+   unsigned int pmg_pre_smooth;
+   unsigned int pmg_post_smooth;
+   unsigned int pmg_coarse_smooth;
+   unsigned int pmg_max_cycles;
+   double       pmg_tol;
 };
 
 //------------------------------------------------------------------------------
-// minmod of three numbers
-//------------------------------------------------------------------------------
-double
-minmod(const double a, const double b, const double c, const double Mh2 = 0.0)
-{
-   double aa = std::fabs(a);
-   if(aa < Mh2) return a;
-
-   int sa = sign(a);
-   int sb = sign(b);
-   int sc = sign(c);
-
-   double result;
-
-   if(sa != sb || sb != sc)
-   {
-      result = 0.0;
-   }
-   else
-   {
-      result  = sa * std::min(aa, std::min(std::fabs(b), std::fabs(c)));
-   }
-
-   return result;
-}
-
+// Values of the active ensemble members are stored with the member index
+// innermost, e.g., [q][var][member], as in the solution vector, so that the
+// batch fluxes of the PDE and the loops over members in the evaluation and
+// integration of the kernels are unit stride and can be vectorized.
 //------------------------------------------------------------------------------
 template <int dim>
 struct ScratchData
@@ -111,23 +133,32 @@ struct ScratchData
                const FiniteElement<dim> &fe,
                const Quadrature<dim> &cell_quadrature,
                const Quadrature<dim-1> &face_quadrature,
+               const unsigned int n_members,
                const UpdateFlags update_flags = update_values |
                                                 update_gradients |
                                                 update_quadrature_points |
                                                 update_JxW_values,
-               const UpdateFlags interface_update_flags = update_values | 
+               const UpdateFlags interface_update_flags = update_values |
                                                           update_quadrature_points |
-                                                          update_JxW_values | 
+                                                          update_JxW_values |
                                                           update_normal_vectors)
-       : 
-       fe_values(mapping, fe, cell_quadrature, update_flags), 
+       :
+       fe_values(mapping, fe, cell_quadrature, update_flags),
        fe_interface_values(mapping,
                            fe,
                            face_quadrature,
                            interface_update_flags),
-      solution_values(cell_quadrature.size(), Vector<double>(nvar)),
-      left_state(face_quadrature.size(), Vector<double>(nvar)),
-      right_state(face_quadrature.size(), Vector<double>(nvar))
+      dof_values(2 * fe.n_dofs_per_cell() * n_members),
+      cell_flux(cell_quadrature.size() * nvar * dim * n_members),
+      left_values(face_quadrature.size() * nvar * n_members),
+      right_values(face_quadrature.size() * nvar * n_members),
+      face_flux(face_quadrature.size() * nvar * n_members),
+      state(nvar * n_members),
+      left_average(nvar * n_members),
+      right_average(nvar * n_members),
+      flux_work(PDE::batch_work * n_members),
+      left_state(nvar),
+      right_state(nvar)
    {
    }
 
@@ -140,74 +171,285 @@ struct ScratchData
                              scratch_data.fe_interface_values.get_fe(),
                              scratch_data.fe_interface_values.get_quadrature(),
                              scratch_data.fe_interface_values.get_update_flags()),
-         solution_values(scratch_data.fe_values.get_quadrature().size(),
-                         Vector<double>(nvar)),
-         left_state(scratch_data.fe_interface_values.get_quadrature().size(),
-                    Vector<double>(nvar)),
-         right_state(scratch_data.fe_interface_values.get_quadrature().size(),
-                     Vector<double>(nvar))
+         dof_values(scratch_data.dof_values),
+         cell_flux(scratch_data.cell_flux),
+         left_values(scratch_data.left_values),
+         right_values(scratch_data.right_values),
+         face_flux(scratch_data.face_flux),
+         state(scratch_data.state),
+         left_average(scratch_data.left_average),
+         right_average(scratch_data.right_average),
+         flux_work(scratch_data.flux_work),
+         left_state(nvar),
+         right_state(nvar)
+   {
+   }
+
+   // Work arrays, without the FEValues objects
+   std::size_t memory_consumption() const
    {
+      return MemoryConsumption::memory_consumption(dof_values) +
+             MemoryConsumption::memory_consumption(cell_flux) +
+             MemoryConsumption::memory_consumption(left_values) +
+             MemoryConsumption::memory_consumption(right_values) +
+             MemoryConsumption::memory_consumption(face_flux) +
+             MemoryConsumption::memory_consumption(state) +
+             MemoryConsumption::memory_consumption(left_average) +
+             MemoryConsumption::memory_consumption(right_average) +
+             MemoryConsumption::memory_consumption(flux_work);
    }
 
    FEValues<dim> fe_values;
    FEInterfaceValues<dim> fe_interface_values;
-   std::vector<Vector<double>> solution_values;
-   std::vector<Vector<double>> left_state;
-   std::vector<Vector<double>> right_state;
+   std::vector<double> dof_values;   // [i][member], i over dofs of both cells
+   std::vector<double> cell_flux;    // [q][var][d][member], times JxW
+   std::vector<double> left_values;  // [q][var][member]
+   std::vector<double> right_values; // [q][var][member]
+   std::vector<double> face_flux;    // [q][var][member], times JxW
+   std::vector<double> state;        // [var][member] at one cell point
+   std::vector<double> left_average; // [var][member]
+   std::vector<double> right_average;// [var][member]
+   std::vector<double> flux_work;    // for the batch fluxes of PDE
+   // State of one member, for boundary values and forces
+   Vector<double> left_state, right_state;
 };
 
 //------------------------------------------------------------------------------
 struct CopyDataFace
 {
    std::vector<types::global_dof_index> joint_dof_indices;
-   Vector<double> cell_rhs;
+   Vector<double> cell_rhs; // [i][member]
 };
 
 //------------------------------------------------------------------------------
 struct CopyData
 {
-   Vector<double> cell_rhs;
+   Vector<double> cell_rhs; // [i][member]
    std::vector<types::global_dof_index> local_dof_indices;
    std::vector<CopyDataFace> face_data;
+   std::vector<Tensor<1,3>> force;       // fx, fy, moment of active members
 
    template <class Iterator>
-   void reinit(const Iterator &cell, unsigned int dofs_per_cell)
+   void reinit(const Iterator &cell,
+               unsigned int dofs_per_cell,
+               unsigned int n_members)
    {
-      cell_rhs.reinit(dofs_per_cell);
+      cell_rhs.reinit(dofs_per_cell * n_members);
 
       local_dof_indices.resize(dofs_per_cell);
       cell->get_dof_indices(local_dof_indices);
+      force.assign(n_members, Tensor<1,3>());
    }
 };
 
+//------------------------------------------------------------------------------
+// Evaluate face values of all members on one side of a face, from dof values
+// u[i][member] of that cell.
+//------------------------------------------------------------------------------
+template <int dim>
+void
+evaluate_face_values(const FEFaceValuesBase<dim>& fe_face_values,
+                     const double*                u,
+                     const unsigned int           n_members,
+                     std::vector<double>&         values)
+{
+   const auto& fe = fe_face_values.get_fe();
+   const unsigned int n_q_points = fe_face_values.n_quadrature_points;
+   std::fill(values.begin(), values.end(), 0.0);
+   for(unsigned int i = 0; i < fe.n_dofs_per_cell(); ++i)
+   {
+      const auto c = fe.system_to_component_index(i).first;
+      const double* ui = u + i * n_members;
+      for(unsigned int q = 0; q < n_q_points; ++q)
+      {
+         const double phi = fe_face_values.shape_value_component(i, q, c);
+         double* v = &values[(q * nvar + c) * n_members];
+         for(unsigned int m = 0; m < n_members; ++m)
+            v[m] += phi * ui[m];
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+// Indices of the ensemble vectors: dof i of member m is at i * n_members + m
+//------------------------------------------------------------------------------
+inline IndexSet
+ensemble_index_set(const IndexSet& dofs, const unsigned int n_members)
+{
+   return dofs.tensor_product(complete_index_set(n_members));
+}
+
+//------------------------------------------------------------------------------
+// Run diagnostics of one member, computed from cell averages:
+//    integrals of conserved variables, integral of entropy,
+//    number of cells with inadmissible average,
+//    -min density, max density, -min pressure, max pressure
+// The first n_sum values are summed and the rest are maximized over ranks, so
+// that diagnostics of all members are reduced with one MPI_Allreduce on
+// records of this size.
+//------------------------------------------------------------------------------
+namespace Diagnostics
+{
+   constexpr unsigned int n_sum = nvar + 2;
+   constexpr unsigned int size = n_sum + 4;
+
+   std::vector<double> initial()
+   {
+      std::vector<double> d(size, 0.0);
+      for(unsigned int i = n_sum; i < size; ++i)
+         d[i] = std::numeric_limits<double>::lowest();
+      return d;
+   }
+
+   template <int dim>
+   void add(const Vector<double>& u,
+            const double          measure,
+            std::vector<double>&  d)
+   {
+      for(unsigned int i = 0; i < nvar; ++i)
+         d[i] += u[i] * measure;
+      if(PDE::is_admissible<dim>(u))
+         d[nvar] += PDE::entropy<dim>(u) * measure;
+      else
+         d[nvar + 1] += 1.0;
+      const double rho = u[0], pre = PDE::pressure<dim>(u);
+      d[n_sum]     = std::max(d[n_sum], -rho);
+      d[n_sum + 1] = std::max(d[n_sum + 1], rho);
+      d[n_sum + 2] = std::max(d[n_sum + 2], -pre);
+      d[n_sum + 3] = std::max(d[n_sum + 3], pre);
+   }
+
+   // len is the number of records, which MPI never splits
+   void reduce_op(void* in, void* inout, int* len, MPI_Datatype* /*type*/)
+   {
+      const double* a = static_cast<const double*>(in);
+      double* b = static_cast<double*>(inout);
+      for(int r = 0; r < *len; ++r, a += size, b += size)
+      {
+         for(unsigned int i = 0; i < n_sum; ++i)
+            b[i] += a[i];
+         for(unsigned int i = n_sum; i < size; ++i)
+            b[i] = std::max(a[i], b[i]);
+      }
+   }
+
+   // MPI type of one record and the reduction op, created once per solver
+   struct Reduction
+   {
+      Reduction()
+      {
+         MPI_Type_contiguous(size, MPI_DOUBLE, &type);
+         MPI_Type_commit(&type);
+         MPI_Op_create(&reduce_op, 1, &op);
+      }
+
+      ~Reduction()
+      {
+         MPI_Op_free(&op);
+         MPI_Type_free(&type);
+      }
+
+      MPI_Datatype type;
+      MPI_Op       op;
+   };
+}
+
 //------------------------------------------------------------------------------
 // Main class of the problem
+// An ensemble of solutions can be computed, each with its own problem object,
+// e.g., with different Mach numbers. The members share grid, dofs, mapping and
+// mass matrix, and they are advanced together in the same cell and face loops.
+// Their solutions are held in one vector with the member index innermost, so
+// that the values of all members at a dof are adjacent and one ghost exchange
+// per stage serves all members.
 //------------------------------------------------------------------------------
 template <int dim>
 class DGSystem
 {
 public:
+   typedef LinearAlgebra::distributed::Vector<double> PVector;
+
    DGSystem(Parameter&        param,
             ProblemBase<dim>& problem,
-            Quadrature<1>&    quadrature_1d);
+            Quadrature<1>&    quadrature_1d,
+            const MPI_Comm    mpi_comm = MPI_COMM_WORLD);
+   DGSystem(Parameter&                            param,
+            const std::vector<ProblemBase<dim>*>& problems,
+            Quadrature<1>&                        quadrature_1d,
+            const MPI_Comm                        mpi_comm = MPI_COMM_WORLD);
    void run();
 
+   // Used by time parallel drivers, see parareal.h
+   void setup();
+   void solve(const double end_time, const bool save_output);
+   void set_solution(const PVector& u, const double t);
+   void write_solution();
+   void set_verbose(const bool verbose) { pcout.set_condition(verbose); }
+
+   // Used by batch driver, see batch.h
+   std::map<std::string, double> run_case(Parameter&         case_param,
+                                          ProblemBase<dim>&  case_problem,
+                                          const std::string& name);
+   const PVector& get_solution() const { return member_solution(0); }
+   const DoFHandler<dim>& get_dof_handler() const { return dof_handler; }
+   const Mapping<dim, dim>& get_mapping() const { return mapping(); }
+
+   // Used by p-multigrid driver, see pmg.h
+   void smooth(const PVector& forcing, const unsigned int n_steps);
+   void compute_residual(PVector& r, const unsigned int step = 0);
+   void setup_outputs();
+   void print_forces() const;
+   unsigned int get_n_rhs() const { return n_rhs; }
+
 private:
    typedef parallel::distributed::Triangulation<dim> PTriangulation;
-   typedef LinearAlgebra::distributed::Vector<double> PVector;
+
+   // Data of one ensemble member
+   struct Member
+   {
+      ProblemBase<dim>*           problem;
+      unsigned int                index;  // in the ensemble vectors
+      std::string                 prefix; // for output file names
+      double                      time, stage_time, dt, next_output_time;
+      unsigned int                time_step;
+      unsigned int                output_counter;
+      std::vector<XDMFEntry>      xdmf_entries;
+      std::vector<Vector<double>> average;
+      std::ofstream               probe_file; // only on rank 0
+      typename ProblemBase<dim>::ForceReference force_ref;
+      Tensor<1,3>                 force;      // fx, fy, moment
+      double                      cl, cd, cm;
+      std::deque<std::array<double,2>> force_history; // cl, cd
+      std::ofstream               force_file; // only on rank 0
+      bool                        converged;  // forces have settled
+      std::vector<double>         diagnostics, diagnostics0; // now, initial
+      std::ofstream               diagnostics_file; // only on rank 0
+   };
 
    void make_grid_and_dofs();
    const Mapping<dim, dim>& mapping() const;
    void initialize();
+   const PVector& member_solution(const unsigned int m) const;
    void assemble_mass_matrix();
    void assemble_rhs();
    void compute_averages();
    void compute_dt();
+   void compute_local_dt();
    void apply_limiter();
    void apply_TVD_limiter();
    void update(const unsigned int rk_stage);
-   bool call_output();
-   void output_results(const double time) const;
+   bool call_output(Member& member);
+   void output_results(Member& member) const;
+   void setup_forces();
+   void record_forces(Member& member);
+   void write_cp(const Member& member) const;
+   void setup_diagnostics();
+   void reduce_diagnostics();
+   void record_diagnostics(Member& member);
+   void setup_probes();
+   void print_memory(const std::string& when);
+   void gather_active(const types::global_dof_index i, double* v) const;
+   void gather_averages(const unsigned int c, double* a) const;
 
    template <class Iterator>
    void cell_worker(const Iterator &cell,
@@ -232,46 +474,96 @@ private:
 
    const MPI_Comm              mpi_comm;
    Parameter*                  param;
-   double                      time, stage_time, dt, next_output_time;
-   unsigned int                time_step;
-   ProblemBase<dim>*           problem;
+   ProblemBase<dim>*           problem; // of first member, used for grid
+   std::vector<Member>         members;
+   std::vector<unsigned int>   active;  // members not yet at end time
+   PVector                     solution; // [dof][member]
+   PVector                     solution_old;
+   PVector                     rhs;
+   mutable PVector             member_work; // one member, see member_solution
+   double                      end_time;
+   bool                        save_output;
    ConditionalOStream          pcout;
+   TimerOutput                 computing_timer;
    PTriangulation              triangulation;
    FESystem<dim>               fe;
    DoFHandler<dim>             dof_handler;
    AffineConstraints<double>   constraints;
    const Quadrature<dim>       cell_quadrature;
    const Quadrature<dim-1>     face_quadrature;
-   PVector                     solution;
-   PVector                     solution_old;
-   PVector                     rhs;
    PVector                     imm;
-   std::vector<Vector<double>> average;
+   PVector                     local_dt; // pseudo time step of each dof
+   unsigned int                n_rhs = 0; // rhs evaluations so far
+   Probes<dim>                 probes;
+   std::set<types::boundary_id> force_ids;
+   bool                        compute_forces; // in current rhs assembly
+   bool                        compute_diagnostics; // in compute_averages
+   std::unique_ptr<Diagnostics::Reduction> diagnostics_reduction;
+   PerfCounters::Monitor       perf;
+   MemoryReport::Report        memory;
+   mutable std::size_t         output_memory = 0; // largest DataOut seen
 };
 
 //------------------------------------------------------------------------------
-// Constructor
+// Constructor for single solution
 //------------------------------------------------------------------------------
 template <int dim>
 DGSystem<dim>::DGSystem(Parameter&        param,
                         ProblemBase<dim>& problem,
-                        Quadrature<1>&    quadrature_1d)
+                        Quadrature<1>&    quadrature_1d,
+                        const MPI_Comm    mpi_comm)
    :
-   mpi_comm(MPI_COMM_WORLD),
+   DGSystem(param, std::vector<ProblemBase<dim>*>{&problem}, quadrature_1d,
+            mpi_comm)
+{
+}
+
+//------------------------------------------------------------------------------
+// Constructor for ensemble of solutions
+//------------------------------------------------------------------------------
+template <int dim>
+DGSystem<dim>::DGSystem(Parameter&                            param,
+                        const std::vector<ProblemBase<dim>*>& problems,
+                        Quadrature<1>&                        quadrature_1d,
+                        const MPI_Comm                        mpi_comm)
+   :
+   mpi_comm(mpi_comm),
    param(&param),
-   problem(&problem),
+   problem(problems[0]),
+   members(problems.size()),
    pcout(std::cout, (Utilities::MPI::this_mpi_process(mpi_comm) == 0)),
+   computing_timer(mpi_comm, pcout, TimerOutput::never, TimerOutput::wall_times),
    triangulation(mpi_comm),
    fe(FE_DGQArbitraryNodes<dim>(quadrature_1d),nvar),
    dof_handler(triangulation),
    cell_quadrature(quadrature_1d),
-   face_quadrature(quadrature_1d)
+   face_quadrature(quadrature_1d),
+   force_ids(param.force_boundary_ids.begin(), param.force_boundary_ids.end()),
+   compute_forces(false),
+   compute_diagnostics(false)
 {
    AssertThrow(dim == 2, ExcIndexRange(dim, 0, 2));
 
-   time = 0.0;
-   time_step = 0;
-   next_output_time = param.output_interval;
+   for(unsigned int m = 0; m < members.size(); ++m)
+   {
+      auto& member = members[m];
+      member.problem = problems[m];
+      member.index = m;
+      // Keep old file names when there is only one member
+      member.prefix = (members.size() == 1) ? ""
+                      : "m" + Utilities::int_to_string(m, 2) + "-";
+      member.time = 0.0;
+      member.stage_time = 0.0;
+      member.dt = 0.0;
+      member.time_step = 0;
+      member.next_output_time = param.output_interval;
+      member.output_counter = 0;
+      member.force_ref = member.problem->get_force_reference();
+      member.cl = member.cd = member.cm = 0.0;
+      member.converged = false;
+   }
+   end_time = param.final_time;
+   save_output = true;
 }
 
 //------------------------------------------------------------------------------
@@ -282,10 +574,19 @@ void
 DGSystem<dim>::make_grid_and_dofs()
 {
    pcout << "Making initial grid ...\n";
+
+   // When coarse cells are to be reordered, the grid is first made in a serial
+   // triangulation and copied to the distributed one in the new order.
+   Triangulation<dim> serial_triangulation;
+   Triangulation<dim>& coarse
+      = (param->cell_order == "natural")
+        ? static_cast<Triangulation<dim>&>(triangulation)
+        : serial_triangulation;
+
    if(param->grid == "user")
    {
       pcout << "   User specified code for grid generation ...\n";
-      problem->make_grid(triangulation);
+      problem->make_grid(coarse);
    }
    else if(param->grid == "box")
    {
@@ -295,17 +596,26 @@ DGSystem<dim>::make_grid_and_dofs()
       const Point<dim> p1(problem->get_xmin(), problem->get_ymin());
       const Point<dim> p2(problem->get_xmax(), problem->get_ymax());
       std::vector<unsigned int> ncells2d({param->n_cells_x,param->n_cells_y});
-      GridGenerator::subdivided_hyper_rectangle(triangulation, ncells2d,
+      GridGenerator::subdivided_hyper_rectangle(coarse, ncells2d,
                                                 p1, p2, true);
    }
    else
    {
       pcout << "Reading gmsh grid from file " << param->grid << std::endl;
-      GridIn<dim> grid_in;
-      grid_in.attach_triangulation(triangulation);
-      std::ifstream gfile(param->grid);
-      AssertThrow(gfile.is_open(), ExcMessage("Grid file not found"));
-      grid_in.read_msh(gfile);
+      // Cached grid is read into a serial triangulation and then copied
+      if(MeshCache::read_msh(param->grid, serial_triangulation,
+                             param->mesh_cache, mpi_comm))
+         pcout << "   Loaded grid from cache\n";
+      if(param->cell_order == "natural")
+         triangulation.copy_triangulation(serial_triangulation);
+   }
+
+   if(param->cell_order != "natural")
+   {
+      pcout << "   Ordering coarse cells along " << param->cell_order
+            << " curve\n";
+      Renumber::reorder_coarse_cells(serial_triangulation, triangulation,
+                                     param->cell_order);
    }
 
    if(problem->get_periodic())
@@ -341,17 +651,30 @@ DGSystem<dim>::make_grid_and_dofs()
    pcout << "   Transforming grid\n";
    problem->transform_grid(triangulation);
 
+   // Refined grid of a msh file is cached; p4est loads it on the coarse grid
+   // made above, see mesh_cache.h
    if(param->n_refine > 0)
    {
-      pcout << "   Refining initial grid\n";
-      triangulation.refine_global(param->n_refine);
+      const bool cache = param->mesh_cache &&
+                         param->grid != "user" && param->grid != "box";
+      const std::string cache_file
+         = cache ? MeshCache::refined_file_name(param->grid, dim,
+                                                param->n_refine,
+                                                problem->get_name() + "|" +
+                                                param->cell_order)
+                 : "";
+      if(cache && MeshCache::load_refined(cache_file, triangulation))
+      {
+         pcout << "   Loaded refined grid from cache\n";
+      }
+      else
+      {
+         pcout << "   Refining initial grid\n";
+         triangulation.refine_global(param->n_refine);
+         if(cache) MeshCache::save_refined(cache_file, triangulation);
+      }
    }
 
-   unsigned int counter = 0;
-   for(auto & cell : triangulation.active_cell_iterators())
-      if(cell->is_locally_owned() || cell->is_ghost())
-         cell->set_user_index(counter++);
-
    pcout << "   Number of active cells: "
          << triangulation.n_global_active_cells()
          << std::endl
@@ -361,6 +684,21 @@ DGSystem<dim>::make_grid_and_dofs()
 
    dof_handler.distribute_dofs(fe);
 
+   // Number dofs and cell data in the same order of cells
+   const auto owned_cells = (param->dof_order == "cuthill_mckee")
+                            ? Renumber::cuthill_mckee_cells(dof_handler)
+                            : Renumber::natural_cells(dof_handler);
+   if(param->dof_order == "cuthill_mckee")
+   {
+      pcout << "   Renumbering dofs by Cuthill-McKee ordering of cells\n";
+      DoFRenumbering::cell_wise(dof_handler, owned_cells);
+   }
+   const unsigned int counter = Renumber::set_user_indices(dof_handler,
+                                                           owned_cells);
+   const unsigned int n_ghost = Utilities::MPI::sum(counter - owned_cells.size(),
+                                                    mpi_comm);
+   pcout << "   Number of ghost cells (sum over ranks): " << n_ghost << "\n";
+
    pcout << "   Number of degrees of freedom: "
          << dof_handler.n_dofs()
          << std::endl;
@@ -370,12 +708,19 @@ DGSystem<dim>::make_grid_and_dofs()
    DoFTools::extract_locally_relevant_dofs(dof_handler,
                                            locally_relevant_dofs);
 
-   // Solution and rhs variables
-   solution.reinit(locally_owned_dofs, locally_relevant_dofs, mpi_comm);
-   solution_old.reinit(locally_owned_dofs, mpi_comm);
+   // Solution and rhs variables of all members
+   const unsigned int nm = members.size();
+   solution.reinit(ensemble_index_set(locally_owned_dofs, nm),
+                   ensemble_index_set(locally_relevant_dofs, nm), mpi_comm);
+   solution_old.reinit(ensemble_index_set(locally_owned_dofs, nm), mpi_comm);
    rhs.reinit(solution);
-   imm.reinit(solution_old);
-   average.resize(counter, Vector<double>(nvar));
+   if(nm > 1)
+      member_work.reinit(locally_owned_dofs, locally_relevant_dofs, mpi_comm);
+   for(auto& member : members)
+      member.average.resize(counter, Vector<double>(nvar));
+   imm.reinit(locally_owned_dofs, mpi_comm);
+   if(param->pmg_cycle != "none")
+      local_dt.reinit(locally_owned_dofs, mpi_comm);
 
    // We dont have any constraints in DG.
    constraints.clear();
@@ -480,6 +825,8 @@ DGSystem<dim>::initialize()
                            update_quadrature_points);
    const unsigned int   n_q_points    = cell_quadrature.size();
    std::vector<types::global_dof_index> dof_indices(fe.dofs_per_cell);
+   Vector<double> initial_value(nvar);
+   const unsigned int nm = members.size();
 
    for(auto & cell : dof_handler.active_cell_iterators())
    if(cell->is_locally_owned())
@@ -487,22 +834,77 @@ DGSystem<dim>::initialize()
       fe_values.reinit(cell);
       cell->get_dof_indices(dof_indices);
 
-      for(unsigned int q = 0; q < n_q_points; ++q)
-      {
-         Vector<double> initial_value(nvar);
-         problem->initial_value(fe_values.quadrature_point(q),
-                                initial_value);
-         for(unsigned int i = 0; i < nvar; ++i)
+      for(auto& member : members)
+         for(unsigned int q = 0; q < n_q_points; ++q)
          {
-            auto idx = fe.component_to_system_index(i, q);
-            solution(dof_indices[idx]) = initial_value[i];
+            member.problem->initial_value(fe_values.quadrature_point(q),
+                                          initial_value);
+            for(unsigned int i = 0; i < nvar; ++i)
+            {
+               auto idx = fe.component_to_system_index(i, q);
+               solution(dof_indices[idx] * nm + member.index) = initial_value[i];
+            }
          }
-      }
    }
 
    solution.compress(VectorOperation::insert);
 }
 
+//------------------------------------------------------------------------------
+// Solution of member m with ghost values, for output and probes. With one
+// member, this is the solution vector itself.
+//------------------------------------------------------------------------------
+template <int dim>
+const typename DGSystem<dim>::PVector&
+DGSystem<dim>::member_solution(const unsigned int m) const
+{
+   const unsigned int nm = members.size();
+   if(nm == 1) return solution;
+
+   // Local elements, owned and ghost, are in the same order in both vectors
+   const unsigned int n_local = member_work.locally_owned_size() +
+                                member_work.get_partitioner()->n_ghost_indices();
+   for(unsigned int i = 0; i < n_local; ++i)
+      member_work.local_element(i) = solution.local_element(i * nm + m);
+   member_work.set_ghost_state(true);
+   return member_work;
+}
+
+//------------------------------------------------------------------------------
+// v[j] = solution at dof i of the j'th active member, from the adjacent values
+// of all members
+//------------------------------------------------------------------------------
+template <int dim>
+inline void
+DGSystem<dim>::gather_active(const types::global_dof_index i, double* v) const
+{
+   const unsigned int nm = members.size();
+   const double* s = solution.begin() +
+                     solution.get_partitioner()->global_to_local(i * nm);
+   if(active.size() == nm)
+      std::copy(s, s + nm, v);
+   else
+      for(unsigned int j = 0; j < active.size(); ++j)
+         v[j] = s[active[j]];
+}
+
+//------------------------------------------------------------------------------
+// Cell averages of cell c of the active members as [var][member]
+//------------------------------------------------------------------------------
+template <int dim>
+inline void
+DGSystem<dim>::gather_averages(const unsigned int c, double* a) const
+{
+   const unsigned int na = active.size();
+   for(unsigned int j = 0; j < na; ++j)
+      for(unsigned int i = 0; i < nvar; ++i)
+         a[i * na + j] = members[active[j]].average[c][i];
+}
+
+//------------------------------------------------------------------------------
+// The geometric data at a quadrature point is loaded once for all the members,
+// and the fluxes of all active members are computed by one call of the batch
+// flux functions of the PDE.
 //------------------------------------------------------------------------------
 template <int dim>
 template <class Iterator>
@@ -513,38 +915,52 @@ void DGSystem<dim>::cell_worker(const Iterator &cell,
    FEValues<dim> &fe_values = scratch_data.fe_values;
    fe_values.reinit(cell);
 
-   const unsigned int dofs_per_cell = fe_values.get_fe().n_dofs_per_cell();
+   const auto &fe = fe_values.get_fe();
+   const unsigned int dofs_per_cell = fe.n_dofs_per_cell();
    const unsigned int n_q_points = fe_values.get_quadrature().size();
+   const unsigned int na = active.size();
 
-   copy_data.reinit(cell, dofs_per_cell);
+   copy_data.reinit(cell, dofs_per_cell, na);
 
    auto &cell_rhs = copy_data.cell_rhs;
-   auto &solution_values = scratch_data.solution_values;
    auto &dof_indices = copy_data.local_dof_indices;
+   auto &u = scratch_data.dof_values;
+   auto &cell_flux = scratch_data.cell_flux;
+   auto &state = scratch_data.state;
 
    for(unsigned int i=0; i<dofs_per_cell; ++i)
+      gather_active(dof_indices[i], &u[i * na]);
+
+   // Quadrature points are the nodes, so solution at q is a dof value
+   for (unsigned int q = 0; q < n_q_points; ++q)
    {
-      auto comp_i = fe_values.get_fe().system_to_component_index(i).first;
-      auto indx_i = fe_values.get_fe().system_to_component_index(i).second;
-      solution_values[indx_i][comp_i] = solution(dof_indices[i]);
+      for(unsigned int c=0; c<nvar; ++c)
+      {
+         const double* uc = &u[fe.component_to_system_index(c, q) * na];
+         std::copy(uc, uc + na, &state[c * na]);
+      }
+      double* f = &cell_flux[q * nvar * dim * na];
+      PDE::physical_flux(na, state.data(), fe_values.quadrature_point(q), f,
+                         scratch_data.flux_work.data());
+      const double JxW = fe_values.JxW(q);
+      for(unsigned int k=0; k<nvar * dim * na; ++k)
+         f[k] *= JxW;
    }
 
-   for (unsigned int q = 0; q < n_q_points; ++q)
+   for (unsigned int i = 0; i < dofs_per_cell; ++i)
    {
-      FluxData<dim> data;
-      data.p = fe_values.quadrature_point(q);
-      data.t = stage_time;
-      ndarray<double,nvar,dim> flux;
-      PDE::physical_flux(solution_values[q], data, flux);
-      for (unsigned int i = 0; i < dofs_per_cell; ++i)
+      const auto c = fe.system_to_component_index(i).first;
+      double* r = &cell_rhs[i * na];
+      for (unsigned int q = 0; q < n_q_points; ++q)
       {
-         const auto c = fe_values.get_fe().system_to_component_index(i).first;
          const auto& shape_grad = fe_values.shape_grad_component(i,q,c);
-         double tmp = 0.0;
-         for(unsigned int d=0; d<dim; ++d) tmp += shape_grad[d] * flux[c][d];
-         cell_rhs(i) += tmp * fe_values.JxW(q);
+         for(unsigned int d=0; d<dim; ++d)
+         {
+            const double* f = &cell_flux[((q * nvar + c) * dim + d) * na];
+            for(unsigned int m=0; m<na; ++m)
+               r[m] += shape_grad[d] * f[m];
+         }
       }
-
    }
 }
 
@@ -563,47 +979,68 @@ void DGSystem<dim>::face_worker(const Iterator &cell,
    FEInterfaceValues<dim> &fe_face_values = scratch_data.fe_interface_values;
    fe_face_values.reinit(cell, f, sf, ncell, nf, nsf);
 
-   const unsigned int n_cell_dofs = fe_face_values.get_fe().n_dofs_per_cell();
+   const auto &fe = fe_face_values.get_fe();
+   const unsigned int n_cell_dofs = fe.n_dofs_per_cell();
    const unsigned int n_face_dofs = fe_face_values.n_current_interface_dofs();
    const unsigned int n_q_points = fe_face_values.get_quadrature().size();
+   const unsigned int na = active.size();
    const auto &q_points = fe_face_values.get_quadrature_points();
 
-   auto &left_state = scratch_data.left_state;
-   auto &right_state = scratch_data.right_state;
-   fe_face_values.get_fe_face_values(0).get_function_values(solution, left_state);
-   fe_face_values.get_fe_face_values(1).get_function_values(solution, right_state);
-
    copy_data.face_data.emplace_back();
    CopyDataFace &copy_data_face = copy_data.face_data.back();
    copy_data_face.joint_dof_indices = fe_face_values.get_interface_dof_indices();
-   copy_data_face.cell_rhs.reinit(n_face_dofs);
+   copy_data_face.cell_rhs.reinit(n_face_dofs * na);
    auto &cell_rhs = copy_data_face.cell_rhs;
 
+   // First n_cell_dofs interface dofs are of cell, rest of ncell
+   auto &u = scratch_data.dof_values;
+   for(unsigned int i=0; i<n_face_dofs; ++i)
+      gather_active(copy_data_face.joint_dof_indices[i], &u[i * na]);
+   evaluate_face_values(fe_face_values.get_fe_face_values(0), &u[0], na,
+                        scratch_data.left_values);
+   evaluate_face_values(fe_face_values.get_fe_face_values(1),
+                        &u[n_cell_dofs * na], na,
+                        scratch_data.right_values);
+   gather_averages(cell->user_index(), scratch_data.left_average.data());
+   gather_averages(ncell->user_index(), scratch_data.right_average.data());
+
+   auto &face_flux = scratch_data.face_flux;
    for(unsigned int q=0; q<n_q_points; ++q)
    {
-      FluxData<dim> data;
-      data.p = q_points[q];
-      data.t = stage_time;
-      data.ul = &average[cell->user_index()];
-      data.ur = &average[ncell->user_index()];
-      Vector<double> num_flux(nvar);
-      PDE::numerical_flux(param->flux_type, 
-                          left_state[q], 
-                          right_state[q], 
+      double* fq = &face_flux[q * nvar * na];
+      PDE::numerical_flux(param->flux_type,
+                          na,
+                          &scratch_data.left_values[q * nvar * na],
+                          &scratch_data.right_values[q * nvar * na],
+                          scratch_data.left_average.data(),
+                          scratch_data.right_average.data(),
                           fe_face_values.normal(q),
-                          data,
-                          num_flux);
-      for (unsigned int i = 0; i < n_face_dofs; ++i)
+                          q_points[q],
+                          fq,
+                          scratch_data.flux_work.data());
+      const double JxW = fe_face_values.JxW(q);
+      for(unsigned int k=0; k<nvar * na; ++k)
+         fq[k] *= JxW;
+   }
+
+   for (unsigned int i = 0; i < n_face_dofs; ++i)
+   {
+      unsigned int ii = (i < n_cell_dofs) ? i : i - n_cell_dofs;
+      const auto c = fe.system_to_component_index(ii).first;
+      double* r = &cell_rhs[i * na];
+      for(unsigned int q=0; q<n_q_points; ++q)
       {
-         unsigned int ii = (i < n_cell_dofs) ? i : i - n_cell_dofs;
-         const auto c = fe_face_values.get_fe().system_to_component_index(ii).first;
-         cell_rhs(i) -= num_flux[c] *
-                        fe_face_values.jump_in_shape_values(i, q, c) *
-                        fe_face_values.JxW(q);
+         const double jump = fe_face_values.jump_in_shape_values(i, q, c);
+         const double* fq = &face_flux[(q * nvar + c) * na];
+         for(unsigned int m=0; m<na; ++m)
+            r[m] -= jump * fq[m];
       }
    }
 }
 
+//------------------------------------------------------------------------------
+// Boundary states are given member by member by the problem of each member,
+// and the flux is computed for all of them.
 //------------------------------------------------------------------------------
 template <int dim>
 template <class Iterator>
@@ -613,54 +1050,97 @@ void DGSystem<dim>::boundary_worker(const Iterator &cell,
                                     CopyData &copy_data)
 {
    scratch_data.fe_interface_values.reinit(cell, f);
-   const auto &fe_face_values 
+   const auto &fe_face_values
       = scratch_data.fe_interface_values.get_fe_face_values(0);
 
-   const unsigned int n_face_dofs = fe_face_values.get_fe().n_dofs_per_cell();
+   const auto &fe = fe_face_values.get_fe();
+   const unsigned int n_face_dofs = fe.n_dofs_per_cell();
    const unsigned int n_q_points = fe_face_values.get_quadrature().size();
+   const unsigned int na = active.size();
    const auto &q_points = fe_face_values.get_quadrature_points();
 
-   auto &left_state = scratch_data.left_state;
-   auto &right_state = scratch_data.right_state;
-   fe_face_values.get_function_values(solution, left_state);
+   auto &u = scratch_data.dof_values;
+   for(unsigned int i=0; i<n_face_dofs; ++i)
+      gather_active(copy_data.local_dof_indices[i], &u[i * na]);
+   evaluate_face_values(fe_face_values, &u[0], na, scratch_data.left_values);
+   gather_averages(cell->user_index(), scratch_data.left_average.data());
    auto &cell_rhs = copy_data.cell_rhs;
 
+   // Pressure force on the body; normal points out of fluid into the body
+   const bool on_body = compute_forces &&
+                        force_ids.count(cell->face(f)->boundary_id()) > 0;
+
+   auto &left_state = scratch_data.left_state;
+   auto &right_state = scratch_data.right_state;
+   auto &face_flux = scratch_data.face_flux;
    for (unsigned int q = 0; q < n_q_points; ++q)
    {
-      problem->boundary_value(cell->face(f)->boundary_id(),
-                              q_points[q],
-                              stage_time,
-                              fe_face_values.normal_vector(q),
-                              left_state[q],
-                              right_state[q]);
-      FluxData<dim> data;
-      data.p = q_points[q];
-      data.t = stage_time;
-      data.ul = &average[cell->user_index()];
-      data.ur = &average[cell->user_index()];
-      Vector<double> num_flux(nvar);
-      PDE::boundary_flux(left_state[q], //todo
-                         right_state[q],
+      const double* ul = &scratch_data.left_values[q * nvar * na];
+      double* ur = &scratch_data.right_values[q * nvar * na];
+      for(unsigned int j = 0; j < na; ++j)
+      {
+         const auto& member = members[active[j]];
+         for(unsigned int c=0; c<nvar; ++c)
+            left_state[c] = ul[c * na + j];
+         if(on_body)
+         {
+            const Tensor<1,dim> df = (PDE::pressure<dim>(left_state) *
+                                      fe_face_values.JxW(q)) *
+                                     fe_face_values.normal_vector(q);
+            const Tensor<1,dim> r = q_points[q] - member.force_ref.center;
+            copy_data.force[j][0] += df[0];
+            copy_data.force[j][1] += df[1];
+            copy_data.force[j][2] += r[0] * df[1] - r[1] * df[0];
+         }
+         member.problem->boundary_value(cell->face(f)->boundary_id(),
+                                        q_points[q],
+                                        member.stage_time,
+                                        fe_face_values.normal_vector(q),
+                                        left_state,
+                                        right_state);
+         for(unsigned int c=0; c<nvar; ++c)
+            ur[c * na + j] = right_state[c];
+      }
+
+      double* fq = &face_flux[q * nvar * na];
+      PDE::boundary_flux(na,
+                         ul,
+                         ur,
+                         scratch_data.left_average.data(),
+                         scratch_data.left_average.data(),
                          fe_face_values.normal_vector(q),
-                         data,
-                         num_flux);
-      for (unsigned int i = 0; i < n_face_dofs; ++i)
+                         q_points[q],
+                         fq,
+                         scratch_data.flux_work.data());
+      const double JxW = fe_face_values.JxW(q);
+      for(unsigned int k=0; k<nvar * na; ++k)
+         fq[k] *= JxW;
+   }
+
+   for (unsigned int i = 0; i < n_face_dofs; ++i)
+   {
+      const auto c = fe.system_to_component_index(i).first;
+      double* r = &cell_rhs[i * na];
+      for (unsigned int q = 0; q < n_q_points; ++q)
       {
-         const auto c = fe_face_values.get_fe().system_to_component_index(i).first;
-         cell_rhs(i) -= num_flux[c] *
-                        fe_face_values.shape_value_component(i, q, c) *
-                        fe_face_values.JxW(q);
+         const double phi = fe_face_values.shape_value_component(i, q, c);
+         const double* fq = &face_flux[(q * nvar + c) * na];
+         for(unsigned int m=0; m<na; ++m)
+            r[m] -= phi * fq[m];
       }
    }
 }
 
 //------------------------------------------------------------------------------
-// Assemble system rhs
+// Assemble system rhs of all active members
 //------------------------------------------------------------------------------
 template <int dim>
 void
 DGSystem<dim>::assemble_rhs()
 {
+   TimerOutput::Scope scope(computing_timer, "Assemble rhs");
+   ++n_rhs;
+
    using Iterator = typename DoFHandler<dim>::active_cell_iterator;
 
    auto cell_worker =
@@ -693,46 +1173,101 @@ DGSystem<dim>::assemble_rhs()
       this->boundary_worker(cell, f, scratch_data, copy_data);
    };
 
-   auto copier = [&](const CopyData &cd)
+   // Local rhs are stored as [i][active member] and added to the adjacent
+   // values of the members; there are no constraints in DG.
+   const unsigned int nm = members.size();
+   const unsigned int na = active.size();
+   auto add_local = [&](const Vector<double>& cell_rhs,
+                        const std::vector<types::global_dof_index>& dof_indices)
    {
-      this->constraints.distribute_local_to_global(cd.cell_rhs,
-                                                   cd.local_dof_indices,
-                                                   this->rhs);
-      for (auto &cdf : cd.face_data)
+      const auto& partitioner = *rhs.get_partitioner();
+      for(unsigned int i = 0; i < dof_indices.size(); ++i)
       {
-         this->constraints.distribute_local_to_global(cdf.cell_rhs,
-                                                      cdf.joint_dof_indices,
-                                                      this->rhs);
+         double* r = rhs.begin() +
+                     partitioner.global_to_local(dof_indices[i] * nm);
+         for(unsigned int j = 0; j < na; ++j)
+            r[active[j]] += cell_rhs(i * na + j);
       }
    };
 
+   auto copier = [&](const CopyData &cd)
+   {
+      add_local(cd.cell_rhs, cd.local_dof_indices);
+      for (auto &cdf : cd.face_data)
+         add_local(cdf.cell_rhs, cdf.joint_dof_indices);
+      if(compute_forces)
+         for(unsigned int j = 0; j < na; ++j)
+            members[active[j]].force += cd.force[j];
+   };
+
    ScratchData<dim> scratch_data(mapping(),
                                  fe,
                                  cell_quadrature,
-                                 face_quadrature);
+                                 face_quadrature,
+                                 members.size());
 
    const auto iterator_range =
         filter_iterators(dof_handler.active_cell_iterators(),
                          IteratorFilters::LocallyOwnedCell());
 
+   const auto face_flags = MeshWorker::assemble_boundary_faces |
+                           MeshWorker::assemble_own_interior_faces_once |
+                           MeshWorker::assemble_ghost_faces_once;
+
    rhs = 0.0;
-   MeshWorker::mesh_loop(iterator_range,
-                         cell_worker,
-                         copier,
-                         scratch_data,
-                         CopyData(),
-                         MeshWorker::assemble_own_cells |
-                         MeshWorker::assemble_boundary_faces |
-                         MeshWorker::assemble_own_interior_faces_once |
-                         MeshWorker::assemble_ghost_faces_once,
-                         boundary_worker,
-                         face_worker);
-
-   // Reduce over all MPI ranks
+   if(!perf.is_enabled())
+      MeshWorker::mesh_loop(iterator_range,
+                            cell_worker,
+                            copier,
+                            scratch_data,
+                            CopyData(),
+                            MeshWorker::assemble_own_cells | face_flags,
+                            boundary_worker,
+                            face_worker);
+   else
+   {
+      // Separate loops over cells and faces so that counters see them apart;
+      // the cell worker of the face loop only sizes copy_data for the copier.
+      auto size_worker =
+          [&](const Iterator &cell,
+              ScratchData<dim> &,
+              CopyData &copy_data)
+      {
+         copy_data.reinit(cell, fe.n_dofs_per_cell(), na);
+      };
+      {
+         PerfCounters::Monitor::Scope perf_scope(perf, "Cell integral");
+         MeshWorker::mesh_loop(iterator_range,
+                               cell_worker,
+                               copier,
+                               scratch_data,
+                               CopyData(),
+                               MeshWorker::assemble_own_cells);
+      }
+      {
+         PerfCounters::Monitor::Scope perf_scope(perf, "Face integral");
+         MeshWorker::mesh_loop(iterator_range,
+                               size_worker,
+                               copier,
+                               scratch_data,
+                               CopyData(),
+                               MeshWorker::assemble_own_cells | face_flags,
+                               boundary_worker,
+                               face_worker);
+      }
+   }
+
+   // Reduce over all MPI ranks, for all members at once
    rhs.compress(VectorOperation::add);
 
    // Multiply by inverse mass matrix
-   rhs.scale(imm);
+   for(unsigned int i = 0; i < imm.locally_owned_size(); ++i)
+   {
+      const double w = imm.local_element(i);
+      double* r = rhs.begin() + i * nm;
+      for(unsigned int m = 0; m < nm; ++m)
+         r[m] *= w;
+   }
 }
 
 //------------------------------------------------------------------------------
@@ -742,10 +1277,18 @@ template <int dim>
 void
 DGSystem<dim>::compute_averages()
 {
+   TimerOutput::Scope scope(computing_timer, "Compute averages");
+   PerfCounters::Monitor::Scope perf_scope(perf, "Averages");
+
    FEValues<dim> fe_values(mapping(), fe, cell_quadrature,
                            update_JxW_values);
    std::vector<types::global_dof_index> dof_indices(fe.dofs_per_cell);
    const unsigned int n_q_points = cell_quadrature.size();
+   const unsigned int nm = members.size();
+
+   if(compute_diagnostics)
+      for(const auto m : active)
+         members[m].diagnostics = Diagnostics::initial();
 
    for(auto & cell : dof_handler.active_cell_iterators())
    if(cell->is_locally_owned() || cell->is_ghost())
@@ -753,20 +1296,59 @@ DGSystem<dim>::compute_averages()
       fe_values.reinit(cell);
       cell->get_dof_indices(dof_indices);
       const auto c = cell->user_index();
-      average[c] = 0.0;
       double cell_measure = 0.0;
-
       for(unsigned int q = 0; q < n_q_points; ++q)
-      {
          cell_measure += fe_values.JxW(q);
-         for(unsigned int i = 0; i < nvar; ++i)
-         {
-            auto idx = fe.component_to_system_index(i,q);
-            average[c][i] += solution(dof_indices[idx]) * fe_values.JxW(q);
-         }
+
+      for(const auto m : active)
+      {
+         auto& average = members[m].average;
+         average[c] = 0.0;
+
+         for(unsigned int q = 0; q < n_q_points; ++q)
+            for(unsigned int i = 0; i < nvar; ++i)
+            {
+               auto idx = fe.component_to_system_index(i,q);
+               average[c][i] += solution(dof_indices[idx] * nm + m) *
+                                fe_values.JxW(q);
+            }
+
+         average[c] /= cell_measure;
+
+         if(compute_diagnostics && cell->is_locally_owned())
+            Diagnostics::add<dim>(average[c], cell_measure,
+                                  members[m].diagnostics);
       }
+   }
+
+   if(compute_diagnostics)
+      reduce_diagnostics();
+}
 
-      average[c] /= cell_measure;
+//------------------------------------------------------------------------------
+// One allreduce for diagnostics of all active members
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGSystem<dim>::reduce_diagnostics()
+{
+   std::vector<double> buffer;
+   for(const auto m : active)
+      buffer.insert(buffer.end(), members[m].diagnostics.begin(),
+                    members[m].diagnostics.end());
+
+   if(!diagnostics_reduction)
+      diagnostics_reduction = std::make_unique<Diagnostics::Reduction>();
+   const int ierr = MPI_Allreduce(MPI_IN_PLACE, buffer.data(), active.size(),
+                                  diagnostics_reduction->type,
+                                  diagnostics_reduction->op, mpi_comm);
+   AssertThrowMPI(ierr);
+
+   auto it = buffer.begin();
+   for(const auto m : active)
+   {
+      std::copy(it, it + Diagnostics::size, members[m].diagnostics.begin());
+      it += Diagnostics::size;
    }
 }
 
@@ -789,40 +1371,84 @@ template <int dim>
 void
 DGSystem<dim>::apply_limiter()
 {
+   TimerOutput::Scope scope(computing_timer, "Limiter");
+   PerfCounters::Monitor::Scope perf_scope(perf, "Limiter");
+
    if(param->degree == 0 || param->limiter_type == LimiterType::none) return;
    apply_TVD_limiter();
 }
 
 //------------------------------------------------------------------------------
-// Compute time step from cfl condition
+// Compute time step from cfl condition. With joint time step, all members use
+// the smallest time step and stay at the same time.
 //------------------------------------------------------------------------------
 template <int dim>
 void
 DGSystem<dim>::compute_dt()
 {
-   dt = 1.0e20;
+   TimerOutput::Scope scope(computing_timer, "Compute dt");
+
+   std::vector<double> dts(active.size(), 1.0e20);
 
    for(auto &cell : dof_handler.active_cell_iterators())
    if(cell->is_locally_owned())
    {
-      auto c = cell->user_index();
-      Tensor<1,dim> jac;
-      PDE::max_speed(average[c], cell->center(), jac);
-      double dtcell = cell->minimum_vertex_distance() / (jac.norm() + 1.0e-20);
-      dt = std::min(dt, dtcell);
+      const auto c = cell->user_index();
+      const double h = cell->minimum_vertex_distance();
+      for(unsigned int j = 0; j < active.size(); ++j)
+      {
+         Tensor<1,dim> jac;
+         PDE::max_speed(members[active[j]].average[c], cell->center(), jac);
+         double dtcell = h / (jac.norm() + 1.0e-20);
+         dts[j] = std::min(dts[j], dtcell);
+      }
    }
 
-   dt *= param->cfl;
-   dt = Utilities::MPI::min(dt, mpi_comm);
+   std::vector<double> dts_local(dts);
+   Utilities::MPI::min(dts_local, mpi_comm, dts);
+   if(param->ensemble_dt == "joint")
+      std::fill(dts.begin(), dts.end(),
+                *std::min_element(dts.begin(), dts.end()));
 
-   if (time + dt > param->final_time)
+   for(unsigned int j = 0; j < active.size(); ++j)
    {
-      dt = param->final_time - time;
+      auto& member = members[active[j]];
+      member.dt = param->cfl * dts[j];
+
+      if (member.time + member.dt > end_time)
+      {
+         member.dt = end_time - member.time;
+      }
+      else if (param->output_interval > 0 && save_output)
+      {
+         if (member.time + member.dt > member.next_output_time)
+            member.dt = member.next_output_time - member.time;
+      }
    }
-   else if (param->output_interval > 0)
+}
+
+//------------------------------------------------------------------------------
+// Local time step of each cell from cfl condition, for pseudo time stepping to
+// steady state; uses the first member.
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGSystem<dim>::compute_local_dt()
+{
+   TimerOutput::Scope scope(computing_timer, "Compute dt");
+
+   std::vector<types::global_dof_index> dof_indices(fe.dofs_per_cell);
+   for(auto &cell : dof_handler.active_cell_iterators())
+   if(cell->is_locally_owned())
    {
-      if (time + dt > next_output_time)
-         dt = next_output_time - time;
+      const double h = cell->minimum_vertex_distance();
+      Tensor<1,dim> jac;
+      PDE::max_speed(members[0].average[cell->user_index()], cell->center(),
+                     jac);
+      const double dtcell = param->cfl * h / (jac.norm() + 1.0e-20);
+      cell->get_dof_indices(dof_indices);
+      for(const auto i : dof_indices)
+         local_dt[i] = dtcell;
    }
 }
 
@@ -833,38 +1459,58 @@ template <int dim>
 void
 DGSystem<dim>::update(const unsigned int rk_stage)
 {
-   // solution = solution + dt * rhs
-   solution.add(dt, rhs);
-
-   // solution = b_rk * solution + a_rk * solution_old
-   solution.sadd(b_rk[rk_stage], a_rk[rk_stage], solution_old);
+   TimerOutput::Scope scope(computing_timer, "Update");
+   PerfCounters::Monitor::Scope perf_scope(perf, "Update");
+
+   // solution = a_rk * solution_old + b_rk * (solution + dt * rhs), with the
+   // time step of each member
+   const unsigned int nm = members.size();
+   const double a = a_rk[rk_stage], b = b_rk[rk_stage];
+   std::vector<double> dt(nm, 0.0);
+   for(const auto m : active)
+      dt[m] = members[m].dt;
+   const unsigned int n_dofs = solution.locally_owned_size() / nm;
+   for(unsigned int i = 0; i < n_dofs; ++i)
+      for(const auto m : active)
+      {
+         const unsigned int k = i * nm + m;
+         solution.local_element(k) = a * solution_old.local_element(k) +
+                                     b * (solution.local_element(k) +
+                                          dt[m] * rhs.local_element(k));
+      }
 
-   stage_time = a_rk[rk_stage] * time + b_rk[rk_stage] * (stage_time + dt);
+   for(const auto m : active)
+   {
+      auto& member = members[m];
+      member.stage_time = a_rk[rk_stage] * member.time
+                          + b_rk[rk_stage] * (member.stage_time + member.dt);
+   }
 }
 
 //-----------------------------------------------------------------------------
 // Decide if solution needs to be saved
 //-----------------------------------------------------------------------------
 template <int dim>
-bool DGSystem<dim>::call_output()
+bool DGSystem<dim>::call_output(Member& member)
 {
    // Save initial condition
-   if (time_step == 0)
+   if (member.time_step == 0)
       return true;
 
    // Save final solution
-   if (fabs(time - param->final_time) < 1.0e-13)
+   if (fabs(member.time - param->final_time) < 1.0e-13)
       return true;
 
    if (param->output_step > 0)
-      if (time_step % param->output_step == 0)
+      if (member.time_step % param->output_step == 0)
          return true;
 
    if (param->output_interval > 0)
-      if (fabs(time - next_output_time) < 1.0e-13)
+      if (fabs(member.time - member.next_output_time) < 1.0e-13)
       {
-         next_output_time += param->output_interval;
-         next_output_time = std::min(next_output_time, param->final_time);
+         member.next_output_time += param->output_interval;
+         member.next_output_time = std::min(member.next_output_time,
+                                            param->final_time);
          return true;
       }
 
@@ -872,25 +1518,25 @@ bool DGSystem<dim>::call_output()
 }
 
 //------------------------------------------------------------------------------
-// Save solution to file
+// Save solution to file. All members use the same mesh file.
 //------------------------------------------------------------------------------
 template <int dim>
 void
-DGSystem<dim>::output_results(const double time) const
+DGSystem<dim>::output_results(Member& member) const
 {
-   static unsigned int counter = 0;
-   static std::vector<XDMFEntry> xdmf_entries;
    std::string mesh_filename = "mesh.h5";
-   std::string solution_filename = ("vars-" +
-                                   Utilities::int_to_string(counter, 4) +
+   std::string solution_filename = (member.prefix + "vars-" +
+                                   Utilities::int_to_string(member.output_counter, 4) +
                                    ".h5");
-   bool write_mesh_file = (counter == 0) ? true : false;
+   bool write_mesh_file = (member.output_counter == 0 && &member == &members[0]);
 
    DataOut<dim> data_out;
    PDE::Postprocessor<dim> postprocessor;
-   data_out.add_data_vector(dof_handler, solution, postprocessor);
+   data_out.add_data_vector(dof_handler, member_solution(member.index),
+                            postprocessor);
    data_out.build_patches(mapping(), param->degree,
                           DataOut<dim>::curved_inner_cells);
+   output_memory = std::max(output_memory, data_out.memory_consumption());
 
    DataOutBase::DataOutFilter data_filter(DataOutBase::DataOutFilterFlags(true, true));
   // Filter the data and store it in data_filter
@@ -905,59 +1551,648 @@ DGSystem<dim>::output_results(const double time) const
   XDMFEntry new_xdmf_entry = data_out.create_xdmf_entry(data_filter,
                                                         mesh_filename,
                                                         solution_filename,
-                                                        time,
+                                                        member.time,
                                                         mpi_comm);
   // Add the XDMF entry to the list
-  xdmf_entries.push_back(new_xdmf_entry);
+  member.xdmf_entries.push_back(new_xdmf_entry);
   // Create an XDMF file from all stored entries
-  data_out.write_xdmf_file(xdmf_entries, "solution.xdmf", mpi_comm);
+  data_out.write_xdmf_file(member.xdmf_entries,
+                           member.prefix + "solution.xdmf",
+                           mpi_comm);
 
-  pcout << "Wrote " << solution_filename << " at t = " << time << "\n";
-   ++counter;
+  pcout << "Wrote " << solution_filename << " at t = " << member.time << "\n";
+   write_cp(member);
+   ++member.output_counter;
 }
 
 //------------------------------------------------------------------------------
-// Start solving the problem
+// Make grid, mass matrix and set initial condition
 //------------------------------------------------------------------------------
 template <int dim>
 void
-DGSystem<dim>::run()
+DGSystem<dim>::setup()
 {
-   pcout << "Solving " << PDE::name << " for " << problem->get_name() << "\n";
-   pcout << "Number of threads = " << MultithreadInfo::n_threads() << "\n";
-
-   if (Utilities::MPI::this_mpi_process(mpi_comm) == 0)
-      PDE::print_info();
+   // After the problem constructors, which may set another eos
+   if(!param->eos_table.empty())
+      PDE::use_eos_table(param->eos_table, mpi_comm);
    make_grid_and_dofs();
    assemble_mass_matrix();
    initialize();
    solution.update_ghost_values();
+   active.resize(members.size());
+   std::iota(active.begin(), active.end(), 0);
    compute_averages();
-   output_results(0.0);
+}
+
+//------------------------------------------------------------------------------
+// Set solution of all members at time t
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGSystem<dim>::set_solution(const PVector& u, const double t)
+{
+   const unsigned int nm = members.size();
+   for(unsigned int i = 0; i < u.locally_owned_size(); ++i)
+      for(unsigned int m = 0; m < nm; ++m)
+         solution.local_element(i * nm + m) = u.local_element(i);
+   solution.update_ghost_values();
+   for(auto& member : members)
+      member.time = t;
+   active.resize(members.size());
+   std::iota(active.begin(), active.end(), 0);
+   compute_averages();
+}
+
+//------------------------------------------------------------------------------
+// Steps of SSP-RK3 with local time step for du/dt = rhs(u) + forcing; needs
+// one member, whose vectors have the layout of forcing.
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGSystem<dim>::smooth(const PVector& forcing, const unsigned int n_steps)
+{
+   AssertThrow(members.size() == 1,
+               ExcMessage("p-multigrid needs ensemble size = 1"));
+   auto& member = members[0];
+   active = {0};
+   for(unsigned int n = 0; n < n_steps; ++n)
+   {
+      solution_old.copy_locally_owned_data_from(solution);
+      member.stage_time = member.time;
+      compute_local_dt();
+
+      for(unsigned int rk = 0; rk < n_rk_stages; ++rk)
+      {
+         assemble_rhs();
+         {
+            TimerOutput::Scope scope(computing_timer, "Update");
+            auto& u = solution;
+            const auto& u_old = solution_old;
+            for(unsigned int i = 0; i < u.locally_owned_size(); ++i)
+            {
+               const double r = rhs.local_element(i)
+                                + forcing.local_element(i);
+               u.local_element(i) = a_rk[rk] * u_old.local_element(i)
+                                    + b_rk[rk] * (u.local_element(i)
+                                    + local_dt.local_element(i) * r);
+            }
+         }
+         {
+            TimerOutput::Scope scope(computing_timer, "Ghost exchange");
+            solution.update_ghost_values();
+         }
+         compute_averages();
+         apply_limiter();
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+// r = rhs(u) of the first member at its current solution. With step > 0, the
+// forces and probes of this solution are also recorded, with step in place
+// of the time step; the p-multigrid driver does this after each cycle.
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGSystem<dim>::compute_residual(PVector& r, const unsigned int step)
+{
+   AssertThrow(members.size() == 1,
+               ExcMessage("p-multigrid needs ensemble size = 1"));
+   auto& member = members[0];
+   active = {0};
+   member.stage_time = member.time;
+   compute_forces = (step > 0 && !force_ids.empty());
+   if(compute_forces) member.force = 0;
+   assemble_rhs();
+   r.copy_locally_owned_data_from(rhs);
+   if(step == 0) return;
+
+   member.time_step = step;
+   if(compute_forces)
+   {
+      TimerOutput::Scope scope(computing_timer, "Forces");
+      record_forces(member);
+      compute_forces = false;
+   }
+   if(probes.size() > 0 && step % param->probe_step == 0)
+   {
+      TimerOutput::Scope scope(computing_timer, "Probes");
+      probes.sample(solution, member.time, member.time_step,
+                    member.probe_file, param->probe_binary);
+   }
+}
+
+//------------------------------------------------------------------------------
+// Open the files of forces and probes, after setup
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGSystem<dim>::setup_outputs()
+{
+   setup_probes();
+   setup_forces();
+}
 
-   while(time < param->final_time)
+//------------------------------------------------------------------------------
+// Last force coefficients of each member
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGSystem<dim>::print_forces() const
+{
+   if(force_ids.empty()) return;
+   for(const auto& member : members)
    {
-      solution_old  = solution;
-      stage_time = time;
+      pcout << "Force coefficients: ";
+      if(members.size() > 1) pcout << member.prefix << " ";
+      pcout << "cl = " << member.cl << " cd = " << member.cd
+            << " cm = " << member.cm << std::endl;
+   }
+}
+
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGSystem<dim>::write_solution()
+{
+   for(auto& member : members)
+      output_results(member);
+}
+
+//------------------------------------------------------------------------------
+// Advance all members from their current time to end_time
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGSystem<dim>::solve(const double end_time, const bool save_output)
+{
+   this->end_time = end_time;
+   this->save_output = save_output;
+   active.clear();
+   for(unsigned int m = 0; m < members.size(); ++m)
+      if(members[m].time < end_time)
+         active.push_back(m);
+
+   while(active.size() > 0)
+   {
+      solution_old.copy_locally_owned_data_from(solution);
+      for(const auto m : active)
+         members[m].stage_time = members[m].time;
       compute_dt();
 
       for(unsigned int rk = 0; rk < n_rk_stages; ++rk)
       {
+         // Forces are computed from the solution at start of time step
+         compute_forces = (rk == 0 && save_output && !force_ids.empty());
+         if(compute_forces)
+            for(const auto m : active)
+               members[m].force = 0;
          assemble_rhs();
+         if(compute_forces)
+         {
+            TimerOutput::Scope scope(computing_timer, "Forces");
+            for(const auto m : active)
+               record_forces(members[m]);
+            compute_forces = false;
+         }
          update(rk);
-         solution.update_ghost_values();
+         {
+            // One exchange for all members
+            TimerOutput::Scope scope(computing_timer, "Ghost exchange");
+            solution.update_ghost_values();
+         }
+         // Diagnostics of the solution at end of time step
+         compute_diagnostics = (rk == n_rk_stages - 1 && save_output &&
+                                param->diagnostics);
          compute_averages();
+         compute_diagnostics = false;
          apply_limiter();
       }
 
-      time += dt, ++time_step;
-      pcout << "Iter = " << time_step
-                << " dt = " << dt
-                << " time = " << time << std::endl;
-      if(call_output()) output_results(time);
+      for(const auto m : active)
+      {
+         auto& member = members[m];
+         member.time += member.dt, ++member.time_step;
+         pcout << "Iter = " << member.time_step;
+         if(members.size() > 1) pcout << " member = " << m;
+         pcout << " dt = " << member.dt
+               << " time = " << member.time << std::endl;
+         if(save_output && param->diagnostics)
+            record_diagnostics(member);
+         if(save_output && probes.size() > 0 &&
+            member.time_step % param->probe_step == 0)
+         {
+            TimerOutput::Scope scope(computing_timer, "Probes");
+            probes.sample(member_solution(m), member.time, member.time_step,
+                          member.probe_file, param->probe_binary);
+         }
+         if(save_output && (member.converged || call_output(member)))
+         {
+            TimerOutput::Scope scope(computing_timer, "Output");
+            output_results(member);
+         }
+      }
+
+      // Remove members which have reached end time
+      active.erase(std::remove_if(active.begin(), active.end(),
+                                  [&](const unsigned int m)
+                                  {
+                                     return members[m].converged ||
+                                            members[m].time >= end_time;
+                                  }),
+                   active.end());
    }
 }
 
+//------------------------------------------------------------------------------
+// Locate probe points, open one time series file per member and save the
+// initial values
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGSystem<dim>::setup_probes()
+{
+   if(param->probe_points.empty())
+   {
+      probes = Probes<dim>(); // remove probes of previous batch case
+      return;
+   }
+
+   std::vector<Point<dim>> points(param->probe_points.size());
+   for(unsigned int i = 0; i < points.size(); ++i)
+      for(unsigned int d = 0; d < dim; ++d)
+         points[i][d] = param->probe_points[i][d];
+   probes.reinit(mapping(), dof_handler, points, mpi_comm);
+   pcout << "Number of probe points = " << probes.size() << "\n";
+   if(probes.size() == 0) return;
+
+   const bool binary = param->probe_binary;
+   for(auto& member : members)
+   {
+      if(Utilities::MPI::this_mpi_process(mpi_comm) == 0)
+      {
+         const std::string name = member.prefix + "probes";
+         if(binary)
+         {
+            std::ofstream header(name + ".txt");
+            probes.write_header(header, binary);
+            member.probe_file.open(name + ".bin", std::ios::binary);
+         }
+         else
+         {
+            member.probe_file.open(name + ".csv");
+            member.probe_file.precision(12);
+            probes.write_header(member.probe_file, binary);
+         }
+      }
+      probes.sample(member_solution(member.index), member.time,
+                    member.time_step, member.probe_file, binary);
+   }
+}
+
+//------------------------------------------------------------------------------
+// Open one file per member for force coefficients of every time step
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGSystem<dim>::setup_forces()
+{
+   if(force_ids.empty()) return;
+   if(Utilities::MPI::this_mpi_process(mpi_comm) != 0) return;
+
+   for(auto& member : members)
+   {
+      member.force_file.open(member.prefix + "forces.csv");
+      member.force_file.precision(12);
+      member.force_file << "time,step,cl,cd,cm" << std::endl;
+   }
+}
+
+//------------------------------------------------------------------------------
+// Reduce force assembled in boundary_worker over ranks, save coefficients
+// and check if cl and cd have settled over the last force_window steps.
+// Moment is about force_ref.center, positive nose up.
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGSystem<dim>::record_forces(Member& member)
+{
+   member.force = Utilities::MPI::sum(member.force, mpi_comm);
+
+   const auto& ref = member.force_ref;
+   const double qref = 0.5 * ref.rho * ref.vel * ref.vel * ref.length;
+   const double fx = member.force[0], fy = member.force[1];
+   member.cl = (fy * cos(ref.alpha) - fx * sin(ref.alpha)) / qref;
+   member.cd = (fx * cos(ref.alpha) + fy * sin(ref.alpha)) / qref;
+   member.cm = -member.force[2] / (qref * ref.length);
+   if(member.force_file.is_open())
+      member.force_file << member.time << "," << member.time_step << ","
+                        << member.cl << "," << member.cd << ","
+                        << member.cm << "\n";
+
+   if(param->force_tol <= 0.0) return;
+
+   auto& history = member.force_history;
+   history.push_back({member.cl, member.cd});
+   if(history.size() > param->force_window) history.pop_front();
+   if(history.size() < param->force_window) return;
+
+   double change = 0.0;
+   for(unsigned int k = 0; k < 2; ++k)
+   {
+      const auto [lo, hi] =
+         std::minmax_element(history.begin(), history.end(),
+                             [k](const auto& a, const auto& b)
+                             {
+                                return a[k] < b[k];
+                             });
+      change = std::max(change, (*hi)[k] - (*lo)[k]);
+   }
+   if(change < param->force_tol)
+   {
+      member.converged = true;
+      pcout << "Forces converged at iter = " << member.time_step;
+      if(members.size() > 1) pcout << " member = " << member.prefix;
+      pcout << " change = " << change << std::endl;
+   }
+}
+
+//------------------------------------------------------------------------------
+// Pressure coefficient at face quadrature points of force boundaries, saved by
+// rank 0 with same number as solution file
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGSystem<dim>::write_cp(const Member& member) const
+{
+   if(force_ids.empty()) return;
+
+   FEFaceValues<dim> fe_face_values(mapping(), fe, face_quadrature,
+                                    update_values | update_quadrature_points);
+   std::vector<Vector<double>> values(face_quadrature.size(),
+                                      Vector<double>(nvar));
+   const auto& ref = member.force_ref;
+   const double qref = 0.5 * ref.rho * ref.vel * ref.vel;
+
+   std::vector<double> data; // x, y, cp
+   for(const auto& cell : dof_handler.active_cell_iterators())
+      if(cell->is_locally_owned())
+         for(const unsigned int f : cell->face_indices())
+            if(cell->at_boundary(f) &&
+               force_ids.count(cell->face(f)->boundary_id()) > 0)
+            {
+               fe_face_values.reinit(cell, f);
+               fe_face_values.get_function_values(member_solution(member.index),
+                                                  values);
+               for(unsigned int q = 0; q < face_quadrature.size(); ++q)
+               {
+                  const auto& p = fe_face_values.quadrature_point(q);
+                  data.push_back(p[0]);
+                  data.push_back(p[1]);
+                  data.push_back((PDE::pressure<dim>(values[q]) - ref.pre)
+                                 / qref);
+               }
+            }
+
+   const auto all_data = Utilities::MPI::gather(mpi_comm, data, 0);
+   if(Utilities::MPI::this_mpi_process(mpi_comm) != 0) return;
+
+   const std::string filename = member.prefix + "cp-" +
+                                Utilities::int_to_string(member.output_counter, 4) +
+                                ".csv";
+   std::ofstream out(filename);
+   out.precision(12);
+   out << "# t = " << member.time << "\n";
+   out << "x,y,cp\n";
+   for(const auto& rank_data : all_data)
+      for(unsigned int i = 0; i < rank_data.size(); i += 3)
+         out << rank_data[i] << "," << rank_data[i + 1] << ","
+             << rank_data[i + 2] << "\n";
+}
+
+//------------------------------------------------------------------------------
+// Open one diagnostics file per member and save the initial values, which are
+// the reference for the drift
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGSystem<dim>::setup_diagnostics()
+{
+   if(!param->diagnostics) return;
+
+   compute_diagnostics = true;
+   compute_averages();
+   compute_diagnostics = false;
+
+   for(auto& member : members)
+   {
+      member.diagnostics0 = member.diagnostics;
+      if(Utilities::MPI::this_mpi_process(mpi_comm) == 0)
+      {
+         auto& out = member.diagnostics_file;
+         out.open(member.prefix + "diagnostics.csv");
+         out.precision(14);
+         out << "time,step";
+         for(unsigned int i = 0; i < nvar; ++i)
+            out << ",integral_u" << i;
+         out << ",entropy,bad_cells,min_rho,max_rho,min_pre,max_pre"
+             << std::endl;
+      }
+      record_diagnostics(member);
+   }
+}
+
+//------------------------------------------------------------------------------
+// Save diagnostics and stop if a cell average is not admissible or if the
+// integral of a variable in PDE::conserved_vars, e.g., mass and energy,
+// drifts by more than drift_tol relative to initial value. Must be called on
+// all ranks.
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGSystem<dim>::record_diagnostics(Member& member)
+{
+   const auto& d = member.diagnostics;
+   const auto& d0 = member.diagnostics0;
+   using Diagnostics::n_sum;
+
+   auto& out = member.diagnostics_file;
+   if(out.is_open())
+   {
+      out << member.time << "," << member.time_step;
+      for(unsigned int i = 0; i <= nvar; ++i)
+         out << "," << d[i];
+      out << "," << d[nvar + 1]
+          << "," << -d[n_sum] << "," << d[n_sum + 1]
+          << "," << -d[n_sum + 2] << "," << d[n_sum + 3] << "\n";
+   }
+
+   bool finite = true;
+   for(const auto v : d)
+      finite = finite && std::isfinite(v);
+   double drift = 0.0;
+   if(param->drift_tol > 0.0)
+      for(const unsigned int i : PDE::conserved_vars)
+         if(d0[i] != 0.0)
+            drift = std::max(drift, std::fabs(d[i] - d0[i]) / std::fabs(d0[i]));
+
+   const bool failed = !finite || d[nvar + 1] > 0.0 ||
+                       drift > param->drift_tol;
+   if(failed && out.is_open()) out.flush();
+   AssertThrow(finite && d[nvar + 1] == 0.0,
+               ExcMessage("Inadmissible cell averages at iter = " +
+                          std::to_string(member.time_step)));
+   AssertThrow(param->drift_tol == 0.0 || drift <= param->drift_tol,
+               ExcMessage("Drift of conserved variables = " +
+                          std::to_string(drift) + " at iter = " +
+                          std::to_string(member.time_step)));
+}
+
+//------------------------------------------------------------------------------
+// Print memory used by the main data structures on each rank
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGSystem<dim>::print_memory(const std::string& when)
+{
+   const std::size_t vectors = solution.memory_consumption() +
+                               solution_old.memory_consumption() +
+                               rhs.memory_consumption() +
+                               member_work.memory_consumption();
+   std::size_t average = 0;
+   for(const auto& member : members)
+      average += MemoryConsumption::memory_consumption(member.average);
+
+   memory.clear();
+   memory.add("triangulation", triangulation.memory_consumption());
+   memory.add("dof_handler", dof_handler.memory_consumption());
+   memory.add("solution, solution_old, rhs", vectors);
+   memory.add("imm", imm.memory_consumption());
+   memory.add("average", average);
+
+   {
+      const ScratchData<dim> scratch_data(mapping(), fe, cell_quadrature,
+                                          face_quadrature, members.size());
+      memory.add("scratch data",
+                 MemoryReport::scratch_memory(scratch_data.fe_values,
+                                              face_quadrature,
+                                              scratch_data.memory_consumption()));
+   }
+   memory.add("output buffers", output_memory);
+   memory.print(pcout, when, dof_handler.n_dofs());
+}
+
+//------------------------------------------------------------------------------
+// Start solving the problem
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGSystem<dim>::run()
+{
+   pcout << "Solving " << PDE::name << " for " << problem->get_name() << "\n";
+   pcout << "Number of threads = " << MultithreadInfo::n_threads() << "\n";
+   pcout << "Number of ensemble members = " << members.size() << "\n";
+
+   memory.reinit(mpi_comm);
+   setup();
+   if (Utilities::MPI::this_mpi_process(mpi_comm) == 0)
+      PDE::print_info();
+   setup_probes();
+   setup_forces();
+   setup_diagnostics();
+   perf.reinit(param->perf_counters, param->perf_fp_events, mpi_comm);
+   write_solution();
+   print_memory("after setup");
+   solve(param->final_time, true);
+   print_forces();
+
+   computing_timer.print_summary();
+   perf.print(pcout);
+   print_memory("at end");
+}
+
+//------------------------------------------------------------------------------
+// Run one batch case on the grid, dofs and mass matrix made in setup(). Only
+// parameters which do not change these may differ from those used in setup.
+// Output files of the case start with name. Returns wall time, number of
+// steps and, if enabled, drift, bounds and force coefficients.
+//------------------------------------------------------------------------------
+template <int dim>
+std::map<std::string, double>
+DGSystem<dim>::run_case(Parameter&         case_param,
+                        ProblemBase<dim>&  case_problem,
+                        const std::string& name)
+{
+   AssertThrow(members.size() == 1,
+               ExcMessage("Batch cases need ensemble size = 1"));
+   AssertThrow(case_param.degree == param->degree &&
+               case_param.basis == param->basis &&
+               case_param.mapping == param->mapping &&
+               case_param.mapping_degree == param->mapping_degree &&
+               case_param.grid == param->grid &&
+               case_param.n_refine == param->n_refine &&
+               case_param.cell_order == param->cell_order &&
+               case_param.dof_order == param->dof_order,
+               ExcMessage("Case " + name + " changes grid or dofs"));
+
+   pcout << "---------- Running case " << name << " ----------\n";
+   Timer timer(mpi_comm, true);
+
+   param = &case_param;
+   force_ids = std::set<types::boundary_id>(case_param.force_boundary_ids.begin(),
+                                            case_param.force_boundary_ids.end());
+
+   auto& member = members[0];
+   member.problem = &case_problem;
+   member.prefix = name + "-";
+   member.time = 0.0;
+   member.stage_time = 0.0;
+   member.dt = 0.0;
+   member.time_step = 0;
+   member.next_output_time = case_param.output_interval;
+   member.output_counter = 0;
+   member.xdmf_entries.clear();
+   member.force_ref = case_problem.get_force_reference();
+   member.cl = member.cd = member.cm = 0.0;
+   member.force_history.clear();
+   member.converged = false;
+   for(auto file : {&member.probe_file, &member.force_file,
+                    &member.diagnostics_file})
+      if(file->is_open()) file->close();
+
+   initialize();
+   solution.update_ghost_values();
+   active.assign(1, 0);
+   compute_averages();
+   setup_probes();
+   setup_forces();
+   setup_diagnostics();
+   write_solution();
+   solve(param->final_time, true);
+   timer.stop();
+
+   std::map<std::string, double> result;
+   result["wall time"] = timer.wall_time();
+   result["steps"] = member.time_step;
+   result["final time"] = member.time;
+   if(param->diagnostics)
+   {
+      const auto& d = member.diagnostics;
+      const auto& d0 = member.diagnostics0;
+      const unsigned int i = PDE::conserved_vars[0];
+      if(d0[i] != 0.0)
+         result["mass drift"] = (d[i] - d0[i]) / d0[i];
+      result["min density"] = -d[Diagnostics::n_sum];
+      result["min pressure"] = -d[Diagnostics::n_sum + 2];
+   }
+   if(!force_ids.empty())
+   {
+      result["cl"] = member.cl;
+      result["cd"] = member.cd;
+   }
+   return result;
+}
+
 //------------------------------------------------------------------------------
 // Declare input parameters
 //------------------------------------------------------------------------------
@@ -974,6 +2209,8 @@ declare_parameters(ParameterHandler& prm)
                      "Specify grid: 100,100 or user or foo.msh");
    prm.declare_entry("initial refine", "0", Patterns::Integer(0),
                      "Number of grid refinements");
+   prm.declare_entry("mesh cache", "true", Patterns::Bool(),
+                     "Save gmsh grid in binary file and read it on later runs");
    prm.declare_entry("output step", "0", Patterns::Integer(0),
                      "Iteration frequency to save solution");
    prm.declare_entry("output number", "0", Patterns::Integer(0),
@@ -990,8 +2227,78 @@ declare_parameters(ParameterHandler& prm)
    prm.declare_entry("numflux", "central",
                      Patterns::Anything(),
                      "Numerical flux");
+   prm.declare_entry("eos table", "", Patterns::Anything(),
+                     "Pressure table p(rho,e) replacing the eos of the problem");
    prm.declare_entry("tvb parameter", "0.0", Patterns::Double(0),
                      "TVB parameter");
+   prm.declare_entry("cell order", "natural",
+                     Patterns::Selection("natural|morton|hilbert"),
+                     "Order of coarse cells: natural, morton or hilbert");
+   prm.declare_entry("dof order", "cell",
+                     Patterns::Selection("cell|cuthill_mckee"),
+                     "Numbering of dofs: cell or cuthill_mckee");
+   prm.declare_entry("ensemble size", "1", Patterns::Integer(1),
+                     "Number of solutions computed together on same grid");
+   prm.declare_entry("ensemble parameters", "", Patterns::Anything(),
+                     "Problem parameters of members: mach = 0.5,0.6; alpha = 1,2");
+   prm.declare_entry("ensemble dt", "joint",
+                     Patterns::Selection("joint|member"),
+                     "Time step: joint (minimum over members) or member");
+   prm.declare_entry("time slices", "1", Patterns::Integer(1),
+                     "Number of parareal time slices, 1 = no parareal");
+   prm.declare_entry("coarse degree", "0", Patterns::Integer(0),
+                     "Degree of parareal coarse propagator");
+   prm.declare_entry("coarse cfl", "0", Patterns::Double(0),
+                     "cfl of parareal coarse propagator, 0 = 0.95/(2*degree+1)");
+   prm.declare_entry("parareal tolerance", "1.0e-8", Patterns::Double(0),
+                     "Relative change in slice start values to stop");
+   prm.declare_entry("parareal max iterations", "0", Patterns::Integer(0),
+                     "Maximum parareal iterations, 0 = number of slices");
+   prm.declare_entry("parareal reference", "false", Patterns::Bool(),
+                     "Also run fine scheme on all ranks for comparison");
+   prm.declare_entry("pmg cycle", "none", Patterns::Selection("none|v|w"),
+                     "p-multigrid cycle to steady state, none = time accurate");
+   prm.declare_entry("pmg coarse degree", "0", Patterns::Integer(0),
+                     "Degree of coarsest p-multigrid level");
+   prm.declare_entry("pmg pre smooth", "1", Patterns::Integer(0),
+                     "RK steps before coarse correction");
+   prm.declare_entry("pmg post smooth", "1", Patterns::Integer(0),
+                     "RK steps after coarse correction");
+   prm.declare_entry("pmg coarse smooth", "4", Patterns::Integer(1),
+                     "RK steps on coarsest level");
+   prm.declare_entry("pmg max cycles", "1000", Patterns::Integer(1),
+                     "Maximum number of p-multigrid cycles");
+   prm.declare_entry("pmg tolerance", "1.0e-10", Patterns::Double(0),
+                     "Reduction of residual to stop p-multigrid");
+   prm.declare_entry("force boundary ids", "", Patterns::Anything(),
+                     "Boundary ids for lift, drag, moment and cp, e.g., 0");
+   prm.declare_entry("force tolerance", "0.0", Patterns::Double(0),
+                     "Stop when cl and cd change less than this, 0 = never");
+   prm.declare_entry("force window", "100", Patterns::Integer(1),
+                     "Number of iterations over which force change is measured");
+   prm.declare_entry("batch cases", "", Patterns::Anything(),
+                     "Parameter files of batch cases: a.prm, b.prm");
+   prm.declare_entry("batch sweep", "", Patterns::Anything(),
+                     "Batch over all combinations: cfl = 0.2,0.3; mach = 0.5,0.6");
+   prm.declare_entry("batch groups", "1", Patterns::Integer(1),
+                     "Number of rank groups running batch cases concurrently");
+   prm.declare_entry("diagnostics", "false", Patterns::Bool(),
+                     "Save integrals, entropy and bounds of cell averages");
+   prm.declare_entry("drift tolerance", "0.0", Patterns::Double(0),
+                     "Stop if conserved variables drift more than this, 0 = never");
+   prm.declare_entry("probe points", "", Patterns::Anything(),
+                     "Points to sample solution: x1,y1; x2,y2");
+   prm.declare_entry("probe lines", "", Patterns::Anything(),
+                     "Lines to sample solution: x1,y1,x2,y2,npoints; ...");
+   prm.declare_entry("probe step", "1", Patterns::Integer(1),
+                     "Iteration frequency to sample probes");
+   prm.declare_entry("probe format", "csv", Patterns::Selection("csv|binary"),
+                     "Probe time series file: csv or binary");
+   prm.declare_entry("perf counters", "false", Patterns::Bool(),
+                     "Hardware counters of solver phases (Linux)");
+   prm.declare_entry("perf fp events", "0x01c7:1,0x04c7:2,0x10c7:4,0x40c7:8",
+                     Patterns::Anything(),
+                     "Raw FP events as hex config:flops per event");
 }
 
 //------------------------------------------------------------------------------
@@ -1055,6 +2362,7 @@ parse_parameters(const ParameterHandler& ph, Parameter& param)
       param.final_time = final_time;
 
    param.n_refine = ph.get_integer("initial refine");
+   param.mesh_cache = ph.get_bool("mesh cache");
 
    param.output_step = ph.get_integer("output step");
    param.output_number = ph.get_integer("output number");
@@ -1097,6 +2405,8 @@ parse_parameters(const ParameterHandler& ph, Parameter& param)
       }
    }
 
+   param.eos_table = ph.get("eos table");
+
    {
       std::string value = ph.get("limiter");
       if (value == "none") param.limiter_type = LimiterType::none;
@@ -1105,4 +2415,68 @@ parse_parameters(const ParameterHandler& ph, Parameter& param)
    }
 
    param.Mlim = ph.get_double("tvb parameter");
+   param.cell_order = ph.get("cell order");
+   param.dof_order = ph.get("dof order");
+
+   param.ensemble_size = ph.get_integer("ensemble size");
+   param.ensemble_dt = ph.get("ensemble dt");
+   param.ensemble_parameters.clear();
+   for(const auto& entry :
+       Utilities::split_string_list(ph.get("ensemble parameters"), ';'))
+   {
+      auto name_values = Utilities::split_string_list(entry, '=');
+      AssertThrow(name_values.size() == 2,
+                  ExcMessage("Give ensemble parameter as: name = v1,v2,..."));
+      auto values = Utilities::string_to_double(
+                       Utilities::split_string_list(name_values[1], ','));
+      AssertThrow(values.size() == param.ensemble_size,
+                  ExcMessage("Need ensemble size number of values for " +
+                             name_values[0]));
+      param.ensemble_parameters.emplace_back(name_values[0], values);
+   }
+
+   param.n_time_slices = ph.get_integer("time slices");
+   param.coarse_degree = ph.get_integer("coarse degree");
+   param.coarse_cfl = ph.get_double("coarse cfl");
+   param.parareal_tol = ph.get_double("parareal tolerance");
+   param.parareal_max_iter = ph.get_integer("parareal max iterations");
+   param.parareal_reference = ph.get_bool("parareal reference");
+   param.pmg_cycle = ph.get("pmg cycle");
+   param.pmg_coarse_degree = ph.get_integer("pmg coarse degree");
+   param.pmg_pre_smooth = ph.get_integer("pmg pre smooth");
+   param.pmg_post_smooth = ph.get_integer("pmg post smooth");
+   param.pmg_coarse_smooth = ph.get_integer("pmg coarse smooth");
+   param.pmg_max_cycles = ph.get_integer("pmg max cycles");
+   param.pmg_tol = ph.get_double("pmg tolerance");
+   param.force_boundary_ids.clear();
+   for(const auto& id : Utilities::split_string_list(ph.get("force boundary ids")))
+      param.force_boundary_ids.push_back(Utilities::string_to_int(id));
+   param.force_tol = ph.get_double("force tolerance");
+   param.force_window = ph.get_integer("force window");
+   param.diagnostics = ph.get_bool("diagnostics");
+   param.drift_tol = ph.get_double("drift tolerance");
+
+   param.probe_points.clear();
+   for(const auto& entry :
+       Utilities::split_string_list(ph.get("probe points"), ';'))
+   {
+      auto x = Utilities::string_to_double(Utilities::split_string_list(entry));
+      AssertThrow(x.size() == 2, ExcMessage("Give probe point as: x,y"));
+      param.probe_points.emplace_back(x[0], x[1]);
+   }
+   for(const auto& entry :
+       Utilities::split_string_list(ph.get("probe lines"), ';'))
+   {
+      auto x = Utilities::string_to_double(Utilities::split_string_list(entry));
+      AssertThrow(x.size() == 5 && x[4] >= 2,
+                  ExcMessage("Give probe line as: x1,y1,x2,y2,npoints"));
+      const Point<2> p1(x[0], x[1]), p2(x[2], x[3]);
+      const unsigned int n = x[4];
+      for(unsigned int i = 0; i < n; ++i)
+         param.probe_points.push_back(p1 + (double(i) / (n - 1)) * (p2 - p1));
+   }
+   param.probe_step = ph.get_integer("probe step");
+   param.probe_binary = (ph.get("probe format") == "binary");
+   param.perf_counters = ph.get_bool("perf counters");
+   param.perf_fp_events = ph.get("perf fp events");
 }
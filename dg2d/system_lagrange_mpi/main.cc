@@ -1,5 +1,8 @@
 #include "dg.h"
 #include "problem.h"
+#include "parareal.h"
+#include "pmg.h"
+#include "batch.h"
 
 //------------------------------------------------------------------------------
 // Main function
@@ -24,11 +27,20 @@ main(int argc, char** argv)
    if(Utilities::MPI::this_mpi_process(MPI_COMM_WORLD) == 0)
       ph.print_parameters(std::cout, ParameterHandler::Text);
 
-   Problem<2> problem;
    Parameter param;
-   param.final_time = problem.get_final_time(); // override this in input file
+   param.final_time = Problem<2>().get_final_time(); // override in input file
    parse_parameters(ph, param);
 
+   // One problem object for each ensemble member
+   std::vector<Problem<2>> problems(param.ensemble_size);
+   std::vector<ProblemBase<2>*> problem_ptrs;
+   for(unsigned int m = 0; m < param.ensemble_size; ++m)
+   {
+      for(const auto& [name, values] : param.ensemble_parameters)
+         problems[m].set_parameter(name, values[m]);
+      problem_ptrs.push_back(&problems[m]);
+   }
+
    Quadrature<1> quadrature_1d;
    if(param.basis == "gl")
    {
@@ -43,8 +55,26 @@ main(int argc, char** argv)
       AssertThrow(false, ExcMessage("Unknown points"));
    }
 
-   DGSystem<2> solver(param, problem, quadrature_1d);
-   solver.run();
+   if(ph.get("batch cases") != "" || ph.get("batch sweep") != "")
+   {
+      Batch<2> batch(ph, argv[1], quadrature_1d);
+      batch.run();
+   }
+   else if(param.n_time_slices > 1)
+   {
+      Parareal<2> parareal(param, problems[0], quadrature_1d);
+      parareal.run();
+   }
+   else if(param.pmg_cycle != "none")
+   {
+      PMultigrid<2> pmg(param, problems[0], quadrature_1d);
+      pmg.run();
+   }
+   else
+   {
+      DGSystem<2> solver(param, problem_ptrs, quadrature_1d);
+      solver.run();
+   }
 
    return 0;
 }
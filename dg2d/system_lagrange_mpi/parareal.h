@@ -0,0 +1,359 @@
+//------------------------------------------------------------------------------
+// Parareal driver: the time interval is divided into slices, and the MPI ranks
+// are divided into groups, one group per slice. Each group solves its slice
+// with a fine propagator F (the DG scheme with given degree) and a coarse
+// propagator G (same grid, lower degree, larger time step). Iteration k is
+//
+//    U(j+1,k+1) = G(U(j,k+1)) + F(U(j,k)) - G(U(j,k))
+//
+// where F can be computed on all slices at the same time and only the cheap
+// G sweep is sequential. After k iterations the first k slices are exact.
+// All groups make the same grid partition, so that rank r of group j owns the
+// same cells as rank r of group j+1, and slice values are sent rank to rank.
+//------------------------------------------------------------------------------
+#ifndef __PARAREAL_H__
+#define __PARAREAL_H__
+
+#include <deal.II/lac/full_matrix.h>
+
+//------------------------------------------------------------------------------
+// Cell-wise L2 projection between two dof handlers on identical triangulations.
+// Integrals are computed with the mapping, so that the projection is in the
+// physical cell, also when the Jacobian is not constant.
+//------------------------------------------------------------------------------
+template <int dim>
+void
+project_dg(const Mapping<dim>&                                mapping,
+           const DoFHandler<dim>&                            dof_in,
+           const LinearAlgebra::distributed::Vector<double>& u_in,
+           const DoFHandler<dim>&                            dof_out,
+           LinearAlgebra::distributed::Vector<double>&       u_out)
+{
+   const auto& fe_in = dof_in.get_fe();
+   const auto& fe_out = dof_out.get_fe();
+   const unsigned int n_out = fe_out.dofs_per_cell;
+   const QGauss<dim> quadrature(std::max(fe_in.degree, fe_out.degree) + 2);
+   FEValues<dim> fe_values_in(mapping, fe_in, quadrature, update_values);
+   FEValues<dim> fe_values_out(mapping, fe_out, quadrature,
+                               update_values | update_JxW_values);
+
+   std::vector<Vector<double>> values(quadrature.size(),
+                                      Vector<double>(fe_in.n_components()));
+   FullMatrix<double> cell_matrix(n_out, n_out);
+   Vector<double> cell_rhs(n_out), v_out(n_out);
+   auto cell_out = dof_out.begin_active();
+   for(auto cell_in = dof_in.begin_active(); cell_in != dof_in.end();
+       ++cell_in, ++cell_out)
+   if(cell_in->is_locally_owned())
+   {
+      Assert(cell_in->center().distance(cell_out->center())
+             < 1.0e-12 * cell_in->diameter(),
+             ExcMessage("Triangulations are not identical"));
+      fe_values_in.reinit(cell_in);
+      fe_values_out.reinit(cell_out);
+      fe_values_in.get_function_values(u_in, values);
+
+      cell_matrix = 0.0;
+      cell_rhs = 0.0;
+      for(unsigned int q = 0; q < quadrature.size(); ++q)
+         for(unsigned int i = 0; i < n_out; ++i)
+         {
+            const auto c = fe_out.system_to_component_index(i).first;
+            const double phi_i = fe_values_out.shape_value(i, q) *
+                                 fe_values_out.JxW(q);
+            cell_rhs(i) += phi_i * values[q][c];
+            for(unsigned int j = 0; j < n_out; ++j)
+               if(fe_out.system_to_component_index(j).first == c)
+                  cell_matrix(i, j) += phi_i * fe_values_out.shape_value(j, q);
+         }
+      cell_matrix.gauss_jordan();
+      cell_matrix.vmult(v_out, cell_rhs);
+      cell_out->set_dof_values(v_out, u_out);
+   }
+}
+
+//------------------------------------------------------------------------------
+template <int dim>
+class Parareal
+{
+public:
+   typedef LinearAlgebra::distributed::Vector<double> PVector;
+
+   Parareal(Parameter&        param,
+            ProblemBase<dim>& problem,
+            Quadrature<1>&    quadrature_1d);
+   void run();
+
+private:
+   static MPI_Comm split_comm(const unsigned int n_slices);
+   static Parameter make_coarse_param(const Parameter& param);
+   void fine(const PVector& u0, PVector& u1);
+   void coarse(const PVector& u0, PVector& u1);
+   void send(const PVector& u);
+   void receive(PVector& u);
+
+   const MPI_Comm       world_comm;
+   Parameter*           param;
+   ProblemBase<dim>*    problem;
+   Quadrature<1>&       fine_quadrature_1d;
+   const unsigned int   n_slices;
+   const unsigned int   slice;       // index of time slice of this rank
+   const MPI_Comm       slice_comm;  // ranks working on same slice
+   const unsigned int   slice_size;  // number of ranks in slice_comm
+   double               t0, t1;      // time interval of this slice
+   Parameter            coarse_param;
+   QGauss<1>            coarse_quadrature_1d;
+   DGSystem<dim>        fine_solver;
+   DGSystem<dim>        coarse_solver;
+   PVector              coarse_work;
+   double               fine_time, coarse_time; // wall time of propagators
+   ConditionalOStream   pcout;
+};
+
+//------------------------------------------------------------------------------
+// Ranks [j*n, (j+1)*n) work on slice j, where n = n_ranks / n_slices
+//------------------------------------------------------------------------------
+template <int dim>
+MPI_Comm
+Parareal<dim>::split_comm(const unsigned int n_slices)
+{
+   const unsigned int n_ranks = Utilities::MPI::n_mpi_processes(MPI_COMM_WORLD);
+   AssertThrow(n_ranks % n_slices == 0,
+               ExcMessage("Number of ranks must be a multiple of time slices"));
+   const unsigned int rank = Utilities::MPI::this_mpi_process(MPI_COMM_WORLD);
+   MPI_Comm comm;
+   const int ierr = MPI_Comm_split(MPI_COMM_WORLD, rank / (n_ranks / n_slices),
+                                   rank, &comm);
+   AssertThrowMPI(ierr);
+   return comm;
+}
+
+//------------------------------------------------------------------------------
+// Coarse solver has lower degree and uses its own time step, with given
+// coarse cfl or, if that is zero, 0.95/(2k+1) of the coarse degree k
+//------------------------------------------------------------------------------
+template <int dim>
+Parameter
+Parareal<dim>::make_coarse_param(const Parameter& param)
+{
+   Parameter coarse_param(param);
+   coarse_param.degree = param.coarse_degree;
+   if(param.coarse_cfl > 0.0)
+      coarse_param.cfl = param.coarse_cfl;
+   else
+      coarse_param.cfl = 0.95 / (2 * coarse_param.degree + 1);
+   return coarse_param;
+}
+
+//------------------------------------------------------------------------------
+template <int dim>
+Parareal<dim>::Parareal(Parameter&        param,
+                        ProblemBase<dim>& problem,
+                        Quadrature<1>&    quadrature_1d)
+   :
+   world_comm(MPI_COMM_WORLD),
+   param(&param),
+   problem(&problem),
+   fine_quadrature_1d(quadrature_1d),
+   n_slices(param.n_time_slices),
+   slice(Utilities::MPI::this_mpi_process(world_comm) /
+         (Utilities::MPI::n_mpi_processes(world_comm) / n_slices)),
+   slice_comm(split_comm(n_slices)),
+   slice_size(Utilities::MPI::n_mpi_processes(slice_comm)),
+   coarse_param(make_coarse_param(param)),
+   coarse_quadrature_1d(param.coarse_degree + 1),
+   fine_solver(param, problem, quadrature_1d, slice_comm),
+   coarse_solver(coarse_param, problem, coarse_quadrature_1d, slice_comm),
+   fine_time(0.0),
+   coarse_time(0.0),
+   pcout(std::cout, Utilities::MPI::this_mpi_process(world_comm) == 0)
+{
+   AssertThrow(param.ensemble_size == 1,
+               ExcMessage("Parareal needs ensemble size = 1"));
+   AssertThrow(param.coarse_degree < param.degree,
+               ExcMessage("Coarse degree must be less than degree"));
+
+   t0 = slice * param.final_time / n_slices;
+   t1 = (slice + 1) * param.final_time / n_slices;
+
+   // Only rank 0 of first slice prints solver messages
+   fine_solver.set_verbose(slice == 0);
+   coarse_solver.set_verbose(false);
+}
+
+//------------------------------------------------------------------------------
+// u1 = F(u0) on this slice
+//------------------------------------------------------------------------------
+template <int dim>
+void
+Parareal<dim>::fine(const PVector& u0, PVector& u1)
+{
+   Timer timer;
+   fine_solver.set_solution(u0, t0);
+   fine_solver.solve(t1, false);
+   u1.copy_locally_owned_data_from(fine_solver.get_solution());
+   fine_time += timer.wall_time();
+}
+
+//------------------------------------------------------------------------------
+// u1 = G(u0) on this slice; projection to coarse space and back is included.
+//------------------------------------------------------------------------------
+template <int dim>
+void
+Parareal<dim>::coarse(const PVector& u0, PVector& u1)
+{
+   Timer timer;
+   project_dg(fine_solver.get_mapping(), fine_solver.get_dof_handler(), u0,
+              coarse_solver.get_dof_handler(), coarse_work);
+   coarse_solver.set_solution(coarse_work, t0);
+   coarse_solver.solve(t1, false);
+   project_dg(fine_solver.get_mapping(),
+              coarse_solver.get_dof_handler(), coarse_solver.get_solution(),
+              fine_solver.get_dof_handler(), u1);
+   coarse_time += timer.wall_time();
+}
+
+//------------------------------------------------------------------------------
+// Send end value of this slice to same rank of next slice
+//------------------------------------------------------------------------------
+template <int dim>
+void
+Parareal<dim>::send(const PVector& u)
+{
+   if(slice == n_slices - 1) return;
+   const int dest = Utilities::MPI::this_mpi_process(world_comm) + slice_size;
+   const int ierr = MPI_Send(u.begin(), u.locally_owned_size(), MPI_DOUBLE,
+                             dest, 0, world_comm);
+   AssertThrowMPI(ierr);
+}
+
+//------------------------------------------------------------------------------
+// Receive start value of this slice from same rank of previous slice
+//------------------------------------------------------------------------------
+template <int dim>
+void
+Parareal<dim>::receive(PVector& u)
+{
+   AssertThrow(slice > 0, ExcInternalError());
+   const int source = Utilities::MPI::this_mpi_process(world_comm) - slice_size;
+   const int ierr = MPI_Recv(u.begin(), u.locally_owned_size(), MPI_DOUBLE,
+                             source, 0, world_comm, MPI_STATUS_IGNORE);
+   AssertThrowMPI(ierr);
+}
+
+//------------------------------------------------------------------------------
+template <int dim>
+void
+Parareal<dim>::run()
+{
+   pcout << "Parareal for " << problem->get_name() << "\n";
+   pcout << "   Time slices      = " << n_slices << "\n";
+   pcout << "   Ranks per slice  = " << slice_size << "\n";
+   pcout << "   Fine degree      = " << param->degree << "\n";
+   pcout << "   Coarse degree    = " << param->coarse_degree << "\n";
+
+   Timer timer(world_comm, true);
+   fine_solver.setup();
+   coarse_solver.setup();
+   fine_solver.set_verbose(false);
+
+   const auto& fine_dofs = fine_solver.get_dof_handler();
+   const auto& coarse_dofs = coarse_solver.get_dof_handler();
+   coarse_work.reinit(coarse_dofs.locally_owned_dofs(), slice_comm);
+
+   PVector u(fine_dofs.locally_owned_dofs(), slice_comm); // start value
+   PVector u_new(u), u_end(u), g_old(u), g_new(u), f_end(u);
+
+   // Initial guess by coarse sweep
+   if(slice == 0)
+      u.copy_locally_owned_data_from(fine_solver.get_solution());
+   else
+      receive(u);
+   coarse(u, g_old);
+   send(g_old);
+   u_end = g_old;
+
+   const unsigned int max_iter = (param->parareal_max_iter > 0)
+                                 ? std::min(param->parareal_max_iter, n_slices)
+                                 : n_slices;
+   unsigned int iter = 0;
+   double change = 0.0;
+   while(iter < max_iter)
+   {
+      ++iter;
+
+      // Fine solution on all slices in parallel
+      fine(u, f_end);
+
+      // Sequential coarse sweep and correction
+      if(slice == 0)
+         u_new = u;
+      else
+         receive(u_new);
+      coarse(u_new, g_new);
+      u_end = g_new;
+      u_end += f_end;
+      u_end -= g_old;
+      send(u_end);
+
+      // Change in start value of slice, relative to its size
+      double slice_change = 0.0;
+      if(slice > 0)
+      {
+         u -= u_new;
+         slice_change = u.l2_norm() / (u_new.l2_norm() + 1.0e-14);
+      }
+      change = Utilities::MPI::max(slice_change, world_comm);
+      u = u_new;
+      g_old = g_new;
+
+      pcout << "Parareal iter = " << iter
+            << " change in start values = " << change << std::endl;
+      if(iter > 1 && change < param->parareal_tol) break;
+   }
+   timer.stop();
+
+   // Final solution is the end value of the last slice
+   if(slice == n_slices - 1)
+   {
+      fine_solver.set_solution(u_end, param->final_time);
+      fine_solver.write_solution();
+   }
+
+   // Wall time of one propagator call, max over all ranks
+   const double t_fine = Utilities::MPI::max(fine_time / iter, world_comm);
+   const double t_coarse = Utilities::MPI::max(coarse_time / (iter + 1),
+                                               world_comm);
+   const double t_parareal = timer.wall_time();
+   const double t_serial = n_slices * t_fine;
+   pcout << "Parareal iterations    = " << iter << "\n";
+   pcout << "Fine time per slice    = " << t_fine << " s\n";
+   pcout << "Coarse time per slice  = " << t_coarse << " s\n";
+   pcout << "Parareal wall time     = " << t_parareal << " s\n";
+   pcout << "Serial in time (est.)  = " << t_serial << " s on "
+         << slice_size << " ranks\n";
+   pcout << "Speedup over serial in time with same ranks per slice = "
+         << t_serial / t_parareal << "\n";
+   pcout << "Model speedup 1/((iter+1)*t_coarse/t_fine + iter/n_slices) = "
+         << 1.0 / ((iter + 1) * t_coarse / t_fine + double(iter) / n_slices)
+         << "\n";
+
+   // Fine solution on all ranks, to compare with pure spatial parallelism
+   if(param->parareal_reference)
+   {
+      pcout << "Running fine scheme on all ranks ...\n";
+      Timer ref_timer(world_comm, true);
+      DGSystem<dim> reference(*param, *problem, fine_quadrature_1d, world_comm);
+      reference.set_verbose(false);
+      reference.setup();
+      reference.solve(param->final_time, false);
+      ref_timer.stop();
+      const double t_spatial = ref_timer.wall_time();
+      pcout << "Fine scheme on " << Utilities::MPI::n_mpi_processes(world_comm)
+            << " ranks = " << t_spatial << " s\n";
+      pcout << "Speedup over pure spatial parallelism = "
+            << t_spatial / t_parareal << "\n";
+   }
+}
+
+#endif
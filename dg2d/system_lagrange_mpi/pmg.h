@@ -0,0 +1,259 @@
+//------------------------------------------------------------------------------
+// p-multigrid driver for steady state, using the full approximation scheme
+// (FAS). Level 0 is the DG scheme of given degree p, level l has degree p-l,
+// down to the coarse degree, all on the same grid. On level l we solve
+//
+//    R_l(u) + f_l = 0,   R_l(u) = M^{-1} * (DG residual),   f_0 = 0
+//
+// by smoothing with SSP-RK3 pseudo time steps which use the largest stable
+// time step of each cell. The coarse problem is driven by the restricted
+// residual of the fine one:
+//
+//    u_c0 = I u,   f_c = I (R_l(u) + f_l) - R_c(u_c0),   u += P (u_c - u_c0)
+//
+// Restriction I is the cell-wise L2 projection, which is also the correct
+// restriction of M^{-1}-scaled residuals, and prolongation P is interpolation,
+// which is exact since the coarse space is contained in the fine one. Low
+// degree levels have a larger stable time step and damp the smooth error
+// components which limit the convergence of explicit RK on the fine level.
+//------------------------------------------------------------------------------
+#ifndef __PMG_H__
+#define __PMG_H__
+
+#include <deal.II/fe/fe_tools.h>
+#include <deal.II/lac/full_matrix.h>
+
+#include <cmath>
+#include <memory>
+
+//------------------------------------------------------------------------------
+template <int dim>
+class PMultigrid
+{
+public:
+   typedef LinearAlgebra::distributed::Vector<double> PVector;
+
+   PMultigrid(Parameter&        param,
+              ProblemBase<dim>& problem,
+              Quadrature<1>&    quadrature_1d);
+   void run();
+
+private:
+   void cycle(const unsigned int l);
+   void transfer(const FullMatrix<double>& matrix,
+                 const DoFHandler<dim>&    dof_in,
+                 const PVector&            u_in,
+                 const DoFHandler<dim>&    dof_out,
+                 PVector&                  u_out) const;
+
+   Parameter*                                  param;
+   ProblemBase<dim>*                           problem;
+   const unsigned int                          n_levels;
+   const unsigned int                          n_visits; // 1 = V, 2 = W cycle
+   std::vector<Parameter>                      level_param;
+   std::vector<Quadrature<1>>                  level_quadrature_1d;
+   std::vector<std::unique_ptr<DGSystem<dim>>> levels;
+   std::vector<FullMatrix<double>>             restriction;   // l -> l+1
+   std::vector<FullMatrix<double>>             prolongation;  // l+1 -> l
+   std::vector<PVector>                        forcing, u0, work, work_c;
+   ConditionalOStream                          pcout;
+};
+
+//------------------------------------------------------------------------------
+// Level l has degree p-l and the cfl number scaled by the stability limit
+// 1/(2k+1) of degree k
+//------------------------------------------------------------------------------
+template <int dim>
+PMultigrid<dim>::PMultigrid(Parameter&        param,
+                            ProblemBase<dim>& problem,
+                            Quadrature<1>&    quadrature_1d)
+   :
+   param(&param),
+   problem(&problem),
+   n_levels(param.degree - std::min<int>(param.pmg_coarse_degree,
+                                         param.degree) + 1),
+   n_visits(param.pmg_cycle == "w" ? 2 : 1),
+   pcout(std::cout, Utilities::MPI::this_mpi_process(MPI_COMM_WORLD) == 0)
+{
+   AssertThrow(param.ensemble_size == 1,
+               ExcMessage("p-multigrid needs ensemble size = 1"));
+
+   // Parameters and quadratures are referenced by the solvers
+   level_param.reserve(n_levels);
+   level_quadrature_1d.reserve(n_levels);
+   for(unsigned int l = 0; l < n_levels; ++l)
+   {
+      level_param.push_back(param);
+      auto& p = level_param.back();
+      p.degree = param.degree - l;
+      p.cfl = param.cfl * (2 * param.degree + 1) / (2 * p.degree + 1);
+      if(l == 0)
+         level_quadrature_1d.push_back(quadrature_1d);
+      else
+         level_quadrature_1d.push_back(QGauss<1>(p.degree + 1));
+      levels.push_back(std::make_unique<DGSystem<dim>>(p, problem,
+                                                       level_quadrature_1d[l]));
+      levels.back()->set_verbose(l == 0);
+   }
+}
+
+//------------------------------------------------------------------------------
+// Cell-wise u_out = matrix * u_in between dof handlers on identical grids
+//------------------------------------------------------------------------------
+template <int dim>
+void
+PMultigrid<dim>::transfer(const FullMatrix<double>& matrix,
+                          const DoFHandler<dim>&    dof_in,
+                          const PVector&            u_in,
+                          const DoFHandler<dim>&    dof_out,
+                          PVector&                  u_out) const
+{
+   Vector<double> v_in(matrix.n()), v_out(matrix.m());
+   auto cell_out = dof_out.begin_active();
+   for(auto cell_in = dof_in.begin_active(); cell_in != dof_in.end();
+       ++cell_in, ++cell_out)
+   if(cell_in->is_locally_owned())
+   {
+      cell_in->get_dof_values(u_in, v_in);
+      matrix.vmult(v_out, v_in);
+      cell_out->set_dof_values(v_out, u_out);
+   }
+}
+
+//------------------------------------------------------------------------------
+// One V or W cycle starting on level l, with the solution of level l in its
+// solver and its forcing in forcing[l]
+//------------------------------------------------------------------------------
+template <int dim>
+void
+PMultigrid<dim>::cycle(const unsigned int l)
+{
+   auto& fine = *levels[l];
+   if(l == n_levels - 1)
+   {
+      fine.smooth(forcing[l], param->pmg_coarse_smooth);
+      return;
+   }
+
+   fine.smooth(forcing[l], param->pmg_pre_smooth);
+
+   // Restrict solution and residual
+   auto& coarse = *levels[l + 1];
+   const auto& dof_f = fine.get_dof_handler();
+   const auto& dof_c = coarse.get_dof_handler();
+   fine.compute_residual(work[l]);
+   work[l] += forcing[l];
+   transfer(restriction[l], dof_f, fine.get_solution(), dof_c, u0[l + 1]);
+   transfer(restriction[l], dof_f, work[l], dof_c, forcing[l + 1]);
+   coarse.set_solution(u0[l + 1], 0.0);
+   coarse.compute_residual(work[l + 1]);
+   forcing[l + 1] -= work[l + 1];
+
+   for(unsigned int k = 0; k < n_visits; ++k)
+      cycle(l + 1);
+
+   // Prolongate coarse correction
+   work_c[l + 1].copy_locally_owned_data_from(coarse.get_solution());
+   work_c[l + 1] -= u0[l + 1];
+   transfer(prolongation[l], dof_c, work_c[l + 1], dof_f, work[l]);
+   work[l] += fine.get_solution();
+   fine.set_solution(work[l], 0.0);
+
+   fine.smooth(forcing[l], param->pmg_post_smooth);
+}
+
+//------------------------------------------------------------------------------
+template <int dim>
+void
+PMultigrid<dim>::run()
+{
+   pcout << "p-multigrid for " << problem->get_name() << "\n";
+   pcout << "   Cycle            = " << param->pmg_cycle << "\n";
+   pcout << "   Degrees          = " << param->degree << " to "
+         << level_param.back().degree << "\n";
+   pcout << "   Smoothing steps  = " << param->pmg_pre_smooth << ", "
+         << param->pmg_post_smooth << ", coarse "
+         << param->pmg_coarse_smooth << "\n";
+
+   Timer timer(MPI_COMM_WORLD, true);
+   for(auto& level : levels)
+      level->setup();
+   levels[0]->setup_outputs();
+   levels[0]->set_verbose(false);
+
+   forcing.resize(n_levels);
+   u0.resize(n_levels);
+   work.resize(n_levels);
+   work_c.resize(n_levels);
+   for(unsigned int l = 0; l < n_levels; ++l)
+   {
+      const auto& dofs = levels[l]->get_dof_handler();
+      forcing[l].reinit(dofs.locally_owned_dofs(), MPI_COMM_WORLD);
+      u0[l].reinit(forcing[l]);
+      work[l].reinit(forcing[l]);
+      work_c[l].reinit(forcing[l]);
+   }
+
+   // Initial guess of coarse levels is not used; they start from I u
+   for(unsigned int l = 0; l + 1 < n_levels; ++l)
+   {
+      const auto& fe_f = levels[l]->get_dof_handler().get_fe();
+      const auto& fe_c = levels[l + 1]->get_dof_handler().get_fe();
+      restriction.emplace_back(fe_c.dofs_per_cell, fe_f.dofs_per_cell);
+      FETools::get_projection_matrix(fe_f, fe_c, restriction.back());
+      prolongation.emplace_back(fe_f.dofs_per_cell, fe_c.dofs_per_cell);
+      FETools::get_interpolation_matrix(fe_c, fe_f, prolongation.back());
+   }
+
+   // Residual of the initial guess, to which the tolerance is relative
+   levels[0]->compute_residual(work[0]);
+   const double res0 = work[0].l2_norm();
+   pcout << "Initial residual = " << res0 << std::endl;
+   AssertThrow(std::isfinite(res0) && res0 > 0,
+               ExcMessage("Initial residual is not finite, or zero so that "
+                          "the initial condition is already steady"));
+
+   double res = res0;
+   unsigned int iter = 0;
+   while(iter < param->pmg_max_cycles)
+   {
+      cycle(0);
+      ++iter;
+
+      // Residual of the solution after the cycle, which costs one more rhs
+      // evaluation but is correct also without post smoothing. Forces and
+      // probes are recorded with the cycle number in place of the time step.
+      levels[0]->compute_residual(work[0], iter);
+      res = work[0].l2_norm();
+      pcout << "Cycle = " << iter << " residual = " << res
+            << " relative = " << res / res0 << std::endl;
+      AssertThrow(std::isfinite(res),
+                  ExcMessage("Residual is not finite at cycle " +
+                             std::to_string(iter)));
+      if(res < param->pmg_tol * res0) break;
+   }
+   timer.stop();
+
+   // Work in units of one rhs evaluation on level 0
+   const double n_dofs = levels[0]->get_dof_handler().n_dofs();
+   double work_units = 0.0;
+   pcout << "Cycles = " << iter << ", relative residual = " << res / res0
+         << "\n";
+   for(unsigned int l = 0; l < n_levels; ++l)
+   {
+      const auto& level = *levels[l];
+      const double w = level.get_n_rhs() * level.get_dof_handler().n_dofs()
+                       / n_dofs;
+      pcout << "   Level " << l << ", degree " << level_param[l].degree
+            << ": " << level.get_n_rhs() << " rhs evaluations\n";
+      work_units += w;
+   }
+   pcout << "Work = " << work_units << " rhs evaluations of degree "
+         << param->degree << ", wall time = " << timer.wall_time() << " s\n";
+
+   levels[0]->set_verbose(true);
+   levels[0]->print_forces();
+   levels[0]->write_solution();
+}
+
+#endif
@@ -0,0 +1,183 @@
+//------------------------------------------------------------------------------
+// Time series of primitive variables at given points
+// Cells containing the points and basis values at the points are found once,
+// so sampling needs only a few dot products and one small MPI reduction.
+//------------------------------------------------------------------------------
+#ifndef __PROBES_H__
+#define __PROBES_H__
+
+#include <deal.II/base/mpi.h>
+#include <deal.II/grid/grid_tools.h>
+#include <deal.II/dofs/dof_handler.h>
+#include <deal.II/fe/mapping.h>
+#include <deal.II/lac/la_parallel_vector.h>
+
+#include <iostream>
+#include <vector>
+
+template <int dim>
+class Probes
+{
+public:
+   void reinit(const Mapping<dim>&             mapping,
+               const DoFHandler<dim>&          dof_handler,
+               const std::vector<Point<dim>>&  all_points,
+               const MPI_Comm                  mpi_comm);
+   unsigned int size() const
+   {
+      return points.size();
+   }
+   void write_header(std::ostream& out, const bool binary) const;
+   void sample(const LinearAlgebra::distributed::Vector<double>& solution,
+               const double                                      time,
+               const unsigned int                                step,
+               std::ostream&                                     out,
+               const bool                                        binary) const;
+
+private:
+   // Probe in a locally owned cell
+   struct LocalProbe
+   {
+      unsigned int                         index;
+      std::vector<types::global_dof_index> dof_indices;
+      std::vector<unsigned int>            component;
+      std::vector<double>                  shape_value;
+   };
+
+   MPI_Comm                    mpi_comm;
+   std::vector<Point<dim>>     points;  // points found in the grid
+   std::vector<LocalProbe>     local_probes;
+   mutable std::vector<double> buffer;  // [probe][var]
+};
+
+//------------------------------------------------------------------------------
+// A point on a partition boundary may be found by several ranks; the lowest
+// rank takes it. Points outside the grid are dropped.
+//------------------------------------------------------------------------------
+template <int dim>
+void
+Probes<dim>::reinit(const Mapping<dim>&             mapping,
+                    const DoFHandler<dim>&          dof_handler,
+                    const std::vector<Point<dim>>&  all_points,
+                    const MPI_Comm                  mpi_comm)
+{
+   this->mpi_comm = mpi_comm;
+   const unsigned int n_ranks = Utilities::MPI::n_mpi_processes(mpi_comm);
+   const unsigned int rank = Utilities::MPI::this_mpi_process(mpi_comm);
+
+   using Iterator = typename DoFHandler<dim>::active_cell_iterator;
+   std::vector<std::pair<Iterator, Point<dim>>> found(all_points.size());
+   std::vector<unsigned int> owner(all_points.size(), n_ranks);
+   for(unsigned int i = 0; i < all_points.size(); ++i)
+   {
+      try
+      {
+         found[i] = GridTools::find_active_cell_around_point(mapping,
+                                                             dof_handler,
+                                                             all_points[i]);
+         if(found[i].first.state() == IteratorState::valid &&
+            found[i].first->is_locally_owned())
+            owner[i] = rank;
+      }
+      catch(const std::exception&)
+      {
+         // not in the part of grid known to this rank
+      }
+   }
+   owner = Utilities::MPI::min(owner, mpi_comm);
+
+   const auto& fe = dof_handler.get_fe();
+   points.clear();
+   local_probes.clear();
+   for(unsigned int i = 0; i < all_points.size(); ++i)
+   {
+      if(owner[i] == n_ranks)
+      {
+         if(rank == 0)
+            std::cout << "Probe point " << all_points[i]
+                      << " is outside the grid, ignored\n";
+         continue;
+      }
+
+      if(owner[i] == rank)
+      {
+         LocalProbe probe;
+         probe.index = points.size();
+         probe.dof_indices.resize(fe.n_dofs_per_cell());
+         found[i].first->get_dof_indices(probe.dof_indices);
+         for(unsigned int j = 0; j < fe.n_dofs_per_cell(); ++j)
+         {
+            probe.component.push_back(fe.system_to_component_index(j).first);
+            probe.shape_value.push_back(fe.shape_value(j, found[i].second));
+         }
+         local_probes.push_back(probe);
+      }
+      points.push_back(all_points[i]);
+   }
+   buffer.resize(points.size() * nvar);
+}
+
+//------------------------------------------------------------------------------
+// Binary files contain records of 2 + size() * nvar doubles, with same columns
+// as the csv file; the header is then written to a separate text file.
+//------------------------------------------------------------------------------
+template <int dim>
+void
+Probes<dim>::write_header(std::ostream& out, const bool binary) const
+{
+   const auto names = PDE::Postprocessor<dim>().get_names();
+   for(unsigned int i = 0; i < points.size(); ++i)
+      out << "# probe " << i << " at " << points[i] << "\n";
+   if(binary)
+      out << "# record of " << 2 + points.size() * nvar << " doubles:\n";
+   out << "time,step";
+   for(unsigned int i = 0; i < points.size(); ++i)
+      for(const auto& name : names)
+         out << "," << name << i;
+   out << std::endl;
+}
+
+//------------------------------------------------------------------------------
+// Must be called on all ranks; only rank 0 writes to out.
+//------------------------------------------------------------------------------
+template <int dim>
+void
+Probes<dim>::sample(const LinearAlgebra::distributed::Vector<double>& solution,
+                    const double                                      time,
+                    const unsigned int                                step,
+                    std::ostream&                                     out,
+                    const bool                                        binary) const
+{
+   std::fill(buffer.begin(), buffer.end(), 0.0);
+   Vector<double> u(nvar), q(nvar);
+   for(const auto& probe : local_probes)
+   {
+      u = 0.0;
+      for(unsigned int j = 0; j < probe.dof_indices.size(); ++j)
+         u[probe.component[j]] += probe.shape_value[j] *
+                                  solution(probe.dof_indices[j]);
+      PDE::con2prim<dim>(u, q);
+      for(unsigned int c = 0; c < nvar; ++c)
+         buffer[probe.index * nvar + c] = q[c];
+   }
+   buffer = Utilities::MPI::sum(buffer, mpi_comm);
+
+   if(Utilities::MPI::this_mpi_process(mpi_comm) != 0) return;
+
+   if(binary)
+   {
+      const double header[2] = {time, double(step)};
+      out.write(reinterpret_cast<const char*>(header), sizeof(header));
+      out.write(reinterpret_cast<const char*>(buffer.data()),
+                buffer.size() * sizeof(double));
+   }
+   else
+   {
+      out << time << "," << step;
+      for(const auto v : buffer)
+         out << "," << v;
+      out << "\n";
+   }
+}
+
+#endif
@@ -14,6 +14,7 @@
 #include <deal.II/dofs/dof_tools.h>
 
 #include <deal.II/fe/fe_dgp.h>
+#include <deal.II/fe/fe_dgq.h>
 #include <deal.II/fe/fe_system.h>
 #include <deal.II/fe/fe_values.h>
 #include <deal.II/fe/fe_interface_values.h>
@@ -21,6 +22,7 @@
 #include <deal.II/base/quadrature_lib.h>
 #include <deal.II/base/function.h>
 #include <deal.II/base/parameter_handler.h>
+#include <deal.II/base/timer.h>
 
 #include <deal.II/numerics/vector_tools.h>
 #include <deal.II/numerics/data_out.h>
@@ -30,11 +32,14 @@
 
 #include <deal.II/meshworker/mesh_loop.h>
 
+#include <array>
 #include <fstream>
 #include <iostream>
 
 #include "pde.h"
 #include "../models/problem_base.h"
+#include "../common/tensor_product.h"
+#include "../common/mesh_cache.h"
 
 #define sign(a)   (((a) > 0.0) ? 1 : -1)
 
@@ -46,7 +51,7 @@ const double a_rk[3] = {0.0, 3.0 / 4.0, 1.0 / 3.0};
 const double b_rk[3] = {1.0, 1.0 / 4.0, 2.0 / 3.0};
 
 // Numerical flux functions
-enum class LimiterType {none, tvd};
+enum class LimiterType {none, tvd, filter};
 
 //------------------------------------------------------------------------------
 // Scheme parameters
@@ -54,16 +59,20 @@ enum class LimiterType {none, tvd};
 struct Parameter
 {
    int          degree;
+   std::string  basis;
    double       cfl;
    double       final_time;
    std::string  grid;
    unsigned int n_cells_x, n_cells_y;
    unsigned int n_refine;
+   bool         mesh_cache;
    unsigned int output_step;
    unsigned int output_number;
    double       output_interval;
    LimiterType  limiter_type;
    double       Mlim;
+   unsigned int filter_order;
+   double       filter_strength;
    FluxType     flux_type;
 };
 
@@ -157,6 +166,10 @@ struct ScratchData
    std::vector<Vector<double>> solution_values;
    std::vector<Vector<double>> left_state;
    std::vector<Vector<double>> right_state;
+
+   // Used with tensor product basis; resized when first used
+   std::vector<double> coef_l, coef_r, values_l, values_r, flux_x, flux_y;
+   std::vector<double> tmp;
 };
 
 //------------------------------------------------------------------------------
@@ -183,6 +196,40 @@ struct CopyData
    }
 };
 
+//------------------------------------------------------------------------------
+// Degree in x and y of each mode of one component, in the order of the basis.
+// FE_DGP: 1, x, ..., x^k, y, xy, ..., x^(k-1)y, y^2, ...
+// FE_DGQLegendre: x^i y^j has index i + (k+1)*j
+//------------------------------------------------------------------------------
+inline std::vector<std::array<unsigned int,2>>
+mode_powers(const Parameter& param)
+{
+   const unsigned int k = param.degree;
+   std::vector<std::array<unsigned int,2>> powers;
+   for(unsigned int j = 0; j <= k; ++j)
+   {
+      const unsigned int n_i = (param.basis == "legendre_q") ? k : k - j;
+      for(unsigned int i = 0; i <= n_i; ++i)
+         powers.push_back({i, j});
+   }
+   return powers;
+}
+
+//------------------------------------------------------------------------------
+// Scalar modal basis: total degree FE_DGP or tensor product FE_DGQLegendre.
+// In both, the first mode is the cell average, the second is the x-slope and
+// the one with index degree+1 is the y-slope.
+//------------------------------------------------------------------------------
+template <int dim>
+std::unique_ptr<FiniteElement<dim>>
+make_base_fe(const Parameter& param)
+{
+   if(param.basis == "legendre_q")
+      return std::make_unique<FE_DGQLegendre<dim>>(param.degree);
+   else
+      return std::make_unique<FE_DGP<dim>>(param.degree);
+}
+
 //------------------------------------------------------------------------------
 // Main class of the problem
 //------------------------------------------------------------------------------
@@ -203,6 +250,7 @@ private:
    void compute_dt();
    void apply_limiter();
    void apply_TVD_limiter();
+   void apply_filter();
    void update(const unsigned int rk_stage);
    bool call_output();
    void output_results(const double time) const;
@@ -228,12 +276,42 @@ private:
                     ScratchData<dim> &scratch_data,
                     CopyData &copy_data);
 
+   // Sum factorized workers for tensor product basis
+   template <class Iterator>
+   void cell_worker_tp(const Iterator &cell,
+                       ScratchData<dim> &scratch_data,
+                       CopyData &copy_data);
+
+   template <class Iterator>
+   void boundary_worker_tp(const Iterator &cell,
+                           const unsigned int &f,
+                           ScratchData<dim> &scratch_data,
+                           CopyData &copy_data);
+
+   template <class Iterator>
+   void face_worker_tp(const Iterator &cell,
+                       const unsigned int &f,
+                       const Iterator &ncell,
+                       const unsigned int &nf,
+                       ScratchData<dim> &scratch_data,
+                       CopyData &copy_data);
+
+   template <class Iterator>
+   void read_coefficients(const Iterator &cell,
+                          std::vector<types::global_dof_index> &dof_indices,
+                          std::vector<double> &coef) const;
+
    Parameter*                  param;
    double                      time, stage_time, dt, next_output_time;
    unsigned int                time_step;
    ProblemBase<dim>*           problem;
    Triangulation<dim>          triangulation;
    FESystem<dim>               fe;
+   const unsigned int          dofs_per_comp;
+   const bool                  tensor_basis;
+   TensorProduct::Basis1D      basis_1d;
+   std::vector<double>         filter_eta; // sum of (mode degree/k)^order
+   std::vector<bool>           top_mode;   // mode has highest degree
    DoFHandler<dim>             dof_handler;
    MappingCartesian<dim>        mapping;
    AffineConstraints<double>   constraints;
@@ -253,11 +331,36 @@ DGSystem<dim>::DGSystem(Parameter&        param,
    :
    param(&param),
    problem(&problem),
-   fe(FE_DGP<dim>(param.degree),nvar),
+   fe(*make_base_fe<dim>(param),nvar),
+   dofs_per_comp(fe.base_element(0).n_dofs_per_cell()),
+   tensor_basis(param.basis == "legendre_q"),
    dof_handler(triangulation)
 {
    AssertThrow(dim == 2, ExcIndexRange(dim, 0, 2));
 
+   if(tensor_basis)
+      basis_1d.reinit(param.degree, param.degree + 1);
+
+   if(param.limiter_type == LimiterType::filter && param.degree > 0)
+   {
+      const double k = param.degree;
+      const double p = param.filter_order;
+      for(const auto& ij : mode_powers(param))
+      {
+         if(tensor_basis)
+         {
+            filter_eta.push_back(std::pow(ij[0] / k, p) + std::pow(ij[1] / k, p));
+            top_mode.push_back(std::max(ij[0], ij[1]) == param.degree);
+         }
+         else
+         {
+            filter_eta.push_back(std::pow((ij[0] + ij[1]) / k, p));
+            top_mode.push_back(ij[0] + ij[1] == param.degree);
+         }
+      }
+      AssertDimension(filter_eta.size(), dofs_per_comp);
+   }
+
    time = 0.0;
    time_step = 0;
    next_output_time = param.output_interval;
@@ -271,7 +374,24 @@ void
 DGSystem<dim>::make_grid_and_dofs()
 {
    std::cout << "Making initial grid ...\n";
-   if(param->grid == "user")
+
+   // Transformed and refined grid of a msh file is cached, see mesh_cache.h
+   const bool cache_refined = param->mesh_cache && param->n_refine > 0 &&
+                              param->grid != "user" && param->grid != "box";
+   const std::string refined_file
+      = cache_refined ? MeshCache::refined_file_name(param->grid, dim,
+                                                     param->n_refine,
+                                                     problem->get_name())
+                      : "";
+   const bool refined = cache_refined &&
+                        MeshCache::load_refined(refined_file, triangulation);
+
+   if(refined)
+   {
+      std::cout << "   Loaded refined grid of " << param->grid
+                << " from cache\n";
+   }
+   else if(param->grid == "user")
    {
       std::cout << "   User specified code for grid generation ...\n";
       problem->make_grid(triangulation);
@@ -290,11 +410,8 @@ DGSystem<dim>::make_grid_and_dofs()
    else
    {
       std::cout << "Reading gmsh grid from file " << param->grid << std::endl;
-      GridIn<dim> grid_in;
-      grid_in.attach_triangulation(triangulation);
-      std::ifstream gfile(param->grid);
-      AssertThrow(gfile.is_open(), ExcMessage("Grid file not found"));
-      grid_in.read_msh(gfile);
+      if(MeshCache::read_msh(param->grid, triangulation, param->mesh_cache))
+         std::cout << "   Loaded grid from cache\n";
    }
 
    if(problem->get_periodic())
@@ -322,14 +439,19 @@ DGSystem<dim>::make_grid_and_dofs()
       triangulation.add_periodicity(periodicity_vector);
    }
 
-   // User specified transformation. NOTE: Cells must remain rectangles.
-   std::cout << "   Transforming grid\n";
-   problem->transform_grid(triangulation);
-
-   if(param->n_refine > 0)
+   if(!refined)
    {
-      std::cout << "   Refining initial grid\n";
-      triangulation.refine_global(param->n_refine);
+      // User specified transformation. NOTE: Cells must remain rectangles.
+      std::cout << "   Transforming grid\n";
+      problem->transform_grid(triangulation);
+
+      if(param->n_refine > 0)
+      {
+         std::cout << "   Refining initial grid\n";
+         triangulation.refine_global(param->n_refine);
+         if(cache_refined)
+            MeshCache::save_refined(refined_file, triangulation);
+      }
    }
 
    unsigned int counter = 0;
@@ -461,6 +583,12 @@ void DGSystem<dim>::cell_worker(const Iterator &cell,
                                 ScratchData<dim> &scratch_data,
                                 CopyData &copy_data)
 {
+   if(tensor_basis)
+   {
+      cell_worker_tp(cell, scratch_data, copy_data);
+      return;
+   }
+
    FEValues<dim> &fe_values = scratch_data.fe_values;
    fe_values.reinit(cell);
 
@@ -504,6 +632,12 @@ void DGSystem<dim>::face_worker(const Iterator &cell,
                                 ScratchData<dim> &scratch_data,
                                 CopyData &copy_data)
 {
+   if(tensor_basis)
+   {
+      face_worker_tp(cell, f, ncell, nf, scratch_data, copy_data);
+      return;
+   }
+
    FEInterfaceValues<dim> &fe_face_values = scratch_data.fe_interface_values;
    fe_face_values.reinit(cell, f, sf, ncell, nf, nsf);
 
@@ -556,6 +690,12 @@ void DGSystem<dim>::boundary_worker(const Iterator &cell,
                                     ScratchData<dim> &scratch_data,
                                     CopyData &copy_data)
 {
+   if(tensor_basis)
+   {
+      boundary_worker_tp(cell, f, scratch_data, copy_data);
+      return;
+   }
+
    scratch_data.fe_interface_values.reinit(cell, f);
    const auto &fe_face_values 
       = scratch_data.fe_interface_values.get_fe_face_values(0);
@@ -598,6 +738,239 @@ void DGSystem<dim>::boundary_worker(const Iterator &cell,
    }
 }
 
+//------------------------------------------------------------------------------
+// Modal coefficients of all components of cell
+//------------------------------------------------------------------------------
+template <int dim>
+template <class Iterator>
+void
+DGSystem<dim>::read_coefficients(const Iterator &cell,
+                                 std::vector<types::global_dof_index> &dof_indices,
+                                 std::vector<double> &coef) const
+{
+   dof_indices.resize(fe.dofs_per_cell);
+   cell->get_dof_indices(dof_indices);
+   coef.resize(fe.dofs_per_cell);
+   for(unsigned int i = 0; i < fe.dofs_per_cell; ++i)
+      coef[i] = solution(dof_indices[i]);
+}
+
+//------------------------------------------------------------------------------
+// Cell integral with sum factorization. Cells are rectangles, so the
+// quadrature points and gradients follow from the cell extents.
+//------------------------------------------------------------------------------
+template <int dim>
+template <class Iterator>
+void DGSystem<dim>::cell_worker_tp(const Iterator &cell,
+                                   ScratchData<dim> &scratch_data,
+                                   CopyData &copy_data)
+{
+   const auto& b = basis_1d;
+   const unsigned int n_q = b.n_q * b.n_q;
+   const auto p0 = cell->vertex(0);
+   const double hx = cell->vertex(1)[0] - p0[0];
+   const double hy = cell->vertex(2)[1] - p0[1];
+   Assert(hx > 0 && hy > 0, ExcMessage("Cell is not in standard orientation"));
+
+   copy_data.cell_rhs.reinit(fe.dofs_per_cell);
+   auto &coef = scratch_data.coef_l;
+   auto &values = scratch_data.values_l;
+   read_coefficients(cell, copy_data.local_dof_indices, coef);
+
+   values.resize(nvar * n_q);
+   scratch_data.flux_x.resize(nvar * n_q);
+   scratch_data.flux_y.resize(nvar * n_q);
+   for(unsigned int c = 0; c < nvar; ++c)
+      TensorProduct::evaluate_cell(b, &coef[c * dofs_per_comp],
+                                   &values[c * n_q], scratch_data.tmp);
+
+   auto &state = scratch_data.solution_values[0];
+   for(unsigned int qy = 0, q = 0; qy < b.n_q; ++qy)
+      for(unsigned int qx = 0; qx < b.n_q; ++qx, ++q)
+      {
+         for(unsigned int c = 0; c < nvar; ++c)
+            state[c] = values[c * n_q + q];
+         FluxData<dim> data;
+         data.p = Point<dim>(p0[0] + b.points[qx] * hx, p0[1] + b.points[qy] * hy);
+         data.t = stage_time;
+         ndarray<double,nvar,dim> flux;
+         PDE::physical_flux(state, data, flux);
+         for(unsigned int c = 0; c < nvar; ++c)
+         {
+            scratch_data.flux_x[c * n_q + q] = flux[c][0];
+            scratch_data.flux_y[c * n_q + q] = flux[c][1];
+         }
+      }
+
+   for(unsigned int c = 0; c < nvar; ++c)
+      TensorProduct::integrate_cell(b,
+                                    &scratch_data.flux_x[c * n_q],
+                                    &scratch_data.flux_y[c * n_q],
+                                    hx, hy,
+                                    copy_data.cell_rhs.begin() + c * dofs_per_comp,
+                                    scratch_data.tmp);
+}
+
+//------------------------------------------------------------------------------
+// Interior face with sum factorization. On a conforming Cartesian grid, the
+// face points of both cells are ordered along the same tangential direction.
+//------------------------------------------------------------------------------
+template <int dim>
+template <class Iterator>
+void DGSystem<dim>::face_worker_tp(const Iterator &cell,
+                                   const unsigned int &f,
+                                   const Iterator &ncell,
+                                   const unsigned int &nf,
+                                   ScratchData<dim> &scratch_data,
+                                   CopyData &copy_data)
+{
+   const auto& b = basis_1d;
+   const unsigned int n_q = b.n_q;
+   const unsigned int n_cell_dofs = fe.dofs_per_cell;
+   const auto p0 = cell->vertex(0);
+   const double hx = cell->vertex(1)[0] - p0[0];
+   const double hy = cell->vertex(2)[1] - p0[1];
+   const unsigned int d = f / 2; // normal direction
+   const double length = (d == 0) ? hy : hx;
+   Tensor<1,dim> normal;
+   normal[d] = (f % 2 == 0) ? -1.0 : 1.0;
+
+   copy_data.face_data.emplace_back();
+   CopyDataFace &copy_data_face = copy_data.face_data.back();
+   auto &dof_indices = copy_data_face.joint_dof_indices;
+   std::vector<types::global_dof_index> ndof_indices;
+   auto &coef_l = scratch_data.coef_l;
+   auto &coef_r = scratch_data.coef_r;
+   read_coefficients(cell, dof_indices, coef_l);
+   read_coefficients(ncell, ndof_indices, coef_r);
+   dof_indices.insert(dof_indices.end(), ndof_indices.begin(), ndof_indices.end());
+
+   auto &ul = scratch_data.values_l;
+   auto &ur = scratch_data.values_r;
+   ul.resize(nvar * n_q);
+   ur.resize(nvar * n_q);
+   for(unsigned int c = 0; c < nvar; ++c)
+   {
+      TensorProduct::evaluate_face(b, f, &coef_l[c * dofs_per_comp],
+                                   &ul[c * n_q], scratch_data.tmp);
+      TensorProduct::evaluate_face(b, nf, &coef_r[c * dofs_per_comp],
+                                   &ur[c * n_q], scratch_data.tmp);
+   }
+
+   // Flux times face length, stored in flux_x for the cell and flux_y for
+   // the neighbour, which sees it with opposite sign
+   auto &gl = scratch_data.flux_x;
+   auto &gr = scratch_data.flux_y;
+   gl.resize(nvar * n_q);
+   gr.resize(nvar * n_q);
+   auto &left_state = scratch_data.left_state[0];
+   auto &right_state = scratch_data.right_state[0];
+   for(unsigned int q = 0; q < n_q; ++q)
+   {
+      for(unsigned int c = 0; c < nvar; ++c)
+      {
+         left_state[c] = ul[c * n_q + q];
+         right_state[c] = ur[c * n_q + q];
+      }
+      FluxData<dim> data;
+      data.p = p0;
+      data.p[d] += (f % 2) * ((d == 0) ? hx : hy);
+      data.p[1-d] += b.points[q] * length;
+      data.t = stage_time;
+      data.ul = &average[cell->user_index()];
+      data.ur = &average[ncell->user_index()];
+      Vector<double> num_flux(nvar);
+      PDE::numerical_flux(param->flux_type, left_state, right_state, normal,
+                          data, num_flux);
+      for(unsigned int c = 0; c < nvar; ++c)
+      {
+         gl[c * n_q + q] = -num_flux[c] * length;
+         gr[c * n_q + q] =  num_flux[c] * length;
+      }
+   }
+
+   copy_data_face.cell_rhs.reinit(2 * n_cell_dofs);
+   auto &cell_rhs = copy_data_face.cell_rhs;
+   for(unsigned int c = 0; c < nvar; ++c)
+   {
+      TensorProduct::integrate_face(b, f, &gl[c * n_q],
+                                    cell_rhs.begin() + c * dofs_per_comp,
+                                    scratch_data.tmp);
+      TensorProduct::integrate_face(b, nf, &gr[c * n_q],
+                                    cell_rhs.begin() + n_cell_dofs
+                                    + c * dofs_per_comp,
+                                    scratch_data.tmp);
+   }
+}
+
+//------------------------------------------------------------------------------
+// Boundary face with sum factorization
+//------------------------------------------------------------------------------
+template <int dim>
+template <class Iterator>
+void DGSystem<dim>::boundary_worker_tp(const Iterator &cell,
+                                       const unsigned int &f,
+                                       ScratchData<dim> &scratch_data,
+                                       CopyData &copy_data)
+{
+   const auto& b = basis_1d;
+   const unsigned int n_q = b.n_q;
+   const auto p0 = cell->vertex(0);
+   const double hx = cell->vertex(1)[0] - p0[0];
+   const double hy = cell->vertex(2)[1] - p0[1];
+   const unsigned int d = f / 2;
+   const double length = (d == 0) ? hy : hx;
+   Tensor<1,dim> normal;
+   normal[d] = (f % 2 == 0) ? -1.0 : 1.0;
+
+   std::vector<types::global_dof_index> dof_indices;
+   auto &coef = scratch_data.coef_r;
+   read_coefficients(cell, dof_indices, coef);
+
+   auto &ul = scratch_data.values_l;
+   ul.resize(nvar * n_q);
+   for(unsigned int c = 0; c < nvar; ++c)
+      TensorProduct::evaluate_face(b, f, &coef[c * dofs_per_comp],
+                                   &ul[c * n_q], scratch_data.tmp);
+
+   auto &g = scratch_data.flux_x;
+   g.resize(nvar * n_q);
+   auto &left_state = scratch_data.left_state[0];
+   auto &right_state = scratch_data.right_state[0];
+   for(unsigned int q = 0; q < n_q; ++q)
+   {
+      for(unsigned int c = 0; c < nvar; ++c)
+         left_state[c] = ul[c * n_q + q];
+      Point<dim> p = p0;
+      p[d] += (f % 2) * ((d == 0) ? hx : hy);
+      p[1-d] += b.points[q] * length;
+      problem->boundary_value(cell->face(f)->boundary_id(),
+                              p,
+                              stage_time,
+                              normal,
+                              left_state,
+                              right_state);
+      FluxData<dim> data;
+      data.p = p;
+      data.t = stage_time;
+      data.ul = &average[cell->user_index()];
+      data.ur = &average[cell->user_index()];
+      Vector<double> num_flux(nvar);
+      PDE::boundary_flux(left_state,
+                         right_state,
+                         normal,
+                         data,
+                         num_flux);
+      for(unsigned int c = 0; c < nvar; ++c)
+         g[c * n_q + q] = -num_flux[c] * length;
+   }
+
+   for(unsigned int c = 0; c < nvar; ++c)
+      TensorProduct::integrate_face(b, f, &g[c * n_q],
+                                    copy_data.cell_rhs.begin() + c * dofs_per_comp,
+                                    scratch_data.tmp);
+}
+
 //------------------------------------------------------------------------------
 // Assemble system rhs
 //------------------------------------------------------------------------------
@@ -685,7 +1058,6 @@ DGSystem<dim>::compute_averages()
 {
    const unsigned int   dofs_per_cell = fe.dofs_per_cell;
    std::vector<types::global_dof_index> dof_indices(dofs_per_cell);
-   const unsigned int dofs_per_comp = ((param->degree + 1) * (param->degree + 2)) / 2;
 
    for(auto & cell : dof_handler.active_cell_iterators())
    {
@@ -711,7 +1083,6 @@ DGSystem<2>::apply_TVD_limiter()
    const unsigned int   dofs_per_cell = fe.dofs_per_cell;
    std::vector<types::global_dof_index> dof_indices(dofs_per_cell);
    const unsigned int degree = param->degree;
-   const unsigned int dofs_per_comp = ((degree+1)*(degree+2))/2;
    Vector<double> dbx(nvar), dfx(nvar), Dx(nvar), Dx_new(nvar);
    Vector<double> dby(nvar), dfy(nvar), Dy(nvar), Dy_new(nvar);
    Vector<double> dbx1(nvar), dfx1(nvar), Dx1(nvar), Dx1_new(nvar);
@@ -820,6 +1191,57 @@ DGSystem<2>::apply_TVD_limiter()
    }
 }
 
+//------------------------------------------------------------------------------
+// Exponential modal filter: mode of degree m is multiplied by
+//    exp(-alpha * (m/k)^order)
+// and alpha = filter strength * eps, where eps in [0,1] comes from the decay of
+// the modal energy, as in the shock sensor of Persson and Peraire. Smooth
+// cells are not filtered. The cell average is not changed, and no neighbour
+// data is needed.
+//------------------------------------------------------------------------------
+template <int dim>
+void
+DGSystem<dim>::apply_filter()
+{
+   if(param->degree == 0 || param->limiter_type != LimiterType::filter) return;
+
+   const double s0 = -4.0 * std::log10(param->degree);
+   const double kappa = 1.0;
+   std::vector<types::global_dof_index> dof_indices(fe.dofs_per_cell);
+   std::vector<double> sigma(dofs_per_comp);
+
+   for(auto & cell : dof_handler.active_cell_iterators())
+   {
+      cell->get_dof_indices(dof_indices);
+
+      // Largest fraction of energy in highest modes over all components
+      double sensor = -1.0e20;
+      for(unsigned int c = 0; c < nvar; ++c)
+      {
+         double e_all = 0, e_top = 0;
+         for(unsigned int m = 0; m < dofs_per_comp; ++m)
+         {
+            const double v = solution(dof_indices[c * dofs_per_comp + m]);
+            e_all += v * v;
+            if(top_mode[m]) e_top += v * v;
+         }
+         if(e_all > 0)
+            sensor = std::max(sensor, std::log10(e_top / e_all + 1.0e-30));
+      }
+      if(sensor < s0 - kappa) continue;
+
+      const double eps = (sensor > s0 + kappa) ? 1.0
+                         : 0.5 * (1.0 + std::sin(0.5 * M_PI * (sensor - s0) / kappa));
+      const double alpha = param->filter_strength * eps;
+      for(unsigned int m = 0; m < dofs_per_comp; ++m)
+         sigma[m] = std::exp(-alpha * filter_eta[m]);
+
+      for(unsigned int c = 0; c < nvar; ++c)
+         for(unsigned int m = 1; m < dofs_per_comp; ++m)
+            solution(dof_indices[c * dofs_per_comp + m]) *= sigma[m];
+   }
+}
+
 //------------------------------------------------------------------------------
 // Apply TVD limiter
 //------------------------------------------------------------------------------
@@ -827,7 +1249,7 @@ template <int dim>
 void
 DGSystem<dim>::apply_limiter()
 {
-   if(param->degree == 0 || param->limiter_type == LimiterType::none) return;
+   if(param->degree == 0 || param->limiter_type != LimiterType::tvd) return;
    apply_TVD_limiter();
 }
 
@@ -942,6 +1364,8 @@ DGSystem<dim>::run()
 {
    std::cout << "Solving " << PDE::name << " for " << problem->get_name() << "\n";
    std::cout << "Number of threas = " << MultithreadInfo::n_threads() << "\n";
+   std::cout << "Basis = " << param->basis << ", dofs per component = "
+             << dofs_per_comp << "\n";
 
    PDE::print_info();
    make_grid_and_dofs();
@@ -950,6 +1374,7 @@ DGSystem<dim>::run()
    compute_averages();
    output_results(0.0);
 
+   Timer timer;
    while(time < param->final_time)
    {
       solution_old  = solution;
@@ -960,6 +1385,7 @@ DGSystem<dim>::run()
       {
          assemble_rhs();
          update(rk);
+         apply_filter();
          compute_averages();
          apply_limiter();
       }
@@ -970,6 +1396,12 @@ DGSystem<dim>::run()
                 << " time = " << time << std::endl;
       if(call_output()) output_results(time);
    }
+   timer.stop();
+
+   const double wall_time = timer.wall_time();
+   std::cout << "Wall time = " << wall_time << " s, per step = "
+             << wall_time / time_step << " s, per step per dof = "
+             << wall_time / (time_step * dof_handler.n_dofs()) << " s\n";
 }
 
 //------------------------------------------------------------------------------
@@ -980,14 +1412,18 @@ declare_parameters(ParameterHandler& prm)
 {
    prm.declare_entry("degree", "0", Patterns::Integer(0, 6),
                      "Polynomial degree");
-   prm.declare_entry("basis", "legendre", Patterns::Anything(),
-                     "Specify basis: NOT USED");
+   prm.declare_entry("basis", "legendre",
+                     Patterns::Selection("legendre|legendre_q"),
+                     "Specify basis: legendre (FE_DGP) or legendre_q "
+                     "(FE_DGQLegendre)");
    prm.declare_entry("mapping", "cartesian", Patterns::Anything(),
                      "Specify mapping: NOT USED, always cartesian");
    prm.declare_entry("grid", "0", Patterns::Anything(),
                      "Specify grid: 100,100 or user or foo.msh");
    prm.declare_entry("initial refine", "0", Patterns::Integer(0),
                      "Number of grid refinements");
+   prm.declare_entry("mesh cache", "true", Patterns::Bool(),
+                     "Save gmsh grid in binary file and read it on later runs");
    prm.declare_entry("output step", "0", Patterns::Integer(0),
                      "Iteration frequency to save solution");
    prm.declare_entry("output number", "0", Patterns::Integer(0),
@@ -999,13 +1435,17 @@ declare_parameters(ParameterHandler& prm)
    prm.declare_entry("final time", "0.0", Patterns::Double(0),
                      "Final time");
    prm.declare_entry("limiter", "none",
-                     Patterns::Selection("none|tvd"),
+                     Patterns::Selection("none|tvd|filter"),
                      "Limiter");
    prm.declare_entry("numflux", "central",
                      Patterns::Anything(),
                      "Numerical flux");
    prm.declare_entry("tvb parameter", "0.0", Patterns::Double(0),
                      "TVB parameter");
+   prm.declare_entry("filter order", "8", Patterns::Integer(1),
+                     "Order of exponential filter, even number");
+   prm.declare_entry("filter strength", "36.0", Patterns::Double(0),
+                     "Largest damping exponent of exponential filter");
 }
 
 //------------------------------------------------------------------------------
@@ -1013,6 +1453,7 @@ void
 parse_parameters(const ParameterHandler& ph, Parameter& param)
 {
    param.degree = ph.get_integer("degree");
+   param.basis = ph.get("basis");
 
    auto grid = ph.get("grid");
    AssertThrow(grid != "0", ExcMessage("Grid is not specified."));
@@ -1033,6 +1474,7 @@ parse_parameters(const ParameterHandler& ph, Parameter& param)
    }
 
    param.n_refine = ph.get_integer("initial refine");
+   param.mesh_cache = ph.get_bool("mesh cache");
 
    double final_time = ph.get_double("final time");
    if(final_time > 0.0)
@@ -1083,8 +1525,11 @@ parse_parameters(const ParameterHandler& ph, Parameter& param)
       std::string value = ph.get("limiter");
       if (value == "none") param.limiter_type = LimiterType::none;
       else if (value == "tvd") param.limiter_type = LimiterType::tvd;
+      else if (value == "filter") param.limiter_type = LimiterType::filter;
       else AssertThrow(false, ExcMessage("Unknown limiter"));
    }
 
    param.Mlim = ph.get_double("tvb parameter");
+   param.filter_order = ph.get_integer("filter order");
+   param.filter_strength = ph.get_double("filter strength");
 }
@@ -0,0 +1,1003 @@
+//------------------------------------------------------------------------------
+// Structured engine for box grids, grid = nx,ny. The grid is split into
+// px x py blocks of cells, one per rank, and each rank stores the modal
+// coefficients of its cells in one array
+//
+//    u[((j+1)*(nx+2) + (i+1))*nvar*n_modes + v*n_modes + m]
+//
+// i.e., cell (i,j), component v and mode m, with one layer of ghost cells
+// i,j = -1 and i = nx, j = ny around the block. Ghost cells hold the cells of
+// the neighbouring ranks, or of the same rank across a periodic boundary, so
+// that cell, face and limiter kernels use direct indices without iterators,
+// user indices or neighbour lookups. Only faces are shared by neighbours and
+// corner ghosts are not used.
+//
+// The ghost exchange is started after each update and completed after the
+// cell integrals of the next rhs, which need no ghost data. A face between
+// two ranks is computed by both, so the rhs needs no reduction.
+//
+// Both bases use the 1d Legendre polynomials; a mode of FE_DGP is placed in
+// the tensor product array of FE_DGQLegendre, see mode_powers, so that the
+// sum factorization of ../common/tensor_product.h is used for both. Output
+// copies the coefficients into a DoFHandler on a triangulation of the block
+// of this rank and writes it with DataOut as DGSystem does.
+//------------------------------------------------------------------------------
+#ifndef __CARTESIAN_H__
+#define __CARTESIAN_H__
+
+#include <deal.II/base/mpi.h>
+#include <deal.II/base/memory_consumption.h>
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <vector>
+
+//------------------------------------------------------------------------------
+// px * py = n_ranks with the smallest perimeter of a block
+//------------------------------------------------------------------------------
+inline std::array<int,2>
+block_dims(const int n_ranks, const int nx, const int ny)
+{
+   std::array<int,2> dims = {0, 0};
+   double best = 1.0e20;
+   for(int px = 1; px <= n_ranks; ++px)
+   {
+      if(n_ranks % px != 0) continue;
+      const int py = n_ranks / px;
+      if(px > nx || py > ny) continue;
+      const double perimeter = double(nx) / px + double(ny) / py;
+      if(perimeter < best)
+      {
+         best = perimeter;
+         dims = {px, py};
+      }
+   }
+   AssertThrow(dims[0] > 0,
+               ExcMessage("Grid has fewer cells than ranks in x or y"));
+   return dims;
+}
+
+//------------------------------------------------------------------------------
+template <int dim>
+class CartesianDG
+{
+public:
+   CartesianDG(Parameter&        param,
+               ProblemBase<dim>& problem);
+   ~CartesianDG();
+   void run();
+
+private:
+   void make_grid();
+   void initialize();
+   void exchange_begin();
+   void exchange_end();
+   void compute_averages();
+   void assemble_rhs();
+   void cell_term(const int i, const int j);
+   void face_term(const unsigned int d, const int i, const int j);
+   void compute_dt();
+   void update(const unsigned int rk_stage);
+   void apply_TVD_limiter();
+   void apply_filter();
+   bool call_output();
+   void output_results(const double time);
+   void compute_error() const;
+   void print_memory(const std::string& when);
+
+   // Index of cell (i,j) of the block, -1 <= i <= nx, -1 <= j <= ny
+   unsigned int cell(const int i, const int j) const
+   {
+      return (j + 1) * (nx + 2) + (i + 1);
+   }
+
+   double* coef(const int i, const int j)
+   {
+      return &u[cell(i, j) * n_cell];
+   }
+
+   const double* coef(const int i, const int j) const
+   {
+      return &u[cell(i, j) * n_cell];
+   }
+
+   // Lower left corner of cell (i,j)
+   Point<dim> corner(const int i, const int j) const
+   {
+      return Point<dim>(xmin + (i0 + i) * hx, ymin + (j0 + j) * hy);
+   }
+
+   // Coefficients of one component in the tensor product order
+   const double* tensor_coef(const double* c, double* tc) const
+   {
+      if(tensor_basis) return c;
+      std::fill(tc, tc + n * n, 0.0);
+      for(unsigned int m = 0; m < n_modes; ++m)
+         tc[tp_index[m]] = c[m];
+      return tc;
+   }
+
+   // r += integral of face flux g on face f
+   void integrate_face(const unsigned int f, const double* g, double* r);
+
+   MPI_Comm                    mpi_comm;
+   Parameter*                  param;
+   double                      time, stage_time, dt, next_output_time;
+   unsigned int                time_step;
+   ProblemBase<dim>*           problem;
+   ConditionalOStream          pcout;
+   TimerOutput                 computing_timer;
+   MemoryReport::Report        memory;
+   FESystem<dim>               fe;
+   const unsigned int          n_modes;   // per component
+   const unsigned int          n_cell;    // nvar * n_modes
+   const unsigned int          n;         // 1d modes, degree + 1
+   const bool                  tensor_basis;
+   std::vector<unsigned int>   tp_index;  // mode -> index i + n*j
+   TensorProduct::Basis1D      basis_1d;
+   std::vector<double>         imm;       // inverse mass of each mode
+   std::vector<double>         filter_eta;
+   std::vector<bool>           top_mode;
+
+   // Block of this rank: cells i0 <= i < i0+nx, j0 <= j < j0+ny
+   int                         rank;
+   std::array<int,2>           dims, coords;
+   int                         nx, ny, i0, j0;
+   double                      xmin, ymin, hx, hy;
+   std::array<int,4>           neighbor;    // rank beyond face 0,1,2,3
+   std::array<bool,4>          at_boundary; // non-periodic boundary
+
+   std::vector<double>         u, u_old;    // with ghost cells
+   std::vector<double>         rhs;         // owned cells, index j*nx+i
+   std::vector<Vector<double>> average;     // with ghost cells
+   std::array<std::vector<double>,4> send_buffer, recv_buffer;
+   std::vector<MPI_Request>    requests;
+
+   // Scratch data of the kernels
+   std::vector<double>         tc, rt, values, flux_x, flux_y, ul, ur, gl, gr;
+   std::vector<double>         tmp;
+   Vector<double>              state_l, state_r, bc_out, num_flux;
+
+   // Triangulation of the block, used for output only
+   Triangulation<dim>          output_triangulation;
+   DoFHandler<dim>             dof_handler;
+   MappingCartesian<dim>       mapping;
+   std::vector<unsigned int>   output_cell; // cell(i,j) of each active cell
+   Vector<double>              output_solution;
+   std::size_t                 output_memory = 0;
+};
+
+//------------------------------------------------------------------------------
+// Constructor
+//------------------------------------------------------------------------------
+template <int dim>
+CartesianDG<dim>::CartesianDG(Parameter&        param,
+                              ProblemBase<dim>& problem)
+   :
+   mpi_comm(MPI_COMM_NULL),
+   param(&param),
+   problem(&problem),
+   pcout(std::cout, (Utilities::MPI::this_mpi_process(MPI_COMM_WORLD) == 0)),
+   computing_timer(MPI_COMM_WORLD, pcout, TimerOutput::never,
+                   TimerOutput::wall_times),
+   fe(*make_base_fe<dim>(param),nvar),
+   n_modes(fe.base_element(0).n_dofs_per_cell()),
+   n_cell(nvar * n_modes),
+   n(param.degree + 1),
+   tensor_basis(param.basis == "legendre_q"),
+   dof_handler(output_triangulation)
+{
+   AssertThrow(dim == 2, ExcIndexRange(dim, 0, 2));
+   AssertThrow(param.grid == "box",
+               ExcMessage("Cartesian engine needs grid = nx,ny"));
+   AssertThrow(param.precision == "double",
+               ExcMessage("Cartesian engine needs precision = double"));
+   AssertThrow(param.limiter_type != LimiterType::mood,
+               ExcMessage("Cartesian engine does not support limiter = mood"));
+   AssertThrow(param.rom == "none" && !param.task_graph &&
+               param.time_scheme == "ssprk3",
+               ExcMessage("Cartesian engine needs rom = none, "
+                          "task graph = false and time scheme = ssprk3"));
+
+   for(const auto& ij : mode_powers(param))
+      tp_index.push_back(ij[0] + n * ij[1]);
+   AssertDimension(tp_index.size(), n_modes);
+   basis_1d.reinit(param.degree, param.degree + 1);
+
+   if(param.limiter_type == LimiterType::filter && param.degree > 0)
+      filter_modes(param, tensor_basis, filter_eta, top_mode);
+
+   time = 0.0;
+   time_step = 0;
+   next_output_time = param.output_interval;
+}
+
+//------------------------------------------------------------------------------
+template <int dim>
+CartesianDG<dim>::~CartesianDG()
+{
+   if(mpi_comm != MPI_COMM_NULL)
+      MPI_Comm_free(&mpi_comm);
+}
+
+//------------------------------------------------------------------------------
+// Split the grid into blocks, allocate arrays and make the triangulation of
+// the block for output
+//------------------------------------------------------------------------------
+template <int dim>
+void
+CartesianDG<dim>::make_grid()
+{
+   pcout << "Making Cartesian grid ...\n";
+   const int n_global_x = param->n_cells_x << param->n_refine;
+   const int n_global_y = param->n_cells_y << param->n_refine;
+   pcout << "   Grid size = " << n_global_x << " x " << n_global_y << "\n";
+
+   const int n_ranks = Utilities::MPI::n_mpi_processes(MPI_COMM_WORLD);
+   dims = block_dims(n_ranks, n_global_x, n_global_y);
+   const int periods[2] = {problem->get_periodic_x(), problem->get_periodic_y()};
+   MPI_Cart_create(MPI_COMM_WORLD, 2, dims.data(), periods, 0, &mpi_comm);
+   MPI_Comm_rank(mpi_comm, &rank);
+   MPI_Cart_coords(mpi_comm, rank, 2, coords.data());
+   MPI_Cart_shift(mpi_comm, 0, 1, &neighbor[0], &neighbor[1]);
+   MPI_Cart_shift(mpi_comm, 1, 1, &neighbor[2], &neighbor[3]);
+   for(unsigned int f = 0; f < 4; ++f)
+      at_boundary[f] = (neighbor[f] == MPI_PROC_NULL);
+   pcout << "   Blocks = " << dims[0] << " x " << dims[1] << "\n";
+   if(problem->get_periodic_x()) pcout << "   Applying periodic in x\n";
+   if(problem->get_periodic_y()) pcout << "   Applying periodic in y\n";
+
+   i0 = (n_global_x * coords[0]) / dims[0];
+   j0 = (n_global_y * coords[1]) / dims[1];
+   nx = (n_global_x * (coords[0] + 1)) / dims[0] - i0;
+   ny = (n_global_y * (coords[1] + 1)) / dims[1] - j0;
+   xmin = problem->get_xmin();
+   ymin = problem->get_ymin();
+   hx = (problem->get_xmax() - xmin) / n_global_x;
+   hy = (problem->get_ymax() - ymin) / n_global_y;
+
+   const unsigned int n_cells = (nx + 2) * (ny + 2);
+   u.assign(n_cells * n_cell, 0.0);
+   u_old.assign(n_cells * n_cell, 0.0);
+   rhs.assign(nx * ny * n_cell, 0.0);
+   average.assign(n_cells, Vector<double>(nvar));
+   for(unsigned int f = 0; f < 4; ++f)
+   {
+      const unsigned int size = ((f < 2) ? ny : nx) * n_cell;
+      send_buffer[f].resize(size);
+      recv_buffer[f].resize(size);
+   }
+
+   // Basis is orthogonal, mass matrix is diagonal and same in all cells
+   std::vector<double> norm(n, 0.0);
+   for(unsigned int i = 0; i < n; ++i)
+      for(unsigned int q = 0; q < basis_1d.n_q; ++q)
+         norm[i] += basis_1d.weights[q] * std::pow(basis_1d.value(q, i), 2);
+   imm.resize(n_modes);
+   for(unsigned int m = 0; m < n_modes; ++m)
+      imm[m] = 1.0 / (hx * hy * norm[tp_index[m] % n] * norm[tp_index[m] / n]);
+
+   // Cells of subdivided_hyper_rectangle are found from their centers, so
+   // their order does not matter
+   const Point<dim> p1 = corner(0, 0);
+   const Point<dim> p2 = corner(nx, ny);
+   GridGenerator::subdivided_hyper_rectangle(output_triangulation,
+                                             {(unsigned int)nx,
+                                              (unsigned int)ny},
+                                             p1, p2);
+   dof_handler.distribute_dofs(fe);
+   output_solution.reinit(dof_handler.n_dofs());
+   for(const auto& c : output_triangulation.active_cell_iterators())
+   {
+      const auto p = c->center();
+      output_cell.push_back(cell(int((p[0] - p1[0]) / hx),
+                                 int((p[1] - p1[1]) / hy)));
+   }
+
+   const types::global_dof_index n_dofs = Utilities::MPI::sum(
+      types::global_dof_index(nx * ny * n_cell), mpi_comm);
+   pcout << "   Number of active cells: " << n_global_x * n_global_y << "\n";
+   pcout << "   Number of degrees of freedom: " << n_dofs << std::endl;
+}
+
+//------------------------------------------------------------------------------
+// L2 projection of initial condition, with 2k+1 Gauss points
+//------------------------------------------------------------------------------
+template <int dim>
+void
+CartesianDG<dim>::initialize()
+{
+   pcout << "Projecting initial condition ...\n";
+
+   TensorProduct::Basis1D b;
+   b.reinit(param->degree, 2 * param->degree + 1);
+   Vector<double> initial_value(nvar);
+   rt.resize(nvar * n * n);
+
+   for(int j = 0; j < ny; ++j)
+      for(int i = 0; i < nx; ++i)
+      {
+         const Point<dim> p0 = corner(i, j);
+         std::fill(rt.begin(), rt.end(), 0.0);
+         for(unsigned int qy = 0; qy < b.n_q; ++qy)
+            for(unsigned int qx = 0; qx < b.n_q; ++qx)
+            {
+               const Point<dim> p(p0[0] + b.points[qx] * hx,
+                                  p0[1] + b.points[qy] * hy);
+               problem->initial_value(p, initial_value);
+               const double w = b.weights[qx] * b.weights[qy] * hx * hy;
+               for(unsigned int v = 0; v < nvar; ++v)
+                  for(unsigned int ly = 0; ly < n; ++ly)
+                     for(unsigned int lx = 0; lx < n; ++lx)
+                        rt[v * n * n + lx + n * ly] += w * initial_value[v]
+                                                       * b.value(qx, lx)
+                                                       * b.value(qy, ly);
+            }
+
+         double* c = coef(i, j);
+         for(unsigned int v = 0; v < nvar; ++v)
+            for(unsigned int m = 0; m < n_modes; ++m)
+               c[v * n_modes + m] = imm[m] * rt[v * n * n + tp_index[m]];
+      }
+}
+
+//------------------------------------------------------------------------------
+// Start sending the cells next to the block faces and receiving the ghost
+// cells. Rows are contiguous in u, columns are packed. A periodic neighbour
+// which is this rank is copied directly.
+//------------------------------------------------------------------------------
+template <int dim>
+void
+CartesianDG<dim>::exchange_begin()
+{
+   TimerOutput::Scope scope(computing_timer, "Ghost exchange");
+   Assert(requests.empty(), ExcMessage("Ghost exchange already started"));
+
+   const int row = nx * n_cell;
+   const int col = ny * n_cell;
+
+   // Receive ghost cells beyond face f, which the neighbour sent across
+   // its face f^1; the tag is the face it was sent across
+   for(unsigned int f = 0; f < 4; ++f)
+   {
+      if(at_boundary[f] || neighbor[f] == rank) continue;
+      double* buf = (f < 2) ? recv_buffer[f].data()
+                            : coef(0, (f == 2) ? -1 : ny);
+      requests.emplace_back();
+      MPI_Irecv(buf, (f < 2) ? col : row, MPI_DOUBLE, neighbor[f], f ^ 1,
+                mpi_comm, &requests.back());
+   }
+
+   for(unsigned int f = 0; f < 4; ++f)
+   {
+      if(at_boundary[f]) continue;
+      const double* buf;
+      if(f < 2)
+      {
+         const int i = (f == 0) ? 0 : nx - 1;
+         for(int j = 0; j < ny; ++j)
+            std::copy(coef(i, j), coef(i, j) + n_cell,
+                      send_buffer[f].begin() + j * n_cell);
+         buf = send_buffer[f].data();
+      }
+      else
+         buf = coef(0, (f == 2) ? 0 : ny - 1);
+
+      if(neighbor[f] == rank)
+      {
+         // Periodic with one block in this direction
+         if(f < 2)
+         {
+            const int i = (f == 0) ? nx : -1;
+            for(int j = 0; j < ny; ++j)
+               std::copy(buf + j * n_cell, buf + (j + 1) * n_cell, coef(i, j));
+         }
+         else
+            std::copy(buf, buf + row, coef(0, (f == 2) ? ny : -1));
+         continue;
+      }
+      requests.emplace_back();
+      MPI_Isend(buf, (f < 2) ? col : row, MPI_DOUBLE, neighbor[f], f,
+                mpi_comm, &requests.back());
+   }
+}
+
+//------------------------------------------------------------------------------
+// Wait for the ghost exchange and unpack the columns
+//------------------------------------------------------------------------------
+template <int dim>
+void
+CartesianDG<dim>::exchange_end()
+{
+   TimerOutput::Scope scope(computing_timer, "Ghost exchange");
+   MPI_Waitall(requests.size(), requests.data(), MPI_STATUSES_IGNORE);
+   requests.clear();
+
+   for(unsigned int f = 0; f < 2; ++f)
+   {
+      if(at_boundary[f] || neighbor[f] == rank) continue;
+      const int i = (f == 0) ? -1 : nx;
+      for(int j = 0; j < ny; ++j)
+         std::copy(recv_buffer[f].begin() + j * n_cell,
+                   recv_buffer[f].begin() + (j + 1) * n_cell,
+                   coef(i, j));
+   }
+}
+
+//------------------------------------------------------------------------------
+// Averages of owned and ghost cells; ghost cells beyond a non-periodic
+// boundary are not used
+//------------------------------------------------------------------------------
+template <int dim>
+void
+CartesianDG<dim>::compute_averages()
+{
+   TimerOutput::Scope scope(computing_timer, "Compute averages");
+   for(int j = -1; j <= ny; ++j)
+      for(int i = -1; i <= nx; ++i)
+      {
+         const double* c = coef(i, j);
+         auto& avg = average[cell(i, j)];
+         for(unsigned int v = 0; v < nvar; ++v)
+            avg[v] = c[v * n_modes];
+      }
+}
+
+//------------------------------------------------------------------------------
+template <int dim>
+void
+CartesianDG<dim>::integrate_face(const unsigned int f,
+                                 const double*      g,
+                                 double*            r)
+{
+   for(unsigned int v = 0; v < nvar; ++v)
+   {
+      if(tensor_basis)
+      {
+         TensorProduct::integrate_face(basis_1d, f, g + v * basis_1d.n_q,
+                                       r + v * n_modes, tmp);
+         continue;
+      }
+      std::fill(rt.begin(), rt.begin() + n * n, 0.0);
+      TensorProduct::integrate_face(basis_1d, f, g + v * basis_1d.n_q,
+                                    rt.data(), tmp);
+      for(unsigned int m = 0; m < n_modes; ++m)
+         r[v * n_modes + m] += rt[tp_index[m]];
+   }
+}
+
+//------------------------------------------------------------------------------
+// Cell integral of cell (i,j) by sum factorization
+//------------------------------------------------------------------------------
+template <int dim>
+void
+CartesianDG<dim>::cell_term(const int i, const int j)
+{
+   const auto& b = basis_1d;
+   const unsigned int n_q = b.n_q * b.n_q;
+   const double* c = coef(i, j);
+   double* r = &rhs[(j * nx + i) * n_cell];
+   const Point<dim> p0 = corner(i, j);
+
+   for(unsigned int v = 0; v < nvar; ++v)
+      TensorProduct::evaluate_cell(b, tensor_coef(c + v * n_modes, tc.data()),
+                                   &values[v * n_q], tmp);
+
+   FluxData<dim,double> data;
+   data.t = stage_time;
+   ndarray<double,nvar,dim> flux;
+   for(unsigned int qy = 0, q = 0; qy < b.n_q; ++qy)
+      for(unsigned int qx = 0; qx < b.n_q; ++qx, ++q)
+      {
+         for(unsigned int v = 0; v < nvar; ++v)
+            state_l[v] = values[v * n_q + q];
+         data.p = Point<dim>(p0[0] + b.points[qx] * hx, p0[1] + b.points[qy] * hy);
+         PDE::physical_flux(state_l, data, flux);
+         for(unsigned int v = 0; v < nvar; ++v)
+         {
+            flux_x[v * n_q + q] = flux[v][0];
+            flux_y[v * n_q + q] = flux[v][1];
+         }
+      }
+
+   for(unsigned int v = 0; v < nvar; ++v)
+   {
+      double* rv = tensor_basis ? r + v * n_modes : rt.data();
+      if(!tensor_basis) std::fill(rt.begin(), rt.begin() + n * n, 0.0);
+      TensorProduct::integrate_cell(b, &flux_x[v * n_q], &flux_y[v * n_q],
+                                    hx, hy, rv, tmp);
+      if(!tensor_basis)
+         for(unsigned int m = 0; m < n_modes; ++m)
+            r[v * n_modes + m] += rt[tp_index[m]];
+   }
+}
+
+//------------------------------------------------------------------------------
+// Face normal to direction d at the left (d = 0) or bottom (d = 1) of cell
+// (i,j), between cells L = (i-1,j) or (i,j-1) and R = (i,j). Either cell may
+// be a ghost; the flux is added to the owned ones. At a non-periodic
+// boundary, the boundary flux of the owned cell is computed.
+//------------------------------------------------------------------------------
+template <int dim>
+void
+CartesianDG<dim>::face_term(const unsigned int d, const int i, const int j)
+{
+   const auto& b = basis_1d;
+   const unsigned int n_q = b.n_q;
+   const int il = (d == 0) ? i - 1 : i;
+   const int jl = (d == 0) ? j : j - 1;
+   const bool owned_l = (d == 0) ? (i > 0) : (j > 0);
+   const bool owned_r = (d == 0) ? (i < nx) : (j < ny);
+   const double length = (d == 0) ? hy : hx;
+   const unsigned int fl = 2 * d + 1, fr = 2 * d; // face of L and R
+
+   FluxData<dim,double> data;
+   data.t = stage_time;
+   const Point<dim> p0 = corner(i, j);
+   auto face_point = [&](const unsigned int q)
+   {
+      Point<dim> p = p0;
+      p[1 - d] += b.points[q] * length;
+      return p;
+   };
+
+   // Boundary face of the owned cell
+   if((!owned_l && at_boundary[fr]) || (!owned_r && at_boundary[fl]))
+   {
+      const int ic = owned_l ? il : i;
+      const int jc = owned_l ? jl : j;
+      const unsigned int f = owned_l ? fl : fr;
+      Tensor<1,dim> normal;
+      normal[d] = owned_l ? 1.0 : -1.0;
+      const double* c = coef(ic, jc);
+      for(unsigned int v = 0; v < nvar; ++v)
+         TensorProduct::evaluate_face(b, f, tensor_coef(c + v * n_modes,
+                                                        tc.data()),
+                                      &ul[v * n_q], tmp);
+      data.ul = &average[cell(ic, jc)];
+      data.ur = &average[cell(ic, jc)];
+      for(unsigned int q = 0; q < n_q; ++q)
+      {
+         for(unsigned int v = 0; v < nvar; ++v)
+            state_l[v] = ul[v * n_q + q];
+         data.p = face_point(q);
+         problem->boundary_value(f, data.p, stage_time, normal, state_l,
+                                 bc_out);
+         PDE::boundary_flux(state_l, bc_out, normal, data, num_flux);
+         for(unsigned int v = 0; v < nvar; ++v)
+            gl[v * n_q + q] = -num_flux[v] * length;
+      }
+      integrate_face(f, gl.data(), &rhs[(jc * nx + ic) * n_cell]);
+      return;
+   }
+
+   const double* cl = coef(il, jl);
+   const double* cr = coef(i, j);
+   for(unsigned int v = 0; v < nvar; ++v)
+   {
+      TensorProduct::evaluate_face(b, fl, tensor_coef(cl + v * n_modes,
+                                                      tc.data()),
+                                   &ul[v * n_q], tmp);
+      TensorProduct::evaluate_face(b, fr, tensor_coef(cr + v * n_modes,
+                                                      tc.data()),
+                                   &ur[v * n_q], tmp);
+   }
+
+   Tensor<1,dim> normal;
+   normal[d] = 1.0;
+   data.ul = &average[cell(il, jl)];
+   data.ur = &average[cell(i, j)];
+   for(unsigned int q = 0; q < n_q; ++q)
+   {
+      for(unsigned int v = 0; v < nvar; ++v)
+      {
+         state_l[v] = ul[v * n_q + q];
+         state_r[v] = ur[v * n_q + q];
+      }
+      data.p = face_point(q);
+      PDE::numerical_flux(param->flux_type, state_l, state_r, normal, data,
+                          num_flux);
+      for(unsigned int v = 0; v < nvar; ++v)
+      {
+         gl[v * n_q + q] = -num_flux[v] * length;
+         gr[v * n_q + q] =  num_flux[v] * length;
+      }
+   }
+
+   if(owned_l)
+      integrate_face(fl, gl.data(), &rhs[(jl * nx + il) * n_cell]);
+   if(owned_r)
+      integrate_face(fr, gr.data(), &rhs[(j * nx + i) * n_cell]);
+}
+
+//------------------------------------------------------------------------------
+// rhs = M^{-1} R(u). The ghost exchange started after the last update is
+// completed after the cell integrals.
+//------------------------------------------------------------------------------
+template <int dim>
+void
+CartesianDG<dim>::assemble_rhs()
+{
+   {
+      TimerOutput::Scope scope(computing_timer, "Assemble rhs");
+      std::fill(rhs.begin(), rhs.end(), 0.0);
+      for(int j = 0; j < ny; ++j)
+         for(int i = 0; i < nx; ++i)
+            cell_term(i, j);
+   }
+
+   exchange_end();
+   compute_averages();
+
+   TimerOutput::Scope scope(computing_timer, "Assemble rhs");
+   for(int j = 0; j < ny; ++j)
+      for(int i = 0; i <= nx; ++i)
+         face_term(0, i, j);
+   for(int j = 0; j <= ny; ++j)
+      for(int i = 0; i < nx; ++i)
+         face_term(1, i, j);
+
+   // Multiply by inverse mass matrix
+   for(unsigned int k = 0, l = 0; k < rhs.size() / n_cell; ++k)
+      for(unsigned int v = 0; v < nvar; ++v)
+         for(unsigned int m = 0; m < n_modes; ++m, ++l)
+            rhs[l] *= imm[m];
+}
+
+//------------------------------------------------------------------------------
+// Compute time step from cfl condition
+//------------------------------------------------------------------------------
+template <int dim>
+void
+CartesianDG<dim>::compute_dt()
+{
+   TimerOutput::Scope scope(computing_timer, "Compute dt");
+
+   dt = 1.0e20;
+   Vector<double> avg(nvar);
+   for(int j = 0; j < ny; ++j)
+      for(int i = 0; i < nx; ++i)
+      {
+         const double* c = coef(i, j);
+         for(unsigned int v = 0; v < nvar; ++v)
+            avg[v] = c[v * n_modes];
+         Point<dim> p = corner(i, j);
+         p[0] += 0.5 * hx;
+         p[1] += 0.5 * hy;
+         Tensor<1,dim> jac;
+         PDE::max_speed(avg, p, jac);
+         const double dtcell = 1.0 / (fabs(jac[0])/hx + fabs(jac[1])/hy + 1.0e-20);
+         dt = std::min(dt, dtcell);
+      }
+
+   dt *= param->cfl;
+   dt = Utilities::MPI::min(dt, mpi_comm);
+
+   if (time + dt > param->final_time)
+   {
+      dt = param->final_time - time;
+   }
+   else if (param->output_interval > 0)
+   {
+      if (time + dt > next_output_time)
+         dt = next_output_time - time;
+   }
+}
+
+//------------------------------------------------------------------------------
+// Update owned cells by one stage of RK
+//------------------------------------------------------------------------------
+template <int dim>
+void
+CartesianDG<dim>::update(const unsigned int rk_stage)
+{
+   TimerOutput::Scope scope(computing_timer, "Update");
+
+   for(int j = 0; j < ny; ++j)
+   {
+      const unsigned int begin = cell(0, j) * n_cell;
+      const double* r = &rhs[j * nx * n_cell];
+      for(unsigned int l = 0; l < nx * n_cell; ++l)
+         u[begin + l] = a_rk[rk_stage] * u_old[begin + l]
+                        + b_rk[rk_stage] * (u[begin + l] + dt * r[l]);
+   }
+
+   stage_time = a_rk[rk_stage] * time + b_rk[rk_stage] * (stage_time + dt);
+}
+
+//------------------------------------------------------------------------------
+// TVD limiter of DGSystem, see tvd_limit_slopes; at a non-periodic boundary,
+// the cell is its own neighbour
+//------------------------------------------------------------------------------
+template <int dim>
+void
+CartesianDG<dim>::apply_TVD_limiter()
+{
+   TimerOutput::Scope scope(computing_timer, "Limiter");
+
+   const unsigned int degree = param->degree;
+   const double Mh2 = param->Mlim * std::pow(std::max(hx, hy), 2);
+   Vector<double> dbx(nvar), dfx(nvar), Dx(nvar);
+   Vector<double> dby(nvar), dfy(nvar), Dy(nvar);
+   TVDScratch<double> scratch(nvar);
+   Tensor<1,dim> ex, ey;
+   ex[0] = 1.0;
+   ey[1] = 1.0;
+
+   for(int j = 0; j < ny; ++j)
+      for(int i = 0; i < nx; ++i)
+      {
+         const unsigned int c  = cell(i, j);
+         const unsigned int cl = (i == 0 && at_boundary[0]) ? c : cell(i - 1, j);
+         const unsigned int cr = (i == nx - 1 && at_boundary[1]) ? c : cell(i + 1, j);
+         const unsigned int cb = (j == 0 && at_boundary[2]) ? c : cell(i, j - 1);
+         const unsigned int ct = (j == ny - 1 && at_boundary[3]) ? c : cell(i, j + 1);
+         double* uc = coef(i, j);
+
+         for(unsigned int v = 0, k = 0; v < nvar; ++v, k += n_modes)
+         {
+            dbx[v] = average[c][v]  - average[cl][v];
+            dfx[v] = average[cr][v] - average[c][v];
+            Dx[v] = uc[k + 1];
+
+            dby[v] = average[c][v]  - average[cb][v];
+            dfy[v] = average[ct][v] - average[c][v];
+            Dy[v] = uc[k + degree + 1];
+         }
+
+         Point<dim> p = corner(i, j);
+         p[0] += 0.5 * hx;
+         p[1] += 0.5 * hy;
+         if(tvd_limit_slopes(average[c], p, ex, ey,
+                             dbx, dfx, dby, dfy, Mh2, Dx, Dy, scratch))
+         {
+            std::fill(uc, uc + n_cell, 0.0);
+            for(unsigned int v = 0, k = 0; v < nvar; ++v, k += n_modes)
+            {
+               uc[k] = average[c][v];
+               uc[k + 1] = Dx[v];
+               uc[k + degree + 1] = Dy[v];
+            }
+         }
+      }
+}
+
+//------------------------------------------------------------------------------
+// Exponential modal filter of DGSystem, see filter_cell
+//------------------------------------------------------------------------------
+template <int dim>
+void
+CartesianDG<dim>::apply_filter()
+{
+   TimerOutput::Scope scope(computing_timer, "Filter");
+
+   std::vector<double> sigma(n_modes);
+   for(int j = 0; j < ny; ++j)
+      for(int i = 0; i < nx; ++i)
+      {
+         double* uc = coef(i, j);
+         filter_cell(*param, filter_eta, top_mode, nvar, n_modes, sigma,
+                     [uc](const unsigned int k) -> double& { return uc[k]; });
+      }
+}
+
+//-----------------------------------------------------------------------------
+// Decide if solution needs to be saved
+//-----------------------------------------------------------------------------
+template <int dim>
+bool
+CartesianDG<dim>::call_output()
+{
+   return output_due(*param, time, time_step, next_output_time);
+}
+
+//------------------------------------------------------------------------------
+// Copy the owned cells into the dof vector of the block and save it like
+// DGSystem::output_results
+//------------------------------------------------------------------------------
+template <int dim>
+void
+CartesianDG<dim>::output_results(const double time)
+{
+   TimerOutput::Scope scope(computing_timer, "Output");
+
+   std::vector<types::global_dof_index> dof_indices(fe.dofs_per_cell);
+   unsigned int k = 0;
+   for(const auto& c : dof_handler.active_cell_iterators())
+   {
+      c->get_dof_indices(dof_indices);
+      const double* uc = &u[output_cell[k++] * n_cell];
+      for(unsigned int l = 0; l < n_cell; ++l)
+         output_solution(dof_indices[l]) = uc[l];
+   }
+
+   static unsigned int counter = 0;
+   static std::vector<XDMFEntry> xdmf_entries;
+   std::string mesh_filename = "mesh.h5";
+   std::string solution_filename = ("vars-" +
+                                   Utilities::int_to_string(counter, 4) +
+                                   ".h5");
+   bool write_mesh_file = (counter == 0) ? true : false;
+
+   DataOut<dim> data_out;
+   PDE::Postprocessor<dim> postprocessor;
+   data_out.add_data_vector(dof_handler, output_solution, postprocessor);
+   data_out.build_patches(mapping, param->degree);
+   output_memory = std::max(output_memory, data_out.memory_consumption());
+
+   DataOutBase::DataOutFilter data_filter(DataOutBase::DataOutFilterFlags(true, true));
+   data_out.write_filtered_data(data_filter);
+   data_out.write_hdf5_parallel(data_filter,
+                                write_mesh_file,
+                                mesh_filename,
+                                solution_filename,
+                                mpi_comm);
+   XDMFEntry new_xdmf_entry = data_out.create_xdmf_entry(data_filter,
+                                                         mesh_filename,
+                                                         solution_filename,
+                                                         time,
+                                                         mpi_comm);
+   xdmf_entries.push_back(new_xdmf_entry);
+   data_out.write_xdmf_file(xdmf_entries, "solution.xdmf", mpi_comm);
+
+   pcout << "Wrote " << solution_filename << " at t = " << time << "\n";
+   ++counter;
+}
+
+//------------------------------------------------------------------------------
+// L2 error with respect to initial condition, with k+2 Gauss points
+//------------------------------------------------------------------------------
+template <int dim>
+void
+CartesianDG<dim>::compute_error() const
+{
+   TensorProduct::Basis1D b;
+   b.reinit(param->degree, param->degree + 2);
+   const unsigned int n_q = b.n_q * b.n_q;
+   std::vector<double> c_tp(n * n), val(n_q), work;
+   Vector<double> exact(nvar);
+   std::vector<double> error(nvar, 0.0);
+
+   for(int j = 0; j < ny; ++j)
+      for(int i = 0; i < nx; ++i)
+      {
+         const Point<dim> p0 = corner(i, j);
+         for(unsigned int v = 0; v < nvar; ++v)
+         {
+            TensorProduct::evaluate_cell(b,
+                                         tensor_coef(coef(i, j) + v * n_modes,
+                                                     c_tp.data()),
+                                         val.data(), work);
+            for(unsigned int qy = 0, q = 0; qy < b.n_q; ++qy)
+               for(unsigned int qx = 0; qx < b.n_q; ++qx, ++q)
+               {
+                  const Point<dim> p(p0[0] + b.points[qx] * hx,
+                                     p0[1] + b.points[qy] * hy);
+                  problem->initial_value(p, exact);
+                  error[v] += pow(val[q] - exact[v], 2) * b.weights[qx]
+                              * b.weights[qy] * hx * hy;
+               }
+         }
+      }
+
+   pcout << "L2 error w.r.t. initial condition:";
+   for(unsigned int v = 0; v < nvar; ++v)
+      pcout << " " << std::sqrt(Utilities::MPI::sum(error[v], mpi_comm));
+   pcout << std::endl;
+}
+
+//------------------------------------------------------------------------------
+// Print memory used by the main data structures on each rank
+//------------------------------------------------------------------------------
+template <int dim>
+void
+CartesianDG<dim>::print_memory(const std::string& when)
+{
+   memory.clear();
+   memory.add("solution", MemoryConsumption::memory_consumption(u));
+   memory.add("solution_old", MemoryConsumption::memory_consumption(u_old));
+   memory.add("rhs", MemoryConsumption::memory_consumption(rhs));
+   memory.add("average", MemoryConsumption::memory_consumption(average));
+   memory.add("ghost buffers",
+              MemoryConsumption::memory_consumption(send_buffer) +
+              MemoryConsumption::memory_consumption(recv_buffer));
+   memory.add("output grid",
+              output_triangulation.memory_consumption() +
+              dof_handler.memory_consumption() +
+              output_solution.memory_consumption());
+   memory.add("output buffers", output_memory);
+   memory.print(pcout, when,
+                Utilities::MPI::sum(types::global_dof_index(nx * ny * n_cell),
+                                    mpi_comm));
+}
+
+//------------------------------------------------------------------------------
+// Start solving the problem
+//------------------------------------------------------------------------------
+template <int dim>
+void
+CartesianDG<dim>::run()
+{
+   pcout << "Solving " << PDE::name << " for " << problem->get_name() << "\n";
+   pcout << "Engine = cartesian\n";
+   pcout << "Basis = " << param->basis << ", dofs per component = "
+         << n_modes << "\n";
+
+   if (Utilities::MPI::this_mpi_process(MPI_COMM_WORLD) == 0)
+      PDE::print_info();
+   memory.reinit(MPI_COMM_WORLD);
+   make_grid();
+
+   const unsigned int n_q = basis_1d.n_q;
+   tc.resize(n * n);
+   rt.resize(n * n);
+   values.resize(nvar * n_q * n_q);
+   flux_x.resize(nvar * n_q * n_q);
+   flux_y.resize(nvar * n_q * n_q);
+   ul.resize(nvar * n_q);
+   ur.resize(nvar * n_q);
+   gl.resize(nvar * n_q);
+   gr.resize(nvar * n_q);
+   for(auto* w : {&state_l, &state_r, &bc_out, &num_flux})
+      w->reinit(nvar);
+
+   initialize();
+   exchange_begin();
+   output_results(0.0);
+   print_memory("after setup");
+
+   const bool tvd = (param->limiter_type == LimiterType::tvd &&
+                     param->degree > 0);
+   const bool filter = (param->limiter_type == LimiterType::filter &&
+                        param->degree > 0);
+   const types::global_dof_index n_dofs
+      = Utilities::MPI::sum(types::global_dof_index(nx * ny * n_cell), mpi_comm);
+
+   Timer timer(mpi_comm);
+   while(time < param->final_time)
+   {
+      // Owned cells only, the ghost rows may still be receiving
+      for(int j = 0; j < ny; ++j)
+         std::copy(coef(0, j), coef(0, j) + nx * n_cell,
+                   &u_old[cell(0, j) * n_cell]);
+      stage_time = time;
+      compute_dt();
+
+      for(unsigned int rk = 0; rk < n_rk_stages; ++rk)
+      {
+         assemble_rhs();
+         update(rk);
+         if(filter) apply_filter();
+         if(tvd)
+         {
+            // Limiter needs the averages of the ghost cells
+            exchange_begin();
+            exchange_end();
+            compute_averages();
+            apply_TVD_limiter();
+         }
+         exchange_begin();
+      }
+
+      time += dt, ++time_step;
+      pcout << "Iter = " << time_step
+            << " dt = " << dt
+            << " time = " << time << std::endl;
+      if(call_output())
+         output_results(time);
+   }
+   exchange_end();
+   timer.stop();
+
+   const double wall_time = timer.wall_time();
+   pcout << "Wall time = " << wall_time << " s, per step = "
+         << wall_time / time_step << " s, per step per dof = "
+         << wall_time / (time_step * n_dofs) << " s\n";
+   if(problem->get_periodic())
+      compute_error();
+   computing_timer.print_summary();
+   print_memory("at end");
+}
+
+#endif
@@ -14,6 +14,7 @@
 #include <deal.II/dofs/dof_tools.h>
 
 #include <deal.II/fe/fe_dgp.h>
+#include <deal.II/fe/fe_dgq.h>
 #include <deal.II/fe/fe_system.h>
 #include <deal.II/fe/fe_values.h>
 #include <deal.II/fe/fe_interface_values.h>
@@ -22,6 +23,8 @@
 #include <deal.II/base/function.h>
 #include <deal.II/base/parameter_handler.h>
 #include <deal.II/base/conditional_ostream.h>
+#include <deal.II/base/timer.h>
+#include <deal.II/base/thread_local_storage.h>
 
 #include <deal.II/numerics/vector_tools.h>
 #include <deal.II/numerics/data_out.h>
@@ -35,13 +38,21 @@
 #include <deal.II/distributed/tria.h>
 
 
+#include <array>
 #include <fstream>
 #include <iostream>
+#include <type_traits>
 
 #include "pde.h"
 #include "../models/problem_base.h"
-
-#define sign(a)   (((a) > 0.0) ? 1 : -1)
+#include "../common/renumber.h"
+#include "../common/mesh_cache.h"
+#include "../common/tensor_product.h"
+#include "../common/limiter.h"
+#include "../common/event_trace.h"
+#include "../common/memory_report.h"
+#include "../common/task_graph.h"
+#include "../common/krylov_exp.h"
 
 using namespace dealii;
 
@@ -51,7 +62,7 @@ const double a_rk[3] = {0.0, 3.0 / 4.0, 1.0 / 3.0};
 const double b_rk[3] = {1.0, 1.0 / 4.0, 2.0 / 3.0};
 
 // Numerical flux functions
-enum class LimiterType {none, tvd};
+enum class LimiterType {none, tvd, filter, mood};
 
 //------------------------------------------------------------------------------
 // Scheme parameters
@@ -59,46 +70,46 @@ enum class LimiterType {none, tvd};
 struct Parameter
 {
    int          degree;
+   std::string  basis;
    double       cfl;
    double       final_time;
    std::string  grid;
    unsigned int n_cells_x, n_cells_y;
    unsigned int n_refine;
+   bool         mesh_cache;
    unsigned int output_step;
    unsigned int output_number;
    double       output_interval;
    LimiterType  limiter_type;
    double       Mlim;
+   unsigned int filter_order;
+   double       filter_strength;
    FluxType     flux_type;
+   std::string  eos_table;          // file, empty = eos of problem
+   std::string  cell_order;
+   std::string  dof_order;
+   std::string  precision;
+   std::string  rom;
+   unsigned int rom_snapshot_step;
+   double       rom_tol;
+   unsigned int rom_max_modes;
+   unsigned int rom_deim_modes;
+   std::string  rom_parameter;           // problem parameter, empty = none
+   std::vector<double> rom_training_values; // full order runs, first is main
+   std::vector<double> rom_test_values;     // reduced model solved for these
+   bool         trace;
+   unsigned int trace_buffer;       // events per thread
+   bool         trace_workers;
+   bool         task_graph;
+   unsigned int task_block_size;    // cells per block
+   unsigned int n_threads;          // per rank, 0 = automatic
+   std::string  time_scheme;        // ssprk3 or exp
+   double       exp_step;           // 0 = output interval or final time
+   double       krylov_tol;
+   unsigned int krylov_dim;
+   std::string  engine;             // generic or cartesian
 };
 
-//------------------------------------------------------------------------------
-// minmod of three numbers
-//------------------------------------------------------------------------------
-double
-minmod(const double a, const double b, const double c, const double Mh2 = 0.0)
-{
-   double aa = std::fabs(a);
-   if(aa < Mh2) return a;
-
-   int sa = sign(a);
-   int sb = sign(b);
-   int sc = sign(c);
-
-   double result;
-
-   if(sa != sb || sb != sc)
-   {
-      result = 0.0;
-   }
-   else
-   {
-      result  = sa * std::min(aa, std::min(std::fabs(b), std::fabs(c)));
-   }
-
-   return result;
-}
-
 //------------------------------------------------------------------------------
 // Find cell size dx, dy for cartesian grid
 //------------------------------------------------------------------------------
@@ -112,7 +123,30 @@ void cell_size(const CIterator &cell, double &dx, double &dy)
 }
 
 //------------------------------------------------------------------------------
-template <int dim>
+// Return the state in the precision used for flux evaluation. When the two
+// precisions agree, the input is returned and nothing is copied.
+//------------------------------------------------------------------------------
+template <typename Number, typename Number2>
+inline const Vector<Number>&
+to_precision(const Vector<Number2>& u, Vector<Number>& work)
+{
+   if constexpr(std::is_same_v<Number, Number2>)
+   {
+      (void)work;
+      return u;
+   }
+   else
+   {
+      work = u;
+      return work;
+   }
+}
+
+//------------------------------------------------------------------------------
+// Number    = type used to evaluate the solution at quadrature points
+// AccNumber = type used for fluxes and accumulation of cell integrals
+//------------------------------------------------------------------------------
+template <int dim, typename Number = double, typename AccNumber = Number>
 struct ScratchData
 {
    ScratchData(const Mapping<dim> &mapping,
@@ -133,13 +167,18 @@ struct ScratchData
                            fe,
                            face_quadrature,
                            interface_update_flags),
-      solution_values(cell_quadrature.size(), Vector<double>(nvar)),
-      left_state(face_quadrature.size(), Vector<double>(nvar)),
-      right_state(face_quadrature.size(), Vector<double>(nvar))
+      solution_values(cell_quadrature.size(), Vector<Number>(nvar)),
+      left_state(face_quadrature.size(), Vector<Number>(nvar)),
+      right_state(face_quadrature.size(), Vector<Number>(nvar)),
+      work_l(nvar),
+      work_r(nvar),
+      bc_in(nvar),
+      bc_out(nvar),
+      time(0.0)
    {
    }
 
-   ScratchData(const ScratchData<dim> &scratch_data)
+   ScratchData(const ScratchData<dim,Number,AccNumber> &scratch_data)
        : fe_values(scratch_data.fe_values.get_mapping(),
                    scratch_data.fe_values.get_fe(),
                    scratch_data.fe_values.get_quadrature(),
@@ -149,34 +188,63 @@ struct ScratchData
                              scratch_data.fe_interface_values.get_quadrature(),
                              scratch_data.fe_interface_values.get_update_flags()),
          solution_values(scratch_data.fe_values.get_quadrature().size(),
-                         Vector<double>(nvar)),
+                         Vector<Number>(nvar)),
          left_state(scratch_data.fe_interface_values.get_quadrature().size(),
-                    Vector<double>(nvar)),
+                    Vector<Number>(nvar)),
          right_state(scratch_data.fe_interface_values.get_quadrature().size(),
-                     Vector<double>(nvar))
+                     Vector<Number>(nvar)),
+         work_l(nvar),
+         work_r(nvar),
+         bc_in(nvar),
+         bc_out(nvar),
+         time(scratch_data.time)
    {
    }
 
    FEValues<dim> fe_values;
    FEInterfaceValues<dim> fe_interface_values;
-   std::vector<Vector<double>> solution_values;
-   std::vector<Vector<double>> left_state;
-   std::vector<Vector<double>> right_state;
+   std::vector<Vector<Number>> solution_values;
+   std::vector<Vector<Number>> left_state;
+   std::vector<Vector<Number>> right_state;
+   Vector<AccNumber> work_l, work_r; // states converted to AccNumber
+   Vector<double> bc_in, bc_out;     // problem bc works in double
+   double time;                      // stage time of the fluxes
+
+   // Used with tensor product basis; resized when first used
+   std::vector<AccNumber> coef_l, coef_r, values_l, values_r, flux_x, flux_y;
+   std::vector<AccNumber> tmp;
+
+   // Work arrays, without the FEValues objects
+   std::size_t memory_consumption() const
+   {
+      return MemoryConsumption::memory_consumption(solution_values) +
+             MemoryConsumption::memory_consumption(left_state) +
+             MemoryConsumption::memory_consumption(right_state) +
+             MemoryConsumption::memory_consumption(coef_l) +
+             MemoryConsumption::memory_consumption(coef_r) +
+             MemoryConsumption::memory_consumption(values_l) +
+             MemoryConsumption::memory_consumption(values_r) +
+             MemoryConsumption::memory_consumption(flux_x) +
+             MemoryConsumption::memory_consumption(flux_y) +
+             MemoryConsumption::memory_consumption(tmp);
+   }
 };
 
 //------------------------------------------------------------------------------
+template <typename Number = double>
 struct CopyDataFace
 {
    std::vector<types::global_dof_index> joint_dof_indices;
-   Vector<double> cell_rhs;
+   Vector<Number> cell_rhs;
 };
 
 //------------------------------------------------------------------------------
+template <typename Number = double>
 struct CopyData
 {
-   Vector<double> cell_rhs;
+   Vector<Number> cell_rhs;
    std::vector<types::global_dof_index> local_dof_indices;
-   std::vector<CopyDataFace> face_data;
+   std::vector<CopyDataFace<Number>> face_data;
 
    template <class Iterator>
    void reinit(const Iterator &cell, unsigned int dofs_per_cell)
@@ -188,12 +256,225 @@ struct CopyData
    }
 };
 
+template <int dim> class ReducedModel;
+
 //------------------------------------------------------------------------------
-// Main class of the problem
+// Degree in x and y of each mode of one component, in the order of the basis.
+// FE_DGP: 1, x, ..., x^k, y, xy, ..., x^(k-1)y, y^2, ...
+// FE_DGQLegendre: x^i y^j has index i + (k+1)*j
+//------------------------------------------------------------------------------
+inline std::vector<std::array<unsigned int,2>>
+mode_powers(const Parameter& param)
+{
+   const unsigned int k = param.degree;
+   std::vector<std::array<unsigned int,2>> powers;
+   for(unsigned int j = 0; j <= k; ++j)
+   {
+      const unsigned int n_i = (param.basis == "legendre_q") ? k : k - j;
+      for(unsigned int i = 0; i <= n_i; ++i)
+         powers.push_back({i, j});
+   }
+   return powers;
+}
+
+//------------------------------------------------------------------------------
+// Scalar modal basis: total degree FE_DGP or tensor product FE_DGQLegendre.
+// In both, the first mode is the cell average, the second is the x-slope and
+// the one with index degree+1 is the y-slope.
 //------------------------------------------------------------------------------
 template <int dim>
+std::unique_ptr<FiniteElement<dim>>
+make_base_fe(const Parameter& param)
+{
+   if(param.basis == "legendre_q")
+      return std::make_unique<FE_DGQLegendre<dim>>(param.degree);
+   else
+      return std::make_unique<FE_DGP<dim>>(param.degree);
+}
+
+//------------------------------------------------------------------------------
+// Filter exponent eta = (m/k)^order of each mode and whether it is one of the
+// highest modes; used by the filter of DGSystem and CartesianDG
+//------------------------------------------------------------------------------
+inline void
+filter_modes(const Parameter&     param,
+             const bool           tensor_basis,
+             std::vector<double>& filter_eta,
+             std::vector<bool>&   top_mode)
+{
+   const double k = param.degree;
+   const double p = param.filter_order;
+   for(const auto& ij : mode_powers(param))
+   {
+      if(tensor_basis)
+      {
+         filter_eta.push_back(std::pow(ij[0] / k, p) + std::pow(ij[1] / k, p));
+         top_mode.push_back(std::max(ij[0], ij[1]) == param.degree);
+      }
+      else
+      {
+         filter_eta.push_back(std::pow((ij[0] + ij[1]) / k, p));
+         top_mode.push_back(ij[0] + ij[1] == param.degree);
+      }
+   }
+}
+
+//------------------------------------------------------------------------------
+// Exponential modal filter of one cell with nvar components of n_modes modes;
+// u(v * n_modes + m) is a reference to mode m of component v. sigma is work
+// space of size n_modes.
+//------------------------------------------------------------------------------
+template <typename Coef>
+void
+filter_cell(const Parameter&           param,
+            const std::vector<double>& filter_eta,
+            const std::vector<bool>&   top_mode,
+            const unsigned int         nvar,
+            const unsigned int         n_modes,
+            std::vector<double>&       sigma,
+            Coef&&                     u)
+{
+   const double s0 = -4.0 * std::log10(param.degree);
+   const double kappa = 1.0;
+
+   // Largest fraction of energy in highest modes over all components
+   double sensor = -1.0e20;
+   for(unsigned int v = 0; v < nvar; ++v)
+   {
+      double e_all = 0, e_top = 0;
+      for(unsigned int m = 0; m < n_modes; ++m)
+      {
+         const double w = u(v * n_modes + m);
+         e_all += w * w;
+         if(top_mode[m]) e_top += w * w;
+      }
+      if(e_all > 0)
+         sensor = std::max(sensor, std::log10(e_top / e_all + 1.0e-30));
+   }
+   if(sensor < s0 - kappa) return;
+
+   const double eps = (sensor > s0 + kappa) ? 1.0
+                      : 0.5 * (1.0 + std::sin(0.5 * M_PI * (sensor - s0) / kappa));
+   const double alpha = param.filter_strength * eps;
+   for(unsigned int m = 0; m < n_modes; ++m)
+      sigma[m] = std::exp(-alpha * filter_eta[m]);
+
+   for(unsigned int v = 0; v < nvar; ++v)
+      for(unsigned int m = 1; m < n_modes; ++m)
+         u(v * n_modes + m) *= sigma[m];
+}
+
+//------------------------------------------------------------------------------
+// Work space of tvd_limit_slopes
+//------------------------------------------------------------------------------
+template <typename Number>
+struct TVDScratch
+{
+   TVDScratch(const unsigned int nvar)
+      :
+      dx1(nvar), dfx1(nvar), Dx1(nvar), Dx1_new(nvar),
+      dy1(nvar), dfy1(nvar), Dy1(nvar), Dy1_new(nvar),
+      Rx(nvar,nvar), Lx(nvar,nvar), Ry(nvar,nvar), Ly(nvar,nvar)
+   {}
+
+   Vector<Number> dx1, dfx1, Dx1, Dx1_new;
+   Vector<Number> dy1, dfy1, Dy1, Dy1_new;
+   FullMatrix<Number> Rx, Lx, Ry, Ly;
+};
+
+//------------------------------------------------------------------------------
+// Characteristic TVD limiting of the slopes Dx, Dy of one cell with average u
+// at p, given the backward and forward differences of the neighbour averages
+// in directions ex, ey. Returns true, with the limited slopes in Dx, Dy, if
+// some slope was changed.
+//------------------------------------------------------------------------------
+template <int dim, typename Number>
+bool
+tvd_limit_slopes(const Vector<Number>&  u,
+                 const Point<dim>&      p,
+                 const Tensor<1,dim>&   ex,
+                 const Tensor<1,dim>&   ey,
+                 const Vector<Number>&  dbx,
+                 const Vector<Number>&  dfx,
+                 const Vector<Number>&  dby,
+                 const Vector<Number>&  dfy,
+                 const double           Mh2,
+                 Vector<Number>&        Dx,
+                 Vector<Number>&        Dy,
+                 TVDScratch<Number>&    scratch)
+{
+   const double sqrt_3 = std::sqrt(3.0);
+   auto& s = scratch;
+
+   PDE::char_mat(u, p, ex, ey, s.Rx, s.Lx, s.Ry, s.Ly);
+   s.Lx.vmult(s.dx1,  dbx);
+   s.Lx.vmult(s.dfx1, dfx);
+   s.Lx.vmult(s.Dx1,  Dx);
+   s.Ly.vmult(s.dy1,  dby);
+   s.Ly.vmult(s.dfy1, dfy);
+   s.Ly.vmult(s.Dy1,  Dy);
+
+   bool tolimit = false;
+   for(unsigned int i = 0; i < u.size(); ++i)
+   {
+      s.Dx1_new[i] = minmod(sqrt_3 * s.Dx1[i], s.dx1[i], s.dfx1[i], Mh2) / sqrt_3;
+      s.Dy1_new[i] = minmod(sqrt_3 * s.Dy1[i], s.dy1[i], s.dfy1[i], Mh2) / sqrt_3;
+      if(fabs(s.Dx1[i] - s.Dx1_new[i]) > 1.0e-6 * fabs(s.Dx1[i]) ||
+         fabs(s.Dy1[i] - s.Dy1_new[i]) > 1.0e-6 * fabs(s.Dy1[i]))
+         tolimit = true;
+   }
+
+   if(tolimit)
+   {
+      s.Rx.vmult(Dx, s.Dx1_new);
+      s.Ry.vmult(Dy, s.Dy1_new);
+   }
+   return tolimit;
+}
+
+//-----------------------------------------------------------------------------
+// Decide if solution needs to be saved at time, time_step; next_output_time is
+// advanced when the output interval is reached
+//-----------------------------------------------------------------------------
+inline bool
+output_due(const Parameter&   param,
+           const double       time,
+           const unsigned int time_step,
+           double&            next_output_time)
+{
+   // Save initial condition
+   if (time_step == 0)
+      return true;
+
+   // Save final solution
+   if (fabs(time - param.final_time) < 1.0e-13)
+      return true;
+
+   if (param.output_step > 0)
+      if (time_step % param.output_step == 0)
+         return true;
+
+   if (param.output_interval > 0)
+      if (fabs(time - next_output_time) < 1.0e-13)
+      {
+         next_output_time += param.output_interval;
+         next_output_time = std::min(next_output_time, param.final_time);
+         return true;
+      }
+
+   return false;
+}
+
+//------------------------------------------------------------------------------
+// Main class of the problem
+// Number    = storage type of solution vectors, which are ghost exchanged
+// AccNumber = type of fluxes, rhs, mass matrix and cell averages
+//------------------------------------------------------------------------------
+template <int dim, typename Number = double, typename AccNumber = Number>
 class DGSystem
 {
+   template <int d> friend class ReducedModel;
+
 public:
    DGSystem(Parameter&        param,
             ProblemBase<dim>& problem);
@@ -201,30 +482,64 @@ public:
 
 private:
    typedef parallel::distributed::Triangulation<dim> PTriangulation;
-   typedef LinearAlgebra::distributed::Vector<double> PVector;
+   typedef LinearAlgebra::distributed::Vector<Number> PVector;
+   typedef LinearAlgebra::distributed::Vector<AccNumber> AVector;
+   typedef ScratchData<dim,Number,AccNumber> Scratch;
+   typedef typename DoFHandler<dim>::active_cell_iterator CellIterator;
 
    void make_grid_and_dofs();
    void initialize();
    void assemble_mass_matrix();
    void assemble_rhs();
    void compute_averages();
+   template <typename Range>
+   void compute_averages(const Range& cells);
    void compute_dt();
    void apply_limiter();
    void apply_TVD_limiter();
+   template <typename Range>
+   void apply_TVD_limiter(const Range& cells);
+   void apply_filter();
+   template <typename Range>
+   void apply_filter(const Range& cells);
+   void setup_subcells();
+   void apply_subcell_fallback(const unsigned int rk_stage);
+   template <class Iterator>
+   void subcell_averages(const PVector& u,
+                         const Iterator& cell,
+                         std::vector<types::global_dof_index>& dof_indices,
+                         std::vector<Vector<AccNumber>>& ub) const;
+   template <class Iterator>
+   void face_trace(const Iterator& cell,
+                   const unsigned int f,
+                   const unsigned int q,
+                   std::vector<types::global_dof_index>& dof_indices,
+                   Vector<AccNumber>& state) const;
    void update(const unsigned int rk_stage);
+   void setup_task_graph();
+   void assemble_rhs_block(const unsigned int b, const unsigned int rk_stage);
+   void update_block(const unsigned int b, const unsigned int rk_stage);
+   void run_task_graph();
    bool call_output();
    void output_results(const double time) const;
+   void compute_error() const;
+   void print_memory(const std::string& when);
+   void store_snapshot();
+   double time_loop();
+   double full_order_run(const double value, const bool store);
+   void check_linear();
+   void exp_step();
 
    template <class Iterator>
    void cell_worker(const Iterator &cell,
-                    ScratchData<dim> &scratch_data,
-                    CopyData &copy_data);
+                    Scratch &scratch_data,
+                    CopyData<AccNumber> &copy_data);
 
    template <class Iterator>
    void boundary_worker(const Iterator &cell,
                         const unsigned int &f,
-                        ScratchData<dim> &scratch_data,
-                        CopyData &copy_data);
+                        Scratch &scratch_data,
+                        CopyData<AccNumber> &copy_data);
 
    template <class Iterator>
    void face_worker(const Iterator &cell,
@@ -233,8 +548,33 @@ private:
                     const Iterator &ncell,
                     const unsigned int &nf,
                     const unsigned int &nsf,
-                    ScratchData<dim> &scratch_data,
-                    CopyData &copy_data);
+                    Scratch &scratch_data,
+                    CopyData<AccNumber> &copy_data);
+
+   // Sum factorized workers for tensor product basis
+   template <class Iterator>
+   void cell_worker_tp(const Iterator &cell,
+                       Scratch &scratch_data,
+                       CopyData<AccNumber> &copy_data);
+
+   template <class Iterator>
+   void boundary_worker_tp(const Iterator &cell,
+                           const unsigned int &f,
+                           Scratch &scratch_data,
+                           CopyData<AccNumber> &copy_data);
+
+   template <class Iterator>
+   void face_worker_tp(const Iterator &cell,
+                       const unsigned int &f,
+                       const Iterator &ncell,
+                       const unsigned int &nf,
+                       Scratch &scratch_data,
+                       CopyData<AccNumber> &copy_data);
+
+   template <class Iterator>
+   void read_coefficients(const Iterator &cell,
+                          std::vector<types::global_dof_index> &dof_indices,
+                          std::vector<AccNumber> &coef) const;
 
    const MPI_Comm              mpi_comm;
    Parameter*                  param;
@@ -242,35 +582,97 @@ private:
    unsigned int                time_step;
    ProblemBase<dim>*           problem;
    ConditionalOStream          pcout;
+   TimerOutput                 computing_timer;
+   EventTrace::Tracer          tracer;
+   MemoryReport::Report        memory;
+   mutable std::size_t         output_memory = 0; // largest DataOut seen
    PTriangulation              triangulation;
    FESystem<dim>               fe;
+   const unsigned int          dofs_per_comp;
+   const bool                  tensor_basis;
+   TensorProduct::Basis1D      basis_1d;
+   std::vector<double>         filter_eta; // sum of (mode degree/k)^order
+   std::vector<bool>           top_mode;   // mode has highest degree
+
+   // Subcell finite volume fallback, limiter = mood. There are (k+1)^2
+   // subcells whose widths are the Gauss weights, so that each face Gauss
+   // point lies on one subcell face.
+   std::vector<double>         subcell_width;
+   std::vector<double>         subcell_edge;    // end points of subcells
+   std::vector<double>         gauss_point;     // 1d Gauss points in [0,1]
+   FullMatrix<double>          subcell_matrix;  // modes -> subcell averages
+   std::vector<double>         mode_norm;       // integral of mode^2
+   Table<3,double>             face_basis;      // [face][q][mode]
+   PVector                     solution_stage;  // solution at start of stage
+   std::vector<Vector<AccNumber>> average_stage;
+   std::vector<typename DoFHandler<dim>::active_cell_iterator> troubled_cells;
+   unsigned int                n_troubled;      // in current time step
    DoFHandler<dim>             dof_handler;
    MappingCartesian<dim>       mapping;
    AffineConstraints<double>   constraints;
    PVector                     solution;
    PVector                     solution_old;
-   PVector                     rhs;
-   PVector                     imm;
-   std::vector<Vector<double>> average;
+   AVector                     rhs;
+   AVector                     imm;
+   std::vector<Vector<AccNumber>> average;
+
+   // Snapshots of solution and rhs for reduced model, locally owned values
+   std::vector<Vector<double>> snapshots;
+   std::vector<Vector<double>> rhs_snapshots;
+   std::vector<double>         dt_history;
+   bool                        store_snapshots = true;
+   bool                        save_output = true;
+
+   // Task graph of the RK stages of one time step, see setup_task_graph
+   struct Block
+   {
+      std::vector<CellIterator> cells;
+      std::vector<unsigned int> dofs;      // local indices
+      std::vector<unsigned int> neighbors; // blocks sharing a face
+      bool                      remote = false; // has ghost data or sends it
+   };
+   std::vector<Block>          blocks;
+   std::vector<unsigned int>   cell_block;  // by user index, invalid for ghosts
+   std::vector<CellIterator>   ghost_cells;
+   TaskGraph::Graph            step_graph;
+   Krylov::ExpIntegrator<PVector> exp_integrator;
+   unsigned int                n_exp_rhs = 0;   // rhs evaluations of Krylov
+   std::array<double,n_rk_stages+1> stage_times;
+   Threads::ThreadLocalStorage<std::shared_ptr<Scratch>> task_scratch;
 };
 
 //------------------------------------------------------------------------------
 // Constructor
 //------------------------------------------------------------------------------
-template <int dim>
-DGSystem<dim>::DGSystem(Parameter&        param,
-                        ProblemBase<dim>& problem)
+template <int dim, typename Number, typename AccNumber>
+DGSystem<dim,Number,AccNumber>::DGSystem(Parameter&        param,
+                                         ProblemBase<dim>& problem)
    :
    mpi_comm(MPI_COMM_WORLD),
    param(&param),
    problem(&problem),
    pcout(std::cout, (Utilities::MPI::this_mpi_process(mpi_comm) == 0)),
+   computing_timer(mpi_comm, pcout, TimerOutput::never, TimerOutput::wall_times),
    triangulation(mpi_comm),
-   fe(FE_DGP<dim>(param.degree),nvar),
+   fe(*make_base_fe<dim>(param),nvar),
+   dofs_per_comp(fe.base_element(0).n_dofs_per_cell()),
+   tensor_basis(param.basis == "legendre_q"),
    dof_handler(triangulation)
 {
    AssertThrow(dim == 2, ExcIndexRange(dim, 0, 2));
 
+   if(tensor_basis)
+      basis_1d.reinit(param.degree, param.degree + 1);
+
+   if(param.limiter_type == LimiterType::filter && param.degree > 0)
+   {
+      filter_modes(param, tensor_basis, filter_eta, top_mode);
+      AssertDimension(filter_eta.size(), dofs_per_comp);
+   }
+
+   if(param.limiter_type == LimiterType::mood && param.degree > 0)
+      setup_subcells();
+
    time = 0.0;
    time_step = 0;
    next_output_time = param.output_interval;
@@ -279,15 +681,24 @@ DGSystem<dim>::DGSystem(Parameter&        param,
 //------------------------------------------------------------------------------
 // Make grid and allocate memory for solution variables
 //------------------------------------------------------------------------------
-template <int dim>
+template <int dim, typename Number, typename AccNumber>
 void
-DGSystem<dim>::make_grid_and_dofs()
+DGSystem<dim,Number,AccNumber>::make_grid_and_dofs()
 {
    pcout << "Making initial grid ...\n";
+
+   // When coarse cells are to be reordered, the grid is first made in a serial
+   // triangulation and copied to the distributed one in the new order.
+   Triangulation<dim> serial_triangulation;
+   Triangulation<dim>& coarse
+      = (param->cell_order == "natural")
+        ? static_cast<Triangulation<dim>&>(triangulation)
+        : serial_triangulation;
+
    if(param->grid == "user")
    {
       pcout << "   User specified code for grid generation ...\n";
-      problem->make_grid(triangulation);
+      problem->make_grid(coarse);
    }
    else if(param->grid == "box")
    {
@@ -297,17 +708,26 @@ DGSystem<dim>::make_grid_and_dofs()
       const Point<dim> p1(problem->get_xmin(), problem->get_ymin());
       const Point<dim> p2(problem->get_xmax(), problem->get_ymax());
       std::vector<unsigned int> ncells2d({param->n_cells_x,param->n_cells_y});
-      GridGenerator::subdivided_hyper_rectangle(triangulation, ncells2d,
+      GridGenerator::subdivided_hyper_rectangle(coarse, ncells2d,
                                                 p1, p2, true);
    }
    else
    {
       pcout << "Reading gmsh grid from file " << param->grid << std::endl;
-      GridIn<dim> grid_in;
-      grid_in.attach_triangulation(triangulation);
-      std::ifstream gfile(param->grid);
-      AssertThrow(gfile.is_open(), ExcMessage("Grid file not found"));
-      grid_in.read_msh(gfile);
+      // Cached grid is read into a serial triangulation and then copied
+      if(MeshCache::read_msh(param->grid, serial_triangulation,
+                             param->mesh_cache, mpi_comm))
+         pcout << "   Loaded grid from cache\n";
+      if(param->cell_order == "natural")
+         triangulation.copy_triangulation(serial_triangulation);
+   }
+
+   if(param->cell_order != "natural")
+   {
+      pcout << "   Ordering coarse cells along " << param->cell_order
+            << " curve\n";
+      Renumber::reorder_coarse_cells(serial_triangulation, triangulation,
+                                     param->cell_order);
    }
 
    if(problem->get_periodic())
@@ -339,17 +759,30 @@ DGSystem<dim>::make_grid_and_dofs()
    pcout << "   Transforming grid\n";
    problem->transform_grid(triangulation);
 
+   // Refined grid of a msh file is cached; p4est loads it on the coarse grid
+   // made above, see mesh_cache.h
    if(param->n_refine > 0)
    {
-      pcout << "   Refining initial grid\n";
-      triangulation.refine_global(param->n_refine);
+      const bool cache = param->mesh_cache &&
+                         param->grid != "user" && param->grid != "box";
+      const std::string cache_file
+         = cache ? MeshCache::refined_file_name(param->grid, dim,
+                                                param->n_refine,
+                                                problem->get_name() + "|" +
+                                                param->cell_order)
+                 : "";
+      if(cache && MeshCache::load_refined(cache_file, triangulation))
+      {
+         pcout << "   Loaded refined grid from cache\n";
+      }
+      else
+      {
+         pcout << "   Refining initial grid\n";
+         triangulation.refine_global(param->n_refine);
+         if(cache) MeshCache::save_refined(cache_file, triangulation);
+      }
    }
 
-   unsigned int counter = 0;
-   for(auto & cell : triangulation.active_cell_iterators())
-      if(cell->is_locally_owned() || cell->is_ghost())
-         cell->set_user_index(counter++);
-
    pcout << "   Number of active cells: "
          << triangulation.n_global_active_cells()
          << std::endl
@@ -359,6 +792,21 @@ DGSystem<dim>::make_grid_and_dofs()
 
    dof_handler.distribute_dofs(fe);
 
+   // Number dofs and cell data in the same order of cells
+   const auto owned_cells = (param->dof_order == "cuthill_mckee")
+                            ? Renumber::cuthill_mckee_cells(dof_handler)
+                            : Renumber::natural_cells(dof_handler);
+   if(param->dof_order == "cuthill_mckee")
+   {
+      pcout << "   Renumbering dofs by Cuthill-McKee ordering of cells\n";
+      DoFRenumbering::cell_wise(dof_handler, owned_cells);
+   }
+   const unsigned int counter = Renumber::set_user_indices(dof_handler,
+                                                           owned_cells);
+   const unsigned int n_ghost = Utilities::MPI::sum(counter - owned_cells.size(),
+                                                    mpi_comm);
+   pcout << "   Number of ghost cells (sum over ranks): " << n_ghost << "\n";
+
    pcout << "   Number of degrees of freedom: "
          << dof_handler.n_dofs()
          << std::endl;
@@ -373,7 +821,13 @@ DGSystem<dim>::make_grid_and_dofs()
    solution_old.reinit(locally_owned_dofs, mpi_comm);
    rhs.reinit(solution);
    imm.reinit(solution_old);
-   average.resize(counter, Vector<double>(nvar));
+   average.resize(counter, Vector<AccNumber>(nvar));
+   if(param->limiter_type == LimiterType::mood)
+   {
+      solution_stage.reinit(solution);
+      solution_stage.update_ghost_values(); // ghosts are copied in run()
+      average_stage.resize(counter, Vector<AccNumber>(nvar));
+   }
 
    // We dont have any constraints in DG.
    constraints.clear();
@@ -385,9 +839,9 @@ DGSystem<dim>::make_grid_and_dofs()
 // With Legendre basis, mass matrix is diagonal, we only store diagonal part.
 // Invert it and store
 //------------------------------------------------------------------------------
-template <int dim>
+template <int dim, typename Number, typename AccNumber>
 void
-DGSystem<dim>::assemble_mass_matrix()
+DGSystem<dim,Number,AccNumber>::assemble_mass_matrix()
 {
    pcout << "Constructing mass matrix ...\n";
    pcout << "  Quadrature using " << param->degree + 1 << " points\n";
@@ -397,7 +851,7 @@ DGSystem<dim>::assemble_mass_matrix()
                            update_values | update_JxW_values);
    const unsigned int   dofs_per_cell = fe.dofs_per_cell;
    const unsigned int   n_q_points    = quadrature_formula.size();
-   Vector<double>   cell_matrix(dofs_per_cell);
+   Vector<AccNumber>    cell_matrix(dofs_per_cell);
    std::vector<types::global_dof_index> dof_indices(dofs_per_cell);
 
    imm = 0.0;
@@ -432,9 +886,9 @@ DGSystem<dim>::assemble_mass_matrix()
 // Set initial conditions
 // L2 projection of initial condition onto dofs
 //------------------------------------------------------------------------------
-template <int dim>
+template <int dim, typename Number, typename AccNumber>
 void
-DGSystem<dim>::initialize()
+DGSystem<dim,Number,AccNumber>::initialize()
 {
    pcout << "Projecting initial condition ...\n";
 
@@ -472,22 +926,29 @@ DGSystem<dim>::initialize()
          }
       }
 
-      // Multiply by inverse mass matrix and add to rhs
+      // Multiply by inverse mass matrix. All dofs of a locally owned cell
+      // are locally owned.
       cell->get_dof_indices(dof_indices);
-      solution.add(dof_indices, cell_rhs);
+      for(unsigned int i = 0; i < dofs_per_cell; ++i)
+         solution(dof_indices[i]) = imm(dof_indices[i]) * cell_rhs(i);
    }
 
-   solution.compress(VectorOperation::add);
-   solution.scale(imm);
+   solution.compress(VectorOperation::insert);
 }
 
 //------------------------------------------------------------------------------
-template <int dim>
+template <int dim, typename Number, typename AccNumber>
 template <class Iterator>
-void DGSystem<dim>::cell_worker(const Iterator &cell,
-                                ScratchData<dim> &scratch_data,
-                                CopyData &copy_data)
+void DGSystem<dim,Number,AccNumber>::cell_worker(const Iterator &cell,
+                                                 Scratch &scratch_data,
+                                                 CopyData<AccNumber> &copy_data)
 {
+   if(tensor_basis)
+   {
+      cell_worker_tp(cell, scratch_data, copy_data);
+      return;
+   }
+
    FEValues<dim> &fe_values = scratch_data.fe_values;
    fe_values.reinit(cell);
 
@@ -502,16 +963,17 @@ void DGSystem<dim>::cell_worker(const Iterator &cell,
 
    for (unsigned int q = 0; q < n_q_points; ++q)
    {
-      FluxData<dim> data;
+      FluxData<dim,AccNumber> data;
       data.p = fe_values.quadrature_point(q);
-      data.t = stage_time;
-      ndarray<double,nvar,dim> flux;
-      PDE::physical_flux(solution_values[q], data, flux);
+      data.t = scratch_data.time;
+      ndarray<AccNumber,nvar,dim> flux;
+      PDE::physical_flux(to_precision(solution_values[q], scratch_data.work_l),
+                         data, flux);
       for (unsigned int i = 0; i < dofs_per_cell; ++i)
       {
          const auto c = fe_values.get_fe().system_to_component_index(i).first;
          const auto& shape_grad = fe_values.shape_grad_component(i,q,c);
-         double tmp = 0.0;
+         AccNumber tmp = 0.0;
          for(unsigned int d=0; d<dim; ++d) tmp += shape_grad[d] * flux[c][d];
          cell_rhs(i) += tmp * fe_values.JxW(q);
       }
@@ -520,17 +982,23 @@ void DGSystem<dim>::cell_worker(const Iterator &cell,
 }
 
 //------------------------------------------------------------------------------
-template <int dim>
+template <int dim, typename Number, typename AccNumber>
 template <class Iterator>
-void DGSystem<dim>::face_worker(const Iterator &cell,
-                                const unsigned int &f,
-                                const unsigned int &sf,
-                                const Iterator &ncell,
-                                const unsigned int &nf,
-                                const unsigned int &nsf,
-                                ScratchData<dim> &scratch_data,
-                                CopyData &copy_data)
+void DGSystem<dim,Number,AccNumber>::face_worker(const Iterator &cell,
+                                                 const unsigned int &f,
+                                                 const unsigned int &sf,
+                                                 const Iterator &ncell,
+                                                 const unsigned int &nf,
+                                                 const unsigned int &nsf,
+                                                 Scratch &scratch_data,
+                                                 CopyData<AccNumber> &copy_data)
 {
+   if(tensor_basis)
+   {
+      face_worker_tp(cell, f, ncell, nf, scratch_data, copy_data);
+      return;
+   }
+
    FEInterfaceValues<dim> &fe_face_values = scratch_data.fe_interface_values;
    fe_face_values.reinit(cell, f, sf, ncell, nf, nsf);
 
@@ -545,22 +1013,22 @@ void DGSystem<dim>::face_worker(const Iterator &cell,
    fe_face_values.get_fe_face_values(1).get_function_values(solution, right_state);
 
    copy_data.face_data.emplace_back();
-   CopyDataFace &copy_data_face = copy_data.face_data.back();
+   CopyDataFace<AccNumber> &copy_data_face = copy_data.face_data.back();
    copy_data_face.joint_dof_indices = fe_face_values.get_interface_dof_indices();
    copy_data_face.cell_rhs.reinit(n_face_dofs);
    auto &cell_rhs = copy_data_face.cell_rhs;
 
    for(unsigned int q=0; q<n_q_points; ++q)
    {
-      FluxData<dim> data;
+      FluxData<dim,AccNumber> data;
       data.p = q_points[q];
-      data.t = stage_time;
+      data.t = scratch_data.time;
       data.ul = &average[cell->user_index()];
       data.ur = &average[ncell->user_index()];
-      Vector<double> num_flux(nvar);
+      Vector<AccNumber> num_flux(nvar);
       PDE::numerical_flux(param->flux_type, 
-                          left_state[q], 
-                          right_state[q], 
+                          to_precision(left_state[q], scratch_data.work_l),
+                          to_precision(right_state[q], scratch_data.work_r),
                           fe_face_values.normal(q),
                           data,
                           num_flux);
@@ -576,13 +1044,19 @@ void DGSystem<dim>::face_worker(const Iterator &cell,
 }
 
 //------------------------------------------------------------------------------
-template <int dim>
+template <int dim, typename Number, typename AccNumber>
 template <class Iterator>
-void DGSystem<dim>::boundary_worker(const Iterator &cell,
-                                    const unsigned int &f,
-                                    ScratchData<dim> &scratch_data,
-                                    CopyData &copy_data)
+void DGSystem<dim,Number,AccNumber>::boundary_worker(const Iterator &cell,
+                                                     const unsigned int &f,
+                                                     Scratch &scratch_data,
+                                                     CopyData<AccNumber> &copy_data)
 {
+   if(tensor_basis)
+   {
+      boundary_worker_tp(cell, f, scratch_data, copy_data);
+      return;
+   }
+
    scratch_data.fe_interface_values.reinit(cell, f);
    const auto &fe_face_values 
       = scratch_data.fe_interface_values.get_fe_face_values(0);
@@ -592,26 +1066,26 @@ void DGSystem<dim>::boundary_worker(const Iterator &cell,
    const auto &q_points = fe_face_values.get_quadrature_points();
 
    auto &left_state = scratch_data.left_state;
-   auto &right_state = scratch_data.right_state;
    fe_face_values.get_function_values(solution, left_state);
    auto &cell_rhs = copy_data.cell_rhs;
+   auto &bc_out = scratch_data.bc_out;
 
    for (unsigned int q = 0; q < n_q_points; ++q)
    {
       problem->boundary_value(cell->face(f)->boundary_id(),
                               q_points[q],
-                              stage_time,
+                              scratch_data.time,
                               fe_face_values.normal_vector(q),
-                              left_state[q],
-                              right_state[q]);
-      FluxData<dim> data;
+                              to_precision(left_state[q], scratch_data.bc_in),
+                              bc_out);
+      FluxData<dim,AccNumber> data;
       data.p = q_points[q];
-      data.t = stage_time;
+      data.t = scratch_data.time;
       data.ul = &average[cell->user_index()];
       data.ur = &average[cell->user_index()];
-      Vector<double> num_flux(nvar);
-      PDE::boundary_flux(left_state[q], //todo
-                         right_state[q],
+      Vector<AccNumber> num_flux(nvar);
+      PDE::boundary_flux(to_precision(left_state[q], scratch_data.work_l), //todo
+                         to_precision(bc_out, scratch_data.work_r),
                          fe_face_values.normal_vector(q),
                          data,
                          num_flux);
@@ -625,20 +1099,261 @@ void DGSystem<dim>::boundary_worker(const Iterator &cell,
    }
 }
 
+//------------------------------------------------------------------------------
+// Modal coefficients of all components of cell, in AccNumber
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+template <class Iterator>
+void
+DGSystem<dim,Number,AccNumber>::read_coefficients(
+   const Iterator &cell,
+   std::vector<types::global_dof_index> &dof_indices,
+   std::vector<AccNumber> &coef) const
+{
+   dof_indices.resize(fe.dofs_per_cell);
+   cell->get_dof_indices(dof_indices);
+   coef.resize(fe.dofs_per_cell);
+   for(unsigned int i = 0; i < fe.dofs_per_cell; ++i)
+      coef[i] = solution(dof_indices[i]);
+}
+
+//------------------------------------------------------------------------------
+// Cell integral with sum factorization. Cells are rectangles, so the
+// quadrature points and gradients follow from the cell extents.
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+template <class Iterator>
+void DGSystem<dim,Number,AccNumber>::cell_worker_tp(const Iterator &cell,
+                                                    Scratch &scratch_data,
+                                                    CopyData<AccNumber> &copy_data)
+{
+   const auto& b = basis_1d;
+   const unsigned int n_q = b.n_q * b.n_q;
+   const auto p0 = cell->vertex(0);
+   const double hx = cell->vertex(1)[0] - p0[0];
+   const double hy = cell->vertex(2)[1] - p0[1];
+   Assert(hx > 0 && hy > 0, ExcMessage("Cell is not in standard orientation"));
+
+   copy_data.cell_rhs.reinit(fe.dofs_per_cell);
+   auto &coef = scratch_data.coef_l;
+   auto &values = scratch_data.values_l;
+   read_coefficients(cell, copy_data.local_dof_indices, coef);
+
+   values.resize(nvar * n_q);
+   scratch_data.flux_x.resize(nvar * n_q);
+   scratch_data.flux_y.resize(nvar * n_q);
+   for(unsigned int c = 0; c < nvar; ++c)
+      TensorProduct::evaluate_cell(b, &coef[c * dofs_per_comp],
+                                   &values[c * n_q], scratch_data.tmp);
+
+   auto &state = scratch_data.work_l;
+   for(unsigned int qy = 0, q = 0; qy < b.n_q; ++qy)
+      for(unsigned int qx = 0; qx < b.n_q; ++qx, ++q)
+      {
+         for(unsigned int c = 0; c < nvar; ++c)
+            state[c] = values[c * n_q + q];
+         FluxData<dim,AccNumber> data;
+         data.p = Point<dim>(p0[0] + b.points[qx] * hx, p0[1] + b.points[qy] * hy);
+         data.t = scratch_data.time;
+         ndarray<AccNumber,nvar,dim> flux;
+         PDE::physical_flux(state, data, flux);
+         for(unsigned int c = 0; c < nvar; ++c)
+         {
+            scratch_data.flux_x[c * n_q + q] = flux[c][0];
+            scratch_data.flux_y[c * n_q + q] = flux[c][1];
+         }
+      }
+
+   for(unsigned int c = 0; c < nvar; ++c)
+      TensorProduct::integrate_cell(b,
+                                    &scratch_data.flux_x[c * n_q],
+                                    &scratch_data.flux_y[c * n_q],
+                                    hx, hy,
+                                    copy_data.cell_rhs.begin() + c * dofs_per_comp,
+                                    scratch_data.tmp);
+}
+
+//------------------------------------------------------------------------------
+// Interior face with sum factorization. On a conforming Cartesian grid, the
+// face points of both cells are ordered along the same tangential direction.
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+template <class Iterator>
+void DGSystem<dim,Number,AccNumber>::face_worker_tp(const Iterator &cell,
+                                                    const unsigned int &f,
+                                                    const Iterator &ncell,
+                                                    const unsigned int &nf,
+                                                    Scratch &scratch_data,
+                                                    CopyData<AccNumber> &copy_data)
+{
+   const auto& b = basis_1d;
+   const unsigned int n_q = b.n_q;
+   const unsigned int n_cell_dofs = fe.dofs_per_cell;
+   const auto p0 = cell->vertex(0);
+   const double hx = cell->vertex(1)[0] - p0[0];
+   const double hy = cell->vertex(2)[1] - p0[1];
+   const unsigned int d = f / 2; // normal direction
+   const double length = (d == 0) ? hy : hx;
+   Tensor<1,dim> normal;
+   normal[d] = (f % 2 == 0) ? -1.0 : 1.0;
+
+   copy_data.face_data.emplace_back();
+   CopyDataFace<AccNumber> &copy_data_face = copy_data.face_data.back();
+   auto &dof_indices = copy_data_face.joint_dof_indices;
+   std::vector<types::global_dof_index> ndof_indices;
+   auto &coef_l = scratch_data.coef_l;
+   auto &coef_r = scratch_data.coef_r;
+   read_coefficients(cell, dof_indices, coef_l);
+   read_coefficients(ncell, ndof_indices, coef_r);
+   dof_indices.insert(dof_indices.end(), ndof_indices.begin(), ndof_indices.end());
+
+   auto &ul = scratch_data.values_l;
+   auto &ur = scratch_data.values_r;
+   ul.resize(nvar * n_q);
+   ur.resize(nvar * n_q);
+   for(unsigned int c = 0; c < nvar; ++c)
+   {
+      TensorProduct::evaluate_face(b, f, &coef_l[c * dofs_per_comp],
+                                   &ul[c * n_q], scratch_data.tmp);
+      TensorProduct::evaluate_face(b, nf, &coef_r[c * dofs_per_comp],
+                                   &ur[c * n_q], scratch_data.tmp);
+   }
+
+   // Flux times face length, stored in flux_x for the cell and flux_y for
+   // the neighbour, which sees it with opposite sign
+   auto &gl = scratch_data.flux_x;
+   auto &gr = scratch_data.flux_y;
+   gl.resize(nvar * n_q);
+   gr.resize(nvar * n_q);
+   auto &left_state = scratch_data.work_l;
+   auto &right_state = scratch_data.work_r;
+   for(unsigned int q = 0; q < n_q; ++q)
+   {
+      for(unsigned int c = 0; c < nvar; ++c)
+      {
+         left_state[c] = ul[c * n_q + q];
+         right_state[c] = ur[c * n_q + q];
+      }
+      FluxData<dim,AccNumber> data;
+      data.p = p0;
+      data.p[d] += (f % 2) * ((d == 0) ? hx : hy);
+      data.p[1-d] += b.points[q] * length;
+      data.t = scratch_data.time;
+      data.ul = &average[cell->user_index()];
+      data.ur = &average[ncell->user_index()];
+      Vector<AccNumber> num_flux(nvar);
+      PDE::numerical_flux(param->flux_type, left_state, right_state, normal,
+                          data, num_flux);
+      for(unsigned int c = 0; c < nvar; ++c)
+      {
+         gl[c * n_q + q] = -num_flux[c] * length;
+         gr[c * n_q + q] =  num_flux[c] * length;
+      }
+   }
+
+   copy_data_face.cell_rhs.reinit(2 * n_cell_dofs);
+   auto &cell_rhs = copy_data_face.cell_rhs;
+   for(unsigned int c = 0; c < nvar; ++c)
+   {
+      TensorProduct::integrate_face(b, f, &gl[c * n_q],
+                                    cell_rhs.begin() + c * dofs_per_comp,
+                                    scratch_data.tmp);
+      TensorProduct::integrate_face(b, nf, &gr[c * n_q],
+                                    cell_rhs.begin() + n_cell_dofs
+                                    + c * dofs_per_comp,
+                                    scratch_data.tmp);
+   }
+}
+
+//------------------------------------------------------------------------------
+// Boundary face with sum factorization
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+template <class Iterator>
+void DGSystem<dim,Number,AccNumber>::boundary_worker_tp(const Iterator &cell,
+                                                        const unsigned int &f,
+                                                        Scratch &scratch_data,
+                                                        CopyData<AccNumber> &copy_data)
+{
+   const auto& b = basis_1d;
+   const unsigned int n_q = b.n_q;
+   const auto p0 = cell->vertex(0);
+   const double hx = cell->vertex(1)[0] - p0[0];
+   const double hy = cell->vertex(2)[1] - p0[1];
+   const unsigned int d = f / 2;
+   const double length = (d == 0) ? hy : hx;
+   Tensor<1,dim> normal;
+   normal[d] = (f % 2 == 0) ? -1.0 : 1.0;
+
+   std::vector<types::global_dof_index> dof_indices;
+   auto &coef = scratch_data.coef_r;
+   read_coefficients(cell, dof_indices, coef);
+
+   auto &ul = scratch_data.values_l;
+   ul.resize(nvar * n_q);
+   for(unsigned int c = 0; c < nvar; ++c)
+      TensorProduct::evaluate_face(b, f, &coef[c * dofs_per_comp],
+                                   &ul[c * n_q], scratch_data.tmp);
+
+   auto &g = scratch_data.flux_x;
+   g.resize(nvar * n_q);
+   auto &bc_in = scratch_data.bc_in;
+   auto &bc_out = scratch_data.bc_out;
+   for(unsigned int q = 0; q < n_q; ++q)
+   {
+      for(unsigned int c = 0; c < nvar; ++c)
+      {
+         scratch_data.work_l[c] = ul[c * n_q + q];
+         bc_in[c] = ul[c * n_q + q];
+      }
+      Point<dim> p = p0;
+      p[d] += (f % 2) * ((d == 0) ? hx : hy);
+      p[1-d] += b.points[q] * length;
+      problem->boundary_value(cell->face(f)->boundary_id(),
+                              p,
+                              scratch_data.time,
+                              normal,
+                              bc_in,
+                              bc_out);
+      FluxData<dim,AccNumber> data;
+      data.p = p;
+      data.t = scratch_data.time;
+      data.ul = &average[cell->user_index()];
+      data.ur = &average[cell->user_index()];
+      Vector<AccNumber> num_flux(nvar);
+      PDE::boundary_flux(scratch_data.work_l,
+                         to_precision(bc_out, scratch_data.work_r),
+                         normal,
+                         data,
+                         num_flux);
+      for(unsigned int c = 0; c < nvar; ++c)
+         g[c * n_q + q] = -num_flux[c] * length;
+   }
+
+   for(unsigned int c = 0; c < nvar; ++c)
+      TensorProduct::integrate_face(b, f, &g[c * n_q],
+                                    copy_data.cell_rhs.begin() + c * dofs_per_comp,
+                                    scratch_data.tmp);
+}
+
 //------------------------------------------------------------------------------
 // Assemble system rhs
 //------------------------------------------------------------------------------
-template <int dim>
+template <int dim, typename Number, typename AccNumber>
 void
-DGSystem<dim>::assemble_rhs()
+DGSystem<dim,Number,AccNumber>::assemble_rhs()
 {
+   TimerOutput::Scope scope(computing_timer, "Assemble rhs");
+
    using Iterator = typename DoFHandler<dim>::active_cell_iterator;
+   const bool trace_workers = param->trace_workers;
 
    auto cell_worker =
        [&](const Iterator &cell,
-           ScratchData<dim> &scratch_data,
-           CopyData &copy_data)
+           Scratch &scratch_data,
+           CopyData<AccNumber> &copy_data)
    {
+      EventTrace::Tracer::Scope trace(tracer, "cell", trace_workers);
       this->cell_worker(cell, scratch_data, copy_data);
    };
 
@@ -649,22 +1364,24 @@ DGSystem<dim>::assemble_rhs()
            const Iterator &ncell,
            const unsigned int nf,
            const unsigned int nsf,
-           ScratchData<dim> &scratch_data,
-           CopyData &copy_data)
+           Scratch &scratch_data,
+           CopyData<AccNumber> &copy_data)
    {
+      EventTrace::Tracer::Scope trace(tracer, "face", trace_workers);
       this->face_worker(cell, f, sf, ncell, nf, nsf, scratch_data, copy_data);
    };
 
    auto boundary_worker =
        [&](const Iterator &cell,
            const unsigned int f,
-           ScratchData<dim> &scratch_data,
-           CopyData &copy_data)
+           Scratch &scratch_data,
+           CopyData<AccNumber> &copy_data)
    {
+      EventTrace::Tracer::Scope trace(tracer, "boundary", trace_workers);
       this->boundary_worker(cell, f, scratch_data, copy_data);
    };
 
-   auto copier = [&](const CopyData &cd)
+   auto copier = [&](const CopyData<AccNumber> &cd)
    {
       this->constraints.distribute_local_to_global(cd.cell_rhs,
                                                    cd.local_dof_indices,
@@ -681,30 +1398,68 @@ DGSystem<dim>::assemble_rhs()
    const QGauss<dim> cell_quadrature(n_gauss_points);
    const QGauss<dim-1> face_quadrature(n_gauss_points);
 
-   ScratchData<dim> scratch_data(mapping,
-                                 fe,
-                                 cell_quadrature,
-                                 face_quadrature);
+   Scratch scratch_data(mapping,
+                        fe,
+                        cell_quadrature,
+                        face_quadrature);
+   scratch_data.time = stage_time;
 
    const auto iterator_range =
         filter_iterators(dof_handler.active_cell_iterators(),
                          IteratorFilters::LocallyOwnedCell());
 
+   const auto face_flags = MeshWorker::assemble_boundary_faces |
+                           MeshWorker::assemble_own_interior_faces_once |
+                           MeshWorker::assemble_ghost_faces_once;
+
    rhs = 0.0;
-   MeshWorker::mesh_loop(iterator_range,
-                         cell_worker,
-                         copier,
-                         scratch_data,
-                         CopyData(),
-                         MeshWorker::assemble_own_cells |
-                         MeshWorker::assemble_boundary_faces |
-                         MeshWorker::assemble_own_interior_faces_once |
-                         MeshWorker::assemble_ghost_faces_once,
-                         boundary_worker,
-                         face_worker);
+   if(!tracer.is_enabled())
+      MeshWorker::mesh_loop(iterator_range,
+                            cell_worker,
+                            copier,
+                            scratch_data,
+                            CopyData<AccNumber>(),
+                            MeshWorker::assemble_own_cells | face_flags,
+                            boundary_worker,
+                            face_worker);
+   else
+   {
+      // Separate loops over cells and faces so that the trace shows them
+      // apart; the cell worker of the face loop only sizes copy_data.
+      auto size_worker =
+          [&](const Iterator &cell,
+              Scratch &,
+              CopyData<AccNumber> &copy_data)
+      {
+         copy_data.reinit(cell, fe.n_dofs_per_cell());
+      };
+      {
+         EventTrace::Tracer::Scope trace(tracer, "Cell loop");
+         MeshWorker::mesh_loop(iterator_range,
+                               cell_worker,
+                               copier,
+                               scratch_data,
+                               CopyData<AccNumber>(),
+                               MeshWorker::assemble_own_cells);
+      }
+      {
+         EventTrace::Tracer::Scope trace(tracer, "Face loop");
+         MeshWorker::mesh_loop(iterator_range,
+                               size_worker,
+                               copier,
+                               scratch_data,
+                               CopyData<AccNumber>(),
+                               MeshWorker::assemble_own_cells | face_flags,
+                               boundary_worker,
+                               face_worker);
+      }
+   }
 
    // Reduce over all MPI ranks
-   rhs.compress(VectorOperation::add);
+   {
+      EventTrace::Tracer::Scope trace(tracer, "Compress");
+      rhs.compress(VectorOperation::add);
+   }
 
    // Multiply by inverse mass matrix
    rhs.scale(imm);
@@ -713,15 +1468,27 @@ DGSystem<dim>::assemble_rhs()
 //------------------------------------------------------------------------------
 // Compute cell average values
 //------------------------------------------------------------------------------
-template <int dim>
+template <int dim, typename Number, typename AccNumber>
+void
+DGSystem<dim,Number,AccNumber>::compute_averages()
+{
+   TimerOutput::Scope scope(computing_timer, "Compute averages");
+   EventTrace::Tracer::Scope trace(tracer, "Averages");
+   compute_averages(dof_handler.active_cell_iterators());
+}
+
+//------------------------------------------------------------------------------
+// Averages of the locally owned and ghost cells among cells
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+template <typename Range>
 void
-DGSystem<dim>::compute_averages()
+DGSystem<dim,Number,AccNumber>::compute_averages(const Range& cells)
 {
    const unsigned int   dofs_per_cell = fe.dofs_per_cell;
    std::vector<types::global_dof_index> dof_indices(dofs_per_cell);
-   const unsigned int dofs_per_comp = ((param->degree + 1)* (param->degree + 2)) / 2;
 
-   for(auto & cell : dof_handler.active_cell_iterators())
+   for(const auto & cell : cells)
    if(cell->is_locally_owned() || cell->is_ghost())
    {
       cell->get_dof_indices(dof_indices);
@@ -736,24 +1503,31 @@ DGSystem<dim>::compute_averages()
 // Apply TVD limiter: 2d case only
 // TODO: Make it work on locally refined grids
 //------------------------------------------------------------------------------
-template <>
+template <int dim, typename Number, typename AccNumber>
 void
-DGSystem<2>::apply_TVD_limiter()
+DGSystem<dim,Number,AccNumber>::apply_TVD_limiter()
 {
    if(param->degree == 0) return;
+   apply_TVD_limiter(dof_handler.active_cell_iterators());
+}
 
-   const double sqrt_3 = std::sqrt(3.0);
+//------------------------------------------------------------------------------
+// TVD limiter on the locally owned cells among cells; reads the averages of
+// their face neighbours
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+template <typename Range>
+void
+DGSystem<dim,Number,AccNumber>::apply_TVD_limiter(const Range& cells)
+{
    const unsigned int   dofs_per_cell = fe.dofs_per_cell;
    std::vector<types::global_dof_index> dof_indices(dofs_per_cell);
    const unsigned int degree = param->degree;
-   const unsigned int dofs_per_comp = ((degree+1)*(degree+2))/2;
-   Vector<double> dbx(nvar), dfx(nvar), Dx(nvar), Dx_new(nvar);
-   Vector<double> dby(nvar), dfy(nvar), Dy(nvar), Dy_new(nvar);
-   Vector<double> dbx1(nvar), dfx1(nvar), Dx1(nvar), Dx1_new(nvar);
-   Vector<double> dby1(nvar), dfy1(nvar), Dy1(nvar), Dy1_new(nvar);
-   FullMatrix<double> Rx(nvar,nvar), Lx(nvar,nvar), Ry(nvar,nvar), Ly(nvar,nvar);
+   Vector<AccNumber> dbx(nvar), dfx(nvar), Dx(nvar);
+   Vector<AccNumber> dby(nvar), dfy(nvar), Dy(nvar);
+   TVDScratch<AccNumber> scratch(nvar);
 
-   for(auto & cell : dof_handler.active_cell_iterators())
+   for(const auto & cell : cells)
    if(cell->is_locally_owned())
    {
       double dx, dy;
@@ -817,63 +1591,379 @@ DGSystem<2>::apply_TVD_limiter()
          Dy[i] = solution(dof_indices[j+degree+1]);
       }
 
-      // TODO: Transform to characteristic
       const auto drx = cell->face(1)->center() - cell->face(0)->center();
       const auto ex = drx / drx.norm();
       const auto dry = cell->face(3)->center() - cell->face(2)->center();
       const auto ey = dry / dry.norm();
-      PDE::char_mat(average[c], cell->center(), ex, ey, Rx, Lx, Ry, Ly);
-      Lx.vmult(dbx1, dbx);
-      Lx.vmult(dfx1, dfx);
-      Lx.vmult(Dx1,  Dx);
-      Ly.vmult(dby1, dby);
-      Ly.vmult(dfy1, dfy);
-      Ly.vmult(Dy1,  Dy);
-
-      bool tolimit = false;
-      for(unsigned int i=0; i<nvar; ++i)
-      {
-         Dx1_new[i] = minmod(sqrt_3 * Dx1[i], dbx1[i], dfx1[i], Mh2) / sqrt_3;
-         Dy1_new[i] = minmod(sqrt_3 * Dy1[i], dby1[i], dfy1[i], Mh2) / sqrt_3;
-         if(fabs(Dx1[i] - Dx1_new[i]) > 1.0e-6 * fabs(Dx1[i]) || 
-            fabs(Dy1[i] - Dy1_new[i]) > 1.0e-6 * fabs(Dy1[i]))
-            tolimit = true;
-      }
-
-      if(tolimit)
+      if(tvd_limit_slopes(average[c], cell->center(), ex, ey,
+                          dbx, dfx, dby, dfy, Mh2, Dx, Dy, scratch))
       {
-         Rx.vmult(Dx_new, Dx1_new);
-         Ry.vmult(Dy_new, Dy1_new);
          for(unsigned int i = 0; i < dofs_per_cell; ++i)
             solution(dof_indices[i]) = 0;
          for(unsigned int i=0, j=0; i<nvar; ++i, j+=dofs_per_comp)
          {
             solution(dof_indices[j]) = average[c][i];
-            solution(dof_indices[j+1]) = Dx_new[i];
-            solution(dof_indices[j+degree+1]) = Dy_new[i];
+            solution(dof_indices[j+1]) = Dx[i];
+            solution(dof_indices[j+degree+1]) = Dy[i];
          }
       }
    }
 }
 
 //------------------------------------------------------------------------------
-// Apply TVD limiter
+// Exponential modal filter: mode of degree m is multiplied by
+//    exp(-alpha * (m/k)^order)
+// and alpha = filter strength * eps, where eps in [0,1] comes from the decay of
+// the modal energy, as in the shock sensor of Persson and Peraire. Smooth
+// cells are not filtered. The cell average is not changed, and no neighbour
+// data is needed.
 //------------------------------------------------------------------------------
-template <int dim>
+template <int dim, typename Number, typename AccNumber>
 void
-DGSystem<dim>::apply_limiter()
+DGSystem<dim,Number,AccNumber>::apply_filter()
 {
-   if(param->degree == 0 || param->limiter_type == LimiterType::none) return;
-   apply_TVD_limiter();
+   if(param->degree == 0 || param->limiter_type != LimiterType::filter) return;
+
+   TimerOutput::Scope scope(computing_timer, "Filter");
+   EventTrace::Tracer::Scope trace(tracer, "Filter");
+   apply_filter(dof_handler.active_cell_iterators());
 }
 
 //------------------------------------------------------------------------------
-// Compute time step from cfl condition
+// Filter the locally owned cells among cells
 //------------------------------------------------------------------------------
-template <int dim>
+template <int dim, typename Number, typename AccNumber>
+template <typename Range>
 void
-DGSystem<dim>::compute_dt()
+DGSystem<dim,Number,AccNumber>::apply_filter(const Range& cells)
 {
+   std::vector<types::global_dof_index> dof_indices(fe.dofs_per_cell);
+   std::vector<double> sigma(dofs_per_comp);
+
+   for(const auto & cell : cells)
+   if(cell->is_locally_owned())
+   {
+      cell->get_dof_indices(dof_indices);
+      filter_cell(*param, filter_eta, top_mode, nvar, dofs_per_comp, sigma,
+                  [&](const unsigned int k) -> Number&
+                  { return solution(dof_indices[k]); });
+   }
+}
+
+//------------------------------------------------------------------------------
+// Subcell averages and face traces of the modes on the reference cell
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+void
+DGSystem<dim,Number,AccNumber>::setup_subcells()
+{
+   const unsigned int n = param->degree + 1;
+   const QGauss<1> quad(n);
+   const auto& fe_base = fe.base_element(0);
+
+   subcell_width.resize(n);
+   gauss_point.resize(n);
+   subcell_edge.assign(n + 1, 0.0);
+   auto& x0 = subcell_edge;
+   for(unsigned int i = 0; i < n; ++i)
+   {
+      subcell_width[i] = quad.weight(i);
+      gauss_point[i] = quad.point(i)[0];
+      x0[i + 1] = x0[i] + quad.weight(i);
+   }
+
+   subcell_matrix.reinit(n * n, dofs_per_comp);
+   mode_norm.assign(dofs_per_comp, 0.0);
+   for(unsigned int j = 0; j < n; ++j)
+      for(unsigned int i = 0; i < n; ++i)
+         for(unsigned int qy = 0; qy < n; ++qy)
+            for(unsigned int qx = 0; qx < n; ++qx)
+            {
+               const Point<dim> p(x0[i] + quad.point(qx)[0] * subcell_width[i],
+                                  x0[j] + quad.point(qy)[0] * subcell_width[j]);
+               const double w = quad.weight(qx) * quad.weight(qy);
+               for(unsigned int m = 0; m < dofs_per_comp; ++m)
+               {
+                  const double phi = fe_base.shape_value(m, p);
+                  subcell_matrix(i + n * j, m) += w * phi;
+                  mode_norm[m] += w * subcell_width[i] * subcell_width[j]
+                                  * phi * phi;
+               }
+            }
+
+   face_basis.reinit(4, n, dofs_per_comp);
+   for(unsigned int f = 0; f < 4; ++f)
+      for(unsigned int q = 0; q < n; ++q)
+      {
+         const double s = quad.point(q)[0];
+         const Point<dim> p = (f < 2) ? Point<dim>(f % 2, s)
+                                      : Point<dim>(s, f % 2);
+         for(unsigned int m = 0; m < dofs_per_comp; ++m)
+            face_basis(f, q, m) = fe_base.shape_value(m, p);
+      }
+
+   // First order scheme on subcells needs cfl <= smallest width
+   const double w_min = *std::min_element(subcell_width.begin(),
+                                          subcell_width.end());
+   if(param->cfl > w_min)
+      pcout << "Warning: cfl = " << param->cfl << " is larger than smallest "
+            << "subcell width " << w_min << "\n";
+}
+
+//------------------------------------------------------------------------------
+// Averages of u on the subcells of cell
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+template <class Iterator>
+void
+DGSystem<dim,Number,AccNumber>::subcell_averages(
+   const PVector& u,
+   const Iterator& cell,
+   std::vector<types::global_dof_index>& dof_indices,
+   std::vector<Vector<AccNumber>>& ub) const
+{
+   cell->get_dof_indices(dof_indices);
+   for(unsigned int s = 0; s < ub.size(); ++s)
+      for(unsigned int c = 0; c < nvar; ++c)
+      {
+         AccNumber v = 0;
+         for(unsigned int m = 0; m < dofs_per_comp; ++m)
+            v += subcell_matrix(s, m) * u(dof_indices[c * dofs_per_comp + m]);
+         ub[s][c] = v;
+      }
+}
+
+//------------------------------------------------------------------------------
+// Trace of stage solution at Gauss point q of face f of cell
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+template <class Iterator>
+void
+DGSystem<dim,Number,AccNumber>::face_trace(
+   const Iterator& cell,
+   const unsigned int f,
+   const unsigned int q,
+   std::vector<types::global_dof_index>& dof_indices,
+   Vector<AccNumber>& state) const
+{
+   cell->get_dof_indices(dof_indices);
+   for(unsigned int c = 0; c < nvar; ++c)
+   {
+      AccNumber v = 0;
+      for(unsigned int m = 0; m < dofs_per_comp; ++m)
+         v += face_basis(f, q, m)
+              * solution_stage(dof_indices[c * dofs_per_comp + m]);
+      state[c] = v;
+   }
+}
+
+//------------------------------------------------------------------------------
+// A posteriori subcell limiting (MOOD). The candidate solution of a stage is
+// checked in each cell; if a subcell average is not admissible or violates
+// the discrete maximum principle of the first variable w.r.t. the stage
+// averages of the cell and its face neighbours, the cell is recomputed from
+// the stage data by a first order finite volume scheme on its subcells. On
+// the cell faces, the DG numerical flux at the Gauss points is used, which
+// keeps the scheme conservative. The result is L2 projected back to the
+// modes. Work is done only for the cells in troubled_cells.
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+void
+DGSystem<dim,Number,AccNumber>::apply_subcell_fallback(const unsigned int rk_stage)
+{
+   if(param->degree == 0) return;
+
+   TimerOutput::Scope scope(computing_timer, "Subcell fallback");
+   EventTrace::Tracer::Scope trace(tracer, "Subcell fallback");
+
+   const unsigned int n = param->degree + 1;
+   const unsigned int n_sub = n * n;
+   std::vector<types::global_dof_index> dof_indices(fe.dofs_per_cell);
+   std::vector<Vector<AccNumber>> ub(n_sub, Vector<AccNumber>(nvar));
+
+   // Detect troubled cells
+   troubled_cells.clear();
+   for(auto & cell : dof_handler.active_cell_iterators())
+   if(cell->is_locally_owned())
+   {
+      AccNumber u_min = average_stage[cell->user_index()][0];
+      AccNumber u_max = u_min;
+      for(const unsigned int f : cell->face_indices())
+         if(!cell->at_boundary(f) || cell->has_periodic_neighbor(f))
+         {
+            const auto c = cell->neighbor_or_periodic_neighbor(f)->user_index();
+            u_min = std::min(u_min, average_stage[c][0]);
+            u_max = std::max(u_max, average_stage[c][0]);
+         }
+      const AccNumber delta = std::max<AccNumber>(1.0e-4, 1.0e-3 * (u_max - u_min));
+
+      subcell_averages(solution, cell, dof_indices, ub);
+      for(unsigned int s = 0; s < n_sub; ++s)
+         if(!PDE::is_admissible<dim>(ub[s]) ||
+            ub[s][0] < u_min - delta || ub[s][0] > u_max + delta)
+         {
+            troubled_cells.push_back(cell);
+            break;
+         }
+   }
+
+   // Recompute troubled cells on subcells
+   std::vector<Vector<AccNumber>> ub_old(n_sub, Vector<AccNumber>(nvar));
+   std::vector<Vector<AccNumber>> res(n_sub, Vector<AccNumber>(nvar));
+   std::vector<types::global_dof_index> ndof_indices(fe.dofs_per_cell);
+   Vector<AccNumber> ul(nvar), ur(nvar), num_flux(nvar);
+   Vector<double> bc_in(nvar), bc_out(nvar);
+   for(const auto& cell : troubled_cells)
+   {
+      const auto p0 = cell->vertex(0);
+      const double hx = cell->vertex(1)[0] - p0[0];
+      const double hy = cell->vertex(2)[1] - p0[1];
+      const auto& w = subcell_width;
+
+      subcell_averages(solution_old, cell, dof_indices, ub_old);
+      subcell_averages(solution_stage, cell, dof_indices, ub);
+      for(auto& r : res) r = 0;
+
+      FluxData<dim,AccNumber> data;
+      data.t = stage_time;
+      data.ul = &average_stage[cell->user_index()];
+      data.ur = data.ul;
+
+      // Interior subcell faces
+      for(unsigned int d = 0; d < dim; ++d)
+      {
+         Tensor<1,dim> normal;
+         normal[d] = 1.0;
+         const double h_n = (d == 0) ? hx : hy; // normal and tangential size
+         const double h_t = (d == 0) ? hy : hx;
+         for(unsigned int k = 0; k < n; ++k)
+            for(unsigned int l = 0; l + 1 < n; ++l)
+            {
+               const unsigned int sl = (d == 0) ? l + n * k : k + n * l;
+               const unsigned int sr = (d == 0) ? sl + 1 : sl + n;
+               const double length = w[k] * h_t;
+               data.p = p0;
+               data.p[d] += subcell_edge[l + 1] * h_n;
+               data.p[1-d] += (subcell_edge[k] + 0.5 * w[k]) * h_t;
+               PDE::numerical_flux(param->flux_type, ub[sl], ub[sr], normal,
+                                   data, num_flux);
+               res[sl].add(-length, num_flux);
+               res[sr].add( length, num_flux);
+            }
+      }
+
+      // Cell faces with the DG flux at Gauss points
+      for(const unsigned int f : cell->face_indices())
+      {
+         const unsigned int d = f / 2;
+         const double length = (d == 0) ? hy : hx;
+         Tensor<1,dim> normal;
+         normal[d] = (f % 2 == 0) ? -1.0 : 1.0;
+         const bool boundary = cell->at_boundary(f) &&
+                               !cell->has_periodic_neighbor(f);
+         for(unsigned int q = 0; q < n; ++q)
+         {
+            Point<dim> p = p0;
+            p[d] += (f % 2) * ((d == 0) ? hx : hy);
+            p[1-d] += gauss_point[q] * length;
+            face_trace(cell, f, q, dof_indices, ul);
+            data.p = p;
+            if(boundary)
+            {
+               for(unsigned int c = 0; c < nvar; ++c) bc_in[c] = ul[c];
+               problem->boundary_value(cell->face(f)->boundary_id(), p,
+                                       stage_time, normal, bc_in, bc_out);
+               data.ur = data.ul;
+               PDE::boundary_flux(ul, to_precision(bc_out, ur), normal, data,
+                                  num_flux);
+            }
+            else
+            {
+               const auto ncell = cell->neighbor_or_periodic_neighbor(f);
+               const unsigned int nf = cell->has_periodic_neighbor(f)
+                                       ? cell->periodic_neighbor_face_no(f)
+                                       : cell->neighbor_face_no(f);
+               face_trace(ncell, nf, q, ndof_indices, ur);
+               data.ur = &average_stage[ncell->user_index()];
+               PDE::numerical_flux(param->flux_type, ul, ur, normal, data,
+                                   num_flux);
+            }
+            const unsigned int s = (f == 0) ? n * q
+                                 : (f == 1) ? n - 1 + n * q
+                                 : (f == 2) ? q
+                                 : q + n * (n - 1);
+            res[s].add(-w[q] * length, num_flux);
+         }
+         data.ur = data.ul;
+      }
+
+      // Stage update of subcell averages, as in update()
+      for(unsigned int j = 0; j < n; ++j)
+         for(unsigned int i = 0; i < n; ++i)
+         {
+            const unsigned int s = i + n * j;
+            const double area = w[i] * w[j] * hx * hy;
+            for(unsigned int c = 0; c < nvar; ++c)
+               ub[s][c] = a_rk[rk_stage] * ub_old[s][c]
+                          + b_rk[rk_stage] * (ub[s][c] + dt * res[s][c] / area);
+         }
+
+      // L2 projection to modes
+      cell->get_dof_indices(dof_indices);
+      for(unsigned int c = 0; c < nvar; ++c)
+         for(unsigned int m = 0; m < dofs_per_comp; ++m)
+         {
+            AccNumber v = 0;
+            for(unsigned int j = 0; j < n; ++j)
+               for(unsigned int i = 0; i < n; ++i)
+                  v += w[i] * w[j] * subcell_matrix(i + n * j, m)
+                       * ub[i + n * j][c];
+            solution(dof_indices[c * dofs_per_comp + m]) = v / mode_norm[m];
+         }
+   }
+
+   // Ghosts and averages of recomputed cells are out of date
+   const unsigned int n_troubled_stage = Utilities::MPI::sum(troubled_cells.size(),
+                                                             mpi_comm);
+   n_troubled += n_troubled_stage;
+   if(n_troubled_stage > 0)
+   {
+      {
+         EventTrace::Tracer::Scope trace(tracer, "Ghost exchange");
+         solution.update_ghost_values();
+      }
+      compute_averages();
+   }
+}
+
+//------------------------------------------------------------------------------
+// Apply TVD limiter
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+void
+DGSystem<dim,Number,AccNumber>::apply_limiter()
+{
+   TimerOutput::Scope scope(computing_timer, "Limiter");
+   EventTrace::Tracer::Scope trace(tracer, "Limiter");
+
+   if(param->degree == 0 || param->limiter_type != LimiterType::tvd) return;
+   apply_TVD_limiter();
+
+   // Next rhs needs the limited solution in ghost cells
+   EventTrace::Tracer::Scope trace_ghost(tracer, "Ghost exchange");
+   solution.update_ghost_values();
+}
+
+//------------------------------------------------------------------------------
+// Compute time step from cfl condition
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+void
+DGSystem<dim,Number,AccNumber>::compute_dt()
+{
+   TimerOutput::Scope scope(computing_timer, "Compute dt");
+   EventTrace::Tracer::Scope trace(tracer, "Compute dt");
+
    dt = 1.0e20;
 
    for(auto &cell : dof_handler.active_cell_iterators())
@@ -889,7 +1979,10 @@ DGSystem<dim>::compute_dt()
    }
 
    dt *= param->cfl;
-   dt = Utilities::MPI::min(dt, mpi_comm);
+   {
+      EventTrace::Tracer::Scope trace_min(tracer, "dt reduction");
+      dt = Utilities::MPI::min(dt, mpi_comm);
+   }
 
    if (time + dt > param->final_time)
    {
@@ -905,54 +1998,394 @@ DGSystem<dim>::compute_dt()
 //------------------------------------------------------------------------------
 // Update solution by one stage of RK
 //------------------------------------------------------------------------------
-template <int dim>
+template <int dim, typename Number, typename AccNumber>
 void
-DGSystem<dim>::update(const unsigned int rk_stage)
+DGSystem<dim,Number,AccNumber>::update(const unsigned int rk_stage)
 {
-   // solution = solution + dt * rhs
-   solution.add(dt, rhs);
+   TimerOutput::Scope scope(computing_timer, "Update");
+   EventTrace::Tracer::Scope trace(tracer, "Update");
 
-   // solution = b_rk * solution + a_rk * solution_old
-   solution.sadd(b_rk[rk_stage], a_rk[rk_stage], solution_old);
+   // solution = a_rk * solution_old + b_rk * (solution + dt * rhs)
+   // Evaluated in AccNumber and rounded to storage precision, since rhs may
+   // have a different type than solution.
+   for(unsigned int i = 0; i < solution.locally_owned_size(); ++i)
+   {
+      const AccNumber u = solution.local_element(i) + dt * rhs.local_element(i);
+      solution.local_element(i) = a_rk[rk_stage] * solution_old.local_element(i)
+                                  + b_rk[rk_stage] * u;
+   }
 
    stage_time = a_rk[rk_stage] * time + b_rk[rk_stage] * (stage_time + dt);
 }
 
-//-----------------------------------------------------------------------------
-// Decide if solution needs to be saved
-//-----------------------------------------------------------------------------
-template <int dim>
-bool DGSystem<dim>::call_output()
+//------------------------------------------------------------------------------
+// Exponential integrator needs rhs(u) = L u with L linear and autonomous,
+// which holds for linear pde with linear flux, periodic or homogeneous bc and
+// no limiter; checked by comparing rhs(2u) with 2 rhs(u). The face data
+// contain cell averages, so they are computed before each rhs.
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+void
+DGSystem<dim,Number,AccNumber>::check_linear()
 {
-   // Save initial condition
-   if (time_step == 0)
-      return true;
+   AssertThrow(param->limiter_type == LimiterType::none,
+               ExcMessage("Exponential integrator needs limiter = none"));
+   AssertThrow(param->rom == "none" && !param->task_graph,
+               ExcMessage("Exponential integrator does not support rom or "
+                          "task graph"));
+   AssertThrow(param->precision == "double",
+               ExcMessage("Exponential integrator needs double precision"));
+
+   solution_old.copy_locally_owned_data_from(solution);
+   stage_time = time;
+   compute_averages();
+   assemble_rhs();
+   Vector<double> r1(rhs.locally_owned_size());
+   for(unsigned int i = 0; i < r1.size(); ++i)
+      r1(i) = rhs.local_element(i);
+   solution *= 2.0;
+   solution.update_ghost_values();
+   compute_averages();
+   assemble_rhs();
+   double diff = 0.0;
+   for(unsigned int i = 0; i < r1.size(); ++i)
+      diff += std::pow(rhs.local_element(i) - 2.0 * r1(i), 2);
+   diff = std::sqrt(Utilities::MPI::sum(diff, mpi_comm));
+   const double rhs_norm = rhs.l2_norm();
+   solution.copy_locally_owned_data_from(solution_old);
+   solution.update_ghost_values();
+   compute_averages();
+   AssertThrow(diff <= 1.0e-10 * rhs_norm + 1.0e-14,
+               ExcMessage("Exponential integrator needs a linear rhs"));
+}
 
-   // Save final solution
-   if (fabs(time - param->final_time) < 1.0e-13)
-      return true;
+//------------------------------------------------------------------------------
+// Advance to next output time, or by exp step, with solution = exp(dt L)
+// solution. The Krylov vectors do not have ghosts; the operator copies its
+// argument into solution to exchange ghosts.
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+void
+DGSystem<dim,Number,AccNumber>::exp_step()
+{
+   TimerOutput::Scope scope(computing_timer, "Exponential step");
+   EventTrace::Tracer::Scope trace(tracer, "Exponential step");
 
-   if (param->output_step > 0)
-      if (time_step % param->output_step == 0)
-         return true;
+   dt = (param->exp_step > 0.0) ? param->exp_step : param->final_time;
+   if (time + dt > param->final_time)
+      dt = param->final_time - time;
+   else if (param->output_interval > 0 && time + dt > next_output_time)
+      dt = next_output_time - time;
 
-   if (param->output_interval > 0)
-      if (fabs(time - next_output_time) < 1.0e-13)
+   auto apply = [&](const PVector& v, PVector& w)
+   {
+      solution.copy_locally_owned_data_from(v);
+      solution.update_ghost_values();
+      compute_averages();
+      assemble_rhs();
+      w.copy_locally_owned_data_from(rhs);
+   };
+   solution_old.copy_locally_owned_data_from(solution);
+   stage_time = time;
+   const auto stats = exp_integrator.advance(apply, dt, solution_old);
+   n_exp_rhs += stats.n_matvec;
+   solution.copy_locally_owned_data_from(solution_old);
+   solution.update_ghost_values();
+   compute_averages();
+   pcout << "   Krylov: rhs = " << stats.n_matvec
+         << ", substeps = " << stats.n_substeps
+         << ", dimension = " << stats.max_dim << std::endl;
+}
+
+//------------------------------------------------------------------------------
+// Graph of the tasks of one time step. Locally owned cells are split into
+// blocks of consecutive cells in the dof order. In each RK stage, there are
+// three tasks per block
+//    rhs    : rhs of the cells of the block, with all their faces
+//    update : update, filter and averages of the cells of the block
+//    limiter: TVD limiter of the cells of the block
+// and two ghost exchanges, after the updates for the averages of ghost cells
+// which the limiter needs, and after the limiter for the solution which the
+// next rhs needs; without TVD limiter, only the first is done. The rhs of a
+// block needs the final solution of its neighbour blocks in the previous
+// stage, its update must wait until the neighbours have read its solution,
+// and its limiter needs the averages of its neighbours. Only blocks with
+// ghost neighbours or with cells which are ghosts on other ranks depend on
+// the exchanges, so the others flow into the next stage without waiting.
+//
+// Faces between two blocks are computed by both blocks, each of which adds
+// only to its own cells, so no two tasks write the same entries of rhs and
+// it need not be compressed.
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+void
+DGSystem<dim,Number,AccNumber>::setup_task_graph()
+{
+   AssertThrow(param->limiter_type != LimiterType::mood,
+               ExcMessage("Task graph does not support limiter = mood"));
+   AssertThrow(param->rom == "none",
+               ExcMessage("Task graph does not support rom"));
+   AssertThrow(!triangulation.has_hanging_nodes(),
+               ExcMessage("Task graph needs a grid without hanging nodes"));
+   int provided;
+   MPI_Query_thread(&provided);
+   AssertThrow(provided >= MPI_THREAD_SERIALIZED,
+               ExcMessage("Task graph needs MPI_THREAD_SERIALIZED"));
+
+   // Owned cells in the order of their user index, which is the dof order
+   const unsigned int n_owned = triangulation.n_locally_owned_active_cells();
+   std::vector<CellIterator> owned_cells(n_owned);
+   ghost_cells.clear();
+   for(const auto& cell : dof_handler.active_cell_iterators())
+      if(cell->is_locally_owned())
+         owned_cells[cell->user_index()] = cell;
+      else if(cell->is_ghost())
+         ghost_cells.push_back(cell);
+
+   // Locally owned dofs which are sent to other ranks
+   const auto& partitioner = *solution.get_partitioner();
+   std::vector<bool> exported(solution.locally_owned_size(), false);
+   for(const auto& range : partitioner.import_indices())
+      for(unsigned int i = range.first; i < range.second; ++i)
+         exported[i] = true;
+
+   const unsigned int block_size = param->task_block_size;
+   const unsigned int n_blocks = (n_owned + block_size - 1) / block_size;
+   blocks.assign(n_blocks, Block());
+   cell_block.assign(n_owned + ghost_cells.size(),
+                     numbers::invalid_unsigned_int);
+   std::vector<types::global_dof_index> dof_indices(fe.dofs_per_cell);
+   for(unsigned int c = 0; c < n_owned; ++c)
+   {
+      auto& block = blocks[c / block_size];
+      block.cells.push_back(owned_cells[c]);
+      cell_block[c] = c / block_size;
+      owned_cells[c]->get_dof_indices(dof_indices);
+      for(const auto i : dof_indices)
       {
-         next_output_time += param->output_interval;
-         next_output_time = std::min(next_output_time, param->final_time);
-         return true;
+         const unsigned int l = partitioner.global_to_local(i);
+         block.dofs.push_back(l);
+         block.remote = block.remote || exported[l];
       }
+   }
 
-   return false;
+   for(unsigned int b = 0; b < n_blocks; ++b)
+   {
+      auto& block = blocks[b];
+      for(const auto& cell : block.cells)
+         for(const unsigned int f : cell->face_indices())
+         {
+            if(cell->at_boundary(f) && !cell->has_periodic_neighbor(f))
+               continue;
+            const auto ncell = cell->neighbor_or_periodic_neighbor(f);
+            const unsigned int nb = cell_block[ncell->user_index()];
+            if(nb == numbers::invalid_unsigned_int)
+               block.remote = true;
+            else if(nb != b)
+               block.neighbors.push_back(nb);
+         }
+      std::sort(block.neighbors.begin(), block.neighbors.end());
+      block.neighbors.erase(std::unique(block.neighbors.begin(),
+                                        block.neighbors.end()),
+                            block.neighbors.end());
+   }
+
+   // Tasks are added stage by stage; last[b] is the task which finished
+   // block b in the previous stage and exchange the last ghost exchange.
+   const bool tvd = (param->limiter_type == LimiterType::tvd &&
+                     param->degree > 0);
+   auto& graph = step_graph;
+   graph.clear();
+   std::vector<unsigned int> rhs_task(n_blocks), update_task(n_blocks),
+                             last(n_blocks);
+   unsigned int exchange = 0;
+
+   // Task runs after task of each neighbour of block b, and after the last
+   // exchange if b is remote
+   auto after_neighbours = [&](const unsigned int task, const unsigned int b,
+                               const std::vector<unsigned int>& before)
+   {
+      graph.depends(task, before[b]);
+      for(const auto nb : blocks[b].neighbors)
+         graph.depends(task, before[nb]);
+      if(blocks[b].remote)
+         graph.depends(task, exchange);
+   };
+
+   auto add_exchange = [&](const bool averages,
+                           const std::vector<unsigned int>& before)
+   {
+      exchange = graph.add([this, averages]()
+      {
+         EventTrace::Tracer::Scope trace(tracer, "Ghost exchange");
+         solution.update_ghost_values();
+         if(averages) compute_averages(ghost_cells);
+      });
+      for(unsigned int b = 0; b < n_blocks; ++b)
+         if(blocks[b].remote)
+            graph.depends(exchange, before[b]);
+   };
+
+   for(unsigned int rk = 0; rk < n_rk_stages; ++rk)
+   {
+      for(unsigned int b = 0; b < n_blocks; ++b)
+      {
+         rhs_task[b] = graph.add([this, b, rk]() { assemble_rhs_block(b, rk); });
+         if(rk > 0) after_neighbours(rhs_task[b], b, last);
+      }
+
+      for(unsigned int b = 0; b < n_blocks; ++b)
+      {
+         update_task[b] = graph.add([this, b, rk]() { update_block(b, rk); });
+         graph.depends(update_task[b], rhs_task[b]);
+         for(const auto nb : blocks[b].neighbors)
+            graph.depends(update_task[b], rhs_task[nb]);
+      }
+      add_exchange(true, update_task);
+      last = update_task;
+
+      if(tvd)
+      {
+         for(unsigned int b = 0; b < n_blocks; ++b)
+         {
+            last[b] = graph.add([this, b]()
+            {
+               EventTrace::Tracer::Scope trace(tracer, "Limiter block");
+               apply_TVD_limiter(blocks[b].cells);
+            });
+            after_neighbours(last[b], b, update_task);
+         }
+         add_exchange(false, last);
+      }
+   }
+
+   unsigned int n_remote = 0;
+   for(const auto& block : blocks)
+      n_remote += block.remote;
+   pcout << "   Task graph: " << Utilities::MPI::sum(n_blocks, mpi_comm)
+         << " blocks of " << block_size << " cells, "
+         << Utilities::MPI::sum(n_remote, mpi_comm) << " with ghost data, "
+         << Utilities::MPI::sum(graph.size(), mpi_comm)
+         << " tasks per time step (sum over ranks)\n";
+}
+
+//------------------------------------------------------------------------------
+// Rhs of the cells of block b, multiplied by the inverse mass matrix in
+// update_block
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+void
+DGSystem<dim,Number,AccNumber>::assemble_rhs_block(const unsigned int b,
+                                                   const unsigned int rk_stage)
+{
+   EventTrace::Tracer::Scope trace(tracer, "Rhs block");
+
+   auto& scratch = task_scratch.get();
+   if(!scratch)
+      scratch = std::make_shared<Scratch>(mapping, fe,
+                                          QGauss<dim>(param->degree + 1),
+                                          QGauss<dim-1>(param->degree + 1));
+   Scratch& scratch_data = *scratch;
+   scratch_data.time = stage_times[rk_stage];
+   CopyData<AccNumber> copy_data;
+
+   const auto& block = blocks[b];
+   for(const auto i : block.dofs)
+      rhs.local_element(i) = 0;
+
+   for(const auto& cell : block.cells)
+   {
+      copy_data.face_data.clear();
+      cell_worker(cell, scratch_data, copy_data);
+      for(const unsigned int f : cell->face_indices())
+      {
+         if(cell->at_boundary(f) && !cell->has_periodic_neighbor(f))
+         {
+            boundary_worker(cell, f, scratch_data, copy_data);
+            continue;
+         }
+
+         // A face inside the block is computed once, from the cell with
+         // smaller index, and adds to both cells
+         const CellIterator ncell = cell->neighbor_or_periodic_neighbor(f);
+         const bool inside = (cell_block[ncell->user_index()] == b);
+         if(inside && ncell->user_index() < cell->user_index()) continue;
+         const unsigned int nf = cell->has_periodic_neighbor(f)
+                                 ? cell->periodic_neighbor_face_no(f)
+                                 : cell->neighbor_face_no(f);
+         face_worker(cell, f, numbers::invalid_unsigned_int,
+                     ncell, nf, numbers::invalid_unsigned_int,
+                     scratch_data, copy_data);
+
+         // First dofs_per_cell interface dofs belong to this cell
+         const auto& cdf = copy_data.face_data.back();
+         const unsigned int n = inside ? cdf.cell_rhs.size() : fe.dofs_per_cell;
+         for(unsigned int i = 0; i < n; ++i)
+            rhs(cdf.joint_dof_indices[i]) += cdf.cell_rhs(i);
+      }
+      for(unsigned int i = 0; i < fe.dofs_per_cell; ++i)
+         rhs(copy_data.local_dof_indices[i]) += copy_data.cell_rhs(i);
+   }
+}
+
+//------------------------------------------------------------------------------
+// Stage update of block b as in update(), followed by filter and averages.
+// The first stage saves the solution of the block in solution_old.
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+void
+DGSystem<dim,Number,AccNumber>::update_block(const unsigned int b,
+                                             const unsigned int rk_stage)
+{
+   EventTrace::Tracer::Scope trace(tracer, "Update block");
+
+   const auto& block = blocks[b];
+   for(const auto i : block.dofs)
+   {
+      if(rk_stage == 0)
+         solution_old.local_element(i) = solution.local_element(i);
+      rhs.local_element(i) *= imm.local_element(i);
+      const AccNumber u = solution.local_element(i) + dt * rhs.local_element(i);
+      solution.local_element(i) = a_rk[rk_stage] * solution_old.local_element(i)
+                                  + b_rk[rk_stage] * u;
+   }
+
+   if(param->limiter_type == LimiterType::filter && param->degree > 0)
+      apply_filter(block.cells);
+   compute_averages(block.cells);
+}
+
+//------------------------------------------------------------------------------
+// All RK stages of one time step with the task graph
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+void
+DGSystem<dim,Number,AccNumber>::run_task_graph()
+{
+   TimerOutput::Scope scope(computing_timer, "Task graph");
+
+   stage_times[0] = time;
+   for(unsigned int rk = 0; rk < n_rk_stages; ++rk)
+      stage_times[rk + 1] = a_rk[rk] * time + b_rk[rk] * (stage_times[rk] + dt);
+   step_graph.run();
+   stage_time = stage_times[n_rk_stages];
+}
+
+//-----------------------------------------------------------------------------
+// Decide if solution needs to be saved
+//-----------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+bool DGSystem<dim,Number,AccNumber>::call_output()
+{
+   return output_due(*param, time, time_step, next_output_time);
 }
 
 //------------------------------------------------------------------------------
 // Save solution to file
 //------------------------------------------------------------------------------
-template <int dim>
+template <int dim, typename Number, typename AccNumber>
 void
-DGSystem<dim>::output_results(const double time) const
+DGSystem<dim,Number,AccNumber>::output_results(const double time) const
 {
    static unsigned int counter = 0;
    static std::vector<XDMFEntry> xdmf_entries;
@@ -966,6 +2399,7 @@ DGSystem<dim>::output_results(const double time) const
    PDE::Postprocessor<dim> postprocessor;
    data_out.add_data_vector(dof_handler, solution, postprocessor);
    data_out.build_patches(mapping, param->degree);
+   output_memory = std::max(output_memory, data_out.memory_consumption());
 
    DataOutBase::DataOutFilter data_filter(DataOutBase::DataOutFilterFlags(true, true));
   // Filter the data and store it in data_filter
@@ -991,46 +2425,287 @@ DGSystem<dim>::output_results(const double time) const
    ++counter;
 }
 
+//------------------------------------------------------------------------------
+// L2 error with respect to initial condition. For periodic problems like
+// rotate and isentropic vortex, this is the exact solution at final time.
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+void
+DGSystem<dim,Number,AccNumber>::compute_error() const
+{
+   QGauss<dim>  quadrature_formula(param->degree + 2);
+   FEValues<dim> fe_values(mapping, fe, quadrature_formula,
+                           update_values   |
+                           update_quadrature_points |
+                           update_JxW_values);
+   const unsigned int n_q_points = quadrature_formula.size();
+   std::vector<Vector<Number>> solution_values(n_q_points, Vector<Number>(nvar));
+   Vector<double> exact(nvar);
+   std::vector<double> error(nvar, 0.0);
+
+   for(auto & cell : dof_handler.active_cell_iterators())
+   if(cell->is_locally_owned())
+   {
+      fe_values.reinit(cell);
+      fe_values.get_function_values(solution, solution_values);
+      for(unsigned int q = 0; q < n_q_points; ++q)
+      {
+         problem->initial_value(fe_values.quadrature_point(q), exact);
+         for(unsigned int i = 0; i < nvar; ++i)
+            error[i] += pow(solution_values[q][i] - exact[i], 2) *
+                        fe_values.JxW(q);
+      }
+   }
+
+   pcout << "L2 error w.r.t. initial condition:";
+   for(unsigned int i = 0; i < nvar; ++i)
+      pcout << " " << std::sqrt(Utilities::MPI::sum(error[i], mpi_comm));
+   pcout << std::endl;
+}
+
+//------------------------------------------------------------------------------
+// Store locally owned solution as snapshot for reduced model
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+void
+DGSystem<dim,Number,AccNumber>::store_snapshot()
+{
+   Vector<double> u(solution.locally_owned_size());
+   for(unsigned int i = 0; i < u.size(); ++i)
+      u(i) = solution.local_element(i);
+   snapshots.push_back(u);
+}
+
+//------------------------------------------------------------------------------
+// Print memory used by the main data structures on each rank
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+void
+DGSystem<dim,Number,AccNumber>::print_memory(const std::string& when)
+{
+   memory.clear();
+   memory.add("triangulation", triangulation.memory_consumption());
+   memory.add("dof_handler", dof_handler.memory_consumption());
+   memory.add("solution", solution.memory_consumption());
+   memory.add("solution_old", solution_old.memory_consumption());
+   memory.add("rhs", rhs.memory_consumption());
+   memory.add("imm", imm.memory_consumption());
+   memory.add("average", MemoryConsumption::memory_consumption(average));
+   if(param->limiter_type == LimiterType::mood)
+      memory.add("subcell fallback",
+                 solution_stage.memory_consumption() +
+                 MemoryConsumption::memory_consumption(average_stage) +
+                 subcell_matrix.memory_consumption() +
+                 face_basis.memory_consumption());
+   if(param->rom != "none")
+      memory.add("rom snapshots",
+                 MemoryConsumption::memory_consumption(snapshots) +
+                 MemoryConsumption::memory_consumption(rhs_snapshots));
+
+   {
+      const QGauss<dim> cell_quadrature(param->degree + 1);
+      const QGauss<dim-1> face_quadrature(param->degree + 1);
+      const Scratch scratch_data(mapping, fe, cell_quadrature, face_quadrature);
+      memory.add("scratch data",
+                 MemoryReport::scratch_memory(scratch_data.fe_values,
+                                              face_quadrature,
+                                              scratch_data.memory_consumption()));
+   }
+   memory.add("output buffers", output_memory);
+   memory.print(pcout, when, dof_handler.n_dofs());
+}
+
+//------------------------------------------------------------------------------
+// Advance solution from time to final time, returns wall time
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+double
+DGSystem<dim,Number,AccNumber>::time_loop()
+{
+   const bool rom = (param->rom != "none") && store_snapshots;
+   const bool use_exp = (param->time_scheme == "exp");
+   Timer timer(mpi_comm);
+   while(time < param->final_time)
+   {
+      EventTrace::Tracer::Scope trace_step(tracer, "Time step");
+      if(!param->task_graph && !use_exp)
+         solution_old  = solution;
+      stage_time = time;
+      if(!use_exp) compute_dt();
+
+      const bool snapshot_step = rom &&
+                                 (time_step % param->rom_snapshot_step == 0);
+
+      n_troubled = 0;
+      if(use_exp)
+         exp_step();
+      else if(param->task_graph)
+         run_task_graph();
+      else
+         for(unsigned int rk = 0; rk < n_rk_stages; ++rk)
+         {
+            EventTrace::Tracer::Scope trace_stage(tracer, "Stage");
+            if(param->limiter_type == LimiterType::mood)
+            {
+               // Stage data with ghosts, used by subcell fallback
+               const unsigned int n_local
+                  = solution.locally_owned_size()
+                    + solution.get_partitioner()->n_ghost_indices();
+               for(unsigned int i = 0; i < n_local; ++i)
+                  solution_stage.local_element(i) = solution.local_element(i);
+               average_stage = average;
+            }
+            assemble_rhs();
+            if(snapshot_step && rk == 0)
+            {
+               Vector<double> f(rhs.locally_owned_size());
+               for(unsigned int i = 0; i < f.size(); ++i)
+                  f(i) = rhs.local_element(i);
+               rhs_snapshots.push_back(f);
+            }
+            update(rk);
+            apply_filter();
+            {
+               TimerOutput::Scope scope(computing_timer, "Ghost exchange");
+               EventTrace::Tracer::Scope trace(tracer, "Ghost exchange");
+               solution.update_ghost_values();
+            }
+            compute_averages();
+            if(param->limiter_type == LimiterType::mood)
+               apply_subcell_fallback(rk);
+            apply_limiter();
+         }
+
+      time += dt, ++time_step;
+      if(rom)
+      {
+         dt_history.push_back(dt);
+         if(time_step % param->rom_snapshot_step == 0) store_snapshot();
+      }
+      pcout << "Iter = " << time_step
+            << " dt = " << dt
+            << " time = " << time << std::endl;
+      if(param->limiter_type == LimiterType::mood)
+         pcout << "   Troubled cells in all stages = " << n_troubled << "\n";
+      if(call_output() && save_output)
+      {
+         TimerOutput::Scope scope(computing_timer, "Output");
+         EventTrace::Tracer::Scope trace(tracer, "Output");
+         output_results(time);
+      }
+   }
+   timer.stop();
+   return timer.wall_time();
+}
+
+//------------------------------------------------------------------------------
+// Full order run from the initial condition with the given value of the rom
+// parameter, without output; used by the reduced model for more training
+// runs and for reference solutions. Snapshots are stored if store is true.
+// dt_history of the main run is kept, returns wall time.
+//------------------------------------------------------------------------------
+template <int dim, typename Number, typename AccNumber>
+double
+DGSystem<dim,Number,AccNumber>::full_order_run(const double value,
+                                               const bool   store)
+{
+   problem->set_parameter(param->rom_parameter, value);
+   store_snapshots = store;
+   const auto n_dt = dt_history.size();
+   const bool verbose = pcout.is_active();
+   pcout.set_condition(false);
+   save_output = false;
+
+   time = 0.0;
+   time_step = 0;
+   next_output_time = param->output_interval;
+   initialize();
+   solution.update_ghost_values();
+   compute_averages();
+   if(store) store_snapshot();
+   const double wall_time = time_loop();
+   if(store && time_step % param->rom_snapshot_step != 0) store_snapshot();
+
+   save_output = true;
+   store_snapshots = true;
+   pcout.set_condition(verbose);
+   dt_history.resize(n_dt);
+   return wall_time;
+}
+
 //------------------------------------------------------------------------------
 // Start solving the problem
 //------------------------------------------------------------------------------
-template <int dim>
+template <int dim, typename Number, typename AccNumber>
 void
-DGSystem<dim>::run()
+DGSystem<dim,Number,AccNumber>::run()
 {
    pcout << "Solving " << PDE::name << " for " << problem->get_name() << "\n";
    pcout << "Number of threads = " << MultithreadInfo::n_threads() << "\n";
+   pcout << "Precision = " << param->precision << "\n";
+   pcout << "Basis = " << param->basis << ", dofs per component = "
+         << dofs_per_comp << "\n";
 
    if (Utilities::MPI::this_mpi_process(mpi_comm) == 0)
       PDE::print_info();
+   memory.reinit(mpi_comm);
    make_grid_and_dofs();
    assemble_mass_matrix();
+   if(param->rom != "none" && !param->rom_parameter.empty())
+      problem->set_parameter(param->rom_parameter,
+                             param->rom_training_values[0]);
    initialize();
    solution.update_ghost_values();
    compute_averages();
    output_results(0.0);
 
-   while(time < param->final_time)
+   const bool rom = (param->rom != "none");
+   if(rom) store_snapshot();
+   if(param->task_graph) setup_task_graph();
+   print_memory("after setup");
+
+   // Steps of SSP-RK3 at the given cfl, for comparison
+   const bool use_exp = (param->time_scheme == "exp");
+   double n_rk_steps = 0.0;
+   if(use_exp)
    {
-      solution_old  = solution;
-      stage_time = time;
+      exp_integrator.reinit(param->krylov_tol, param->krylov_dim);
+      check_linear();
       compute_dt();
+      n_rk_steps = std::ceil(param->final_time / dt);
+   }
+
+   tracer.reinit(param->trace, param->trace_buffer, mpi_comm);
+   const double wall_time = time_loop();
+   pcout << "Wall time = " << wall_time << " s, per step = "
+         << wall_time / time_step << " s, per step per dof = "
+         << wall_time / (time_step * dof_handler.n_dofs()) << " s\n";
+   if(use_exp)
+      pcout << "Rhs evaluations = " << n_exp_rhs << ", SSP-RK3 at cfl = "
+            << param->cfl << " needs " << n_rk_stages * n_rk_steps << "\n";
+   if(problem->get_periodic())
+      compute_error();
+   computing_timer.print_summary();
+   print_memory("at end");
+   if(tracer.is_enabled())
+   {
+      const auto [n_saved, n_lost] = tracer.write("trace.json");
+      pcout << "Saved " << n_saved << " events in trace.json";
+      if(n_lost > 0)
+         pcout << ", " << n_lost << " older events were overwritten, "
+               << "increase trace buffer";
+      pcout << "\n";
+   }
 
-      for(unsigned int rk = 0; rk < n_rk_stages; ++rk)
+   if constexpr(std::is_same_v<Number, double> &&
+                std::is_same_v<AccNumber, double>)
+      if(rom)
       {
-         assemble_rhs();
-         update(rk);
-         solution.update_ghost_values();
-         compute_averages();
-         apply_limiter();
+         // Reduced model needs final solution as last snapshot
+         if(time_step % param->rom_snapshot_step != 0) store_snapshot();
+         ReducedModel<dim> reduced_model(*this);
+         reduced_model.run(wall_time);
       }
-
-      time += dt, ++time_step;
-      pcout << "Iter = " << time_step
-            << " dt = " << dt
-            << " time = " << time << std::endl;
-      if(call_output()) output_results(time);
-   }
 }
 
 //------------------------------------------------------------------------------
@@ -1041,14 +2716,18 @@ declare_parameters(ParameterHandler& prm)
 {
    prm.declare_entry("degree", "0", Patterns::Integer(0),
                      "Polynomial degree");
-   prm.declare_entry("basis", "legendre", Patterns::Anything(),
-                     "Specify basis: NOT USED");
+   prm.declare_entry("basis", "legendre",
+                     Patterns::Selection("legendre|legendre_q"),
+                     "Specify basis: legendre (FE_DGP) or legendre_q "
+                     "(FE_DGQLegendre)");
    prm.declare_entry("mapping", "cartesian", Patterns::Anything(),
                      "Specify mapping: NOT USED, always cartesian");
    prm.declare_entry("grid", "0", Patterns::Anything(),
                      "Specify grid: 100,100 or user or foo.msh");
    prm.declare_entry("initial refine", "0", Patterns::Integer(0),
                      "Number of grid refinements");
+   prm.declare_entry("mesh cache", "true", Patterns::Bool(),
+                     "Save gmsh grid in binary file and read it on later runs");
    prm.declare_entry("output step", "0", Patterns::Integer(0),
                      "Iteration frequency to save solution");
    prm.declare_entry("output number", "0", Patterns::Integer(0),
@@ -1060,13 +2739,71 @@ declare_parameters(ParameterHandler& prm)
    prm.declare_entry("final time", "0.0", Patterns::Double(0),
                      "Final time");
    prm.declare_entry("limiter", "none",
-                     Patterns::Selection("none|tvd"),
+                     Patterns::Selection("none|tvd|filter|mood"),
                      "Limiter");
    prm.declare_entry("numflux", "central",
                      Patterns::Anything(),
                      "Numerical flux");
+   prm.declare_entry("eos table", "", Patterns::Anything(),
+                     "Pressure table p(rho,e) replacing the eos of the problem");
    prm.declare_entry("tvb parameter", "0.0", Patterns::Double(0),
                      "TVB parameter");
+   prm.declare_entry("filter order", "8", Patterns::Integer(1),
+                     "Order of exponential filter, even number");
+   prm.declare_entry("filter strength", "36.0", Patterns::Double(0),
+                     "Largest damping exponent of exponential filter");
+   prm.declare_entry("cell order", "natural",
+                     Patterns::Selection("natural|morton|hilbert"),
+                     "Order of coarse cells: natural, morton or hilbert");
+   prm.declare_entry("dof order", "cell",
+                     Patterns::Selection("cell|cuthill_mckee"),
+                     "Numbering of dofs: cell or cuthill_mckee");
+   prm.declare_entry("precision", "double",
+                     Patterns::Selection("single|double|mixed"),
+                     "Precision: single, double or mixed (float storage, "
+                     "double accumulation)");
+   prm.declare_entry("rom", "none",
+                     Patterns::Selection("none|galerkin|deim"),
+                     "Reduced order model: none, galerkin or deim");
+   prm.declare_entry("rom snapshot step", "1", Patterns::Integer(1),
+                     "Iteration frequency to store snapshots");
+   prm.declare_entry("rom tolerance", "1.0e-10", Patterns::Double(0),
+                     "Relative energy of neglected POD modes");
+   prm.declare_entry("rom max modes", "40", Patterns::Integer(1),
+                     "Maximum number of POD modes");
+   prm.declare_entry("rom deim modes", "0", Patterns::Integer(0),
+                     "Number of DEIM points, 0 = from rom tolerance");
+   prm.declare_entry("rom parameter", "", Patterns::Anything(),
+                     "Problem parameter varied by the reduced model, e.g., mach");
+   prm.declare_entry("rom training values", "", Patterns::Anything(),
+                     "Values of rom parameter for full order runs: 0.4,0.5");
+   prm.declare_entry("rom test values", "", Patterns::Anything(),
+                     "Values of rom parameter for reduced model runs: 0.45");
+   prm.declare_entry("trace", "false", Patterns::Bool(),
+                     "Save timeline of phases of each rank in trace.json");
+   prm.declare_entry("trace buffer", "65536", Patterns::Integer(1),
+                     "Events kept per thread, older events are overwritten");
+   prm.declare_entry("trace workers", "false", Patterns::Bool(),
+                     "Also trace every cell, face and boundary worker");
+   prm.declare_entry("task graph", "false", Patterns::Bool(),
+                     "Run the RK stages as a graph of tasks on blocks of cells");
+   prm.declare_entry("task block size", "256", Patterns::Integer(1),
+                     "Cells per block of the task graph");
+   prm.declare_entry("threads", "0", Patterns::Integer(0),
+                     "Threads per rank, 0 = one, or all cores with task graph");
+   prm.declare_entry("time scheme", "ssprk3",
+                     Patterns::Selection("ssprk3|exp"),
+                     "Time scheme, exp only for linear pde");
+   prm.declare_entry("exp step", "0.0", Patterns::Double(0),
+                     "Time step of exp scheme, 0 = output interval");
+   prm.declare_entry("krylov tolerance", "1.0e-8", Patterns::Double(0),
+                     "Relative error of exp scheme");
+   prm.declare_entry("krylov dimension", "30", Patterns::Integer(1),
+                     "Largest Krylov space of exp scheme");
+   prm.declare_entry("engine", "generic",
+                     Patterns::Selection("generic|cartesian"),
+                     "Solver: generic (DoFHandler) or cartesian (structured "
+                     "arrays, grid = nx,ny only)");
 }
 
 //------------------------------------------------------------------------------
@@ -1074,6 +2811,7 @@ void
 parse_parameters(const ParameterHandler& ph, Parameter& param)
 {
    param.degree = ph.get_integer("degree");
+   param.basis = ph.get("basis");
 
    auto grid = ph.get("grid");
    AssertThrow(grid != "0", ExcMessage("Grid is not specified."));
@@ -1098,6 +2836,7 @@ parse_parameters(const ParameterHandler& ph, Parameter& param)
       param.final_time = final_time;
 
    param.n_refine = ph.get_integer("initial refine");
+   param.mesh_cache = ph.get_bool("mesh cache");
 
    param.output_step = ph.get_integer("output step");
    param.output_number = ph.get_integer("output number");
@@ -1140,12 +2879,48 @@ parse_parameters(const ParameterHandler& ph, Parameter& param)
       }
    }
 
+   param.eos_table = ph.get("eos table");
+
    {
       std::string value = ph.get("limiter");
       if (value == "none") param.limiter_type = LimiterType::none;
       else if (value == "tvd") param.limiter_type = LimiterType::tvd;
+      else if (value == "filter") param.limiter_type = LimiterType::filter;
+      else if (value == "mood") param.limiter_type = LimiterType::mood;
       else AssertThrow(false, ExcMessage("Unknown limiter"));
    }
 
    param.Mlim = ph.get_double("tvb parameter");
+   param.filter_order = ph.get_integer("filter order");
+   param.filter_strength = ph.get_double("filter strength");
+   param.cell_order = ph.get("cell order");
+   param.dof_order = ph.get("dof order");
+   param.precision = ph.get("precision");
+   param.rom = ph.get("rom");
+   param.rom_snapshot_step = ph.get_integer("rom snapshot step");
+   param.rom_tol = ph.get_double("rom tolerance");
+   param.rom_max_modes = ph.get_integer("rom max modes");
+   param.rom_deim_modes = ph.get_integer("rom deim modes");
+   param.rom_parameter = ph.get("rom parameter");
+   param.rom_training_values = Utilities::string_to_double(
+      Utilities::split_string_list(ph.get("rom training values")));
+   param.rom_test_values = Utilities::string_to_double(
+      Utilities::split_string_list(ph.get("rom test values")));
+   AssertThrow(param.rom_parameter.empty() ||
+               (param.rom_training_values.size() > 0 &&
+                param.rom_test_values.size() > 0),
+               ExcMessage("rom parameter needs training and test values"));
+   param.trace = ph.get_bool("trace");
+   param.trace_buffer = ph.get_integer("trace buffer");
+   param.trace_workers = ph.get_bool("trace workers");
+   param.task_graph = ph.get_bool("task graph");
+   param.task_block_size = ph.get_integer("task block size");
+   param.n_threads = ph.get_integer("threads");
+   param.time_scheme = ph.get("time scheme");
+   param.exp_step = ph.get_double("exp step");
+   param.krylov_tol = ph.get_double("krylov tolerance");
+   param.krylov_dim = ph.get_integer("krylov dimension");
+   param.engine = ph.get("engine");
+   AssertThrow(param.rom == "none" || param.precision == "double",
+               ExcMessage("Reduced model needs double precision"));
 }
@@ -1,4 +1,6 @@
 #include "dg.h"
+#include "rom.h"
+#include "cartesian.h"
 #include "problem.h"
 
 //------------------------------------------------------------------------------
@@ -7,9 +9,8 @@
 int
 main(int argc, char** argv)
 {
-   // Number of threads to use
-   unsigned int n_threads = 1;
-   Utilities::MPI::MPI_InitFinalize mpi_initialization(argc, argv, n_threads);
+   // One thread per rank until the parameters are read
+   Utilities::MPI::MPI_InitFinalize mpi_initialization(argc, argv, 1);
 
    ParameterHandler ph;
    declare_parameters(ph);
@@ -29,8 +30,36 @@ main(int argc, char** argv)
    param.final_time = problem.get_final_time(); // override this in input file
    parse_parameters(ph, param);
 
-   DGSystem<2> solver(param, problem);
-   solver.run();
+   // The task graph runs its tasks on all threads of the rank
+   if(param.n_threads > 0)
+      MultithreadInfo::set_thread_limit(param.n_threads);
+   else if(param.task_graph)
+      MultithreadInfo::set_thread_limit(numbers::invalid_unsigned_int);
+
+   // Replaces the eos which the problem constructor has set
+   if(!param.eos_table.empty())
+      PDE::use_eos_table(param.eos_table, MPI_COMM_WORLD);
+
+   if(param.engine == "cartesian")
+   {
+      CartesianDG<2> solver(param, problem);
+      solver.run();
+   }
+   else if(param.precision == "single")
+   {
+      DGSystem<2,float> solver(param, problem);
+      solver.run();
+   }
+   else if(param.precision == "mixed")
+   {
+      DGSystem<2,float,double> solver(param, problem);
+      solver.run();
+   }
+   else
+   {
+      DGSystem<2> solver(param, problem);
+      solver.run();
+   }
 
    return 0;
 }
@@ -0,0 +1,725 @@
+//------------------------------------------------------------------------------
+// Reduced order model built from snapshots of the DG solution.
+//
+// Snapshots of the solution u and of the rhs f(u) = M^{-1} R(u) are stored
+// during the full order run. The POD basis V of the solution snapshots is
+// computed by a randomized SVD and the reduced solution u = V a solves
+//
+//    da/dt = V^T f(V a)
+//
+// with the same SSP-RK3 scheme and time steps as the full order run.
+//
+// galerkin: For linear problems, f(u) = A u + b, and the reduced operator
+//           V^T A V and V^T b are assembled once, so the online cost is
+//           O(r^2) per stage and the projection is exact.
+// deim    : f is approximated by DEIM, f(V a) ~ U (P^T U)^{-1} P^T f(V a),
+//           where U is the POD basis of the rhs snapshots and P selects a few
+//           dofs. Only the cells containing these dofs are assembled online,
+//           which is needed for nonlinear problems.
+//
+// The basis and the DEIM data depend only on the grid, so one reduced model
+// can be solved for several values of a problem parameter: with "rom
+// parameter", snapshots of full order runs at all training values are used,
+// and the reduced model is solved at each test value. The galerkin operator
+// depends on the problem and is assembled again for each test value.
+//
+// Tall matrices like snapshots and bases are stored as FullMatrix with the
+// locally owned rows of this rank; their products are threaded over rows and
+// summed over ranks.
+//------------------------------------------------------------------------------
+#ifndef __ROM_H__
+#define __ROM_H__
+
+#include <deal.II/base/parallel.h>
+#include <deal.II/lac/full_matrix.h>
+#include <deal.II/lac/lapack_full_matrix.h>
+
+#include <map>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <set>
+#include <tuple>
+
+namespace ROM
+{
+   using namespace dealii;
+
+   //---------------------------------------------------------------------------
+   // C = A^T B, A and B have same rows, summed over ranks
+   //---------------------------------------------------------------------------
+   inline FullMatrix<double>
+   transpose_mult(const FullMatrix<double>& A,
+                  const FullMatrix<double>& B,
+                  const MPI_Comm            comm)
+   {
+      AssertDimension(A.m(), B.m());
+      const unsigned int p = A.n(), q = B.n();
+      FullMatrix<double> C(p, q);
+      std::mutex mutex;
+      parallel::apply_to_subranges(
+         0u, A.m(),
+         [&](const unsigned int begin, const unsigned int end)
+         {
+            FullMatrix<double> C_local(p, q);
+            for(unsigned int r = begin; r < end; ++r)
+               for(unsigned int i = 0; i < p; ++i)
+               {
+                  const double a = A(r, i);
+                  for(unsigned int j = 0; j < q; ++j)
+                     C_local(i, j) += a * B(r, j);
+               }
+            std::lock_guard<std::mutex> lock(mutex);
+            C.add(1.0, C_local);
+         },
+         64);
+      FullMatrix<double> C_global(p, q);
+      Utilities::MPI::sum(C, comm, C_global);
+      return C_global;
+   }
+
+   //---------------------------------------------------------------------------
+   // C = A B, A is tall and B is small; no communication
+   //---------------------------------------------------------------------------
+   inline FullMatrix<double>
+   mult(const FullMatrix<double>& A, const FullMatrix<double>& B)
+   {
+      AssertDimension(A.n(), B.m());
+      FullMatrix<double> C(A.m(), B.n());
+      parallel::apply_to_subranges(
+         0u, A.m(),
+         [&](const unsigned int begin, const unsigned int end)
+         {
+            for(unsigned int r = begin; r < end; ++r)
+               for(unsigned int k = 0; k < A.n(); ++k)
+               {
+                  const double a = A(r, k);
+                  for(unsigned int j = 0; j < B.n(); ++j)
+                     C(r, j) += a * B(k, j);
+               }
+         },
+         64);
+      return C;
+   }
+
+   //---------------------------------------------------------------------------
+   // Orthonormalize columns of Y by shifted CholeskyQR, done twice for
+   // accuracy. The shift allows rank deficient Y.
+   //---------------------------------------------------------------------------
+   inline void
+   orthonormalize(FullMatrix<double>& Y, const MPI_Comm comm)
+   {
+      for(unsigned int pass = 0; pass < 2; ++pass)
+      {
+         FullMatrix<double> G = transpose_mult(Y, Y, comm);
+         const double shift = 1.0e-13 * G.trace() / G.m();
+         for(unsigned int i = 0; i < G.m(); ++i)
+            G(i, i) += shift;
+         FullMatrix<double> L(G.m()), L_inv(G.m()), L_invT(G.m());
+         L.cholesky(G);
+         L_inv.invert(L);
+         L_invT.copy_transposed(L_inv);
+         Y = mult(Y, L_invT);
+      }
+   }
+
+   //---------------------------------------------------------------------------
+   // Left singular vectors and singular values of X by randomized SVD with
+   // n_rank + 10 samples and n_power power iterations.
+   //---------------------------------------------------------------------------
+   inline void
+   randomized_svd(const FullMatrix<double>& X,
+                  const unsigned int        n_rank,
+                  const unsigned int        n_power,
+                  const MPI_Comm            comm,
+                  FullMatrix<double>&       U,
+                  std::vector<double>&      sigma)
+   {
+      const unsigned int l = std::min(X.n(), n_rank + 10);
+
+      // Same random matrix on all ranks
+      std::mt19937 generator(1234);
+      std::normal_distribution<double> normal;
+      FullMatrix<double> omega(X.n(), l);
+      for(unsigned int i = 0; i < X.n(); ++i)
+         for(unsigned int j = 0; j < l; ++j)
+            omega(i, j) = normal(generator);
+
+      FullMatrix<double> Y = mult(X, omega);
+      orthonormalize(Y, comm);
+      for(unsigned int i = 0; i < n_power; ++i)
+      {
+         Y = mult(X, transpose_mult(X, Y, comm));
+         orthonormalize(Y, comm);
+      }
+
+      // X ~ Y B, B = Y^T X is small; B = Ub S Vb^T
+      LAPACKFullMatrix<double> B(l, X.n());
+      B = transpose_mult(Y, X, comm);
+      B.compute_svd();
+      const auto& Ub = B.get_svd_u();
+      FullMatrix<double> Ub_full(l, l);
+      for(unsigned int i = 0; i < l; ++i)
+         for(unsigned int j = 0; j < l; ++j)
+            Ub_full(i, j) = Ub(i, j);
+
+      U = mult(Y, Ub_full);
+      sigma.resize(std::min(l, X.n()));
+      for(unsigned int i = 0; i < sigma.size(); ++i)
+         sigma[i] = B.singular_value(i);
+   }
+
+   //---------------------------------------------------------------------------
+   // Number of modes to keep so that relative energy left out < tol
+   //---------------------------------------------------------------------------
+   inline unsigned int
+   truncation_rank(const std::vector<double>& sigma,
+                   const double               tol,
+                   const unsigned int         max_modes)
+   {
+      double total = 0.0;
+      for(const auto s : sigma) total += s * s;
+      double energy = 0.0;
+      unsigned int r = 0;
+      while(r < std::min<std::size_t>(sigma.size(), max_modes))
+      {
+         energy += sigma[r] * sigma[r];
+         ++r;
+         if(total - energy <= tol * total) break;
+      }
+      return std::max(r, 1u);
+   }
+
+   //---------------------------------------------------------------------------
+   // Greedy DEIM selection of rows of U. Returns global indices of rows
+   // (owned rows are given by "owned") and P^T U.
+   //---------------------------------------------------------------------------
+   inline std::vector<types::global_dof_index>
+   deim_points(const FullMatrix<double>& U,
+               const IndexSet&           owned,
+               const MPI_Comm            comm,
+               FullMatrix<double>&       PU)
+   {
+      const unsigned int m = U.n();
+      const int rank = Utilities::MPI::this_mpi_process(comm);
+      std::vector<types::global_dof_index> points(m);
+      PU.reinit(m, m);
+      Vector<double> residual(U.m());
+
+      for(unsigned int l = 0; l < m; ++l)
+      {
+         // residual = U_l - U_{0:l-1} c, with P^T residual = 0 at old points
+         Vector<double> c(l);
+         if(l > 0)
+         {
+            FullMatrix<double> A(l, l);
+            Vector<double> rhs(l);
+            for(unsigned int i = 0; i < l; ++i)
+            {
+               for(unsigned int j = 0; j < l; ++j)
+                  A(i, j) = PU(i, j);
+               rhs(i) = PU(i, l);
+            }
+            A.gauss_jordan();
+            A.vmult(c, rhs);
+         }
+         for(unsigned int r = 0; r < U.m(); ++r)
+         {
+            residual(r) = U(r, l);
+            for(unsigned int j = 0; j < l; ++j)
+               residual(r) -= U(r, j) * c(j);
+         }
+
+         // Largest residual over all ranks
+         struct { double value; int rank; } local, global;
+         local.value = (U.m() > 0) ? residual.linfty_norm() : -1.0;
+         local.rank = rank;
+         const int ierr = MPI_Allreduce(&local, &global, 1, MPI_DOUBLE_INT,
+                                        MPI_MAXLOC, comm);
+         AssertThrowMPI(ierr);
+
+         // Owner sends index and row of U
+         types::global_dof_index index = 0;
+         Vector<double> row(m);
+         if(rank == global.rank)
+         {
+            unsigned int r_max = 0;
+            for(unsigned int r = 0; r < U.m(); ++r)
+               if(std::fabs(residual(r)) > std::fabs(residual(r_max)))
+                  r_max = r;
+            index = owned.nth_index_in_set(r_max);
+            for(unsigned int j = 0; j < m; ++j)
+               row(j) = U(r_max, j);
+         }
+         points[l] = Utilities::MPI::sum(index, comm);
+         Utilities::MPI::sum(row, comm, row);
+         for(unsigned int j = 0; j < m; ++j)
+            PU(l, j) = row(j);
+      }
+
+      return points;
+   }
+}
+
+//------------------------------------------------------------------------------
+template <int dim>
+class ReducedModel
+{
+public:
+   typedef DGSystem<dim>                               System;
+   typedef LinearAlgebra::distributed::Vector<double>  PVector;
+   typedef typename DoFHandler<dim>::active_cell_iterator Iterator;
+
+   ReducedModel(System& system);
+   void run(const double full_order_time);
+
+private:
+   void build_basis();
+   void build_galerkin();
+   void build_deim();
+   void rhs(const Vector<double>& a, const double t, Vector<double>& da);
+   void evaluate_sampled(const Vector<double>& a, const double t,
+                         Vector<double>& f_p);
+   Vector<double> local_solution() const;
+   void solve(const Vector<double>& u0,
+              const Vector<double>& u1,
+              const double          full_order_time);
+
+   System&              system;
+   const MPI_Comm       mpi_comm;
+   ConditionalOStream&  pcout;
+   FullMatrix<double>   V;       // POD basis, locally owned rows
+   unsigned int         n_modes;
+
+   // galerkin
+   FullMatrix<double>   A_r;     // V^T A V
+   Vector<double>       b_r;     // V^T b
+
+   // deim
+   FullMatrix<double>   W;       // V^T U (P^T U)^{-1}
+   std::vector<Iterator>                sampled_cells;
+   std::vector<Iterator>                needed_cells; // sampled + neighbours
+   std::vector<types::global_dof_index> needed_dofs;
+   FullMatrix<double>                   V_needed;     // rows of V at needed_dofs
+   // for each sampled cell: (local dof, DEIM point, inverse mass) triplets
+   std::vector<std::vector<std::tuple<unsigned int,unsigned int,double>>> cell_points;
+   unsigned int         n_points;
+   // kept for all calls of evaluate_sampled
+   std::unique_ptr<typename System::Scratch> scratch_data;
+   CopyData<double>     copy_data;
+   Vector<double>       u_needed;
+   Vector<double>       cell_rhs;
+   Vector<double>       f_p;
+};
+
+//------------------------------------------------------------------------------
+template <int dim>
+ReducedModel<dim>::ReducedModel(System& system)
+   :
+   system(system),
+   mpi_comm(system.mpi_comm),
+   pcout(system.pcout)
+{
+}
+
+//------------------------------------------------------------------------------
+// POD basis from solution snapshots
+//------------------------------------------------------------------------------
+template <int dim>
+void
+ReducedModel<dim>::build_basis()
+{
+   const auto& snapshots = system.snapshots;
+   const unsigned int n_rows = system.solution.locally_owned_size();
+   FullMatrix<double> X(n_rows, snapshots.size());
+   for(unsigned int j = 0; j < snapshots.size(); ++j)
+      for(unsigned int i = 0; i < n_rows; ++i)
+         X(i, j) = snapshots[j](i);
+
+   FullMatrix<double> U;
+   std::vector<double> sigma;
+   ROM::randomized_svd(X, system.param->rom_max_modes, 1, mpi_comm, U, sigma);
+   n_modes = ROM::truncation_rank(sigma, system.param->rom_tol,
+                                  system.param->rom_max_modes);
+
+   V.reinit(n_rows, n_modes);
+   V.fill(U, 0, 0, 0, 0);
+
+   pcout << "   Number of snapshots = " << snapshots.size() << "\n";
+   pcout << "   Number of POD modes = " << n_modes
+         << ", sigma_r/sigma_1 = " << sigma[n_modes-1] / sigma[0] << "\n";
+}
+
+//------------------------------------------------------------------------------
+// Apply full order rhs to each basis vector; f(u) = A u + b is assumed, with
+// b independent of time.
+//------------------------------------------------------------------------------
+template <int dim>
+void
+ReducedModel<dim>::build_galerkin()
+{
+   auto& solution = system.solution;
+   const unsigned int n_rows = solution.locally_owned_size();
+   system.stage_time = 0.0;
+
+   // b = f(0)
+   solution = 0.0;
+   solution.update_ghost_values();
+   system.compute_averages();
+   system.assemble_rhs();
+   FullMatrix<double> b(n_rows, 1);
+   for(unsigned int i = 0; i < n_rows; ++i)
+      b(i, 0) = system.rhs.local_element(i);
+
+   FullMatrix<double> AV(n_rows, n_modes);
+   for(unsigned int j = 0; j < n_modes; ++j)
+   {
+      for(unsigned int i = 0; i < n_rows; ++i)
+         solution.local_element(i) = V(i, j);
+      solution.update_ghost_values();
+      system.compute_averages();
+      system.assemble_rhs();
+      for(unsigned int i = 0; i < n_rows; ++i)
+         AV(i, j) = system.rhs.local_element(i) - b(i, 0);
+   }
+
+   A_r = ROM::transpose_mult(V, AV, mpi_comm);
+   const auto Vb = ROM::transpose_mult(V, b, mpi_comm);
+   b_r.reinit(n_modes);
+   for(unsigned int i = 0; i < n_modes; ++i)
+      b_r(i) = Vb(i, 0);
+}
+
+//------------------------------------------------------------------------------
+// DEIM points from rhs snapshots and the cells needed to evaluate rhs there
+//------------------------------------------------------------------------------
+template <int dim>
+void
+ReducedModel<dim>::build_deim()
+{
+   const auto& snapshots = system.rhs_snapshots;
+   const auto& param = *system.param;
+   const auto& owned = system.dof_handler.locally_owned_dofs();
+   const unsigned int n_rows = system.solution.locally_owned_size();
+   FullMatrix<double> X(n_rows, snapshots.size());
+   for(unsigned int j = 0; j < snapshots.size(); ++j)
+      for(unsigned int i = 0; i < n_rows; ++i)
+         X(i, j) = snapshots[j](i);
+
+   FullMatrix<double> U_all;
+   std::vector<double> sigma;
+   const unsigned int max_points = (param.rom_deim_modes > 0)
+                                   ? param.rom_deim_modes
+                                   : param.rom_max_modes;
+   ROM::randomized_svd(X, max_points, 1, mpi_comm, U_all, sigma);
+   n_points = (param.rom_deim_modes > 0)
+              ? std::min<unsigned int>(param.rom_deim_modes, sigma.size())
+              : ROM::truncation_rank(sigma, param.rom_tol, max_points);
+   FullMatrix<double> U(n_rows, n_points);
+   U.fill(U_all, 0, 0, 0, 0);
+
+   FullMatrix<double> PU;
+   const auto points = ROM::deim_points(U, owned, mpi_comm, PU);
+
+   // W = V^T U (P^T U)^{-1}
+   FullMatrix<double> PU_inv(n_points);
+   PU_inv.invert(PU);
+   const auto VU = ROM::transpose_mult(V, U, mpi_comm);
+   W.reinit(n_modes, n_points);
+   VU.mmult(W, PU_inv);
+
+   // Cells containing points, and their neighbours whose solution is needed
+   std::map<types::global_dof_index, unsigned int> point_id;
+   for(unsigned int p = 0; p < points.size(); ++p)
+      if(owned.is_element(points[p]))
+         point_id[points[p]] = p;
+
+   const auto& fe = system.fe;
+   std::vector<types::global_dof_index> dof_indices(fe.dofs_per_cell);
+   std::set<Iterator> needed;
+   for(const auto& cell : system.dof_handler.active_cell_iterators())
+   if(cell->is_locally_owned())
+   {
+      cell->get_dof_indices(dof_indices);
+      std::vector<std::tuple<unsigned int,unsigned int,double>> cp;
+      for(unsigned int i = 0; i < fe.dofs_per_cell; ++i)
+      {
+         const auto it = point_id.find(dof_indices[i]);
+         if(it != point_id.end())
+            cp.emplace_back(i, it->second, system.imm(dof_indices[i]));
+      }
+      if(cp.size() > 0)
+      {
+         sampled_cells.push_back(cell);
+         cell_points.push_back(cp);
+         needed.insert(cell);
+         for(const unsigned int f : cell->face_indices())
+            if(!cell->at_boundary(f) || cell->has_periodic_neighbor(f))
+               needed.insert(cell->neighbor_or_periodic_neighbor(f));
+      }
+   }
+   needed_cells.assign(needed.begin(), needed.end());
+
+   // Rows of V at dofs of needed cells, some of which are ghosts
+   std::vector<PVector> modes(n_modes);
+   IndexSet relevant;
+   DoFTools::extract_locally_relevant_dofs(system.dof_handler, relevant);
+   for(unsigned int j = 0; j < n_modes; ++j)
+   {
+      modes[j].reinit(owned, relevant, mpi_comm);
+      for(unsigned int i = 0; i < n_rows; ++i)
+         modes[j].local_element(i) = V(i, j);
+      modes[j].update_ghost_values();
+   }
+
+   needed_dofs.clear();
+   for(const auto& cell : needed_cells)
+   {
+      cell->get_dof_indices(dof_indices);
+      needed_dofs.insert(needed_dofs.end(), dof_indices.begin(),
+                         dof_indices.end());
+   }
+   V_needed.reinit(needed_dofs.size(), n_modes);
+   for(unsigned int k = 0; k < needed_dofs.size(); ++k)
+      for(unsigned int j = 0; j < n_modes; ++j)
+         V_needed(k, j) = modes[j](needed_dofs[k]);
+
+   scratch_data = std::make_unique<typename System::Scratch>(
+      system.mapping, fe,
+      QGauss<dim>(fe.degree + 1),
+      QGauss<dim-1>(fe.degree + 1));
+   u_needed.reinit(needed_dofs.size());
+   cell_rhs.reinit(fe.dofs_per_cell);
+   f_p.reinit(n_points);
+
+   pcout << "   Number of DEIM points = " << n_points << "\n";
+   pcout << "   Sampled cells = "
+         << Utilities::MPI::sum(sampled_cells.size(), mpi_comm)
+         << ", needed cells = "
+         << Utilities::MPI::sum(needed_cells.size(), mpi_comm)
+         << " of " << system.triangulation.n_global_active_cells() << "\n";
+}
+
+//------------------------------------------------------------------------------
+// f_p = P^T f(V a) at time t, assembled only on sampled cells
+//------------------------------------------------------------------------------
+template <int dim>
+void
+ReducedModel<dim>::evaluate_sampled(const Vector<double>& a,
+                                    const double          t,
+                                    Vector<double>&       f_p)
+{
+   auto& solution = system.solution;
+   const auto& fe = system.fe;
+
+   // Solution and averages on needed cells
+   V_needed.vmult(u_needed, a);
+   for(unsigned int k = 0; k < needed_dofs.size(); ++k)
+      solution(needed_dofs[k]) = u_needed(k);
+
+   std::vector<types::global_dof_index> dof_indices(fe.dofs_per_cell);
+   for(const auto& cell : needed_cells)
+   {
+      cell->get_dof_indices(dof_indices);
+      for(unsigned int i = 0; i < nvar; ++i)
+         system.average[cell->user_index()][i]
+            = solution(dof_indices[fe.component_to_system_index(i, 0)]);
+   }
+
+   // Cell and face terms of sampled cells, in the order of mesh_loop
+   scratch_data->time = t;
+   f_p = 0.0;
+   for(unsigned int c = 0; c < sampled_cells.size(); ++c)
+   {
+      const auto& cell = sampled_cells[c];
+      copy_data.face_data.clear();
+      system.cell_worker(cell, *scratch_data, copy_data);
+      for(const unsigned int f : cell->face_indices())
+      {
+         if(cell->at_boundary(f) && !cell->has_periodic_neighbor(f))
+         {
+            system.boundary_worker(cell, f, *scratch_data, copy_data);
+         }
+         else
+         {
+            const Iterator ncell = cell->neighbor_or_periodic_neighbor(f);
+            const unsigned int nf = cell->has_periodic_neighbor(f)
+                                    ? cell->periodic_neighbor_face_no(f)
+                                    : cell->neighbor_face_no(f);
+            system.face_worker(cell, f, numbers::invalid_unsigned_int,
+                               ncell, nf, numbers::invalid_unsigned_int,
+                               *scratch_data, copy_data);
+         }
+      }
+
+      // First dofs_per_cell interface dofs belong to this cell
+      cell_rhs = copy_data.cell_rhs;
+      for(const auto& cdf : copy_data.face_data)
+         for(unsigned int i = 0; i < fe.dofs_per_cell; ++i)
+            cell_rhs(i) += cdf.cell_rhs(i);
+
+      for(const auto& [i, p, imm] : cell_points[c])
+         f_p(p) = imm * cell_rhs(i);
+   }
+   Utilities::MPI::sum(f_p, mpi_comm, f_p);
+}
+
+//------------------------------------------------------------------------------
+// Reduced rhs: da = V^T f(V a)
+//------------------------------------------------------------------------------
+template <int dim>
+void
+ReducedModel<dim>::rhs(const Vector<double>& a,
+                       const double          t,
+                       Vector<double>&       da)
+{
+   if(system.param->rom == "galerkin")
+   {
+      A_r.vmult(da, a);
+      da += b_r;
+   }
+   else
+   {
+      evaluate_sampled(a, t, f_p);
+      W.vmult(da, f_p);
+   }
+}
+
+//------------------------------------------------------------------------------
+template <int dim>
+Vector<double>
+ReducedModel<dim>::local_solution() const
+{
+   Vector<double> u(system.solution.locally_owned_size());
+   for(unsigned int i = 0; i < u.size(); ++i)
+      u(i) = system.solution.local_element(i);
+   return u;
+}
+
+//------------------------------------------------------------------------------
+// Solve reduced model from u0 with the time steps of the main run and compare
+// with the full order solution u1 at final time.
+//------------------------------------------------------------------------------
+template <int dim>
+void
+ReducedModel<dim>::solve(const Vector<double>& u0_local,
+                         const Vector<double>& u1_local,
+                         const double          full_order_time)
+{
+   // Initial condition a = V^T u0
+   const unsigned int n_rows = V.m();
+   FullMatrix<double> u0(n_rows, 1), u1(n_rows, 1);
+   for(unsigned int i = 0; i < n_rows; ++i)
+   {
+      u0(i, 0) = u0_local(i);
+      u1(i, 0) = u1_local(i);
+   }
+   const auto Vu0 = ROM::transpose_mult(V, u0, mpi_comm);
+   Vector<double> a(n_modes), a_old(n_modes), da(n_modes);
+   for(unsigned int i = 0; i < n_modes; ++i)
+      a(i) = Vu0(i, 0);
+
+   Timer online_timer(mpi_comm, true);
+   double time = 0.0;
+   for(const auto dt : system.dt_history)
+   {
+      a_old = a;
+      double stage_time = time;
+      for(unsigned int rk = 0; rk < n_rk_stages; ++rk)
+      {
+         rhs(a, stage_time, da);
+         a.add(dt, da);
+         a.sadd(b_rk[rk], a_rk[rk], a_old);
+         stage_time = a_rk[rk] * time + b_rk[rk] * (stage_time + dt);
+      }
+      time += dt;
+   }
+   online_timer.stop();
+
+   // Error of reduced solution and of projection of final snapshot
+   const auto Vu1 = ROM::transpose_mult(V, u1, mpi_comm);
+   double err = 0.0, proj_err = 0.0, norm = 0.0;
+   for(unsigned int i = 0; i < n_rows; ++i)
+   {
+      double u_rom = 0.0, u_proj = 0.0;
+      for(unsigned int j = 0; j < n_modes; ++j)
+      {
+         u_rom += V(i, j) * a(j);
+         u_proj += V(i, j) * Vu1(j, 0);
+      }
+      err += std::pow(u_rom - u1(i, 0), 2);
+      proj_err += std::pow(u_proj - u1(i, 0), 2);
+      norm += std::pow(u1(i, 0), 2);
+   }
+   err = Utilities::MPI::sum(err, mpi_comm);
+   proj_err = Utilities::MPI::sum(proj_err, mpi_comm);
+   norm = Utilities::MPI::sum(norm, mpi_comm);
+
+   const double online_time = online_timer.wall_time();
+   pcout << "   Full order time         = " << full_order_time << " s\n";
+   pcout << "   Online time             = " << online_time << " s\n";
+   pcout << "   Online speedup          = " << full_order_time / online_time << "\n";
+   pcout << "   Relative error at final time = " << std::sqrt(err / norm) << "\n";
+   pcout << "   Relative projection error    = " << std::sqrt(proj_err / norm)
+         << "\n";
+}
+
+//------------------------------------------------------------------------------
+// Build reduced model from the main run, and from the other training runs if
+// a rom parameter is given, and solve it for the main run or for each test
+// value. The first snapshot of the main run is its initial condition and the
+// last one its final solution.
+//------------------------------------------------------------------------------
+template <int dim>
+void
+ReducedModel<dim>::run(const double full_order_time)
+{
+   const auto& param = *system.param;
+   const bool sweep = !param.rom_parameter.empty();
+   const Vector<double> u0 = system.snapshots.front();
+   const Vector<double> u1 = system.snapshots.back();
+
+   pcout << "Building reduced model: " << param.rom << "\n";
+   Timer offline_timer(mpi_comm, true);
+   if(sweep)
+      for(unsigned int i = 1; i < param.rom_training_values.size(); ++i)
+      {
+         pcout << "   Training run with " << param.rom_parameter << " = "
+               << param.rom_training_values[i] << "\n";
+         system.full_order_run(param.rom_training_values[i], true);
+      }
+   build_basis();
+   if(param.rom == "deim")
+      build_deim();
+   else if(!sweep)
+      build_galerkin();
+   offline_timer.stop();
+   pcout << "   Offline time            = " << offline_timer.wall_time() << " s\n";
+
+   if(!sweep)
+   {
+      solve(u0, u1, full_order_time);
+      return;
+   }
+
+   // Reference solution by full order run, then reduced model from the same
+   // initial condition
+   for(const auto value : param.rom_test_values)
+   {
+      pcout << "Test with " << param.rom_parameter << " = " << value << "\n";
+      const double test_time = system.full_order_run(value, false);
+      const Vector<double> u1_test = local_solution();
+      system.initialize();
+      const Vector<double> u0_test = local_solution();
+      if(param.rom == "galerkin")
+      {
+         Timer timer(mpi_comm, true);
+         build_galerkin();
+         timer.stop();
+         pcout << "   Reduced operator time   = " << timer.wall_time() << " s\n";
+      }
+      solve(u0_test, u1_test, test_time);
+   }
+}
+
+#endif
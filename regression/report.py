@@ -0,0 +1,44 @@
+"""
+Collect the reports of all cases written by run_case.py into one json file
+    python3 report.py -work <dir> -output regression_report.json
+and print a summary. Exits with 1 if any case failed.
+"""
+import argparse
+import glob
+import json
+import os
+import sys
+
+here = os.path.dirname(os.path.abspath(__file__))
+
+parser = argparse.ArgumentParser()
+parser.add_argument('-work', required=True, help='Directory of case reports')
+parser.add_argument('-output', default='regression_report.json',
+                    help='Combined report')
+args = parser.parse_args()
+
+with open(os.path.join(here, 'cases.json')) as f:
+    names = list(json.load(f).keys())
+
+cases = {}
+for name in names:
+    fname = os.path.join(args.work, name + '.json')
+    if os.path.exists(fname):
+        with open(fname) as f:
+            cases[name] = json.load(f)
+    else:
+        cases[name] = {'case': name, 'status': 'not run'}
+
+bad = [n for n, c in cases.items() if c['status'] in ('failed', 'error', 'not run')]
+report = {'status': 'failed' if bad else 'passed', 'cases': cases}
+with open(args.output, 'w') as f:
+    json.dump(report, f, indent=3)
+
+print('%-20s %-10s %14s  %s' % ('case', 'status', 'time/step/dof', 'failed'))
+for name, c in cases.items():
+    t = c.get('time_per_step_dof')
+    t = '%14.6e' % t if t is not None else '%14s' % '-'
+    print('%-20s %-10s %s  %s' % (name, c['status'], t,
+                                 ', '.join(c.get('failed', []))))
+print('Report written to', os.path.abspath(args.output))
+sys.exit(1 if bad else 0)
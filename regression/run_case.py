@@ -0,0 +1,244 @@
+"""
+Build and run one regression case, check the results against reference.json
+and write a json report with the time per step per dof, which is not checked.
+Only the python standard library is used. Normally called by ctest, see
+README.md; to run by hand
+    python3 run_case.py -case sod -work /tmp/regression
+"""
+import argparse
+import fcntl
+import json
+import math
+import os
+import re
+import shutil
+import subprocess
+import sys
+import time
+
+SKIP = 77 # ctest SKIP_RETURN_CODE
+
+here = os.path.dirname(os.path.abspath(__file__))
+
+parser = argparse.ArgumentParser()
+parser.add_argument('-case', required=True, help='Case name in cases.json')
+parser.add_argument('-work', required=True, help='Directory to build and run')
+parser.add_argument('-root', default=os.path.dirname(here),
+                    help='Root of the repository')
+parser.add_argument('-deal_ii_dir', default=os.environ.get('DEAL_II_DIR', ''),
+                    help='deal.II installation')
+parser.add_argument('-mpiexec', default='mpirun', help='MPI launcher')
+parser.add_argument('-jobs', type=int, default=4, help='Parallel make jobs')
+parser.add_argument('-update', choices=('none','reference'),
+                    default='none', help='Store results as new references')
+args = parser.parse_args()
+
+with open(os.path.join(here, 'cases.json')) as f:
+    case = json.load(f)[args.case]
+
+work = os.path.join(os.path.abspath(args.work), args.case)
+src = os.path.join(work, case['source'])
+log_file = os.path.join(os.path.abspath(args.work), args.case + '.log')
+out_file = os.path.join(os.path.abspath(args.work), args.case + '.out')
+
+#-------------------------------------------------------------------------------
+def fail_setup(msg, code=1):
+    print(args.case + ': ' + msg)
+    write_report({'status': 'skipped' if code == SKIP else 'error',
+                  'message': msg})
+    sys.exit(code)
+
+def write_report(report):
+    report['case'] = args.case
+    report['description'] = case['description']
+    os.makedirs(os.path.abspath(args.work), exist_ok=True)
+    name = os.path.join(os.path.abspath(args.work), args.case + '.json')
+    with open(name, 'w') as f:
+        json.dump(report, f, indent=3)
+
+def run(cmd, cwd, out):
+    out.write('$ ' + ' '.join(cmd) + '\n'); out.flush()
+    return subprocess.call(cmd, cwd=cwd, stdout=out, stderr=subprocess.STDOUT)
+
+# Read-modify-write of a json file shared by cases running concurrently
+def update_json(name, func):
+    with open(name, 'r+') as f:
+        fcntl.flock(f, fcntl.LOCK_EX)
+        data = json.load(f)
+        func(data)
+        f.seek(0); f.truncate()
+        json.dump(data, f, indent=3)
+        f.write('\n')
+
+#-------------------------------------------------------------------------------
+# Copy sources so that the tree is not touched by the build
+#-------------------------------------------------------------------------------
+def setup():
+    shutil.rmtree(work, ignore_errors=True)
+    for path in case['copy']:
+        shutil.copytree(os.path.join(args.root, path), os.path.join(work, path),
+                        symlinks=False)
+    for dst, path in case['files'].items():
+        shutil.copy(os.path.join(src, path), os.path.join(src, dst))
+    if 'input' in case:
+        with open(os.path.join(src, case['input']), 'w') as f:
+            f.write('\n'.join(case['parameters']) + '\n')
+
+def build(out):
+    for cmd in case.get('prepare', []):
+        if shutil.which(cmd[0]) is None:
+            fail_setup(cmd[0] + ' not found', SKIP)
+        if run(cmd, src, out) != 0:
+            fail_setup('failed: ' + ' '.join(cmd))
+    cmake = ['cmake', '.', '-DCMAKE_BUILD_TYPE=Release']
+    if args.deal_ii_dir:
+        cmake.append('-DDEAL_II_DIR=' + args.deal_ii_dir)
+    if run(cmake, src, out) != 0:
+        fail_setup('cmake failed, see ' + log_file)
+    if run(['make', '-j' + str(args.jobs)], src, out) != 0:
+        fail_setup('build failed, see ' + log_file)
+
+def execute():
+    cmd = list(case['command'])
+    if case.get('mpi', 1) > 1:
+        if shutil.which(args.mpiexec) is None:
+            fail_setup(args.mpiexec + ' not found', SKIP)
+        cmd = [args.mpiexec, '-np', str(case['mpi'])] + cmd
+    with open(out_file, 'w') as out:
+        start = time.perf_counter()
+        status = run(cmd, src, out)
+        wall = time.perf_counter() - start
+    if status != 0:
+        fail_setup('run failed with status %d, see %s' % (status, out_file))
+    return wall
+
+#-------------------------------------------------------------------------------
+# Measured quantities
+#-------------------------------------------------------------------------------
+def last_match(pattern, text):
+    m = re.findall(pattern, text, re.MULTILINE)
+    if not m:
+        raise ValueError('no match for ' + pattern)
+    return m[-1]
+
+def read_table(name):
+    rows = []
+    with open(os.path.join(src, name)) as f:
+        for line in f:
+            if line.strip() and not line.startswith('#'):
+                rows.append([float(v) for v in line.split()])
+    return rows
+
+def read_csv(name):
+    with open(os.path.join(src, name)) as f:
+        lines = [l.strip() for l in f if l.strip() and not l.startswith('#')]
+    header = lines[0].split(',')
+    return header, [[float(v) for v in l.split(',')] for l in lines[1:]]
+
+def metric(m, log):
+    kind = m['type']
+    if kind == 'regex':
+        return float(last_match(m['pattern'], log))
+    if kind == 'table_value': # value in row with x nearest to given x
+        rows = read_table(m['file'])
+        row = min(rows, key=lambda r: abs(r[0] - m['x']))
+        return row[m['column']]
+    if kind == 'table_integral': # midpoint rule on uniform cells
+        rows = read_table(m['file'])
+        dx = rows[1][0] - rows[0][0]
+        return dx * sum(r[m['column']] for r in rows)
+    if kind in ('csv_last', 'csv_drift'):
+        header, rows = read_csv(m['file'])
+        c = header.index(m['column'])
+        if kind == 'csv_last':
+            return rows[-1][c]
+        return (rows[-1][c] - rows[0][c]) / abs(rows[0][c])
+    raise ValueError('Unknown metric type ' + kind)
+
+# A reference with 'case' is the value of the same metric in the report of
+# that case, which must have been run before, e.g. the same problem with
+# another solver or number of ranks
+def resolve(name, ref):
+    if 'case' not in ref:
+        return ref
+    fname = os.path.join(os.path.abspath(args.work), ref['case'] + '.json')
+    try:
+        with open(fname) as f:
+            value = json.load(f)['metrics'][name]['value']
+    except (IOError, KeyError, ValueError):
+        print(args.case + ': no result of ' + name + ' in ' + fname)
+        value = float('nan')
+    return dict(ref, value=value)
+
+def check(value, ref):
+    if not math.isfinite(value):
+        return False
+    ok = True
+    if 'value' in ref:
+        if not math.isfinite(ref['value']):
+            return False
+        tol = ref.get('atol', 0.0) + ref.get('rtol', 0.0) * abs(ref['value'])
+        ok = ok and abs(value - ref['value']) <= tol
+    if 'min' in ref: ok = ok and value >= ref['min']
+    if 'max' in ref: ok = ok and value <= ref['max']
+    return ok
+
+#-------------------------------------------------------------------------------
+os.makedirs(os.path.abspath(args.work), exist_ok=True)
+with open(log_file, 'w') as out:
+    setup()
+    build(out)
+wall = execute()
+with open(out_file) as f:
+    log = f.read()
+
+report = {'status': 'passed', 'wall_time': wall, 'metrics': {}}
+failed = []
+
+steps = int(last_match(case['steps'], log)) if case['steps'] else 1
+dofs = int(last_match(case['dofs'], log))
+report['steps'] = steps
+report['dofs'] = dofs
+
+references = json.load(open(os.path.join(here, 'reference.json')))
+references = references.get(args.case, {})
+for name, m in case['metrics'].items():
+    try:
+        value = metric(m, log)
+    except (ValueError, IOError, IndexError) as e:
+        value = float('nan')
+        print(args.case + ': cannot get ' + name + ': ' + str(e))
+    ref = resolve(name, references.get(name, {}))
+    ok = check(value, ref)
+    report['metrics'][name] = {'value': value, 'reference': ref,
+                               'passed': ok}
+    if not ok: failed.append(name)
+
+# Time per step per dof, includes setup which is small for these cases
+time_per_step_dof = wall / (steps * dofs)
+report['time_per_step_dof'] = time_per_step_dof
+
+if args.update == 'reference':
+    def set_values(d):
+        for name, m in report['metrics'].items():
+            ref = d.setdefault(args.case, {}).setdefault(name, {})
+            if 'case' in ref:
+                continue
+            ref['value'] = m['value']
+            if 'rtol' not in ref and 'atol' not in ref:
+                ref['rtol'] = 1.0e-6
+    update_json(os.path.join(here, 'reference.json'), set_values)
+
+if failed and args.update == 'none':
+    report['status'] = 'failed'
+    report['failed'] = failed
+write_report(report)
+
+#-------------------------------------------------------------------------------
+print('%s: %s, steps = %d, dofs = %d, wall time = %.3f s' %
+      (args.case, report['status'], steps, dofs, wall))
+for name, m in report['metrics'].items():
+    print('   %-16s %14.6e  %s' % (name, m['value'],
+                                   'ok' if m['passed'] else 'FAILED'))
+print('   time/step/dof    %14.6e  not checked' % time_per_step_dof)
+sys.exit(1 if report['status'] == 'failed' else 0)